@@ -0,0 +1,30 @@
+// 把 binlog_start 写入的二进制日志格式化为文本：binlog_decode <file> [output]
+#include "direct/binlog.h"
+
+int main(int argc, char **argv)
+{
+    FILE *in, *out = stdout;
+    bool ok;
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <binlog> [output]\n", argv[0]);
+        return 2;
+    }
+    if (!(in = fopen(argv[1], "rb"))) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    if (argc > 2 && !(out = fopen(argv[2], "w"))) {
+        fprintf(stderr, "cannot open %s\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+    ok = binlog_decode(in, out);
+    if (!ok) {
+        fprintf(stderr, "%s: invalid or truncated binlog\n", argv[1]);
+    }
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+// 热路径中记录日志的代价：多个线程同时调用 logtracex_，对比立即格式化输出到文件和二进制
+// 延迟日志（binlog_start），报告每条日志的时间和解码得到的行数（缓存满时丢弃的日志不在其中）；二进制日志写入 binlog.bin，
+// 可以用 config/binlog_decode 转换为文本
+#define __CURR_FILE__ STRID_TEST_DECL
+#include "internal/decl.h"
+#include "direct/binlog.h"
+
+#define NLOG 200000
+#define NTHREAD 4
+
+static void task(void *para, uint32 worker, uint32 i)
+{
+    uint32 n;
+    (void)para;
+    (void)i;
+    for (n = 0; n < NLOG; n += 1) {
+        logtracex_(builtin_error(ERROR_INVALID_PARAM), X_FILE(0), X_LINE(LOG_LEVEL_E, 2), worker, n);
+    }
+}
+
+static double run(void)
+{
+    uint64 start = thread_clock_ns();
+    thread_for(NTHREAD, NTHREAD, task, null);
+    return (double)(thread_clock_ns() - start) / NLOG / NTHREAD; // 所有线程的总时间，单核机器上也可以比较
+}
+
+int main(void)
+{
+    FILE *f;
+    double text, bin;
+    uint32 lines = 0;
+    int c;
+    if (!freopen("binlog.txt", "w", stdout)) {
+        return 1;
+    }
+    text = run();
+    fflush(stdout);
+    binlog_start("binlog.bin");
+    bin = run();
+    binlog_stop();
+    if ((f = fopen("binlog.bin", "rb")) && freopen("binlog_decoded.txt", "w", stdout)) {
+        binlog_decode(f, stdout);
+        fflush(stdout);
+        fclose(f);
+    }
+    if ((f = fopen("binlog_decoded.txt", "r"))) {
+        while ((c = fgetc(f)) != EOF) {
+            lines += (c == '\n');
+        }
+        fclose(f);
+    }
+    fprintf(stderr, "%u threads x %u logs: printf %.1f ns/log, binlog %.1f ns/log, decoded %u lines\n",
+        NTHREAD, NLOG, text, bin, lines);
+    return 0;
+}
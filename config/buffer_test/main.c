@@ -0,0 +1,85 @@
+// 缓存增长策略的对比：词法分析时字符串和注释缓存原来每次增加128字节，现在使用默认的增长
+// 策略；代码生成时一个大缓存每次追加几个字节。报告重新分配次数、地址改变（内容被拷贝）的
+// 次数和每字节的时间
+#include "builtin/decl.h"
+#include <time.h>
+
+#define NSTR 100000     // 字符串字面量和注释的个数
+#define CODE_SIZE (64 * 1024 * 1024)
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+typedef struct {
+    uint32 realloc;
+    uint32 moved;
+    double ns;
+} stat_t;
+
+static void count(buffer_t *b, uint96 cap, byte *a, stat_t *s)
+{
+    if (b->cap != cap) {
+        s->realloc += 1;
+        s->moved += (a && b->a != a);
+    }
+}
+
+static stat_t bench_lex(int96 expand) // 长度从几个字节到几千字节，分段压入
+{
+    stat_t s = {0};
+    uint64 start = now_ns();
+    buffer_t b;
+    byte piece[64] = {0};
+    uint32 i, n, len;
+    uint96 cap;
+    byte *a;
+    for (i = 0; i < NSTR; i += 1) {
+        memset(&b, 0, sizeof(buffer_t));
+        len = (i * 2654435761u) % ((i & 15) ? 96 : 8192);
+        for (n = 0; n < len; n += 16) {
+            cap = b.cap;
+            a = b.a;
+            buffer_push(&b, piece, 16, expand);
+            count(&b, cap, a, &s);
+        }
+        buffer_free(&b);
+    }
+    s.ns = (double)(now_ns() - start) / NSTR;
+    return s;
+}
+
+static stat_t bench_code(int96 expand)
+{
+    stat_t s = {0};
+    uint64 start = now_ns();
+    buffer_t b = {0};
+    byte insn[7] = {0x48, 0x8b, 0x44, 0x24, 0x08, 0x90, 0x90};
+    uint32 i;
+    uint96 cap;
+    byte *a;
+    for (i = 0; i < CODE_SIZE / 7; i += 1) {
+        cap = b.cap;
+        a = b.a;
+        buffer_push(&b, insn, 3 + (i & 3), expand);
+        count(&b, cap, a, &s);
+    }
+    s.ns = (double)(now_ns() - start) / b.len;
+    buffer_free(&b);
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    stat_t a = bench_lex(128), b = bench_lex(0), c, d;
+    printf("lexer buffers   expand 128: %8u reallocs %8u moved %8.1f ns/string\n", a.realloc, a.moved, a.ns);
+    printf("lexer buffers   default:    %8u reallocs %8u moved %8.1f ns/string\n", b.realloc, b.moved, b.ns);
+    c = bench_code(4096);
+    d = bench_code(0);
+    printf("64 MiB code     expand 4K:  %8u reallocs %8u moved %8.3f ns/byte\n", c.realloc, c.moved, c.ns);
+    printf("64 MiB code     default:    %8u reallocs %8u moved %8.3f ns/byte\n", d.realloc, d.moved, d.ns);
+    return 0;
+}
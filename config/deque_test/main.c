@@ -0,0 +1,105 @@
+// 先进先出工作队列的对比：array_ex_push 压入、删除第一个元素时 memmove 剩余的元素，与分块
+// 双端队列的 deque_push_back/deque_pop_front。队列中保持 DEPTH 个元素，每轮压入一个、弹出
+// 一个，报告每次操作的时间；最后用 deque_append 批量追加、deque_run 逐段遍历
+#include "builtin/deque.h"
+#include <time.h>
+
+#define NOPS 200000
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+typedef struct {
+    uint32 id;
+    uint32 line;
+    uint64 data;
+} item_t;
+
+static uint64 bench_array(uint32 depth, uint64 *sum)
+{
+    array2_ex_t a;
+    array_ex_t *p;
+    item_t it = {0}, *e;
+    uint64 start = now_ns();
+    uint32 i;
+    array_ex_init(&a, sizeof(item_t), depth);
+    for (i = 0; i < depth + NOPS; i += 1) {
+        it.id = i;
+        array_ex_push(&a, (const byte *)&it, 0);
+        if (i < depth) {
+            continue;
+        }
+        p = a.a;
+        e = (item_t *)(p + 1);
+        *sum += e->id;
+        memmove(e, e + 1, (p->len - 1) * sizeof(item_t)); // 删除第一个元素
+        p->len -= 1;
+    }
+    array_free((array2_t *)&a);
+    return now_ns() - start;
+}
+
+static uint64 bench_deque(uint32 depth, uint64 *sum)
+{
+    deque_t d;
+    item_t it = {0};
+    uint64 start = now_ns();
+    uint32 i;
+    deque_init(&d, sizeof(item_t));
+    for (i = 0; i < depth + NOPS; i += 1) {
+        it.id = i;
+        deque_push_back(&d, &it);
+        if (i < depth) {
+            continue;
+        }
+        *sum += ((item_t *)deque_front(&d))->id;
+        deque_pop_front(&d, null);
+    }
+    deque_free(&d);
+    return now_ns() - start;
+}
+
+static void bench_bulk(void)
+{
+    static item_t a[1 << 16];
+    deque_t d;
+    uint64 start, sum = 0;
+    uint96 i, j, n;
+    item_t *p;
+    for (i = 0; i < (1 << 16); i += 1) {
+        a[i].id = (uint32)i;
+    }
+    deque_init(&d, sizeof(item_t));
+    start = now_ns();
+    for (i = 0; i < 64; i += 1) {
+        deque_append(&d, a, 1 << 16);
+    }
+    for (i = 0; (p = (item_t *)deque_run(&d, i, &n)); i += n) {
+        for (j = 0; j < n; j += 1) {
+            sum += p[j].id;
+        }
+    }
+    printf("bulk append+run %llu items: %.2f ns/item (sum %llu)\n", (unsigned long long)d.len,
+        (double)(now_ns() - start) / d.len, (unsigned long long)sum);
+    deque_free(&d);
+}
+
+int main(void)
+{
+    uint32 depth[] = {16, 256, 4096, 65536};
+    uint64 sa, sd, ta, td;
+    uint32 i;
+    for (i = 0; i < sizeof(depth) / sizeof(depth[0]); i += 1) {
+        sa = sd = 0;
+        ta = bench_array(depth[i], &sa);
+        td = bench_deque(depth[i], &sd);
+        printf("depth %6u: array+memmove %8.2f ns/op, deque %6.2f ns/op%s\n", depth[i],
+            (double)ta / NOPS, (double)td / NOPS, (sa == sd) ? "" : " MISMATCH");
+    }
+    bench_bulk();
+    return 0;
+}
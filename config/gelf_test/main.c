@@ -0,0 +1,96 @@
+// 加载时动态符号查找的性能对比：.hash 与 .gnu.hash 分别查找存在的符号和不存在的符号；
+// 参数是符号名称文件（每行一个名称，例如 nm -j 的输出）时，报告字符串表合并后缀节省的大小
+#include "chcc/gelf.h"
+#include <time.h>
+
+#define NSYM 20000
+#define ROUND 20
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+static byte *symname(const char *prefix, uint32 i)
+{
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), "%s_%u_%x", prefix, i, i * 2654435761u);
+    byte *s = (byte *)malloc(n + 1);
+    memcpy(s, buf, n + 1);
+    return s;
+}
+
+static double bench(const uint32 *tab, bool gnu, const byte *const *names, byte **keys, uint32 nkey, uint32 *found)
+{
+    uint64 start = now_ns();
+    uint32 r, i, n = 0;
+    for (r = 0; r < ROUND; r += 1) {
+        for (i = 0; i < nkey; i += 1) {
+            n += (gnu ? elf_gnu_hash_lookup(tab, true, names, keys[i]) : elf_hash_lookup(tab, names, keys[i])) != ELF_SYMNDX_UNDEF;
+        }
+    }
+    *found = n / ROUND;
+    return (double)(now_ns() - start) / ((double)ROUND * nkey);
+}
+
+static int strtab_report(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    elf_strtab_t t;
+    buffer_t out = {0};
+    char line[1024], *a;
+    uint32 len, count = 0;
+    if (!fp || !elf_strtab_init(&t)) {
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        len = (uint32)strcspn(line, "\r\n");
+        if (!len || !(a = (char *)malloc(len))) {
+            continue;
+        }
+        memcpy(a, line, len);
+        elf_strtab_intern(&t, (byte *)a, len);
+        count += 1;
+    }
+    fclose(fp);
+    elf_strtab_build(&t, &out);
+    printf("names %u, unique %u, .strtab %u -> %u bytes (saved %.1f%%)\n", count, (uint32)(t.strs.len / sizeof(elfstr_t)) - 1,
+        t.rawsize, t.size, 100.0 * (t.rawsize - t.size) / t.rawsize);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    byte **names = (byte **)malloc(NSYM * sizeof(byte *));
+    byte **sorted = (byte **)malloc(NSYM * sizeof(byte *));
+    byte **miss = (byte **)malloc(NSYM * sizeof(byte *));
+    uint32 *order = (uint32 *)malloc(NSYM * sizeof(uint32));
+    uint32 *ht, *gh, i, found;
+    uintd_t ht_size, gh_size;
+    if (argc > 1) {
+        return strtab_report(argv[1]);
+    }
+    names[0] = sorted[0] = (byte *)"";
+    for (i = 1; i < NSYM; i += 1) {
+        names[i] = symname("sym", i);
+        miss[i] = symname("nos", i);
+    }
+    miss[0] = (byte *)"nos";
+    ht = elf_hash_build((const byte *const *)names, NSYM, &ht_size);
+    gh = elf_gnu_hash_build((const byte *const *)names, NSYM, 1, true, order, &gh_size);
+    for (i = 1; i < NSYM; i += 1) { // 动态符号表按 .gnu.hash 的要求排序
+        sorted[i] = names[order[i]];
+    }
+    printf("symbols %u, .hash %u bytes, .gnu.hash %u bytes\n", NSYM - 1, (uint32)ht_size, (uint32)gh_size);
+    printf(".hash     hit  %6.1f ns", bench(ht, false, (const byte *const *)names, names + 1, NSYM - 1, &found));
+    printf(" (found %u)\n", found);
+    printf(".hash     miss %6.1f ns", bench(ht, false, (const byte *const *)names, miss, NSYM, &found));
+    printf(" (found %u)\n", found);
+    printf(".gnu.hash hit  %6.1f ns", bench(gh, true, (const byte *const *)sorted, sorted + 1, NSYM - 1, &found));
+    printf(" (found %u)\n", found);
+    printf(".gnu.hash miss %6.1f ns", bench(gh, true, (const byte *const *)sorted, miss, NSYM, &found));
+    printf(" (found %u)\n", found);
+    return 0;
+}
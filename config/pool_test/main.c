@@ -0,0 +1,59 @@
+// 链表和栈节点的压入弹出性能对比：堆分配、按大小类别的节点池、按缓存行对齐的节点池，
+// 报告每秒完成的压入弹出次数
+#include "builtin/pool.h"
+#include <time.h>
+
+#define ROUND 20000
+#define DEPTH 64    // 每一轮压入的节点个数，模拟作用域和文件栈的嵌套深度
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+static double bench_stack(pool_t *p)
+{
+    uint64 start = now_ns();
+    stack_t s = {0};
+    uint32 k, i;
+    for (k = 0; k < ROUND; k += 1) {
+        for (i = 0; i < DEPTH; i += 1) {
+            *(uint32 *)stack_push_p(&s, 24 + (i & 7) * 8, p) = i;
+        }
+        while (stack_pop_p(&s, null, p)) {}
+    }
+    return (double)ROUND * DEPTH * 1e9 / (double)(now_ns() - start);
+}
+
+static double bench_slist(pool_t *p)
+{
+    uint64 start = now_ns();
+    slist_t l = {0};
+    uint32 k, i;
+    for (k = 0; k < ROUND; k += 1) {
+        for (i = 0; i < DEPTH; i += 1) { // 先进先出，节点释放的顺序与分配顺序相同
+            *(uint32 *)slist_push_back_p(&l, 48, p) = i;
+            if (i & 1) {
+                slist_pop_front_p(&l, null, p);
+            }
+        }
+        slist_free_p(&l, null, p);
+    }
+    return (double)ROUND * DEPTH * 1e9 / (double)(now_ns() - start);
+}
+
+int main(int argc, char **argv)
+{
+    pool_t p, c;
+    pool_init(&p, 0);
+    pool_init(&c, POOL_CACHE_LINE);
+    printf("stack push/pop  heap %7.2f  pool %7.2f  cache-line pool %7.2f Mops/s\n",
+        bench_stack(null) / 1e6, bench_stack(&p) / 1e6, bench_stack(&c) / 1e6);
+    printf("slist push/pop  heap %7.2f  pool %7.2f  cache-line pool %7.2f Mops/s\n",
+        bench_slist(null) / 1e6, bench_slist(&p) / 1e6, bench_slist(&c) / 1e6);
+    pool_free(&p);
+    pool_free(&c);
+    return 0;
+}
@@ -0,0 +1,114 @@
+// 多生产者多消费者队列的竞争测试：生产者和消费者各 1 到 N 个（参数指定 N，默认是处理器
+// 个数，最多8个），比较有界无锁队列 mpmc_t 和无界链式队列 lqueue_t 的吞吐量，以及元素从入
+// 队到出队的延迟分布
+#include "direct/queue.h"
+
+#define NITEM (1 << 20)     // 每一轮传递的元素总数
+#define QUEUE_CAP 1024
+#define SAMPLE 16           // 每隔 SAMPLE 个元素记录一次延迟
+#define SPIN 64             // 连续失败 SPIN 次之后让出处理器
+
+typedef struct {
+    mpmc_t *q;
+    lqueue_t *l;
+    uint32 nitem;           // 生产者入队或消费者出队的个数
+    uint64 *lat;
+    uint32 nlat;
+} worker_t;
+
+static void backoff(uint32 *spin)
+{
+    if (++*spin >= SPIN) {
+        thread_sleep(0);
+        *spin = 0;
+    } else {
+        atom_pause();
+    }
+}
+
+static void producer(void *para)
+{
+    worker_t *w = (worker_t *)para;
+    uint64 t;
+    uint32 i, spin = 0;
+    for (i = 0; i < w->nitem; i += 1) {
+        t = thread_clock_ns();
+        while (w->q ? !mpmc_push(w->q, &t) : !lqueue_push(w->l, &t)) {
+            backoff(&spin);
+        }
+    }
+}
+
+static void consumer(void *para)
+{
+    worker_t *w = (worker_t *)para;
+    uint64 t;
+    uint32 i, spin = 0;
+    for (i = 0; i < w->nitem; i += 1) {
+        while (w->q ? !mpmc_pop(w->q, &t) : !lqueue_pop(w->l, &t)) {
+            backoff(&spin);
+        }
+        if (i % SAMPLE == 0) {
+            w->lat[w->nlat++] = thread_clock_ns() - t;
+        }
+    }
+}
+
+static int latcmp(const void *a, const void *b)
+{
+    uint64 x = *(const uint64 *)a, y = *(const uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char *name, mpmc_t *q, lqueue_t *l, uint32 np, uint32 nc)
+{
+    worker_t w[16];
+    thread_t t[16];
+    uint64 *lat = (uint64 *)malloc((NITEM / SAMPLE + nc) * sizeof(uint64)), start, ns;
+    uint32 i, nlat = 0;
+    memset(w, 0, sizeof(w));
+    start = thread_clock_ns();
+    for (i = 0; i < np + nc; i += 1) {
+        w[i].q = q;
+        w[i].l = l;
+        if (i < np) {
+            w[i].nitem = NITEM / np + (i < NITEM % np);
+        } else {
+            w[i].nitem = NITEM / nc + (i - np < NITEM % nc);
+            w[i].lat = lat + nlat;
+            nlat += w[i].nitem / SAMPLE + 1;
+        }
+        thread_create(t + i, i < np ? producer : consumer, w + i);
+    }
+    for (i = 0; i < np + nc; i += 1) {
+        thread_join(t + i);
+    }
+    ns = thread_clock_ns() - start;
+    for (nlat = 0, i = np; i < np + nc; i += 1) { // 合并各个消费者的延迟样本
+        memmove(lat + nlat, w[i].lat, w[i].nlat * sizeof(uint64));
+        nlat += w[i].nlat;
+    }
+    qsort(lat, nlat, sizeof(uint64), latcmp);
+    printf("%-7s %2up %2uc %8.2f Mops/s  p50 %8.0f ns  p99 %9.0f ns  p99.9 %9.0f ns\n", name, np, nc,
+        (double)NITEM * 1e3 / (double)ns, (double)lat[nlat / 2], (double)lat[nlat * 99 / 100], (double)lat[nlat * 999 / 1000]);
+    free(lat);
+}
+
+int main(int argc, char **argv)
+{
+    uint32 n = argc > 1 ? (uint32)atoi(argv[1]) : thread_cpu_count(), p, c;
+    mpmc_t q;
+    lqueue_t l;
+    n = n < 1 ? 1 : (n > 8 ? 8 : n);
+    for (p = 1; p <= n; p *= 2) {
+        for (c = 1; c <= n; c *= 2) {
+            mpmc_init(&q, QUEUE_CAP, sizeof(uint64));
+            run("mpmc", &q, null, p, c);
+            mpmc_free(&q);
+            lqueue_init(&l, sizeof(uint64));
+            run("lqueue", null, &l, p, c);
+            lqueue_free(&l);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+// 类似 readelf 的 ELF64 文件查看工具，使用 chcc/gread.h 的映射读取，不拷贝文件内容：
+// readelf [-h] [-S] [-s] [-r] [-n] [-d] [-a] [-t] file
+// -t 只报告打开文件并遍历所有分区、符号、重定位、说明和动态条目的耗时
+#include "chcc/gread.h"
+#include <time.h>
+
+#define SHOW_HEADER 0x01
+#define SHOW_SECTIONS 0x02
+#define SHOW_SYMBOLS 0x04
+#define SHOW_RELOCS 0x08
+#define SHOW_NOTES 0x10
+#define SHOW_DYNAMIC 0x20
+#define SHOW_ALL 0x3f
+#define SHOW_TIME 0x40
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+static const char *sectype(uint32 type)
+{
+    static char buf[16];
+    switch (type) {
+    case ELF_SEC_NULL: return "NULL";
+    case ELF_SEC_PROGBITS: return "PROGBITS";
+    case ELF_SEC_SYMTAB: return "SYMTAB";
+    case ELF_SEC_STRTAB: return "STRTAB";
+    case ELF_SEC_RELA: return "RELA";
+    case ELF_SEC_HASH: return "HASH";
+    case ELF_SEC_DYNAMIC: return "DYNAMIC";
+    case ELF_SEC_NOTE: return "NOTE";
+    case ELF_SEC_NOBITS: return "NOBITS";
+    case ELF_SEC_REL: return "REL";
+    case ELF_SEC_DYNSYM: return "DYNSYM";
+    case ELF_SEC_INIT_ARRAY: return "INIT_ARRAY";
+    case ELF_SEC_FINI_ARRAY: return "FINI_ARRAY";
+    case ELF_SEC_PREINIT_ARRAY: return "PREINIT_ARRAY";
+    case ELF_SEC_GROUP: return "GROUP";
+    case ELF_SEC_SYMTAB_SHNDX: return "SYMTAB_SHNDX";
+    case ELF_SEC_GNU_HASH: return "GNU_HASH";
+    default: break;
+    }
+    snprintf(buf, sizeof(buf), "0x%x", type);
+    return buf;
+}
+
+static const char *secflags(uint64 flags)
+{
+    static const char chars[] = "WAX?MSILOGTC";
+    static char buf[16];
+    uint32 i, n = 0;
+    for (i = 0; i < sizeof(chars) - 1; i += 1) {
+        if ((flags & ((uint64)1 << i)) && chars[i] != '?') {
+            buf[n++] = chars[i];
+        }
+    }
+    buf[n] = 0;
+    return buf;
+}
+
+static void show_header(elfmap_t *m)
+{
+    const Elf64Ehdr *e = m->ehdr;
+    printf("ELF Header:\n");
+    printf("  Type:                    %u\n", le_16_to_host(e->type));
+    printf("  Machine:                 %u\n", le_16_to_host(e->machine));
+    printf("  Entry point address:     0x%llx\n", (unsigned long long)le_64_to_host(e->entry));
+    printf("  Start of program headers: %llu\n", (unsigned long long)le_64_to_host(e->phoff));
+    printf("  Start of section headers: %llu\n", (unsigned long long)le_64_to_host(e->shoff));
+    printf("  Number of program headers: %u\n", le_16_to_host(e->phnum));
+    printf("  Number of section headers: %u\n", m->shnum);
+    printf("  File size:               %llu\n", (unsigned long long)m->len);
+}
+
+static void show_sections(elfmap_t *m)
+{
+    const Elf64Shdr *sh;
+    uint32 i;
+    printf("Section Headers:\n");
+    printf("  [Nr] %-20s %-12s %-16s %-8s %-8s %-3s %2s %3s %s\n", "Name", "Type", "Address", "Off", "Size", "Flg", "Lk", "Inf", "Al");
+    for (i = 0; (sh = elfmap_section(m, i)); i += 1) {
+        printf("  [%2u] %-20s %-12s %016llx %08llx %08llx %-3s %2u %3u %llu\n", i, elfmap_secname(m, sh),
+            sectype(le_32_to_host(sh->type)), (unsigned long long)le_64_to_host(sh->addr),
+            (unsigned long long)le_64_to_host(sh->offset), (unsigned long long)le_64_to_host(sh->size),
+            secflags(le_64_to_host(sh->flags)), le_32_to_host(sh->link), le_32_to_host(sh->info),
+            (unsigned long long)le_64_to_host(sh->addralign));
+    }
+}
+
+static void show_symbols(elfmap_t *m)
+{
+    static const char *types[] = {"NOTYPE", "OBJECT", "FUNC", "SECTION", "FILE", "COMMON", "TLS"};
+    static const char *binds[] = {"LOCAL", "GLOBAL", "WEAK"};
+    const Elf64Shdr *sh;
+    const Elf64Sym *sym;
+    elfsymit_t it;
+    uint32 i, n;
+    for (i = 0; (sh = elfmap_section(m, i)); i += 1) {
+        if (le_32_to_host(sh->type) != ELF_SEC_SYMTAB && le_32_to_host(sh->type) != ELF_SEC_DYNSYM) {
+            continue;
+        }
+        if (!elfsym_init(&it, m, sh)) {
+            printf("Symbol table '%s' is invalid\n", elfmap_secname(m, sh));
+            continue;
+        }
+        printf("Symbol table '%s' contains %u entries:\n", elfmap_secname(m, sh), it.n);
+        printf("   Num: %-16s %5s %-7s %-6s %5s Name\n", "Value", "Size", "Type", "Bind", "Ndx");
+        for (n = 0; (sym = elfsym_next(&it)); n += 1) {
+            printf("%6u: %016llx %5llu %-7s %-6s %5u %s\n", n, (unsigned long long)le_64_to_host(sym->value),
+                (unsigned long long)le_64_to_host(sym->size),
+                ELF_SYM_TYPE(sym->info) <= ELF_SYM_TYPE_TLS ? types[ELF_SYM_TYPE(sym->info)] : "?",
+                ELF_SYM_BIND(sym->info) <= ELF_SYM_BIND_WEAK ? binds[ELF_SYM_BIND(sym->info)] : "?",
+                le_16_to_host(sym->shndx), elfsym_name(&it, sym));
+        }
+    }
+}
+
+static const char *symname(elfmap_t *m, elfsymit_t *it, const Elf64Sym *sym) // 分区符号显示分区名称
+{
+    const Elf64Shdr *sh;
+    if (ELF_SYM_TYPE(sym->info) == ELF_SYM_TYPE_SECTION) {
+        return (sh = elfmap_section(m, le_16_to_host(sym->shndx))) ? elfmap_secname(m, sh) : "";
+    }
+    return elfsym_name(it, sym);
+}
+
+static void show_relocs(elfmap_t *m)
+{
+    const Elf64Shdr *sh, *symsh;
+    const Elf64Rela *r;
+    const Elf64Sym *sym;
+    elfrelait_t it;
+    elfsymit_t syms;
+    uint64 info;
+    uint32 i;
+    bool hassym;
+    for (i = 0; (sh = elfmap_section(m, i)); i += 1) {
+        if (le_32_to_host(sh->type) != ELF_SEC_RELA) {
+            continue;
+        }
+        if (!elfrela_init(&it, m, sh)) {
+            printf("Relocation section '%s' is invalid\n", elfmap_secname(m, sh));
+            continue;
+        }
+        symsh = elfmap_section(m, le_32_to_host(sh->link));
+        hassym = symsh && elfsym_init(&syms, m, symsh);
+        printf("Relocation section '%s' contains %u entries:\n", elfmap_secname(m, sh), it.n);
+        printf("  %-12s %-8s %-8s %-16s %s\n", "Offset", "Type", "Sym", "Addend", "Name");
+        while ((r = elfrela_next(&it))) {
+            info = le_64_to_host(r->info);
+            sym = (hassym && ELF_REL_SYM_64(info) < syms.n) ? syms.sym + ELF_REL_SYM_64(info) : null;
+            printf("  %012llx %-8u %-8u %16lld %s\n", (unsigned long long)le_64_to_host(r->offset),
+                (uint32)ELF_REL_TYPE_64(info), (uint32)ELF_REL_SYM_64(info), (long long)le_64_to_host((uint64)r->addend),
+                sym ? symname(m, &syms, sym) : "");
+        }
+    }
+}
+
+static void show_note_entries(elfnoteit_t *it)
+{
+    elfnote_t n;
+    uint32 k;
+    printf("  %-20s %-10s %s\n", "Owner", "Data size", "Type / Description");
+    while (elfnote_next(it, &n)) {
+        printf("  %-20s 0x%08x 0x%08x ", n.name, n.descsz, n.type);
+        for (k = 0; k < n.descsz && k < 32; k += 1) {
+            printf("%02x", n.desc[k]);
+        }
+        printf("\n");
+    }
+}
+
+static void show_notes(elfmap_t *m)
+{
+    const Elf64Shdr *sh;
+    const Elf64Phdr *ph;
+    elfnoteit_t it;
+    uint32 i;
+    for (i = 0; (sh = elfmap_section(m, i)); i += 1) {
+        if (le_32_to_host(sh->type) == ELF_SEC_NOTE && elfnote_init(&it, m, sh)) {
+            printf("Displaying notes found in: %s\n", elfmap_secname(m, sh));
+            show_note_entries(&it);
+        }
+    }
+    if (m->shnum) {
+        return;
+    }
+    for (i = 0; (ph = elfmap_segment(m, i)); i += 1) { // 没有分区头部时从说明分段读取
+        if (elfnote_init_seg(&it, m, ph)) {
+            printf("Displaying notes found at file offset 0x%08llx with length 0x%08llx:\n",
+                (unsigned long long)le_64_to_host(ph->offset), (unsigned long long)le_64_to_host(ph->filesz));
+            show_note_entries(&it);
+        }
+    }
+}
+
+static void show_dynamic(elfmap_t *m)
+{
+    const Elf64Shdr *sh;
+    const Elf64Dyn *d;
+    const char *s;
+    elfdynit_t it;
+    uint64 tag;
+    uint32 i;
+    for (i = 0; (sh = elfmap_section(m, i)); i += 1) {
+        if (le_32_to_host(sh->type) != ELF_SEC_DYNAMIC || !elfdyn_init(&it, m, sh)) {
+            continue;
+        }
+        printf("Dynamic section '%s':\n", elfmap_secname(m, sh));
+        printf("  %-18s %s\n", "Tag", "Value");
+        while ((d = elfdyn_next(&it))) {
+            tag = le_64_to_host((uint64)d->tag);
+            s = null;
+            if (tag == ELF_DT_NEEDED || tag == ELF_DT_SONAME || tag == ELF_DT_RPATH || tag == ELF_DT_RUNPATH) {
+                s = elfmap_string(m, le_32_to_host(sh->link), le_64_to_host(d->val));
+            }
+            printf("  0x%016llx 0x%llx %s\n", (unsigned long long)tag, (unsigned long long)le_64_to_host(d->val), s ? s : "");
+        }
+    }
+}
+
+static uint64 walk_sum; // 使用遍历的内容防止遍历被优化掉
+
+static uint64 walk_all(elfmap_t *m) // 遍历所有条目，返回条目数
+{
+    const Elf64Shdr *sh;
+    elfsymit_t syms;
+    elfrelait_t relas;
+    elfnoteit_t notes;
+    elfdynit_t dyns;
+    elfnote_t n;
+    uint64 count = 0, sum = 0;
+    uint32 i, type;
+    const Elf64Sym *sym;
+    const Elf64Rela *r;
+    for (i = 0; (sh = elfmap_section(m, i)); i += 1, count += 1) {
+        type = le_32_to_host(sh->type);
+        if ((type == ELF_SEC_SYMTAB || type == ELF_SEC_DYNSYM) && elfsym_init(&syms, m, sh)) {
+            for (; (sym = elfsym_next(&syms)); count += 1) {
+                sum += (byte)elfsym_name(&syms, sym)[0];
+            }
+        } else if (type == ELF_SEC_RELA && elfrela_init(&relas, m, sh)) {
+            for (; (r = elfrela_next(&relas)); count += 1) {
+                sum += le_64_to_host(r->info);
+            }
+        } else if (type == ELF_SEC_NOTE && elfnote_init(&notes, m, sh)) {
+            for (; elfnote_next(&notes, &n); count += 1) {
+                sum += n.type;
+            }
+        } else if (type == ELF_SEC_DYNAMIC && elfdyn_init(&dyns, m, sh)) {
+            for (; elfdyn_next(&dyns); count += 1) {}
+        }
+    }
+    walk_sum = sum;
+    return count;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filename = null;
+    uint32 show = 0, i;
+    uint64 start, open_ns, count;
+    elfmap_t m;
+    for (i = 1; i < (uint32)argc; i += 1) {
+        if (argv[i][0] != '-') {
+            filename = argv[i];
+        } else if (strcmp(argv[i], "-h") == 0) {
+            show |= SHOW_HEADER;
+        } else if (strcmp(argv[i], "-S") == 0) {
+            show |= SHOW_SECTIONS;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            show |= SHOW_SYMBOLS;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            show |= SHOW_RELOCS;
+        } else if (strcmp(argv[i], "-n") == 0) {
+            show |= SHOW_NOTES;
+        } else if (strcmp(argv[i], "-d") == 0) {
+            show |= SHOW_DYNAMIC;
+        } else if (strcmp(argv[i], "-a") == 0) {
+            show |= SHOW_ALL;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            show |= SHOW_TIME;
+        }
+    }
+    if (!filename) {
+        printf("usage: readelf [-h] [-S] [-s] [-r] [-n] [-d] [-a] [-t] file\n");
+        return 1;
+    }
+    start = now_ns();
+    if (!elfmap_open(&m, filename)) {
+        printf("%s: not a valid ELF64 little-endian file\n", filename);
+        return 1;
+    }
+    open_ns = now_ns() - start;
+    if (show & SHOW_TIME) {
+        start = now_ns();
+        count = walk_all(&m);
+        printf("%s: %llu bytes, open %.3f ms, walk %llu entries %.3f ms\n", filename, (unsigned long long)m.len,
+            open_ns / 1e6, (unsigned long long)count, (now_ns() - start) / 1e6);
+    }
+    if (!(show & SHOW_ALL) && !(show & SHOW_TIME)) {
+        show = SHOW_HEADER | SHOW_SECTIONS;
+    }
+    if (show & SHOW_HEADER) {
+        show_header(&m);
+    }
+    if (show & SHOW_SECTIONS) {
+        show_sections(&m);
+    }
+    if (show & SHOW_SYMBOLS) {
+        show_symbols(&m);
+    }
+    if (show & SHOW_RELOCS) {
+        show_relocs(&m);
+    }
+    if (show & SHOW_NOTES) {
+        show_notes(&m);
+    }
+    if (show & SHOW_DYNAMIC) {
+        show_dynamic(&m);
+    }
+    elfmap_close(&m);
+    return 0;
+}
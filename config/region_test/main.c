@@ -0,0 +1,105 @@
+// 区域分配与堆分配的性能对比：按编译器生成函数体时的模式使用栈节点、临时缓存和哈希表，
+// 区域版本在每一轮结束时回退到开始时的记录，堆版本逐个释放
+#include "builtin/region.h"
+#include <time.h>
+
+#define ROUND 2000
+#define NFUNC 64    // 每一轮模拟的函数体个数
+#define NEXPR 256   // 每个函数体压入值栈的节点个数
+#define NBUF 64     // 每一轮使用的临时缓存个数
+#define NKEY 1024   // 每一轮插入哈希表的键个数
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+static bool keyeq(const void *obj, const void *para)
+{
+    return *(const uint32 *)obj == *(const uint32 *)para;
+}
+
+static double bench_stack(region_t *r)
+{
+    uint64 start = now_ns();
+    stack_t s = {0};
+    region_mark_t m;
+    uint32 k, f, i;
+    for (k = 0; k < ROUND; k += 1) {
+        for (f = 0; f < NFUNC; f += 1) {
+            m = r ? region_mark(r) : (region_mark_t){0};
+            for (i = 0; i < NEXPR; i += 1) { // 表达式求值时压入和弹出交替进行
+                stack_push_r(&s, 48 + (i & 3) * 8, r);
+                if (i & 1) {
+                    stack_pop_r(&s, null, r);
+                }
+            }
+            while (stack_pop_r(&s, null, r)) {}
+            if (r) {
+                region_rollback(r, m);
+            }
+        }
+    }
+    return (double)(now_ns() - start) / ((double)ROUND * NFUNC * NEXPR);
+}
+
+static double bench_buffer(region_t *r)
+{
+    uint64 start = now_ns();
+    buffer_t b[NBUF];
+    region_mark_t m;
+    uint32 k, i, j;
+    for (k = 0; k < ROUND; k += 1) {
+        memset(b, 0, sizeof(b));
+        m = r ? region_mark(r) : (region_mark_t){0};
+        for (i = 0; i < NBUF; i += 1) {
+            for (j = 0; j < 64 + i * 4; j += 1) {
+                buffer_put_r(b + i, (byte)j, 0, r);
+            }
+        }
+        if (r) {
+            region_rollback(r, m);
+        } else {
+            for (i = 0; i < NBUF; i += 1) {
+                buffer_free(b + i);
+            }
+        }
+    }
+    return (double)(now_ns() - start) / ((double)ROUND * NBUF);
+}
+
+static double bench_bhash(region_t *r)
+{
+    uint64 start = now_ns();
+    bhash2_t h;
+    region_mark_t m;
+    uint32 k, i, key;
+    bool exist;
+    for (k = 0; k < ROUND / 4; k += 1) {
+        m = r ? region_mark(r) : (region_mark_t){0};
+        bhash_init_r(&h, NKEY / 4, r);
+        for (i = 0; i < NKEY; i += 1) {
+            key = i * 2654435761u;
+            *(uint32 *)bhash_push_r(h.a, key >> 7, keyeq, &key, sizeof(uint32), &exist, r) = key;
+        }
+        if (r) {
+            region_rollback(r, m);
+        } else {
+            bhash_free(&h, null);
+        }
+    }
+    return (double)(now_ns() - start) / ((double)(ROUND / 4) * NKEY);
+}
+
+int main(int argc, char **argv)
+{
+    region_t r;
+    region_init(&r, 0);
+    printf("stack node   heap %6.2f ns  region %6.2f ns\n", bench_stack(null), bench_stack(&r));
+    printf("buffer       heap %6.2f ns  region %6.2f ns\n", bench_buffer(null), bench_buffer(&r));
+    printf("bhash insert heap %6.2f ns  region %6.2f ns\n", bench_bhash(null), bench_bhash(&r));
+    region_free(&r);
+    return 0;
+}
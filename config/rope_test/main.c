@@ -0,0 +1,87 @@
+// 常驻内存的源文件的增量编辑：在一个几兆字节的源文件中随机位置插入和删除几个字节，对比
+// 平坦的缓存（memmove）和绳索；每次编辑之后取一个快照、从编辑位置所在的行开始读取一段，
+// 模拟编译服务重新做词法分析
+#include "builtin/rope.h"
+#include <time.h>
+
+#define SRC_SIZE (4 * 1024 * 1024)
+#define NEDIT 20000
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+static byte *gen_source(void)
+{
+    static const char *line = "    numlit_end(top, &val); // 模拟一行源代码\n";
+    uint96 n = strlen(line), i;
+    byte *a = (byte *)malloc(SRC_SIZE + NEDIT * 8);
+    for (i = 0; i + n <= SRC_SIZE; i += n) {
+        memcpy(a + i, line, n);
+    }
+    memset(a + i, ' ', SRC_SIZE - i);
+    return a;
+}
+
+static uint64 lex(const byte *a, uint96 n) // 读取编辑位置之后的一段
+{
+    uint64 h = 0;
+    uint96 i;
+    for (i = 0; i < n; i += 1) {
+        h = h * 31 + a[i];
+    }
+    return h;
+}
+
+int main(void)
+{
+    byte *a = gen_source();
+    uint96 n = SRC_SIZE, pos, len, i, line, col, k;
+    uint64 start, h1 = 0, h2 = 0, t1, t2;
+    uint32 x = 1;
+    rope_t r, s;
+    rope_iter_t it;
+    rope_from(&r, a, n);
+    start = now_ns();
+    for (i = 0, x = 1; i < NEDIT; i += 1) {
+        x = x * 1103515245 + 12345;
+        pos = (x >> 4) % (n - 256);
+        if (x & 1) {
+            memmove(a + pos + 4, a + pos, n - pos);
+            memcpy(a + pos, "abc;", 4);
+            n += 4;
+        } else {
+            memmove(a + pos, a + pos + 3, n - pos - 3);
+            n -= 3;
+        }
+        h1 += lex(a + pos, 256);
+    }
+    t1 = now_ns() - start;
+    start = now_ns();
+    for (i = 0, x = 1; i < NEDIT; i += 1) {
+        x = x * 1103515245 + 12345;
+        pos = (x >> 4) % (rope_len(&r) - 256);
+        if (x & 1) {
+            rope_insert(&r, pos, (const byte *)"abc;", 4);
+        } else {
+            rope_erase(&r, pos, 3);
+        }
+        rope_snapshot(&r, &s);
+        rope_line_col(&s, pos, &line, &col);
+        rope_iter_init(&it, &s, pos);
+        for (k = 0, len = 0; k < 256; k += 1) {
+            len = len * 31 + rope_iter_get(&it);
+        }
+        h2 += len;
+        rope_free(&s);
+    }
+    t2 = now_ns() - start;
+    printf("%u edits on %u bytes: flat %.2f us/edit, rope %.2f us/edit (height %u)%s\n", NEDIT, SRC_SIZE,
+        (double)t1 / NEDIT / 1000, (double)t2 / NEDIT / 1000, r.root->height, (h1 == h2) ? "" : " MISMATCH");
+    rope_free(&r);
+    free(a);
+    return 0;
+}
@@ -0,0 +1,135 @@
+// 哈希表性能对比：bhash_t（链式，每个条目分配一次，通过 equal_t 比较）与 smap_t（开放寻址，
+// SSE2 一次比较16个控制标记，键的比较内联），条目个数从 1K 到 10M，分别测量插入、命中查找、
+// 不命中查找和删除每次操作的时间，参数可以指定最大条目个数
+#include "builtin/smap.h"
+#include <time.h>
+
+typedef struct {
+    uint64 key;
+    uint64 val;
+} entry_t;
+
+SMAP_DEFINE(emap, uint64, uint64, SMAP_HASH, SMAP_EQUAL)
+
+static uint64 now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+static bool entryeq(const void *obj, const void *para)
+{
+    return ((const entry_t *)obj)->key == *(const uint64 *)para;
+}
+
+static uint32 bkeyhash(uint64 key)
+{
+    return (uint32)smap_hash_u64(key);
+}
+
+static void bench_bhash(const uint64 *keys, const uint64 *miss, uint32 n, double t[4])
+{
+    bhash2_t h;
+    bhash_node_t node;
+    entry_t *e;
+    snode_t *p;
+    uint64 start, sum = 0;
+    uint32 i, len = 2;
+    bool exist;
+    while (len < n) {
+        len *= 2;
+    }
+    bhash_init(&h, len);
+    start = now_ns();
+    for (i = 0; i < n; i += 1) {
+        e = (entry_t *)bhash_push(h.a, bkeyhash(keys[i]), entryeq, keys + i, sizeof(entry_t), &exist);
+        e->key = keys[i];
+        e->val = i;
+    }
+    t[0] = (double)(now_ns() - start) / n;
+    start = now_ns();
+    for (i = 0; i < n; i += 1) {
+        sum += ((entry_t *)bhash_find(h.a, bkeyhash(keys[i]), entryeq, keys + i))->val;
+    }
+    t[1] = (double)(now_ns() - start) / n;
+    start = now_ns();
+    for (i = 0; i < n; i += 1) {
+        sum += bhash_find(h.a, bkeyhash(miss[i]), entryeq, miss + i) != null;
+    }
+    t[2] = (double)(now_ns() - start) / n;
+    start = now_ns();
+    for (i = 0; i < n; i += 1) { // bhash_t 没有删除操作，从前一个节点摘下
+        if (bhash_find_x(h.a, bkeyhash(keys[i]), entryeq, keys + i, &node)) {
+            p = node.node->next;
+            node.node->next = p->next;
+            free(p);
+        }
+    }
+    t[3] = (double)(now_ns() - start) / n;
+    bhash_free(&h, null);
+    if (sum == 1) {
+        printf("\n");
+    }
+}
+
+static void bench_smap(const uint64 *keys, const uint64 *miss, uint32 n, double t[4])
+{
+    smap_t m = {0};
+    uint64 start, sum = 0;
+    uint32 i;
+    bool exist;
+    start = now_ns();
+    for (i = 0; i < n; i += 1) {
+        *emap_insert(&m, keys[i], &exist) = i;
+    }
+    t[0] = (double)(now_ns() - start) / n;
+    start = now_ns();
+    for (i = 0; i < n; i += 1) {
+        sum += *emap_find(&m, keys[i]);
+    }
+    t[1] = (double)(now_ns() - start) / n;
+    start = now_ns();
+    for (i = 0; i < n; i += 1) {
+        sum += emap_find(&m, miss[i]) != null;
+    }
+    t[2] = (double)(now_ns() - start) / n;
+    start = now_ns();
+    for (i = 0; i < n; i += 1) {
+        emap_erase(&m, keys[i]);
+    }
+    t[3] = (double)(now_ns() - start) / n;
+    smap_free(&m);
+    if (sum == 1) {
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32 max = argc > 1 ? (uint32)atoi(argv[1]) : 10000000, n, i;
+    uint64 *keys = (uint64 *)malloc(max * sizeof(uint64));
+    uint64 *miss = (uint64 *)malloc(max * sizeof(uint64));
+    uint64 x = 88172645463325252ULL;
+    double b[4], s[4];
+    if (!keys || !miss) {
+        return 1;
+    }
+    for (i = 0; i < max; i += 1) { // xorshift 随机键，最低位区分存在和不存在的键
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        keys[i] = x & ~1ULL;
+        miss[i] = x | 1;
+    }
+    printf("%10s %21s %21s %21s %21s\n", "entries", "insert ns", "hit ns", "miss ns", "erase ns");
+    printf("%10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "", "bhash", "smap", "bhash", "smap", "bhash", "smap", "bhash", "smap");
+    for (n = 1000; n <= max; n *= 10) {
+        bench_bhash(keys, miss, n, b);
+        bench_smap(keys, miss, n, s);
+        printf("%10u %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", n, b[0], s[0], b[1], s[1], b[2], s[2], b[3], s[3]);
+    }
+    free(keys);
+    free(miss);
+    return 0;
+}
@@ -1,4 +1,11 @@
 #include "chcc/abi/x86_abi.h"
+#include "direct/trace.h"
+#if !defined(__MSC__)
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 // 000 001 010 011 100 101 110 111
 // EAX ECX EDX EBX ESP EBP ESI EDI
@@ -79,6 +86,47 @@
 // 会对齐到内存分页的整数倍位置，这会导致内存分段之前和之后可能有空白填补空间，例如代码
 // 分段之后的数据分区，其开始部分可能是填补的空白空间。
 
+// 生成的代码直接写入 cc->text。并行生成时每个函数生成到自己的代码缓存，cc->text_end 是
+// 缓存的结尾，剩余空间不足时标记 cc->text_full，之后的代码不再写入缓存，返回的地址位置
+// 指向一个丢弃的临时区域，调用者会丢弃整个函数的代码并加倍缓存之后重新生成。
+#define GEN_MAX_BYTES 8 // 一次生成的最大字节数
+
+static THREAD_LOCAL byte gsink_[GEN_MAX_BYTES];
+
+static bool groom_(chcc_t *cc)
+{
+    if (cc->text_end && !cc->text_full && cc->text + GEN_MAX_BYTES > cc->text_end) {
+        cc->text_full = true;
+        if (!cc->rels) { // 串行生成时直接写入代码段，不能加倍重新生成
+            log_error(ERROR_JIT_TEXT_TOO_LARGE);
+        }
+    }
+    return !cc->text_full;
+}
+
+void g(chcc_t *cc, uint32 n) // 从低字节开始生成 n 的非零字节
+{
+    if (!groom_(cc)) {
+        return;
+    }
+    while (n) {
+        *cc->text++ = (byte)n;
+        n >>= 8;
+    }
+}
+
+byte *ga(chcc_t *cc, uint32 n, byte *addr) // 生成指令和32位的地址或立即数，返回地址所在的位置
+{
+    byte *a;
+    g(cc, n);
+    if (!groom_(cc)) {
+        return gsink_;
+    }
+    a = cc->text;
+    cc->text = host_32_to_lp((uint32)(uintd_t)addr, a);
+    return a;
+}
+
 void gi(chcc_t *cc, uint32 imm32) // 加载一个立即数
 {
     ga(cc, 0xb8, (byte *)imm32); // mov $imm32, %eax
@@ -108,35 +156,58 @@ void gcmp(byte cc) // 如果条件成立将%eax置1或置0
     g(0xc0);
 }
 
-void gmov(uint32 val, uint32 addr)
+void guse(chcc_t *cc, byte *a, vsym_t *v) // 引用全局变量的绝对地址，变量地址确定之后写入
+{
+    if (a == gsink_) {
+        return;
+    }
+    if (cc->rels) { // 并行生成时使用位置在拼接代码时才确定，拼接之后串连到变量的使用地址列表
+        gfrel(cc, a, FREL_USEL, v);
+        return;
+    }
+    if (cc->genobj) { // 64位模式下是相对下一条指令的地址 disp32(%rip)
+        gorel(cc, a, ELF_R_X86_64_PC32, v, 0, -4);
+    }
+    host_32_to_lp((uint32)(uintd_t)v->usel, a);
+    v->usel = (int96 *)a;
+}
+
+void gvaraddr(vsym_t *v, byte *addr) // 将全局变量的地址写入所有使用位置
+{
+    byte *a = (byte *)v->usel, *next;
+    while (a) {
+        next = (byte *)(uintd_t)lp_32_to_host(a);
+        host_32_to_lp((uint32)(uintd_t)addr, a);
+        a = next;
+    }
+    v->usel = null;
+}
+
+void gmov(chcc_t *cc, uint32 val, vsym_t *v)
 {
-    var32_t *v = (var32_t *)addr;
-    int32 n = v->v;
     // val = 0  [83]    add imm8 => r/m32 符号扩展
     // val = 6  [89]    mov r32 => r/m32
     // val = 8  [8B]    mov r/m32 => r32
     // val = 10 [8D]    lea EA => r32
-    g(0x83 + val);
-    if (n && n < LOCAL) { // 定义的局部变量，相对%ebp的地址
+    if (!v->symb.isgvar) { // 局部变量，相对%ebp的地址
         // [83] 10 000 101 disp32   add $imm8,disp32(%ebp)
         // [89] 10 000 101 disp32   mov %eax,disp32(%ebp)
         // [8B] 10 000 101 disp32   mov disp32(%ebp),%eax
         // [8D] 10 000 101 disp32   lea disp32(%ebp),%eax
-        ga(0x85, (byte *)n);
-    } else { // 未定义的或定义的全局变量，使用绝对地址
+        ga(cc, ((0x83 + val) | 0x8500), (byte *)v->addr);
+    } else { // 全局变量，使用绝对地址
         // [83] 00 000 101 disp32   add $imm8,(disp32)
         // [89] 00 000 101 disp32   mov %eax,(disp32)
         // [8B] 00 000 101 disp32   mov (disp32),%eax
         // [8D] 00 000 101 disp32   lea (disp32),%eax
-        v->addr = (uint32)ga(cc, 0x05, v->addr);
+        guse(cc, ga(cc, ((0x83 + val) | 0x0500), 0), v);
     }
 }
 
-
 void grel(byte *cur, ipsz *usel)
 {
     byte *a;
-    while (usel) {
+    while (usel && (byte *)usel != gsink_) {
         a = (byte *)lp_ab_to_host(usel);
         if (*(a - 1) == 0x05) { // 绝对地址
             if (cur >= data && cur < glo) { // 数据区
@@ -151,14 +222,52 @@ void grel(byte *cur, ipsz *usel)
     }
 }
 
-void gldr(synval_t *a, uint32 reg) // m32 => r32
+void gldrloc(chcc_t *cc, uint32 disp) // 局部变量 => %eax
+{
+    // mov disp32(%ebp),%eax [8b] 10 000 101 disp32
+    ga(cc, 0x858b, (byte *)(uintd_t)disp);
+}
+
+void gstoloc(chcc_t *cc, uint32 disp) // %eax => 局部变量
 {
-    
+    // mov %eax,disp32(%ebp) [89] 10 000 101 disp32
+    ga(cc, 0x8589, (byte *)(uintd_t)disp);
 }
 
-void gsto(uint32 reg, vsym_t *a) // r32 => m32
+void gpush(chcc_t *cc) // 计算右操作数之前保存%eax中的左操作数
 {
+    // push %eax [50]
+    g(cc, 0x50);
+}
+
+bool gbinop(chcc_t *cc, cfid_t op) // 左操作数在栈上，右操作数在%eax，结果保存在%eax
+{
+    // mov %eax,%ecx [89] 11 000 001 [89 c1]
+    // pop %eax [58]
+    g(cc, 0x58c189);
+    if (op == CIFA_OP_ADD || op == CIFA_OP_ADD_ASSIGN) {
+        // add %ecx,%eax [01] 11 001 000 [01 c8]
+        g(cc, 0xc801);
+    } else if (op == CIFA_OP_SUB || op == CIFA_OP_SUB_ASSIGN) {
+        // sub %ecx,%eax [29] 11 001 000 [29 c8]
+        g(cc, 0xc829);
+    } else if (op == CIFA_OP_MUL || op == CIFA_OP_MUL_ASSIGN) {
+        // imul %ecx,%eax [0f af] 11 000 001 [0f af c1]
+        g(cc, 0xc1af0f);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void gldr(chcc_t *cc, synval_t *a) // m32 => %eax
+{
+    gmov(cc, 8, a->refv);
+}
 
+void gsto(chcc_t *cc, vsym_t *a) // %eax => m32
+{
+    gmov(cc, 6, a);
 }
 
 uint32 genter(chcc_t *cc, fsym_t *f)
@@ -179,8 +288,12 @@ uint32 genter(chcc_t *cc, fsym_t *f)
     // mov %edx,%ebp
     // r32 => r32 [89] 11 010 101           [89 d5]
     g(cc, 0xd589);
-    // 3. 预留edx保存空间，初始化loc和radr
-    f->loc = loc + sizeof(upsz);
+    // 3. 将 %edx 移到本函数帧之后，作为被调函数的帧，帧大小在函数生成结束之后写入
+    // add $imm32,%edx
+    // imm32 => r32 [81] 11 000 010 imm32   [81 c2 xx xx xx xx]
+    f->fsize = ga(cc, 0xc281, 0);
+    // 4. 预留edx保存空间，初始化loc和radr
+    f->loc = f->maxloc = loc + sizeof(upsz);
     f->radr = null;
     return f->loc;
 }
@@ -188,8 +301,9 @@ uint32 genter(chcc_t *cc, fsym_t *f)
 void gret(chcc_t *cc, fsym_t *f)
 {
     uint32 loc = f->plen;
-    // 0. 重定位return语句的跳转地址
+    // 0. 重定位return语句的跳转地址，写入函数帧大小
     grel(cc->text, f->radr);
+    host_32_to_lp(round_up(f->maxloc, sizeof(upsz)), f->fsize);
     // 1. 将 %ebp 恢复到 %edx
     // mov %ebp,%edx
     // r32 => r32 [89] 11 101 010           [89 ea]
@@ -209,10 +323,254 @@ void gret(chcc_t *cc, fsym_t *f)
     g(cc, 0x22ff);
 }
 
+void garg(chcc_t *cc, uint32 disp) // 将%eax中的实参保存到被调函数的参数位置
+{
+    // 主调函数的%edx即被调函数的%ebp，参数位置为 (%edx+8) 开始
+    // mov %eax,disp32(%edx)
+    // r32 => m32 [89] 10 000 010 disp32    [89 82 xx xx xx xx]
+    ga(cc, 0x8289, (byte *)disp);
+}
+
+void gcall(chcc_t *cc, fsym_t *f) // 调用函数，函数地址在函数生成开始时已经确定
+{
+    byte *a, *b;
+    // 1. 写入函数返回地址，返回地址为之后jmp指令的下一条指令
+    if (cc->genobj) { // 目标文件默认按位置无关代码链接，使用相对下一条指令的地址，同一分区内不需要重定位
+        // lea disp32(%rip),%rax [48 8d] 00 000 101 [05] disp32，参数已经保存，%rax 可以使用
+        // mov %rax,(%rdx)       [48 89] 00 000 010 [02]，64位模式下 jmp (%rdx) 读取8字节的返回地址
+        a = ga(cc, 0x058d48, 0);
+        g(cc, 0x028948);
+    } else {
+        // movl $imm32,(%edx)
+        // imm32 => m32 [c7] 00 000 010 imm32   [c7 02 xx xx xx xx]
+        a = ga(cc, 0x02c7, 0);
+    }
+    // 2. 跳转到被调函数，被调函数返回时执行 jmp (%edx)
+    // jmp rel32 [e9 xx xx xx xx]
+    if (cc->rels) { // 并行生成时被调函数地址和本函数地址都在拼接代码时确定
+        gfrel(cc, gjmp(cc, 0), FREL_CALL, f);
+        if (!cc->genobj) {
+            gfrel(cc, a, FREL_TEXT, null);
+        }
+    } else {
+        b = gjmp(cc, (byte *)(f->v.addr - ((int96)cc->text + 5)));
+        if (cc->genobj) {
+            gorel(cc, b, ELF_R_X86_64_PLT32, &f->v, 0, -4);
+        }
+    }
+    if (cc->genobj) {
+        host_32_to_lp((uint32)(cc->text - (a + 4)), a);
+    } else {
+        host_ab_to_lp(cc->text, a);
+    }
+}
+
+// 调用外部函数使用C调用约定，%edx 是调用者保存的寄存器需要先保护，参数保存在%esp
+// 开始的栈上，函数地址在加载时写入数据段中的导入地址槽，通过导入地址槽间接调用。
+
+byte *gcenter(chcc_t *cc) // 返回预留参数空间大小的位置，参数计算完成之后写入
+{
+    // push %edx [52]
+    g(cc, 0x52);
+    // sub $imm32,%esp [81] 11 101 100 [ec] imm32
+    return ga(cc, 0xec81, 0);
+}
+
+void gcarg(chcc_t *cc, uint32 disp)
+{
+    // mov %eax,disp32(%esp) [89] 10 000 100 [84] 00 100 100 [24] disp32
+    ga(cc, 0x248489, (byte *)disp);
+}
+
+void gccall(chcc_t *cc, byte *slot, byte *a, uint32 size)
+{
+    host_32_to_lp(size, a);
+    // call *(disp32) [ff] 00 010 101 [15] disp32，导入地址槽是绝对地址
+    a = ga(cc, 0x15ff, slot);
+    if (cc->rels) {
+        gfrel(cc, a, FREL_SLOT, slot);
+    } else if (cc->genobj) { // 64位模式下是相对下一条指令的地址 call *disp32(%rip)
+        gorel(cc, a, ELF_R_X86_64_PC32, null, OSEC_DATA, (int32)(slot - cc->data_section) - 4);
+    }
+    // add $imm32,%esp [81] 11 000 100 [c4] imm32
+    ga(cc, 0xc481, (byte *)(uintd_t)size);
+    // pop %edx [5a]
+    g(cc, 0x5a);
+}
+
+// switch 分支选择代码在所有分支代码之后生成，进入时 %eax 保存选择的值，所有跳转目标
+// 地址都已经确定。值范围密集的分支生成带边界检查的跳转表，跳转表保存在只读数据分区，
+// 并行生成时保存在函数代码中。稀疏的分支生成二分查找的比较树，每次比较排除一半的分支。
+#define SWITCH_TABLE_MIN_CASES 4    // 生成跳转表的最少分支个数
+#define SWITCH_TABLE_DENSITY 3      // 值范围小于分支个数的3倍时生成跳转表
+
+byte *gjmp_to(chcc_t *cc, uint32 op, byte *target) // 跳转到已知地址
+{
+    byte *a = ga(cc, op, 0);
+    host_32_to_lp((uint32)(target - (a + 4)), a);
+    return a;
+}
+
+void gcmpi(chcc_t *cc, int32 imm32)
+{
+    // cmp $imm32,%eax [3d imm32]
+    ga(cc, 0x3d, (byte *)(intd_t)imm32);
+}
+
+static byte *gcasealign(chcc_t *cc, uint32 align) // 并行生成时跳转表放在函数代码中间接跳转之后
+{
+    while (((uintd_t)cc->text & (align - 1)) && !cc->text_full) {
+        g(cc, 0xcc); // int3
+    }
+    return cc->text;
+}
+
+static void gcaseent(chcc_t *cc, byte *addr) // 跳转表项，代码的绝对地址
+{
+    byte *p;
+    if (cc->rels) { // 跳转表在函数代码中，拼接时重定位
+        p = ga(cc, 0, addr);
+        if (cc->genobj) {
+            ga(cc, 0, 0);
+            host_64_to_lp((uint64)(uintd_t)addr, p);
+            gfrel(cc, p, FREL_TEXT64, null);
+        } else {
+            gfrel(cc, p, FREL_TEXT, null);
+        }
+    } else if (cc->genobj) { // 位置无关代码链接时64位的绝对地址成为加载时的相对重定位
+        gorel(cc, cc->rodata, ELF_R_X86_64_64, null, OSEC_TEXT, (int32)(addr - cc->text_section));
+        cc->rodata = host_64_to_lp((uint64)(uintd_t)addr, cc->rodata);
+    } else {
+        cc->rodata = host_32_to_lp((uint32)(uintd_t)addr, cc->rodata);
+    }
+}
+
+void gcasetable(chcc_t *cc, case_t *c, uint32 n, byte *dflt)
+{
+    int32 lo = c[0].val;
+    uint32 range = (uint32)(c[n-1].val - lo) + 1;
+    uint32 i, j = 0;
+    byte *table, *a;
+    // sub $imm32,%eax [2d imm32]
+    if (lo) {
+        ga(cc, 0x2d, (byte *)(intd_t)lo);
+    }
+    // jae rel32 [0f 83 rel32] 无符号比较，小于最小值的情况也会变成一个很大的无符号数
+    gcmpi(cc, (int32)range);
+    gjmp_to(cc, 0x830f, dflt);
+    if (cc->genobj) { // 目标文件默认按位置无关代码链接，表地址相对下一条指令，表项是64位的代码地址
+        // lea disp32(%rip),%rcx [48 8d] 00 001 101 [0d] disp32
+        // jmp *(%rcx,%rax,8)    [ff] 00 100 100 [24] 11 000 001 [c1]，写%eax时%rax的高32位已经清零
+        a = ga(cc, 0x0d8d48, 0);
+        g(cc, 0xc124ff);
+        if (cc->rels) {
+            table = gcasealign(cc, sizeof(uint64));
+            host_32_to_lp((uint32)(table - (a + 4)), a); // 同一个函数中的相对地址不需要重定位
+        } else {
+            cc->rodata = round_up_addr(cc->rodata, sizeof(uint64)-1);
+            table = cc->rodata;
+            gorel(cc, a, ELF_R_X86_64_PC32, null, OSEC_RODATA, (int32)(table - cc->rodata_section) - 4);
+        }
+    } else {
+        // jmp *disp32(,%eax,4) [ff] 00 100 100 [24] 10 000 101 [85] disp32
+        a = ga(cc, 0x8524ff, 0); // 跳转表地址和表项中的代码地址都是绝对地址
+        if (cc->rels) { // 并行生成时只读数据分区是共享的
+            table = gcasealign(cc, sizeof(uint32));
+            gfrel(cc, a, FREL_TEXT, null);
+        } else {
+            cc->rodata = round_up_addr(cc->rodata, sizeof(uint32)-1);
+            table = cc->rodata;
+        }
+        host_32_to_lp((uint32)(uintd_t)table, a);
+    }
+    if (!cc->rels && cc->rodata_end && table + range * (cc->genobj ? sizeof(uint64) : sizeof(uint32)) > cc->rodata_end) {
+        log_error(ERROR_JIT_RODATA_TOO_LARGE);
+        cc->text_full = true; // 丢弃之后生成的代码，函数生成失败
+        return;
+    }
+    for (i = 0; i < range; i += 1) {
+        if (j < n && (uint32)(c[j].val - lo) == i) {
+            gcaseent(cc, c[j].addr);
+            j += 1;
+        } else {
+            gcaseent(cc, dflt);
+        }
+    }
+}
+
+void gswitch(chcc_t *cc, case_t *c, uint32 n, byte *dflt) // 分支按值从小到大排序并且没有重复值
+{
+    uint32 m, i;
+    byte *a;
+    if (n >= SWITCH_TABLE_MIN_CASES && (int64)c[n-1].val - c[0].val < (int64)n * SWITCH_TABLE_DENSITY) {
+        gcasetable(cc, c, n, dflt);
+        return;
+    }
+    if (n <= 3) { // 分支很少时顺序比较
+        for (i = 0; i < n; i += 1) {
+            gcmpi(cc, c[i].val);
+            gjmp_to(cc, 0x840f, c[i].addr); // je rel32 [0f 84 rel32]
+        }
+        gjmp_to(cc, 0xe9, dflt);
+        return;
+    }
+    m = n / 2;
+    gcmpi(cc, c[m].val);
+    gjmp_to(cc, 0x840f, c[m].addr); // je rel32 [0f 84 rel32]
+    a = ga(cc, 0x8f0f, 0);          // jg rel32 [0f 8f rel32] 有符号比较，大于中间值在右半部分查找
+    gswitch(cc, c, m, dflt);
+    host_32_to_lp((uint32)(cc->text - (a + 4)), a);
+    gswitch(cc, c + m + 1, n - m - 1, dflt);
+}
+
+
+// 生成 ELF64 可重定位目标文件，文件结构如下，分区头部紧跟在文件头部之后：
+//  0x0000_0000 [   Elf64Ehdr       ] 64-byte
+//  0x0000_0040 [   Elf64Shdr * N   ] 12个固定分区加上附加分区和它们的重定位分区，第一个是特殊的空分区头部
+//              [   .text           ]
+//              [   .rodata         ]
+//              [   .rodata.str     ]
+//              [   .data           ] 包含外部函数的导入地址槽
+//              [   .symtab         ] 空符号、分区符号（本地）、全局函数、全局变量和外部函数（全局）
+//              [   .strtab         ]
+//              [   .rela.text      ] 调用函数 PLT32，代码中的绝对地址 32，导入地址槽、全局变量和跳转表 PC32
+//              [   .rela.rodata    ] 跳转表项中的代码地址 64
+//              [   .rela.data      ] 导入地址槽 64
+//              [   .shstrtab       ]
+//              [   附加分区 ...     ] 调试信息和元数据等非加载分区，可以用 zlib 压缩
+//              [   .rela附加分区 ...] 附加分区中的重定位，例如 DWARF 中的代码地址和分区偏移
+// 最后一个附加分区是 .note.gnu.build-id，构建标识是整个文件内容的哈希。
+// 目标文件中的代码分区基地址为0，符号的值是符号在所在分区的偏移，引用位置的内容不再有意
+// 义，链接时由 ElfRela 的 addend 计算。
+
+#define OSEC_SYMTAB 6
+#define OSEC_STRTAB 7
+#define OSEC_RELA_TEXT 8
+#define OSEC_RELA_RODATA 9
+#define OSEC_RELA_DATA 10
+#define OSEC_SHSTRTAB 11
+#define OSEC_NUM 12
+
+void gorel(chcc_t *cc, byte *a, uint32 type, vsym_t *v, uint32 sec, int32 addend) // 记录目标文件的重定位
+{
+    orel_t r;
+    r.addr = a;
+    r.type = type;
+    r.sec = sec;
+    r.addend = addend;
+    r.sym = v;
+    buffer_push(&cc->orels, (byte *)&r, sizeof(orel_t), 0);
+}
+
+bool gobjdef(chcc_t *cc, fsym_t *f) // 记录目标文件中定义的全局函数
+{
+    return !cc->genobj || buffer_push(&cc->odefs, (byte *)&f, sizeof(fsym_t *), 0);
+}
+
 typedef struct {
     byte *shnum;        // uint16 shnum 分区个数>=0xff00，该值0x0000
     byte *strsh;        // uint16 strsh 头部索引>=0xff00，该值0xffff
-    byte *real_shnum;   // uint32 size
+    byte *real_shnum;   // uint64 size
     byte *real_strsh;   // uint32 link
 } objhdr_t;
 
@@ -220,151 +578,659 @@ byte *gelfobjhdr(byte *p, objhdr_t *out)
 {
     // 文件头部
     // 0x7f 'E' 'L' 'F'
-    p = host_32_to_lp(p, 0x464c457f);
-    // 0x01 ELF_CLASS_32            32-bit
+    p = host_32_to_lp(0x464c457f, p);
+    // 0x02 ELF_CLASS_64            64-bit
     // 0x01 ELF_DATA_2LSB           小端模式
     // 0x01 ELF_VERSION_CURR        当前版本
     // 0x00 ELF_OSABI_NONE          无操作系统ABI
-    p = host_32_to_lp(p, 0x00010101);
+    p = host_32_to_lp(0x00010102, p);
     // 0x00 ELF_ABIVERSION_NONE     无ABI版本
-    // 0x00 ELF_HDR_PAD 3-byte
-    *(uint32 *)p = 0x00000000; p += 4;
-    // 0x00 ELF_HDR_PAD 4-byte
-    *(uint32 *)p = 0x00000000; p += 4;
+    // 0x00 ELF_HDR_PAD 7-byte
+    p = host_64_to_lp(0, p);
     // 0x01 0x00 ELF_TYPE_REL       type    可重定位文件
-    // 0x03 0x00 ELF_MACHINE_386    machine x86-32
-    p = host_32_to_lp(p, 0x00030001);
+    // 0x3e 0x00 ELF_MACHINE_X86_64 machine x86-64
+    p = host_32_to_lp(0x003e0001, p);
     // 0x01 0x00 0x00 0x00          version ELF_VERSION_CURR
-    p = host_32_to_lp(p, 0x00000001);
-    // 0x00 0x00 0x00 0x00          entry
-    *(uint32 *)p = 0x00000000; p += 4;
-    // 0x00 0x00 0x00 0x00          phoff
-    *(uint32 *)p = 0x00000000; p += 4;
-    // 0x34 0x00 0x00 0x00          shoff   sizeof(Elf32Ehdr)
-    p = host_32_to_lp(p, 0x00000034);
+    p = host_32_to_lp(0x00000001, p);
+    // 8-byte 0x00                  entry
+    p = host_64_to_lp(0, p);
+    // 8-byte 0x00                  phoff
+    p = host_64_to_lp(0, p);
+    // 0x40 0x00 ...                shoff   sizeof(Elf64Ehdr)
+    p = host_64_to_lp(sizeof(Elf64Ehdr), p);
     // 0x00 0x00 0x00 0x00          flags
-    *(uint32 *)p = 0x00000000; p += 4;
-    // 0x34 0x00 (52)               ehsize  sizeof(Elf32Ehdr)
+    p = host_32_to_lp(0x00000000, p);
+    // 0x40 0x00 (64)               ehsize  sizeof(Elf64Ehdr)
     // 0x00 0x00                    phsize
-    p = host_32_to_lp(p, 0x00000034);
+    p = host_32_to_lp(0x00000040, p);
     // 0x00 0x00                    phnum
-    // 0x28 0x00 (40)               shsize  sizeof(Elf32Shdr)
-    p = host_32_to_lp(p, 0x00280000);
+    // 0x40 0x00 (64)               shsize  sizeof(Elf64Shdr)
+    p = host_32_to_lp(0x00400000, p);
     // 0x00 0x00                    shnum   分区个数，如果个数>=0xff00，该值0x0000
     // 0x00 0x00                    strsh   分区名称使用的字符串表头部索引，如果索引>=0xff00，该值0xffff
     out->shnum = p;
     out->strsh = p + 2;
-    // 特殊的第一个分区头部
-    // 0x00 0x00 0x00 0x00          name    ELF_SHNDX_UNDEF 没有名称
-    // 0x00 0x00 0x00 0x00          type    ELF_SEC_NULL 非活动分区头部
-    // 0x00 0x00 0x00 0x00          flags   没有分区属性
-    // 0x00 0x00 0x00 0x00          addr    没有内存映射地址
-    // 0x00 0x00 0x00 0x00          offset  没有文件空间偏移
-    // 0x00 0x00 0x00 0x00          size    非零表示实际的分区个数
-    // 0x00 0x00 0x00 0x00          link    非零表示实际的字符串表头部索引
-    // 0x00 0x00 0x00 0x00          info    没有额外信息
-    // 0x00 0x00 0x00 0x00          addralign 无地址对齐要求
-    // 0x00 0x00 0x00 0x00          entsize 不包含固定大小条目
-    memset(p, 0, 4 + sizeof(Elf32Shdr));
-    out->real_shnum = p + 4 + 20;   // size
-    out->real_strsh = p + 4 + 24;   // link
-    return p + 4 + sizeof(Elf32Shdr);
+    p += 4;
+    // 特殊的第一个分区头部，全部为零，size 非零表示实际的分区个数，link 非零表示实际
+    // 的字符串表头部索引
+    memset(p, 0, sizeof(Elf64Shdr));
+    out->real_shnum = p + 32;   // size
+    out->real_strsh = p + 40;   // link
+    return p + sizeof(Elf64Shdr);
 }
 
 typedef struct {
     byte *name;     // uint32 name
-    byte *offset;   // uint32 offset, offset-4 为 addr 位置
-    byte *size;     // uint32 size
+    byte *offset;   // uint64 offset, offset-8 为 addr 位置
+    byte *size;     // uint64 size
+    byte *link;     // uint32 link, link+4 为 info 位置
 } sechdr_t;
 
-byte *gelfsechdr(byte *p, sechdr_t *out, uint32 type, uint32 attr)
+byte *gelfsechdr(byte *p, sechdr_t *out, uint32 type, uint64 attr, uint64 align, uint64 entsize)
 {
     out->name = p;
-    *(uint32 *)p = 0x00000000; p += 4;  // name
-    p = host_32_to_lp(p, type);         // type
-    p = host_32_to_lp(p, attr);         // flags
-    *(uint32 *)p = 0x00000000; p += 4;  // addr
-    out->offset = p; p += 4;            // offset
-    out->size = p; p += 4;              // size
-    *(uint32 *)p = 0x00000000; p += 4;  // link
-    *(uint32 *)p = 0x00000000; p += 4;  // info
-    p = host_32_to_lp(p, 0x00000004);   // addralign
-    *(uint32 *)p = 0x00000000;          // entsize
-    return p + 4;
+    p = host_32_to_lp(0, p);            // name
+    p = host_32_to_lp(type, p);         // type
+    p = host_64_to_lp(attr, p);         // flags
+    p = host_64_to_lp(0, p);            // addr
+    out->offset = p;
+    p = host_64_to_lp(0, p);            // offset
+    out->size = p;
+    p = host_64_to_lp(0, p);            // size
+    out->link = p;
+    p = host_32_to_lp(0, p);            // link
+    p = host_32_to_lp(0, p);            // info
+    p = host_64_to_lp(align, p);        // addralign
+    return host_64_to_lp(entsize, p);   // entsize
 }
 
 byte *gelfsnmstr(byte *p, sechdr_t *out) // 分区名称
 {
-    return gelfsechdr(p, out, ELF_SEC_STRTAB, 0);
+    return gelfsechdr(p, out, ELF_SEC_STRTAB, 0, 1, 0);
 }
 
 byte *gelfsymstr(byte *p, sechdr_t *out) // 符号名称
 {
-    return gelfsechdr(p, out, ELF_SEC_STRTAB, 0);
+    return gelfsechdr(p, out, ELF_SEC_STRTAB, 0, 1, 0);
 }
 
 byte *gelfsymtab(byte *p, sechdr_t *out) // 符号表分区，只能有一个
 {
-    p = gelfsechdr(p, out, ELF_SEC_SYMTAB, 0);
-    host_32_to_lp(sizeof(Elf32Sym), p - 4); // entsize
-    return p;
+    return gelfsechdr(p, out, ELF_SEC_SYMTAB, 0, 8, sizeof(Elf64Sym));
 }
 
-byte *gelfrel(byte *p, sechdr_t *out) // 代码分区重定位
+byte *gelfrela(byte *p, sechdr_t *out) // 重定位分区，info 为应用重定位的分区
 {
-    p = gelfsechdr(p, out, ELF_SEC_REL, 0);
-    host_32_to_lp(sizeof(Elf32Rel), p - 4); // entsize
-    return p;
+    return gelfsechdr(p, out, ELF_SEC_RELA, ELF_SF_INFO_LINK, 8, sizeof(Elf64Rela));
 }
 
 byte *gelftext(byte *p, sechdr_t *out) // 程序代码
 {
-    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC|ELF_SF_EXECINSTR);
+    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC|ELF_SF_EXECINSTR, 16, 0);
 }
 
 byte *gelfrodata(byte *p, sechdr_t *out) // 只读数据（非字符串）
 {
-    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC);
+    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC, 8, 0);
 }
 
 byte *gelfrodstr(byte *p, sechdr_t *out) // 只读字符串数据
 {
-    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC);
+    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC, 1, 0);
 }
 
 byte *gelfdata(byte *p, sechdr_t *out) // 全局初始化数据
 {
-    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC|ELF_SF_WRITE);
+    return gelfsechdr(p, out, ELF_SEC_PROGBITS, ELF_SF_ALLOC|ELF_SF_WRITE, 8, 0);
 }
 
 byte *gelfbss(byte *p, sechdr_t *out) // 全局未初始化数据，不占用文件空洞，但会分配内存
 {
-    return gelfsechdr(p, out, ELF_SEC_NOBITS, ELF_SF_ALLOC|ELF_SF_WRITE);
+    return gelfsechdr(p, out, ELF_SEC_NOBITS, ELF_SF_ALLOC|ELF_SF_WRITE, 8, 0);
 }
 
 typedef struct {
-    sechdr_t symstr;
-    sechdr_t symtab;
-    sechdr_t rel;
-    sechdr_t text;
+    sechdr_t text;      // 分区头部顺序与 OSEC_XXX 一致
     sechdr_t rodata;
     sechdr_t rodstr;
     sechdr_t data;
     sechdr_t bss;
+    sechdr_t symtab;
+    sechdr_t symstr;
+    sechdr_t relatext;
+    sechdr_t relarodata;
+    sechdr_t reladata;
+    sechdr_t snmstr;
 } objfile_t;
 
-byte *gobjhdr(byte *p, objfile_t *obj)
+static const char *objsecname[OSEC_NUM] = {
+    "", ".text", ".rodata", ".rodata.str", ".data", ".bss",
+    ".symtab", ".strtab", ".rela.text", ".rela.rodata", ".rela.data", ".shstrtab"
+};
+
+byte *gobjhdr(byte *p, objfile_t *obj, uint32 first_global, const uint32 *secname, uint32 nextra)
 {
     objhdr_t objhdr;
+    sechdr_t *sh = (sechdr_t *)obj;
+    uint32 i;
     p = gelfobjhdr(p, &objhdr);         // 文件头部
-    p = gelfsymstr(p, &obj->symstr);    // 分区头部
-    p = gelfsymtab(p, &obj->symtab);
-    p = gelfrel(p, &obj->rel);
-    p = gelftext(p, &obj->text);
+    p = gelftext(p, &obj->text);        // 分区头部
     p = gelfrodata(p, &obj->rodata);
     p = gelfrodstr(p, &obj->rodstr);
     p = gelfdata(p, &obj->data);
     p = gelfbss(p, &obj->bss);
-    host_16_to_lp(1 + sizeof(objfile_t)/sizeof(sechdr_t), (byte *)objhdr.shnum);
+    p = gelfsymtab(p, &obj->symtab);
+    p = gelfsymstr(p, &obj->symstr);
+    p = gelfrela(p, &obj->relatext);
+    p = gelfrela(p, &obj->relarodata);
+    p = gelfrela(p, &obj->reladata);
+    p = gelfsnmstr(p, &obj->snmstr);
+    for (i = 1; i < OSEC_NUM; i += 1) { // 分区名称在 .shstrtab 中的偏移
+        host_32_to_lp(secname[i], sh[i-1].name);
+    }
+    host_32_to_lp(OSEC_STRTAB, obj->symtab.link);
+    host_32_to_lp(first_global, obj->symtab.link + 4);
+    host_32_to_lp(OSEC_SYMTAB, obj->relatext.link);
+    host_32_to_lp(OSEC_TEXT, obj->relatext.link + 4);
+    host_32_to_lp(OSEC_SYMTAB, obj->relarodata.link);
+    host_32_to_lp(OSEC_RODATA, obj->relarodata.link + 4);
+    host_32_to_lp(OSEC_SYMTAB, obj->reladata.link);
+    host_32_to_lp(OSEC_DATA, obj->reladata.link + 4);
+    host_16_to_lp(OSEC_NUM + nextra, objhdr.shnum);
+    host_16_to_lp(OSEC_SHSTRTAB, objhdr.strsh);
     return p;
 }
+
+// 符号名称先登记到字符串表构建器，name 字段暂存登记的序号，生成字符串表之后改成偏移
+static bool gobjsym(buffer_t *symtab, elf_strtab_t *names, string_t *name, uint32 info, uint32 shndx, uint64 value, uint64 size)
+{
+    byte e[sizeof(Elf64Sym)], *p = e;
+    uint32 id = name ? elf_strtab_intern(names, name->a, (uint32)name->len) : 0;
+    if (id == 0xffffffff) {
+        return false;
+    }
+    p = host_32_to_lp(id, p);
+    *p++ = (byte)info;
+    *p++ = ELF_SYM_DEFAULT;
+    p = host_16_to_lp((u16)shndx, p);
+    p = host_64_to_lp(value, p);
+    host_64_to_lp(size, p);
+    return buffer_push(symtab, e, sizeof(e), 0);
+}
+
+static bool gobjsymname(buffer_t *symtab, elf_strtab_t *names, buffer_t *strtab)
+{
+    byte *p = symtab->a, *end = symtab->a + symtab->len;
+    if (!elf_strtab_build(names, strtab)) {
+        return false;
+    }
+    for (; p < end; p += sizeof(Elf64Sym)) {
+        host_32_to_lp(elf_strtab_offset(names, lp_32_to_host(p)), p);
+    }
+    return true;
+}
+
+static bool gobjrela(buffer_t *rela, uint64 offset, uint32 sym, uint32 type, int64 addend)
+{
+    byte e[sizeof(Elf64Rela)], *p = e;
+    p = host_64_to_lp(offset, p);
+    p = host_64_to_lp(ELF_REL_INFO_64(sym, type), p);
+    host_64_to_lp((uint64)addend, p);
+    return buffer_push(rela, e, sizeof(e), 0);
+}
+
+static bool gobjglobal(buffer_t *symtab, elf_strtab_t *names, vsym_t *v, uint32 shndx, uint64 value, uint64 size)
+{
+    uint32 type = (shndx == OSEC_TEXT) ? ELF_SYM_TYPE_FUNC : shndx ? ELF_SYM_TYPE_OBJECT : ELF_SYM_TYPE_NOTYPE;
+    v->objsym = (uint32)(symtab->len / sizeof(Elf64Sym));
+    return gobjsym(symtab, names, &v->symb.name->s, ELF_SYM_INFO(ELF_SYM_BIND_GLOBAL, type), shndx, value, size);
+}
+
+// 先计算文件布局，再按顺序收集文件头部和各分区内容的地址，分区内容直接引用代码段、数据
+// 段和生成的符号表等已有的内存，写文件时使用 writev 聚集写入，不需要拷贝到一个连续的文
+// 件缓存中，输出需要的额外内存只有文件头部和分区头部。
+
+#define OBJ_MAX_EXTRA (OSEC_EXTRA_MAX + DWSEC_NUM) // 用户的附加分区、调试信息分区和构建标识
+#define OBJ_MAX_SECS (OSEC_NUM + 2 * OBJ_MAX_EXTRA) // 每个附加分区可能有一个重定位分区
+#define OBJ_MAX_PARTS (1 + 2 * OBJ_MAX_SECS) // 文件头部，每个分区的对齐填充和内容
+#define OBJ_RELNAME_MAX 64
+
+typedef bidpart_t objpart_t;
+
+typedef struct {
+    byte hdr[sizeof(Elf64Ehdr) + OBJ_MAX_SECS * sizeof(Elf64Shdr)];
+    buffer_t symtab;
+    buffer_t strtab;
+    buffer_t relatext;
+    buffer_t relarodata;
+    buffer_t reladata;
+    buffer_t snmstr;
+    elf_strtab_t names;
+    elf_strtab_t secnames;
+    uint32 secname[OBJ_MAX_SECS];
+    osec_t extra[OBJ_MAX_EXTRA]; // 附加分区，前 nuser 个是 cc->osecs 的浅拷贝
+    uint32 nextra;
+    uint32 nuser;
+    dwsec_t dwarf[DWSEC_NUM]; // 调试信息分区的内容
+    buffer_t note;  // 构建标识说明分区的内容
+    buffer_t xrela[OBJ_MAX_EXTRA]; // 附加分区的重定位分区内容
+    uint32 xrelsec[OBJ_MAX_EXTRA]; // 重定位分区应用到的附加分区
+    char xrelname[OBJ_MAX_EXTRA][OBJ_RELNAME_MAX];
+    uint32 nxrela;
+    uint32 zlevel;
+    buffer_t zsec[OBJ_MAX_EXTRA]; // 附加分区压缩之后的内容，为空表示不压缩
+    objpart_t part[OBJ_MAX_PARTS];
+    uint32 npart;
+    uint64 size;
+} objout_t;
+
+static const byte objzero[16];
+
+static void gobjpart(objout_t *o, const byte *a, uint64 n)
+{
+    if (n) {
+        o->part[o->npart].a = a;
+        o->part[o->npart].n = (uintd_t)n;
+        o->npart += 1;
+        o->size += n;
+    }
+}
+
+static void gobjsec(objout_t *o, sechdr_t *sh, const byte *a, uint64 n, uint64 align)
+{
+    uint64 pad = o->size & (align - 1);
+    if (pad) {
+        gobjpart(o, objzero, align - pad);
+    }
+    host_64_to_lp(o->size, sh->offset);
+    host_64_to_lp(n, sh->size);
+    if (a) {
+        gobjpart(o, a, n);
+    }
+}
+
+static void gobjoutfree(objout_t *o)
+{
+    uint32 i;
+    buffer_free(&o->symtab);
+    buffer_free(&o->strtab);
+    buffer_free(&o->relatext);
+    buffer_free(&o->relarodata);
+    buffer_free(&o->reladata);
+    buffer_free(&o->snmstr);
+    elf_strtab_free(&o->names);
+    elf_strtab_free(&o->secnames);
+    for (i = 0; i < OBJ_MAX_EXTRA; i += 1) {
+        buffer_free(&o->zsec[i]);
+        buffer_free(&o->xrela[i]);
+    }
+    for (i = o->nuser; i < o->nextra; i += 1) { // 调试信息分区的内容由 o->dwarf 释放
+        buffer_free(&o->extra[i].rels);
+    }
+    dwarf_free(o->dwarf);
+    buffer_free(&o->note);
+}
+
+bool gobjsection(chcc_t *cc, const char *name, uint32 type, uint32 align, bool zlib, const byte *a, uintd_t n) // 添加附加分区，内容被拷贝
+{
+    osec_t s;
+    if (cc->osecs.len / sizeof(osec_t) >= OSEC_EXTRA_MAX) {
+        return false;
+    }
+    memset(&s, 0, sizeof(osec_t));
+    s.name = name;
+    s.type = type;
+    s.align = align ? align : 1;
+    s.zlib = zlib;
+    if (n && !buffer_push(&s.data, a, n, 0)) {
+        return false;
+    }
+    if (!buffer_push(&cc->osecs, (byte *)&s, sizeof(osec_t), 0)) {
+        buffer_free(&s.data);
+        return false;
+    }
+    return true;
+}
+
+static void gobjzip_task(void *para, uint32 worker, uint32 task) // 每个任务压缩一个附加分区
+{
+    objout_t *o = (objout_t *)para;
+    osec_t *s = o->extra + task;
+    buffer_t *z = o->zsec + task;
+    if (!s->zlib || !s->data.len) {
+        return;
+    }
+    if (!elf_compress_section(s->data.a, s->data.len, s->align, o->zlevel, z) || z->len >= s->data.len) {
+        buffer_clear(z); // 压缩失败或者没有变小时保存原始内容
+    }
+}
+
+// 调试信息分区追加在用户的附加分区之后，只包含目标文件中定义的全局函数
+static bool gobjdwarf(chcc_t *cc, objout_t *o)
+{
+    static const char *names[DWSEC_NUM] = {"", ".debug_abbrev", ".debug_info", ".debug_line"};
+    fsym_t **defs = (fsym_t **)cc->odefs.a;
+    uint32 i, j, n = (uint32)(cc->odefs.len / sizeof(fsym_t *)), base = o->nextra - DWSEC_ABBREV;
+    dwfunc_t *f;
+    dwrel_t *r;
+    osrel_t e;
+    osec_t *s;
+    bool succ;
+    if (!cc->gdebug || !n) {
+        return true;
+    }
+    if (!(f = (dwfunc_t *)malloc(n * sizeof(dwfunc_t)))) {
+        return false;
+    }
+    for (i = 0; i < n; i += 1) {
+        f[i].name = defs[i]->v.symb.name->s.a;
+        f[i].namelen = (uint32)defs[i]->v.symb.name->s.len;
+        f[i].line = defs[i]->line;
+        f[i].offset = (uint64)((byte *)defs[i]->v.addr - cc->text_section);
+        f[i].size = defs[i]->clen;
+        f[i].rows = (const dwline_t *)defs[i]->lines.a;
+        f[i].nrow = (uint32)(defs[i]->lines.len / sizeof(dwline_t));
+    }
+    succ = dwarf_build(cc->srcname.a, (uint32)cc->srcname.len, f, n, (uint64)(cc->text - cc->text_section), o->dwarf);
+    free(f);
+    for (j = DWSEC_ABBREV; succ && j < DWSEC_NUM; j += 1) {
+        s = o->extra + o->nextra++;
+        s->name = names[j];
+        s->type = ELF_SEC_PROGBITS;
+        s->align = 1;
+        s->zlib = true;
+        s->data = o->dwarf[j].data;
+        r = (dwrel_t *)o->dwarf[j].rels.a;
+        for (i = 0; succ && i < o->dwarf[j].rels.len / sizeof(dwrel_t); i += 1) {
+            e.offset = r[i].offset;
+            e.type = (r[i].size == 8) ? ELF_R_X86_64_64 : ELF_R_X86_64_32;
+            e.sec = (r[i].target == DWSEC_TEXT) ? OSEC_TEXT : OSEC_EXTRA(base + r[i].target);
+            e.addend = r[i].addend;
+            succ = buffer_push(&s->rels, (byte *)&e, sizeof(osrel_t), 0);
+        }
+    }
+    return succ;
+}
+
+// 构建标识是最后一个附加分区，链接生成可执行文件时丢弃，内容在文件布局完成之后计算
+static bool gobjbuildid(objout_t *o)
+{
+    osec_t *s = o->extra + o->nextra++;
+    if (!buffer_init(&o->note, BUILDID_NOTE_SIZE)) {
+        return false;
+    }
+    buildid_note(o->note.a);
+    o->note.len = BUILDID_NOTE_SIZE;
+    s->name = ".note.gnu.build-id";
+    s->type = ELF_SEC_NOTE;
+    s->align = 4;
+    s->flags = ELF_SF_EXCLUDE;
+    s->data = o->note;
+    return true;
+}
+
+static uint32 gobjsecsym(uint32 sec) // 分区符号的索引，附加分区的分区符号在 .bss 的分区符号之后
+{
+    return (sec < OSEC_EXTRA(0)) ? sec : OSEC_BSS + 1 + (sec - OSEC_EXTRA(0));
+}
+
+static bool gobjxrela(objout_t *o) // 生成附加分区的重定位分区
+{
+    osrel_t *r;
+    uint32 i, j;
+    for (i = 0; i < o->nextra; i += 1) {
+        if (!o->extra[i].rels.len) {
+            continue;
+        }
+        r = (osrel_t *)o->extra[i].rels.a;
+        for (j = 0; j < o->extra[i].rels.len / sizeof(osrel_t); j += 1) {
+            if (!gobjrela(&o->xrela[o->nxrela], r[j].offset, gobjsecsym(r[j].sec), r[j].type, r[j].addend)) {
+                return false;
+            }
+        }
+        snprintf(o->xrelname[o->nxrela], OBJ_RELNAME_MAX, ".rela%s", o->extra[i].name);
+        o->xrelsec[o->nxrela++] = i;
+    }
+    return true;
+}
+
+static bool gobjlayout_(chcc_t *cc, objout_t *o) // 生成符号表和重定位表，计算文件布局
+{
+    fsym_t **defs = (fsym_t **)cc->odefs.a;
+    fsym_t **imps = (fsym_t **)cc->imps.a;
+    vsym_t **vars = (vsym_t **)cc->vars.a;
+    orel_t *r = (orel_t *)cc->orels.a;
+    uintd_t ndef = cc->odefs.len / sizeof(fsym_t *);
+    uintd_t nimp = cc->imps.len / sizeof(fsym_t *);
+    uintd_t nvar = cc->vars.len / sizeof(vsym_t *);
+    uintd_t nrel = cc->orels.len / sizeof(orel_t);
+    uintd_t i;
+    buffer_t *rela;
+    byte *base;
+    objfile_t obj;
+    sechdr_t extra[OBJ_MAX_EXTRA], xrela[OBJ_MAX_EXTRA];
+    const char *name;
+    byte *p;
+    memset(o, 0, sizeof(objout_t));
+    o->nuser = o->nextra = (uint32)(cc->osecs.len / sizeof(osec_t));
+    memcpy(o->extra, cc->osecs.a, cc->osecs.len);
+    o->zlevel = cc->ozlib;
+    if (!gobjdwarf(cc, o) || !gobjbuildid(o) || !gobjxrela(o)) {
+        return false;
+    }
+    if (o->zlevel && o->nextra) { // 附加分区之间没有依赖，并行压缩
+        thread_for(cc->jobs ? cc->jobs : 1, o->nextra, gobjzip_task, o);
+    }
+    if (!elf_strtab_init(&o->names) || !elf_strtab_init(&o->secnames)) {
+        return false;
+    }
+    for (i = 0; i < ndef; i += 1) { defs[i]->v.objsym = 0; }
+    for (i = 0; i < nimp; i += 1) { imps[i]->v.objsym = 0; }
+    for (i = 0; i < nvar; i += 1) { vars[i]->objsym = 0; }
+    for (i = 0; i < nrel; i += 1) { if (r[i].sym) r[i].sym->objsym = 0; }
+    // 空符号和分区符号是本地符号，必须在全局符号之前
+    if (!gobjsym(&o->symtab, &o->names, null, 0, ELF_SHNDX_UNDEF, 0, 0)) {
+        return false;
+    }
+    for (i = OSEC_TEXT; i <= OSEC_BSS + o->nextra; i += 1) {
+        if (!gobjsym(&o->symtab, &o->names, null, ELF_SYM_INFO(ELF_SYM_BIND_LOCAL, ELF_SYM_TYPE_SECTION),
+                (uint32)(i <= OSEC_BSS ? i : OSEC_NUM + i - OSEC_BSS - 1), 0, 0)) {
+            return false;
+        }
+    }
+    for (i = 0; i < ndef; i += 1) {
+        if (!gobjglobal(&o->symtab, &o->names, &defs[i]->v, OSEC_TEXT, (uint64)((byte *)defs[i]->v.addr - cc->text_section), defs[i]->clen)) {
+            return false;
+        }
+    }
+    for (i = 0; i < nvar; i += 1) { // 全局变量的地址是在未初始化数据段中的偏移
+        if (!gobjglobal(&o->symtab, &o->names, vars[i], OSEC_BSS, (uint64)vars[i]->addr, vars[i]->symb.size)) {
+            return false;
+        }
+    }
+    for (i = 0; i < nimp; i += 1) { // 外部函数的导入地址槽在链接时填入函数的地址
+        if (!gobjglobal(&o->symtab, &o->names, &imps[i]->v, ELF_SHNDX_UNDEF, 0, 0) ||
+            !gobjrela(&o->reladata, (uint64)(imps[i]->slot - cc->data_section), imps[i]->v.objsym, ELF_R_X86_64_64, 0)) {
+            return false;
+        }
+    }
+    for (i = 0; i < nrel; i += 1) {
+        if (r[i].sym && !r[i].sym->objsym && !gobjglobal(&o->symtab, &o->names, r[i].sym, ELF_SHNDX_UNDEF, 0, 0)) {
+            return false;
+        }
+        if (r[i].addr >= cc->rodata_section && r[i].addr < cc->rodata) { // 跳转表项
+            rela = &o->relarodata;
+            base = cc->rodata_section;
+        } else {
+            rela = &o->relatext;
+            base = cc->text_section;
+        }
+        if (!gobjrela(rela, (uint64)(r[i].addr - base), r[i].sym ? r[i].sym->objsym : r[i].sec, r[i].type, r[i].addend)) {
+            return false;
+        }
+    }
+    for (i = 1; i < OSEC_NUM + o->nextra + o->nxrela; i += 1) {
+        name = (i < OSEC_NUM) ? objsecname[i] : (i < OSEC_NUM + o->nextra) ? o->extra[i - OSEC_NUM].name : o->xrelname[i - OSEC_NUM - o->nextra];
+        if ((o->secname[i] = elf_strtab_intern(&o->secnames, (const byte *)name, (uint32)strlen(name))) == 0xffffffff) {
+            return false;
+        }
+    }
+    if (!gobjsymname(&o->symtab, &o->names, &o->strtab) || !elf_strtab_build(&o->secnames, &o->snmstr)) {
+        return false;
+    }
+    for (i = 1; i < OSEC_NUM + o->nextra + o->nxrela; i += 1) {
+        o->secname[i] = elf_strtab_offset(&o->secnames, o->secname[i]);
+    }
+    p = gobjhdr(o->hdr, &obj, 1 + OSEC_BSS + o->nextra, o->secname, o->nextra + o->nxrela);
+    for (i = 0; i < o->nextra; i += 1) { // 压缩分区的对齐是压缩头部的对齐
+        p = gelfsechdr(p, extra + i, o->extra[i].type, o->extra[i].flags | (o->zsec[i].len ? ELF_SF_COMPRESSED : 0),
+            o->zsec[i].len ? 8 : o->extra[i].align, 0);
+        host_32_to_lp(o->secname[OSEC_NUM + i], extra[i].name);
+    }
+    for (i = 0; i < o->nxrela; i += 1) {
+        p = gelfrela(p, xrela + i);
+        host_32_to_lp(o->secname[OSEC_NUM + o->nextra + i], xrela[i].name);
+        host_32_to_lp(OSEC_SYMTAB, xrela[i].link);
+        host_32_to_lp(OSEC_NUM + o->xrelsec[i], xrela[i].link + 4);
+    }
+    gobjpart(o, o->hdr, (uint64)(p - o->hdr));
+    gobjsec(o, &obj.text, cc->text_section, cc->text - cc->text_section, 16);
+    gobjsec(o, &obj.rodata, cc->rodata_section, cc->rodata - cc->rodata_section, 8);
+    gobjsec(o, &obj.rodstr, cc->rodstr_section, cc->rodstr - cc->rodstr_section, 1);
+    gobjsec(o, &obj.data, cc->data_section, cc->data - cc->data_section, 8);
+    gobjsec(o, &obj.bss, null, cc->bss, 8); // 不占用文件空间，只记录大小
+    gobjsec(o, &obj.symtab, o->symtab.a, o->symtab.len, 8);
+    gobjsec(o, &obj.symstr, o->strtab.a, o->strtab.len, 1);
+    gobjsec(o, &obj.relatext, o->relatext.a, o->relatext.len, 8);
+    gobjsec(o, &obj.relarodata, o->relarodata.a, o->relarodata.len, 8);
+    gobjsec(o, &obj.reladata, o->reladata.a, o->reladata.len, 8);
+    gobjsec(o, &obj.snmstr, o->snmstr.a, o->snmstr.len, 1);
+    for (i = 0; i < o->nextra; i += 1) {
+        if (o->zsec[i].len) {
+            gobjsec(o, extra + i, o->zsec[i].a, o->zsec[i].len, 8);
+        } else {
+            gobjsec(o, extra + i, o->extra[i].data.a, o->extra[i].data.len, o->extra[i].align);
+        }
+    }
+    for (i = 0; i < o->nxrela; i += 1) {
+        gobjsec(o, xrela + i, o->xrela[i].a, o->xrela[i].len, 8);
+    }
+    // 说明分区的内容由 part 引用，哈希时构建标识为全零，算出后直接填入
+    return buildid_hash(o->part, o->npart, cc->jobs ? cc->jobs : 1, o->note.a + BUILDID_NOTE_DESC);
+}
+
+static bool gobjlayout(chcc_t *cc, objout_t *o)
+{
+    bool succ;
+    trace_begin("gobjlayout");
+    succ = gobjlayout_(cc, o);
+    trace_end("gobjlayout");
+    return succ;
+}
+
+bool gobjfile(chcc_t *cc, buffer_t *out) // 生成可重定位目标文件到内存 out
+{
+    objout_t *o = (objout_t *)malloc(sizeof(objout_t));
+    bool succ = false;
+    uint32 i;
+    if (!o) {
+        return false;
+    }
+    if (gobjlayout(cc, o)) {
+        buffer_clear(out);
+        if (out->a && out->cap < o->size) {
+            buffer_free(out);
+        }
+        if (out->a || buffer_init(out, o->size)) {
+            for (i = 0; i < o->npart; i += 1) {
+                memcpy(out->a + out->len, o->part[i].a, o->part[i].n);
+                out->len += o->part[i].n;
+            }
+            succ = true;
+        }
+    }
+    gobjoutfree(o);
+    free(o);
+    return succ;
+}
+
+#if defined(__MSC__)
+static bool gobjwritev(const char *filename, objout_t *o)
+{
+    FILE *fp;
+    bool succ;
+    uint32 i;
+    trace_begin("gobjwritev");
+    remove(filename); // 输出位置的旧文件可能是目标文件缓存的硬链接，不能改写
+    fp = fopen(filename, "wb");
+    succ = (fp != null);
+    for (i = 0; succ && i < o->npart; i += 1) {
+        succ = (fwrite(o->part[i].a, 1, o->part[i].n, fp) == o->part[i].n);
+    }
+    if (fp) {
+        succ = (fclose(fp) == 0) && succ;
+    }
+    if (!succ) {
+        remove(filename); // 不留下不完整的目标文件
+    }
+    trace_end("gobjwritev");
+    return succ;
+}
+#else
+static bool gobjwritev(const char *filename, objout_t *o)
+{
+    struct iovec iov[OBJ_MAX_PARTS];
+    uint32 i, n = o->npart, k = 0;
+    uint64 off = 0;
+    ssize_t w;
+    int fd;
+    bool succ = true;
+    trace_begin("gobjwritev");
+    unlink(filename); // 输出位置的旧文件可能是目标文件缓存的硬链接，不能改写
+    if ((fd = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0) {
+        trace_end("gobjwritev");
+        return false;
+    }
+    for (i = 0; i < n; i += 1) {
+        iov[i].iov_base = (void *)o->part[i].a;
+        iov[i].iov_len = o->part[i].n;
+    }
+    while (k < n) { // 部分写入时跳过已经写完的部分，从文件偏移 off 继续写
+        w = pwritev(fd, iov + k, (int)(n - k), (off_t)off);
+        if (w <= 0) { // 返回0表示无法继续写入，重试只会死循环
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        off += (uint64)w;
+        for (; k < n && (uintd_t)w >= iov[k].iov_len; k += 1) {
+            w -= iov[k].iov_len;
+        }
+        if (k < n) {
+            iov[k].iov_base = (byte *)iov[k].iov_base + w;
+            iov[k].iov_len -= w;
+        }
+    }
+    if (close(fd) != 0 || k != n) {
+        unlink(filename); // 不留下不完整的目标文件
+        succ = false;
+    }
+    trace_end("gobjwritev");
+    return succ;
+}
+#endif
+
+bool gobjsave(chcc_t *cc, const char *filename)
+{
+    objout_t *o = (objout_t *)malloc(sizeof(objout_t));
+    bool succ = false;
+    trace_begin("gobjsave");
+    if (o) {
+        succ = gobjlayout(cc, o) && gobjwritev(filename, o);
+        gobjoutfree(o);
+        free(o);
+    }
+    trace_end("gobjsave");
+    return succ;
+}
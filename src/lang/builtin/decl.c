@@ -1,5 +1,8 @@
 #define __CURR_FILE__ STRID_LANG_DECL
 #include "internal/decl.h"
+#include "builtin/region.h"
+#include "builtin/pool.h"
+#include <ctype.h>
 
 #if CONFIG_RT_ERROR_STRING
 const byte* builtin_errors_g[BUILTIN_NUM_ERRORS] = {
@@ -11,13 +14,75 @@ const byte* builtin_errors_g[BUILTIN_NUM_ERRORS] = {
 };
 #endif
 
-#if CONFIG_RT_FILE_STRING
-static const byte* file_strings_g[] = {
-#define FILE_MAPPING(ID, STR, LEVEL) STR,
+static const char* file_strings_g[] = { // log_level_set 按名称查找文件
+#define FILE_MAPPING(ID, STR) STR,
 #include "internal/init.h"
-#undef FILE_MAPPING
 };
-#endif
+
+static const byte log_levels_default_g[] = {
+#define FILE_MAPPING(ID, STR) LOG_LEVEL_OF(ID##_LOG_LEVEL),
+#include "internal/init.h"
+};
+
+byte log_levels_g[sizeof(log_levels_default_g)] = {
+#define FILE_MAPPING(ID, STR) LOG_LEVEL_OF(ID##_LOG_LEVEL),
+#include "internal/init.h"
+};
+
+static bool loglevelitem_(byte *levels, const char *name, uint32 len, char c)
+{
+    const char *p = c ? strchr("FMEID", toupper((unsigned char)c)) : null;
+    uint32 i, n = sizeof(log_levels_g);
+    bool found = false;
+    if (!p) {
+        return false;
+    }
+    for (i = 0; i < n; i += 1) {
+        if ((len == 1 && name[0] == '*') || (strlen(file_strings_g[i]) == len && !memcmp(file_strings_g[i], name, len))) {
+            levels[i] = (byte)(p - "FMEID");
+            found = true;
+        }
+    }
+    return found;
+}
+
+// spec 是以逗号、分号或空白分隔的 "文件=级别"，例如 "chcc/cifa=D, chcc/glink=I"，文件名
+// 为 * 时表示所有文件，级别是 F M E I D 之一。没有出现的文件恢复编译时的级别，spec 为空时
+// 全部恢复。新的级别先在局部数组中算好再逐个字节写入，其他线程不会看到中间状态的默认级
+// 别，每个文件的级别是修改之前或之后的值。有无法识别的项时返回 false，其余的项仍然生效。
+bool log_level_set(const char *spec)
+{
+    byte levels[sizeof(log_levels_g)];
+    const char *p = spec, *name;
+    uint32 i;
+    bool ok = true;
+    memcpy(levels, log_levels_default_g, sizeof(levels));
+    while (p && *p) {
+        if (*p == ',' || *p == ';' || isspace((unsigned char)*p)) {
+            p += 1;
+            continue;
+        }
+        name = p;
+        while (*p && *p != '=' && *p != ',' && *p != ';' && !isspace((unsigned char)*p)) {
+            p += 1;
+        }
+        if (*p != '=' || !loglevelitem_(levels, name, (uint32)(p - name), p[1])) {
+            ok = false;
+        }
+        while (*p && *p != ',' && *p != ';' && !isspace((unsigned char)*p)) {
+            p += 1;
+        }
+    }
+    for (i = 0; i < sizeof(levels); i += 1) {
+        LOG_LEVEL_STORE(i, levels[i]);
+    }
+    return ok;
+}
+
+bool log_level_init(void) // 从环境变量 CHAPL_LOG_LEVEL 读取
+{
+    return log_level_set(getenv("CHAPL_LOG_LEVEL"));
+}
 
 void assertfault_(uint16 file, uint32 line)
 {
@@ -65,10 +130,18 @@ void assertfaults_(uint16 file, uint32 argn_line, string_t s, ...)
     exit(1);
 }
 
+logsink_t logsink_g = null;
+
 void logtrace_(errot err, uint32 file_err, uint32 line)
 {
     const byte* err_str = null;
     strid_t file = LOG_FILE(file_err);
+    logsink_t sink = logsink_g;
+
+    if (sink) {
+        sink(err, file_err, line, null);
+        return;
+    }
 
 #if CONFIG_RT_FILE_STRING
     if (err_str) {
@@ -90,6 +163,18 @@ void logtracex_(errot err, uint32 file_err, uint32 argn_line, ...)
     uint32 argn = LOG_ARGN(argn_line);
     strid_t file = LOG_FILE(file_err);
     uint32 a, i = 0;
+    uint32 args[32];
+    logsink_t sink = logsink_g;
+    if (sink) {
+        va_list vl;
+        va_start(vl, argn_line);
+        for (; i < argn; ++i) {
+            args[i] = va_arg(vl, uint32);
+        }
+        va_end(vl);
+        sink(err, file_err, argn_line, args);
+        return;
+    }
     printf("[%c] %02x#%04d %02X:", LOG_CHAR(argn_line), file, LOG_LINE(argn_line), (uint32)err);
     va_list vl;
     va_start(vl, argn_line);
@@ -122,6 +207,16 @@ void logtraces_(errot err, uint32 file_err, uint32 argn_line, string_t s, ...)
     printf("\n");
 }
 
+static void *ralloc_(region_t *r, int96 n) // r 为空时从堆分配
+{
+    return r ? region_alloc(r, (uint96)n) : malloc(n);
+}
+
+static void *rrealloc_(region_t *r, void *p, int96 old, int96 n)
+{
+    return r ? region_realloc(r, p, (uint96)old, (uint96)n) : realloc(p, n);
+}
+
 bool string_init(string_t *s, const byte *a, int96 len, bool alloc)
 {
     byte *p = 0;
@@ -158,6 +253,23 @@ void string_move(string_t *to, string_t *from)
     string_move_init(to, from);
 }
 
+bool string_init_r(string_t *s, const byte *a, int96 len, region_t *r) // 区域中的字符串不设置 dyn
+{
+    byte *p = 0;
+    if (!r) {
+        return string_init(s, a, len, true);
+    }
+    len = (a && len > 0) ? len : 0;
+    s->len = 0;
+    s->dyn = 0;
+    if (len && (p = (byte *)region_alloc(r, len))) {
+        memcpy(p, a, len);
+        s->len = len;
+    }
+    s->a = p;
+    return (p != 0);
+}
+
 string_t string_create(const byte *a, int96 len, bool alloc)
 {
     string_t s;
@@ -180,14 +292,14 @@ void string_free(string_t *s)
     memset(s, 0, sizeof(string_t));
 }
 
-static array_t *arrayinit_(array2_t *a, int96 elt_bytes, int96 elt_count, int96 N, int96 elt_off)
+static array_t *arrayinit_(array2_t *a, int96 elt_bytes, int96 elt_count, int96 N, int96 elt_off, region_t *r)
 {
     int96 bytes;
     array_t *p;
     elt_bytes = (elt_bytes > 0) ? elt_bytes : 1;
     bytes = elt_bytes * elt_count;
     bytes = (bytes > 0) ? bytes : elt_bytes;
-    p = (array_t *)malloc(N + bytes);
+    p = (array_t *)ralloc_(r, N + bytes);
     if (p) {
         memset(p, 0, N);
         p->cap = elt_count;
@@ -203,17 +315,22 @@ static array_t *arrayinit_(array2_t *a, int96 elt_bytes, int96 elt_count, int96
 
 bool arrfix_init(arrfix2_t *a, int96 len)
 {
-    return arrayinit_((array2_t *)a, 1, len, sizeof(arrfix_t), 0) != 0;
+    return arrayinit_((array2_t *)a, 1, len, sizeof(arrfix_t), 0, null) != 0;
 }
 
 bool arrfix_ex_init(arrfix2_ex_t *p, int96 elt_bytes, int96 elt_count)
 {
-    return arrayinit_((array2_t *)p, elt_bytes, elt_count, sizeof(arrfix_ex_t), 1) != 0;
+    return arrayinit_((array2_t *)p, elt_bytes, elt_count, sizeof(arrfix_ex_t), 1, null) != 0;
 }
 
 bool array_init(array2_t *a, int96 cap)
 {
-    return arrayinit_(a, 1, cap, sizeof(array_t), 0) != 0;
+    return arrayinit_(a, 1, cap, sizeof(array_t), 0, null) != 0;
+}
+
+bool array_init_r(array2_t *a, int96 cap, region_t *r)
+{
+    return arrayinit_(a, 1, cap, sizeof(array_t), 0, r) != 0;
 }
 
 void array_free(array2_t *a)
@@ -224,7 +341,7 @@ void array_free(array2_t *a)
     }
 }
 
-static bool arraypush_(array2_t *a2, const byte* data, int96 elt_count, int96 expand, int96 elt_bytes, int96 N)
+static bool arraypush_(array2_t *a2, const byte* data, int96 elt_count, int96 expand, int96 elt_bytes, int96 N, region_t *r)
 {
     array_t *a = a2->a;
     array_t *p;
@@ -242,7 +359,7 @@ static bool arraypush_(array2_t *a2, const byte* data, int96 elt_count, int96 ex
     }
     if (cap_bytes < len2_bytes) {
         expand = (expand > 0) ? (len2 + expand) : (len2 * 2);
-        p = (array_t *)realloc(a, N + expand * elt_bytes);
+        p = (array_t *)rrealloc_(r, a, N + cap_bytes, N + expand * elt_bytes);
         if (!p) {
             return false;
         }
@@ -256,22 +373,37 @@ static bool arraypush_(array2_t *a2, const byte* data, int96 elt_count, int96 ex
 
 bool array_push(array2_t *a2, const byte* data, int96 len, int96 expand)
 {
-    return arraypush_(a2, data, len, expand, 1, sizeof(array_t));
+    return arraypush_(a2, data, len, expand, 1, sizeof(array_t), null);
+}
+
+bool array_push_r(array2_t *a2, const byte* data, int96 len, int96 expand, region_t *r)
+{
+    return arraypush_(a2, data, len, expand, 1, sizeof(array_t), r);
 }
 
 bool array_ex_init(array2_ex_t *a, int96 elt_bytes, int96 elt_count)
 {
-    return arrayinit_((array2_t *)a, elt_bytes, elt_count, sizeof(array_ex_t), 2) != 0;
+    return arrayinit_((array2_t *)a, elt_bytes, elt_count, sizeof(array_ex_t), 2, null) != 0;
+}
+
+bool array_ex_init_r(array2_ex_t *a, int96 elt_bytes, int96 elt_count, region_t *r)
+{
+    return arrayinit_((array2_t *)a, elt_bytes, elt_count, sizeof(array_ex_t), 2, r) != 0;
 }
 
 bool array_ex_push(array2_ex_t *a, const byte* data, int96 expand)
 {
-    return arraypush_((array2_t *)a, data, 1, expand, a->a->elt, sizeof(array_ex_t));
+    return arraypush_((array2_t *)a, data, 1, expand, a->a->elt, sizeof(array_ex_t), null);
+}
+
+bool array_ex_push_r(array2_ex_t *a, const byte* data, int96 expand, region_t *r)
+{
+    return arraypush_((array2_t *)a, data, 1, expand, a->a->elt, sizeof(array_ex_t), r);
 }
 
 bool buffix_init(buffix2_t *b, int96 cap)
 {
-    buffix_t *p = (buffix_t *)arrayinit_((array2_t *)b, 1, cap, sizeof(buffix_t), 0);
+    buffix_t *p = (buffix_t *)arrayinit_((array2_t *)b, 1, cap, sizeof(buffix_t), 0, null);
     if (p) {
         p->cur = buffix_data(p);
         return true;
@@ -283,11 +415,11 @@ typedef struct {
     byte *a;
 } buffer_head_t;
 
-byte *bufferinit_(buffer_head_t *b, int96 cap, bool cap_filed_uint, int96 N)
+static byte *bufferinitr_(buffer_head_t *b, int96 cap, bool cap_filed_uint, int96 N, region_t *r)
 {
     byte *p;
     cap = (cap > 0) ? cap : 1;
-    p = (byte *)malloc(cap);
+    p = (byte *)ralloc_(r, cap);
     if (p) {
         b->a = p;
         b += 1;
@@ -303,6 +435,11 @@ byte *bufferinit_(buffer_head_t *b, int96 cap, bool cap_filed_uint, int96 N)
     return p;
 }
 
+byte *bufferinit_(buffer_head_t *b, int96 cap, bool cap_filed_uint, int96 N)
+{
+    return bufferinitr_(b, cap, cap_filed_uint, N, null);
+}
+
 void bufferfree_(buffer_head_t *b, int96 N)
 {
     if (b->a) {
@@ -313,7 +450,12 @@ void bufferfree_(buffer_head_t *b, int96 N)
 
 bool buffer_init(buffer_t *b, int96 cap)
 {
-    return bufferinit_((buffer_head_t *)b, cap, true, sizeof(buffer_t)) != 0;
+    return bufferinitr_((buffer_head_t *)b, cap, true, sizeof(buffer_t), null) != 0;
+}
+
+bool buffer_init_r(buffer_t *b, int96 cap, region_t *r)
+{
+    return bufferinitr_((buffer_head_t *)b, cap, true, sizeof(buffer_t), r) != 0;
 }
 
 void buffer_move_init(buffer_t *b, buffer_t *from)
@@ -340,11 +482,32 @@ void buffer_free(buffer_t *b)
     bufferfree_((buffer_head_t *)b, sizeof(buffer_t));
 }
 
-bool buffer_push(buffer_t *b, const byte* a, int96 n, int96 expand)
+// expand <= 0 时缓存的默认增长策略：小缓存至少分配 BUFFER_MIN_CAP 字节，之后按需要的长度
+// 加倍；超过 BUFFER_PAGE_GROW 之后每次增长一半并按页取整，这样的大块内存由系统直接映射，
+// glibc 的 realloc 通过 mremap 扩大，不需要拷贝内容，按页取整避免每次增长都重新映射
+#define BUFFER_MIN_CAP 64
+#define BUFFER_PAGE_GROW (256 * 1024)
+#define BUFFER_PAGE_SIZE 4096
+
+static int96 buffergrow_(int96 need, int96 expand)
+{
+    if (expand > 0) {
+        return need + expand;
+    }
+    if (need < BUFFER_MIN_CAP) {
+        return BUFFER_MIN_CAP;
+    }
+    if (need < BUFFER_PAGE_GROW) {
+        return need * 2;
+    }
+    return (int96)upr_times_of_N((upr)(need + need / 2), BUFFER_PAGE_SIZE);
+}
+
+static bool bufferpush_(buffer_t *b, const byte* a, int96 n, int96 expand, region_t *r)
 {
     int96 len2;
     void *p;
-    if (!b->a && !buffer_init(b, n)) {
+    if (!b->a && !buffer_init_r(b, buffergrow_(n, expand), r)) {
         return false;
     }
     if (!a || n <= 0) {
@@ -361,8 +524,8 @@ bool buffer_push(buffer_t *b, const byte* a, int96 n, int96 expand)
         //  如果传入的 ptr 为空，相当于 malloc(size)
         //  如果传入的 size 为零，相当于 free(ptr)，此时返回的指针可能为空，也可能指向不能解引用的内存位置
         //  当 size 不为零的情况下，如果返回空指针表示分配失败，ptr 指向的旧空间仍然有效
-        expand = (expand > 0) ? (len2 + expand) : (len2 * 2);
-        p = realloc(b->a, expand);
+        expand = buffergrow_(len2, expand);
+        p = rrealloc_(r, b->a, b->cap, expand);
         if (!p) {
             return false;
         }
@@ -374,11 +537,26 @@ bool buffer_push(buffer_t *b, const byte* a, int96 n, int96 expand)
     return true;
 }
 
+bool buffer_push(buffer_t *b, const byte* a, int96 n, int96 expand)
+{
+    return bufferpush_(b, a, n, expand, null);
+}
+
+bool buffer_push_r(buffer_t *b, const byte* a, int96 n, int96 expand, region_t *r)
+{
+    return bufferpush_(b, a, n, expand, r);
+}
+
 bool buffer_put(buffer_t *b, byte a, int96 expand)
 {
     return buffer_push(b, &a, 1, expand);
 }
 
+bool buffer_put_r(buffer_t *b, byte a, int96 expand, region_t *r)
+{
+    return bufferpush_(b, &a, 1, expand, r);
+}
+
 void buffer_pop(buffer_t *b, int96 n)
 {
     if (n > 0 && (int96)b->len >= n) {
@@ -416,41 +594,88 @@ byte *slist_pop_front_node(slist_t *l)
     return p ? (byte *)(p + 1) : null;
 }
 
-bool slist_pop_front(slist_t *l, free_t func)
+static void nodefree_(snode_t *n, pool_t *p) // p 为空时节点从堆分配
+{
+    if (p) {
+        pool_release(p, n);
+    } else {
+        free(n);
+    }
+}
+
+static bool slistpopfront_(slist_t *l, free_t func, pool_t *pool)
 {
     snode_t *p = slistpop_(l);
     if (p) {
         if (func) {
             func(p + 1);
         }
-        free(p);
+        nodefree_(p, pool);
         return true;
     }
     return false;
 }
 
-void slist_free(slist_t *l, free_t func){
+bool slist_pop_front(slist_t *l, free_t func)
+{
+    return slistpopfront_(l, func, null);
+}
+
+bool slist_pop_front_p(slist_t *l, free_t func, pool_t *p)
+{
+    return slistpopfront_(l, func, p);
+}
+
+static void slistfree_(slist_t *l, free_t func, pool_t *p)
+{
     snode_t *n;
     while ((n = l->head.next)) {
         l->head.next = n->next;
         if (func) {
             func(n + 1);
         }
-        free(n);
+        nodefree_(n, p);
     }
     l->tail = null;
 }
 
-struct stack_it *stack_new_it(int96 obj_bytes)
+void slist_free(slist_t *l, free_t func){
+    slistfree_(l, func, null);
+}
+
+void slist_free_p(slist_t *l, free_t func, pool_t *p)
+{
+    slistfree_(l, func, p);
+}
+
+static struct stack_it *stacknewit_(int96 obj_bytes, region_t *r)
 {
     int96 alloc = sizeof(snode_t) + (obj_bytes > 0 ? obj_bytes : 1);
-    snode_t *p = (snode_t *)malloc(alloc);
+    snode_t *p = (snode_t *)ralloc_(r, alloc);
     if (p) {
         memset(p, 0, alloc);
     }
     return (struct stack_it *)p;
 }
 
+struct stack_it *stack_new_it(int96 obj_bytes)
+{
+    return stacknewit_(obj_bytes, null);
+}
+
+static struct stack_it *stacknewitp_(int96 obj_bytes, pool_t *pool)
+{
+    int96 alloc = sizeof(snode_t) + (obj_bytes > 0 ? obj_bytes : 1);
+    snode_t *p;
+    if (!pool) {
+        return stack_new_it(obj_bytes);
+    }
+    if ((p = (snode_t *)pool_alloc(pool, alloc))) {
+        memset(p, 0, alloc);
+    }
+    return (struct stack_it *)p;
+}
+
 snode_t *stackinsertafter_x_(struct stack_it *it, struct stack_it *node)
 {
     snode_t *p = (snode_t *)it;
@@ -463,23 +688,45 @@ snode_t *stackinsertafter_x_(struct stack_it *it, struct stack_it *node)
     return 0;
 }
 
-byte *slist_push_front(slist_t *l, int96 obj_bytes)
+static byte *slistpushfront_(slist_t *l, struct stack_it *node)
 {
-    snode_t *n = stackinsertafter_x_((struct stack_it *)l, stack_new_it(obj_bytes));
+    snode_t *n = stackinsertafter_x_((struct stack_it *)l, node);
     if (l->tail == null) {
         l->tail = n;
     }
     return n ? (byte *)(n + 1) : 0;
 }
 
-byte *slist_push_back(slist_t *l, int96 obj_bytes)
+byte *slist_push_front(slist_t *l, int96 obj_bytes)
+{
+    return slistpushfront_(l, stack_new_it(obj_bytes));
+}
+
+byte *slist_push_front_p(slist_t *l, int96 obj_bytes, pool_t *p)
+{
+    return slistpushfront_(l, stacknewitp_(obj_bytes, p));
+}
+
+static byte *slistpushback_(slist_t *l, struct stack_it *node)
 {
     struct stack_it *p = l->tail ? (struct stack_it *)l->tail : (struct stack_it *)l;
-    snode_t *n = stackinsertafter_x_(p, stack_new_it(obj_bytes));
-    l->tail = n;
+    snode_t *n = stackinsertafter_x_(p, node);
+    if (n) { // 分配失败时保持原来的尾节点
+        l->tail = n;
+    }
     return n ? (byte *)(n + 1) : 0;
 }
 
+byte *slist_push_back(slist_t *l, int96 obj_bytes)
+{
+    return slistpushback_(l, stack_new_it(obj_bytes));
+}
+
+byte *slist_push_back_p(slist_t *l, int96 obj_bytes, pool_t *p)
+{
+    return slistpushback_(l, stacknewitp_(obj_bytes, p));
+}
+
 byte *stackinsertafter_(struct stack_it *it, struct stack_it *node)
 {
     snode_t *n = stackinsertafter_x_(it, node);
@@ -496,12 +743,34 @@ byte *stack_push(stack_t *s, int96 obj_bytes)
     return stack_push_it(s, stack_new_it(obj_bytes));
 }
 
+byte *stack_push_r(stack_t *s, int96 obj_bytes, region_t *r)
+{
+    return stack_push_it(s, stacknewit_(obj_bytes, r));
+}
+
+byte *stack_push_p(stack_t *s, int96 obj_bytes, pool_t *p)
+{
+    return stack_push_it(s, stacknewitp_(obj_bytes, p));
+}
+
 byte *stack_new_node(int96 obj_bytes)
 {
     snode_t *n = (snode_t *)stack_new_it(obj_bytes);
     return n ? (byte *)(n + 1) : 0;
 }
 
+byte *stack_new_node_r(int96 obj_bytes, region_t *r)
+{
+    snode_t *n = (snode_t *)stacknewit_(obj_bytes, r);
+    return n ? (byte *)(n + 1) : 0;
+}
+
+byte *stack_new_node_p(int96 obj_bytes, pool_t *p)
+{
+    snode_t *n = (snode_t *)stacknewitp_(obj_bytes, p);
+    return n ? (byte *)(n + 1) : 0;
+}
+
 byte *stack_push_node(stack_t *s, const byte *node)
 {
     return stackinsertafter_((struct stack_it *)s, (struct stack_it *)(node - sizeof(snode_t)));
@@ -550,15 +819,41 @@ byte *stack_replace(struct stack_before_it *p, struct stack_it *node, free_t fun
     return stackinsertafter_((struct stack_it *)b, node);
 }
 
+static bool stackpop_(stack_t *s, free_t func, pool_t *pool)
+{
+    snode_t *p = s->top;
+    if (p) {
+        s->top = p->next;
+        if (func) {
+            func(p + 1);
+        }
+        nodefree_(p, pool);
+        return true;
+    }
+    return false;
+}
+
 bool stack_pop(stack_t *s, free_t func)
+{
+    return stackpop_(s, func, null);
+}
+
+bool stack_pop_p(stack_t *s, free_t func, pool_t *p)
+{
+    return stackpop_(s, func, p);
+}
+
+bool stack_pop_r(stack_t *s, free_t func, region_t *r)
 {
     snode_t *p = s->top;
+    if (!r) {
+        return stack_pop(s, func);
+    }
     if (p) {
         s->top = p->next;
         if (func) {
             func(p + 1);
         }
-        free(p);
         return true;
     }
     return false;
@@ -571,7 +866,14 @@ void stack_free_node(const byte *node)
     }
 }
 
-void stack_free(stack_t *s, free_t func)
+void stack_free_node_p(const byte *node, pool_t *p)
+{
+    if (node) {
+        nodefree_((snode_t *)(node - sizeof(snode_t)), p);
+    }
+}
+
+static void stackfree_(stack_t *s, free_t func, pool_t *pool)
 {
     snode_t *p;
     while ((p = s->top)) {
@@ -579,11 +881,21 @@ void stack_free(stack_t *s, free_t func)
         if (func) {
             func(p + 1);
         }
-        free(p);
+        nodefree_(p, pool);
     }
 }
 
-bool bhash_init(bhash2_t *p, int96 len)
+void stack_free(stack_t *s, free_t func)
+{
+    stackfree_(s, func, null);
+}
+
+void stack_free_p(stack_t *s, free_t func, pool_t *p)
+{
+    stackfree_(s, func, p);
+}
+
+static bool bhashinit_(bhash2_t *p, int96 len, region_t *r)
 {
     int96 alloc;
     bhash_t *a;
@@ -591,23 +903,32 @@ bool bhash_init(bhash2_t *p, int96 len)
         len = 2;
     }
     alloc = sizeof(bhash_t) + len * sizeof(snode_t);
-    a = (bhash_t *)malloc(alloc);
+    a = (bhash_t *)ralloc_(r, alloc);
     p->a = a;
     if (a) {
         memset(a, 0, alloc);
         a->len = len; // len 必须是 2 的幂
         return true;
     }
-    a->len = 0;
     return false;
 }
 
+bool bhash_init(bhash2_t *p, int96 len)
+{
+    return bhashinit_(p, len, null);
+}
+
+bool bhash_init_r(bhash2_t *p, int96 len, region_t *r)
+{
+    return bhashinit_(p, len, r);
+}
+
 void bhash_free(bhash2_t *p, free_t func)
 {
     bhash_t *a = p->a;
     if (!a) return;
     int96 i = 0;
-    int96 n = a->len + 1;
+    int96 n = a->len;
     snode_t *head = (snode_t *)(a + 1);
     snode_t *node = 0;
     for (; i < n; i += 1) {
@@ -624,7 +945,7 @@ void bhash_free(bhash2_t *p, free_t func)
     free(a);
 }
 
-byte *bhash_push(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para, int96 obj_bytes, bool *exist)
+static byte *bhashpush_(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para, int96 obj_bytes, bool *exist, region_t *r)
 {
     snode_t *head = (snode_t *)(a + 1);
     hash &= (a->len - 1);
@@ -632,7 +953,7 @@ byte *bhash_push(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para, int9
     if (exist) *exist = 0;
 label_loop:
     if (!head->next) {
-        return bhash_push_x((bhash_node_t){head}, obj_bytes);
+        return bhash_push_x_r((bhash_node_t){head}, obj_bytes, r);
     }
     if (eq((byte *)(head->next + 1), cmp_para)) {
         if (exist) *exist = 1;
@@ -642,6 +963,16 @@ label_loop:
     goto label_loop;
 }
 
+byte *bhash_push(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para, int96 obj_bytes, bool *exist)
+{
+    return bhashpush_(a, hash, eq, cmp_para, obj_bytes, exist, null);
+}
+
+byte *bhash_push_r(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para, int96 obj_bytes, bool *exist, region_t *r)
+{
+    return bhashpush_(a, hash, eq, cmp_para, obj_bytes, exist, r);
+}
+
 snode_t *bhashfind_(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para)
 {
     snode_t *head = (snode_t *)(a + 1);
@@ -672,11 +1003,16 @@ byte *bhash_find_x(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para, bh
 }
 
 byte *bhash_push_x(bhash_node_t p, int96 obj_bytes)
+{
+    return bhash_push_x_r(p, obj_bytes, null);
+}
+
+byte *bhash_push_x_r(bhash_node_t p, int96 obj_bytes, region_t *r)
 {
     snode_t *head = p.node;
     snode_t *node = 0;
     int96 alloc = sizeof(snode_t) + (obj_bytes > 0 ? obj_bytes : 1);
-    node = (snode_t *)malloc(alloc);
+    node = (snode_t *)ralloc_(r, alloc);
     if (node) {
         memset(node, 0, alloc);
         head->next = node;
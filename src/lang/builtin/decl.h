@@ -129,8 +129,14 @@ extern "C" {
 
 void assertfault_(u16 file, u32 line);
 void assertfaultx_(u16 file, u32 argn_line, ...);
+void assertfaults_(u16 file, u32 argn_line, string_t s, ...);
 void logtrace_(errot err, u32 file_err, u32 line);
 void logtracex_(errot err, u32 file_err, u32 argn_line, ...);
+void logtraces_(errot err, u32 file_err, u32 argn_line, string_t s, ...);
+
+// 不为空时 logtrace_/logtracex_ 把日志交给它记录，不再立即格式化输出，见 direct/binlog.h
+typedef void (*logsink_t)(errot err, u32 file_err, u32 argn_line, const u32 *args);
+extern logsink_t logsink_g;
 
 #define X_FILE(err) (__CURR_FILE__ << 16)
 #define X_ARGN_LINE(argn) (((argn) << 27) | __LINE__)
@@ -146,42 +152,44 @@ void logtracex_(errot err, u32 file_err, u32 argn_line, ...);
 #define log_fatal_x(err, n, ...) logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_F, (n)), __VA_ARGS__)
 #define log_fatal_s_x(err, s, n, ...) logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_F, (n)), (s), ## __VA_ARGS__)
 
+// 每个源文件的日志级别保存在 log_levels_g 中（LOG_LEVEL(line) 的值，0 到 4），初始值是
+// internal/init.h 中编译时指定的 __LOG_LEVEL__，运行时可以用 log_level_set 修改。调用处只
+// 检查一次这个字节，没有开启的日志只是一个不跳转的分支，参数不会被求值。调试日志仍然只在
+// CONFIG_DEBUG 时编译。其他线程运行时修改级别，每个字节用宽松的原子操作读写，在 x86 上
+// 和普通的读写是同样的指令。
+extern byte log_levels_g[];
+bool log_level_set(const char *spec);
+bool log_level_init(void);
+
 #define __LOG_LEVEL__ X_X_NAME(__CURR_FILE__, _LOG_LEVEL)
+#define LOG_LEVEL_OF(c) ((c) == 'D' ? 4 : (c) == 'I' ? 3 : (c) == 'E' ? 2 : (c) == 'M' ? 1 : 0)
 
-#if (__LOG_LEVEL__ == 'M' || __LOG_LEVEL__ == 'E' || __LOG_LEVEL__ == 'I' || __LOG_LEVEL__ == 'D')
-#define log_main(err) logtrace_((err), X_FILE(err), LOG_LEVEL_M|__LINE__)
-#define log_main_x(err, n, ...) logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_M, (n)), __VA_ARGS__)
-#define log_main_s_x(err, s, n, ...) logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_M, (n)), (s), ## __VA_ARGS__)
+#if defined(__GNU__)
+#define LOG_LEVEL_LOAD(i) __atomic_load_n(&log_levels_g[i], __ATOMIC_RELAXED)
+#define LOG_LEVEL_STORE(i, v) __atomic_store_n(&log_levels_g[i], (v), __ATOMIC_RELAXED)
+#define LOG_ENABLED(level) __builtin_expect(LOG_LEVEL_LOAD(__CURR_FILE__) >= ((level) >> 24), 0)
 #else
-#define log_main(err)
-#define log_main_x(err, n, ...)
-#define log_main_s_x(err, s, n, ...)
+#define LOG_LEVEL_LOAD(i) (*(volatile byte *)&log_levels_g[i])
+#define LOG_LEVEL_STORE(i, v) (*(volatile byte *)&log_levels_g[i] = (v))
+#define LOG_ENABLED(level) (LOG_LEVEL_LOAD(__CURR_FILE__) >= ((level) >> 24))
 #endif
 
-#if (__LOG_LEVEL__ == 'E' || __LOG_LEVEL__ == 'I' || __LOG_LEVEL__ == 'D')
-#define log_error(err) logtrace_((err), X_FILE(err), LOG_LEVEL_E|__LINE__)
-#define log_error_x(err, n, ...) logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_E, (n)), __VA_ARGS__)
-#define log_error_s_x(err, s, n, ...) logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_E, (n)), (s), ## __VA_ARGS__)
-#else
-#define log_error(err)
-#define log_error_x(err, n, ...)
-#define log_error_s_x(err, s, n, ...)
-#endif
+#define log_main(err) (LOG_ENABLED(LOG_LEVEL_M) ? logtrace_((err), X_FILE(err), LOG_LEVEL_M|__LINE__) : (void)0)
+#define log_main_x(err, n, ...) (LOG_ENABLED(LOG_LEVEL_M) ? logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_M, (n)), __VA_ARGS__) : (void)0)
+#define log_main_s_x(err, s, n, ...) (LOG_ENABLED(LOG_LEVEL_M) ? logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_M, (n)), (s), ## __VA_ARGS__) : (void)0)
 
-#if (__LOG_LEVEL__ == 'I' || __LOG_LEVEL__ == 'D')
-#define log_info(err) logtrace_((err), X_FILE(err), LOG_LEVEL_I|__LINE__)
-#define log_info_x(err, n, ...) logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_I, (n)), __VA_ARGS__)
-#define log_info_s_x(err, s, n, ...) logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_I, (n)), (s), ## __VA_ARGS__)
-#else
-#define log_info(err)
-#define log_info_x(err, n, ...)
-#define log_info_s_x(err, s, n, ...)
-#endif
+#define log_error(err) (LOG_ENABLED(LOG_LEVEL_E) ? logtrace_((err), X_FILE(err), LOG_LEVEL_E|__LINE__) : (void)0)
+#define log_error_x(err, n, ...) (LOG_ENABLED(LOG_LEVEL_E) ? logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_E, (n)), __VA_ARGS__) : (void)0)
+#define log_error_s_x(err, s, n, ...) (LOG_ENABLED(LOG_LEVEL_E) ? logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_E, (n)), (s), ## __VA_ARGS__) : (void)0)
+
+#define log_info(err) (LOG_ENABLED(LOG_LEVEL_I) ? logtrace_((err), X_FILE(err), LOG_LEVEL_I|__LINE__) : (void)0)
+#define log_info_x(err, n, ...) (LOG_ENABLED(LOG_LEVEL_I) ? logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_I, (n)), __VA_ARGS__) : (void)0)
+#define log_info_s_x(err, s, n, ...) (LOG_ENABLED(LOG_LEVEL_I) ? logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_I, (n)), (s), ## __VA_ARGS__) : (void)0)
 
-#if (__LOG_LEVEL__ == 'D') && defined(CONFIG_DEBUG)
-#define log_debug(err) logtrace_((err), X_FILE(err), LOG_LEVEL_D|__LINE__)
-#define log_debug_x(err, n, ...) logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_D, (n)), __VA_ARGS__)
-#define log_debug_s_x(err, s, n, ...) logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_D, (n)), (s), ## __VA_ARGS__)
+#if defined(CONFIG_DEBUG)
+#define log_debug(err) (LOG_ENABLED(LOG_LEVEL_D) ? logtrace_((err), X_FILE(err), LOG_LEVEL_D|__LINE__) : (void)0)
+#define log_debug_x(err, n, ...) (LOG_ENABLED(LOG_LEVEL_D) ? logtracex_((err), X_FILE(err), X_LINE(LOG_LEVEL_D, (n)), __VA_ARGS__) : (void)0)
+#define log_debug_s_x(err, s, n, ...) (LOG_ENABLED(LOG_LEVEL_D) ? logtraces_((err), X_FILE(err), X_LINE(LOG_LEVEL_D, (n)), (s), ## __VA_ARGS__) : (void)0)
 #else
 #define log_debug(err)
 #define log_debug_x(err, n, ...)
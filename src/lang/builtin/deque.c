@@ -0,0 +1,187 @@
+#include "builtin/deque.h"
+
+extern inline byte *deque_at(const deque_t *d, uint96 i);
+extern inline byte *deque_front(const deque_t *d);
+extern inline byte *deque_back(const deque_t *d);
+
+#define DEQUE_PER(d) ((uint96)1 << (d)->shift)
+#define DEQUE_MAP(d, k) ((d)->map[((d)->mhead + (k)) & ((d)->mapcap - 1)])
+
+void deque_init(deque_t *d, uint32 elt_bytes)
+{
+    memset(d, 0, sizeof(deque_t));
+    d->elt = elt_bytes ? elt_bytes : 1;
+    while (((uint96)2 << d->shift) * d->elt <= DEQUE_BLOCK_BYTES) {
+        d->shift += 1;
+    }
+}
+
+static byte *dequeblock_(deque_t *d)
+{
+    byte *b = d->spare;
+    if (b) {
+        d->spare = null;
+        return b;
+    }
+    return (byte *)malloc(DEQUE_PER(d) * d->elt);
+}
+
+static void dequerelease_(deque_t *d, byte *b)
+{
+    if (d->spare) {
+        free(d->spare);
+    }
+    d->spare = b;
+}
+
+static bool dequemap_(deque_t *d) // 索引表满时加倍，块指针按顺序搬到新表的开头
+{
+    uint96 cap = d->mapcap ? d->mapcap * 2 : 8, k;
+    byte **map;
+    if (d->nblock < d->mapcap) {
+        return true;
+    }
+    if (!(map = (byte **)malloc(cap * sizeof(byte *)))) {
+        return false;
+    }
+    for (k = 0; k < d->nblock; k += 1) {
+        map[k] = DEQUE_MAP(d, k);
+    }
+    free(d->map);
+    d->map = map;
+    d->mapcap = cap;
+    d->mhead = 0;
+    return true;
+}
+
+void deque_clear(deque_t *d)
+{
+    uint96 k;
+    for (k = 0; k < d->nblock; k += 1) {
+        dequerelease_(d, DEQUE_MAP(d, k));
+    }
+    d->nblock = d->head = d->len = d->mhead = 0;
+}
+
+void deque_free(deque_t *d)
+{
+    deque_clear(d);
+    free(d->spare);
+    free(d->map);
+    deque_init(d, d->elt);
+}
+
+byte *deque_push_back(deque_t *d, const void *data)
+{
+    uint96 pos = d->head + d->len;
+    byte *b, *p;
+    if (pos == (d->nblock << d->shift)) { // 最后一个块已满
+        if (!dequemap_(d) || !(b = dequeblock_(d))) {
+            return null;
+        }
+        DEQUE_MAP(d, d->nblock) = b;
+        d->nblock += 1;
+    }
+    p = deque_at(d, d->len);
+    d->len += 1;
+    if (data) {
+        memcpy(p, data, d->elt);
+    }
+    return p;
+}
+
+byte *deque_push_front(deque_t *d, const void *data)
+{
+    byte *b;
+    if (d->head == 0) { // 第一个块已满，在索引表前面增加一个块
+        if (!dequemap_(d) || !(b = dequeblock_(d))) {
+            return null;
+        }
+        d->mhead = (d->mhead - 1) & (d->mapcap - 1);
+        d->map[d->mhead] = b;
+        d->nblock += 1;
+        d->head = DEQUE_PER(d);
+    }
+    d->head -= 1;
+    d->len += 1;
+    if (data) {
+        memcpy(deque_at(d, 0), data, d->elt);
+    }
+    return deque_at(d, 0);
+}
+
+bool deque_pop_back(deque_t *d, void *out)
+{
+    if (!d->len) {
+        return false;
+    }
+    d->len -= 1;
+    if (out) {
+        memcpy(out, deque_at(d, d->len), d->elt);
+    }
+    if (d->head + d->len == ((d->nblock - 1) << d->shift)) { // 最后一个块已空
+        d->nblock -= 1;
+        dequerelease_(d, DEQUE_MAP(d, d->nblock));
+        if (!d->nblock) {
+            d->head = 0;
+        }
+    }
+    return true;
+}
+
+bool deque_pop_front(deque_t *d, void *out)
+{
+    if (!d->len) {
+        return false;
+    }
+    if (out) {
+        memcpy(out, deque_at(d, 0), d->elt);
+    }
+    d->head += 1;
+    d->len -= 1;
+    if (!d->len) { // 队列为空时保留最后一个块，从头开始使用
+        d->head = 0;
+    } else if (d->head == DEQUE_PER(d)) { // 第一个块已空
+        dequerelease_(d, d->map[d->mhead]);
+        d->mhead = (d->mhead + 1) & (d->mapcap - 1);
+        d->nblock -= 1;
+        d->head = 0;
+    }
+    return true;
+}
+
+bool deque_append(deque_t *d, const void *data, uint96 n)
+{
+    const byte *a = (const byte *)data;
+    uint96 pos, room, m;
+    while (n) {
+        pos = d->head + d->len;
+        if (pos == (d->nblock << d->shift)) {
+            if (!deque_push_back(d, a)) {
+                return false;
+            }
+            a += d->elt;
+            n -= 1;
+            continue;
+        }
+        room = DEQUE_PER(d) - (pos & (DEQUE_PER(d) - 1)); // 最后一个块剩余的位置
+        m = (n < room) ? n : room;
+        memcpy(DEQUE_MAP(d, pos >> d->shift) + (pos & (DEQUE_PER(d) - 1)) * d->elt, a, m * d->elt);
+        d->len += m;
+        a += m * d->elt;
+        n -= m;
+    }
+    return true;
+}
+
+byte *deque_run(const deque_t *d, uint96 i, uint96 *n)
+{
+    uint96 pos = d->head + i, room;
+    if (i >= d->len) {
+        *n = 0;
+        return null;
+    }
+    room = DEQUE_PER(d) - (pos & (DEQUE_PER(d) - 1));
+    *n = (d->len - i < room) ? (d->len - i) : room;
+    return deque_at(d, i);
+}
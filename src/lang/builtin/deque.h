@@ -0,0 +1,73 @@
+#ifndef CHAPL_BUILTIN_DEQUE_H
+#define CHAPL_BUILTIN_DEQUE_H
+#include "builtin/decl.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 分块双端队列：元素保存在固定大小的块中，块指针保存在环形的索引表中，两端压入和弹出都
+// 是 O(1)，不移动已有的元素。元素的地址在它被弹出之前保持不变，两端压入只会扩大索引表，
+// 不会移动块。每个块包含 2 的幂个元素，第 i 个元素的位置由 head + i 移位和取余得到。最近
+// 释放的一个块留作备用，在一端反复压入弹出时不会反复分配。
+//
+// 从 array_t/array_ex_t 迁移：
+//
+//  array_init(&a, cap)                     deque_init(&d, 1)
+//  array_ex_init(&a, elt_bytes, count)     deque_init(&d, elt_bytes)
+//  array_push(&a, data, n, expand)         deque_append(&d, data, n)
+//  array_ex_push(&a, data, expand)         deque_push_back(&d, data)
+//  删除第一个元素（memmove 之后 len 减1） deque_pop_front(&d, out)
+//  删除最后一个元素（len 减1）             deque_pop_back(&d, out)
+//  在开头插入（memmove 之后写入）          deque_push_front(&d, data)
+//  元素地址 data + i * elt_bytes           deque_at(&d, i)
+//  顺序遍历连续的内存                      deque_run(&d, i, &n)，每次得到一段连续的元素
+//  array_free(&a)                          deque_free(&d)
+//
+// 元素不再连续，需要把整个数组当作一块内存传递的代码（memcpy、qsort、写文件）应该保留
+// array_t，或者用 deque_run 逐段处理。在中间删除元素（例如 BPE 合并循环中的 array_del）
+// 用双端队列也是 O(n)，这类循环应该改成一遍扫描、用写位置原地压缩，而不是逐个删除。
+
+#define DEQUE_BLOCK_BYTES 4096
+
+typedef struct {
+    byte **map;     // 块指针的环形索引表
+    uint96 mapcap;  // 索引表容量，2的幂
+    uint96 mhead;   // 第一个块在索引表中的位置
+    uint96 nblock;
+    uint96 head;    // 第一个元素在第一个块中的位置
+    uint96 len;
+    uint32 elt;     // 元素字节数
+    uint32 shift;   // 每个块 1 << shift 个元素
+    byte *spare;    // 备用的空块
+} deque_t;
+
+void deque_init(deque_t *d, uint32 elt_bytes);
+void deque_free(deque_t *d);
+void deque_clear(deque_t *d);
+byte *deque_push_back(deque_t *d, const void *data); // data 为空时不拷贝，返回新元素的地址
+byte *deque_push_front(deque_t *d, const void *data);
+bool deque_pop_back(deque_t *d, void *out); // out 可以为空
+bool deque_pop_front(deque_t *d, void *out);
+bool deque_append(deque_t *d, const void *data, uint96 n); // 在末尾追加 n 个元素，按块整段拷贝
+byte *deque_run(const deque_t *d, uint96 i, uint96 *n); // 从第 i 个元素开始的连续元素，n 返回个数
+
+inline byte *deque_at(const deque_t *d, uint96 i) // i 必须小于 len
+{
+    uint96 pos = d->head + i, mask = ((uint96)1 << d->shift) - 1;
+    return d->map[(d->mhead + (pos >> d->shift)) & (d->mapcap - 1)] + (pos & mask) * d->elt;
+}
+
+inline byte *deque_front(const deque_t *d)
+{
+    return d->len ? deque_at(d, 0) : null;
+}
+
+inline byte *deque_back(const deque_t *d)
+{
+    return d->len ? deque_at(d, d->len - 1) : null;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_BUILTIN_DEQUE_H */
@@ -0,0 +1,98 @@
+#include "builtin/pool.h"
+#if defined(__MSC__)
+#include <malloc.h>
+#endif
+
+static pool_block_t *poolblock_(uint96 size) // 块按 POOL_BLOCK_SIZE 对齐
+{
+    void *b = null;
+#if defined(__MSC__)
+    b = _aligned_malloc(size, POOL_BLOCK_SIZE);
+#else
+    if (posix_memalign(&b, POOL_BLOCK_SIZE, size)) {
+        b = null;
+    }
+#endif
+    return (pool_block_t *)b;
+}
+
+static void poolblockfree_(pool_block_t *b)
+{
+#if defined(__MSC__)
+    _aligned_free(b);
+#else
+    free(b);
+#endif
+}
+
+void pool_init(pool_t *p, uint32 align)
+{
+    memset(p, 0, sizeof(pool_t));
+    p->align = align ? align : POOL_ALIGN;
+    if (p->align < POOL_ALIGN) {
+        p->align = POOL_ALIGN;
+    } else if (p->align > POOL_CACHE_LINE) {
+        p->align = POOL_CACHE_LINE;
+    }
+    p->hdr = (uint32)upr_times_of_N(sizeof(pool_block_t), p->align);
+}
+
+void *pool_alloc(pool_t *p, uint96 n)
+{
+    uint32 cls;
+    void **a;
+    pool_block_t *b;
+    n = n ? n : 1;
+    if (n > POOL_SMALL_MAX) {
+        if (n > POOL_BLOCK_SIZE - p->hdr || !(b = poolblock_(p->hdr + n))) {
+            return null;
+        }
+        b->next = null;
+        b->cls = POOL_CLASS_MAX;
+        return (byte *)b + p->hdr;
+    }
+    cls = (uint32)((n - 1) / p->align);
+    if ((a = (void **)p->free[cls])) {
+        p->free[cls] = *a;
+        return a;
+    }
+    n = (uint96)(cls + 1) * p->align;
+    if ((uint96)(p->end[cls] - p->cur[cls]) < n) {
+        if (!(b = poolblock_(POOL_BLOCK_SIZE))) {
+            return null;
+        }
+        b->next = p->block;
+        b->cls = cls;
+        p->block = b;
+        p->cur[cls] = (byte *)b + p->hdr;
+        p->end[cls] = (byte *)b + POOL_BLOCK_SIZE;
+    }
+    a = (void **)p->cur[cls];
+    p->cur[cls] += n;
+    return a;
+}
+
+void pool_release(pool_t *p, void *a)
+{
+    pool_block_t *b = (pool_block_t *)((upr)a & ~(upr)(POOL_BLOCK_SIZE - 1));
+    if (!a) {
+        return;
+    }
+    if (b->cls == POOL_CLASS_MAX) {
+        poolblockfree_(b);
+        return;
+    }
+    *(void **)a = p->free[b->cls];
+    p->free[b->cls] = a;
+}
+
+void pool_free(pool_t *p)
+{
+    pool_block_t *b;
+    uint32 align = p->align;
+    while ((b = p->block)) {
+        p->block = b->next;
+        poolblockfree_(b);
+    }
+    pool_init(p, align);
+}
@@ -0,0 +1,61 @@
+#ifndef CHAPL_BUILTIN_POOL_H
+#define CHAPL_BUILTIN_POOL_H
+#include "builtin/decl.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 节点池：链表和栈的节点按大小类别分配，每个类别有自己的空闲链表，释放的节点放回空闲链
+// 表，下次分配同一类别时直接取出，不再调用 malloc/free。空闲链表为空时从 POOL_BLOCK_SIZE
+// 大小的块中按顺序切出新节点，一个块只切同一类别的节点。块按自身大小对齐，节点地址按块
+// 大小取整就是所在的块，块头部记录了节点的类别，因此释放时不需要知道节点大小，节点本身
+// 也没有额外的头部。超过 POOL_SMALL_MAX 的对象单独分配一个对齐的块，释放时直接归还给系
+// 统。
+//
+// 节点对齐到 align 字节，align 为 POOL_CACHE_LINE 时每个节点独占缓存行，避免相邻节点被
+// 不同线程访问时的伪共享，代价是小节点占用更多内存。内存池不是线程安全的，可以每个链表
+// 一个内存池，也可以多个链表共用一个按大小类别分配的内存池。池中的块只在 pool_free 时释
+// 放。
+//
+// 容器的 _p 版本从内存池 p 中分配和释放节点，p 为空时与对应的普通版本相同。同一个容器的
+// 节点必须全部来自同一个内存池，或者全部来自堆。
+
+#define POOL_ALIGN (2 * sizeof(void *))
+#define POOL_CACHE_LINE 64
+#define POOL_BLOCK_SIZE (64 * 1024)
+#define POOL_SMALL_MAX 1024
+#define POOL_CLASS_MAX (POOL_SMALL_MAX / POOL_ALIGN)
+
+typedef struct pool_block {
+    struct pool_block *next;    // 切分节点的块串成链表，大对象的块不在链表中
+    uint32 cls;                 // 块中节点的大小类别，POOL_CLASS_MAX 表示大对象
+} pool_block_t;
+
+typedef struct {
+    void *free[POOL_CLASS_MAX]; // 每个大小类别的空闲链表，节点的第一个字指向下一个空闲节点
+    byte *cur[POOL_CLASS_MAX];  // 每个大小类别当前块中下一个节点的位置
+    byte *end[POOL_CLASS_MAX];
+    pool_block_t *block;
+    uint32 align;
+    uint32 hdr;                 // 块头部对齐之后的大小
+} pool_t;
+
+void pool_init(pool_t *p, uint32 align); // align 为0时使用 POOL_ALIGN，必须是2的幂且不超过 POOL_CACHE_LINE
+void *pool_alloc(pool_t *p, uint96 n); // 按 align 对齐，内容未初始化
+void pool_release(pool_t *p, void *a);
+void pool_free(pool_t *p); // 释放所有块，之前分配的节点全部失效
+
+byte *slist_push_front_p(slist_t *l, int96 obj_bytes, pool_t *p);
+byte *slist_push_back_p(slist_t *l, int96 obj_bytes, pool_t *p);
+bool slist_pop_front_p(slist_t *l, free_t func, pool_t *p);
+void slist_free_p(slist_t *l, free_t func, pool_t *p);
+byte *stack_new_node_p(int96 obj_bytes, pool_t *p);
+void stack_free_node_p(const byte *node, pool_t *p);
+byte *stack_push_p(stack_t *s, int96 obj_bytes, pool_t *p);
+bool stack_pop_p(stack_t *s, free_t func, pool_t *p);
+void stack_free_p(stack_t *s, free_t func, pool_t *p);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_BUILTIN_POOL_H */
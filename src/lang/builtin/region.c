@@ -0,0 +1,116 @@
+#include "builtin/region.h"
+
+#define REGION_HDR upr_times_of_N(sizeof(region_block_t), REGION_ALIGN)
+
+void region_init(region_t *r, uint96 block_size)
+{
+    memset(r, 0, sizeof(region_t));
+    block_size = block_size ? block_size : REGION_BLOCK_SIZE;
+    r->bsize = upr_times_of_N(block_size, REGION_ALIGN);
+    if (r->bsize < 2 * REGION_HDR) {
+        r->bsize = 2 * REGION_HDR;
+    }
+}
+
+static void regionrelease_(region_t *r, region_block_t *b) // 标准大小的块放入备用链表
+{
+    if ((uint96)(b->end - (byte *)b) == r->bsize) {
+        b->prev = r->spare;
+        r->spare = b;
+    } else {
+        free(b);
+    }
+}
+
+static bool regiongrow_(region_t *r, uint96 n) // 切换到一个至少能容纳 n 字节的新块
+{
+    uint96 size = REGION_HDR + n;
+    region_block_t *b;
+    if (size < n) {
+        return false;
+    }
+    if (size <= r->bsize && r->spare) {
+        b = r->spare;
+        r->spare = b->prev;
+    } else {
+        size = (size <= r->bsize) ? r->bsize : size; // 大对象单独占用一个块
+        if (!(b = (region_block_t *)malloc(size))) {
+            return false;
+        }
+        b->end = (byte *)b + size;
+    }
+    b->prev = r->block;
+    r->block = b;
+    r->cur = (byte *)b + REGION_HDR;
+    r->end = b->end;
+    return true;
+}
+
+void *region_alloc(region_t *r, uint96 n)
+{
+    byte *p;
+    n = upr_times_of_N(n ? n : 1, REGION_ALIGN);
+    if ((uint96)(r->end - r->cur) < n && !regiongrow_(r, n)) {
+        return null;
+    }
+    p = r->cur;
+    r->cur += n;
+    r->last = p;
+    return p;
+}
+
+void *region_realloc(region_t *r, void *p, uint96 old, uint96 n)
+{
+    byte *q;
+    if (!p) {
+        return region_alloc(r, n);
+    }
+    if ((byte *)p == r->last && (uint96)(r->end - (byte *)p) >= upr_times_of_N(n ? n : 1, REGION_ALIGN)) {
+        r->cur = (byte *)p + upr_times_of_N(n ? n : 1, REGION_ALIGN); // 对象在块的末尾，原地扩大或缩小
+        return p;
+    }
+    if (n <= old) {
+        return p;
+    }
+    if ((q = (byte *)region_alloc(r, n))) {
+        memcpy(q, p, old);
+    }
+    return q;
+}
+
+region_mark_t region_mark(region_t *r)
+{
+    region_mark_t m;
+    m.block = r->block;
+    m.cur = r->cur;
+    return m;
+}
+
+void region_rollback(region_t *r, region_mark_t m)
+{
+    region_block_t *b;
+    while (r->block != m.block) {
+        b = r->block;
+        r->block = b->prev;
+        regionrelease_(r, b);
+    }
+    r->cur = m.cur;
+    r->end = m.block ? m.block->end : null;
+    r->last = null;
+}
+
+void region_reset(region_t *r)
+{
+    region_mark_t m = {null, null};
+    region_rollback(r, m);
+}
+
+void region_free(region_t *r)
+{
+    region_block_t *b;
+    region_reset(r);
+    while ((b = r->spare)) {
+        r->spare = b->prev;
+        free(b);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef CHAPL_BUILTIN_REGION_H
+#define CHAPL_BUILTIN_REGION_H
+#include "builtin/decl.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 区域分配：从大块内存中按顺序切出小块，分配只是移动当前位置，单独的对象不释放，整个区
+// 域一次重置或释放。region_mark 记录当前位置，region_rollback 回退到记录的位置，回退之后
+// 记录之后分配的对象全部失效，记录可以嵌套，按后进先出的顺序回退。回退和重置空出来的标
+// 准大小的块保留在备用链表中，下次需要新块时复用，超过标准大小的块直接释放。最近一次分
+// 配的对象还在块的末尾时可以原地扩大，缓存在区域中增长时通常不需要拷贝。区域不是线程安
+// 全的，每个线程使用自己的区域。
+//
+// 容器的 _r 版本从区域 r 中分配内存，r 为空时与对应的普通版本相同，从堆中分配。从区域中
+// 分配的容器不能调用普通版本的释放函数（string_free 除外，区域中的字符串没有 dyn 标记），
+// 内存随区域回退、重置或释放时一起回收。
+
+#define REGION_ALIGN (2 * sizeof(void *))
+#define REGION_BLOCK_SIZE (64 * 1024)
+
+typedef struct region_block {
+    struct region_block *prev;
+    byte *end;
+} region_block_t;
+
+typedef struct {
+    byte *cur;              // 下一次分配的位置
+    byte *end;              // 当前块的结束位置
+    byte *last;             // 最近一次分配的对象，只有它可以原地扩大
+    region_block_t *block;  // 当前块，通过 prev 串连之前分配的块
+    region_block_t *spare;  // 回退或重置之后留待复用的块
+    uint96 bsize;           // 标准块的大小，包括块头部
+} region_t;
+
+typedef struct {
+    region_block_t *block;
+    byte *cur;
+} region_mark_t;
+
+void region_init(region_t *r, uint96 block_size); // block_size 为0时使用 REGION_BLOCK_SIZE
+void *region_alloc(region_t *r, uint96 n); // 按 REGION_ALIGN 对齐，内容未初始化
+void *region_realloc(region_t *r, void *p, uint96 old, uint96 n); // p 是最近一次分配的对象时原地扩大
+region_mark_t region_mark(region_t *r);
+void region_rollback(region_t *r, region_mark_t m);
+void region_reset(region_t *r); // 回收所有对象，保留内存块
+void region_free(region_t *r);
+
+bool string_init_r(string_t *s, const byte *a, int96 len, region_t *r);
+bool array_init_r(array2_t *a, int96 cap, region_t *r);
+bool array_push_r(array2_t *a, const byte *data, int96 len, int96 expand, region_t *r);
+bool array_ex_init_r(array2_ex_t *a, int96 elt_bytes, int96 elt_count, region_t *r);
+bool array_ex_push_r(array2_ex_t *a, const byte *data, int96 expand, region_t *r);
+bool buffer_init_r(buffer_t *b, int96 cap, region_t *r);
+bool buffer_push_r(buffer_t *b, const byte *a, int96 n, int96 expand, region_t *r);
+bool buffer_put_r(buffer_t *b, byte a, int96 expand, region_t *r);
+byte *stack_new_node_r(int96 obj_bytes, region_t *r);
+byte *stack_push_r(stack_t *s, int96 obj_bytes, region_t *r);
+bool stack_pop_r(stack_t *s, free_t func, region_t *r); // r 不为空时只调用 func 不释放节点
+bool bhash_init_r(bhash2_t *p, int96 len, region_t *r);
+byte *bhash_push_r(bhash_t *a, uint32 hash, equal_t eq, const void *cmp_para, int96 obj_bytes, bool *exist, region_t *r);
+byte *bhash_push_x_r(bhash_node_t p, int96 obj_bytes, region_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_BUILTIN_REGION_H */
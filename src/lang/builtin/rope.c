@@ -0,0 +1,480 @@
+#include "builtin/rope.h"
+
+extern inline uint96 rope_len(const rope_t *r);
+extern inline uint96 rope_lines(const rope_t *r);
+extern inline uint96 rope_runes(const rope_t *r);
+extern inline rune rope_iter_get(rope_iter_t *it);
+extern inline void rope_iter_unget(rope_iter_t *it);
+
+// 内部函数消耗传入节点的引用，返回的节点带有一个引用。内存分配失败时设置 oom，丢弃无法
+// 组合的部分，返回的树仍然可以正常释放，由公开的函数丢弃它并保留原来的树。
+
+#define ROPE_DATA(n) ((byte *)((n) + 1))
+
+static rope_node_t *roperef_(rope_node_t *n)
+{
+    if (n) {
+        n->ref += 1;
+    }
+    return n;
+}
+
+static void ropeunref_(rope_node_t *n)
+{
+    rope_node_t *r;
+    while (n && --n->ref == 0) { // 左子树递归，右子树循环
+        ropeunref_(n->left);
+        r = n->right;
+        free(n);
+        n = r;
+    }
+}
+
+static uint32 ropeheight_(const rope_node_t *n)
+{
+    return n ? n->height : 0;
+}
+
+static rope_node_t *ropeleaf_(const byte *a, uint96 na, const byte *b, uint96 nb, const byte *c, uint96 nc, bool *oom)
+{
+    rope_node_t *x;
+    byte *d;
+    uint96 i;
+    if (!na && !nb && !nc) {
+        return null;
+    }
+    if (!(x = (rope_node_t *)malloc(sizeof(rope_node_t) + na + nb + nc))) {
+        *oom = true;
+        return null;
+    }
+    memset(x, 0, sizeof(rope_node_t));
+    x->ref = 1;
+    x->bytes = na + nb + nc;
+    d = ROPE_DATA(x);
+    if (na) {
+        memcpy(d, a, na);
+    }
+    if (nb) {
+        memcpy(d + na, b, nb);
+    }
+    if (nc) {
+        memcpy(d + na + nb, c, nc);
+    }
+    for (i = 0; i < x->bytes; i += 1) {
+        x->lines += (d[i] == '\n');
+        x->runes += ((d[i] & 0xC0) != 0x80);
+    }
+    return x;
+}
+
+static rope_node_t *ropenode_(rope_node_t *l, rope_node_t *r, bool *oom)
+{
+    rope_node_t *x;
+    if (!l || !r) { // 内部节点总有两个子节点
+        return l ? l : r;
+    }
+    if (!(x = (rope_node_t *)malloc(sizeof(rope_node_t)))) {
+        ropeunref_(l);
+        ropeunref_(r);
+        *oom = true;
+        return null;
+    }
+    x->left = l;
+    x->right = r;
+    x->ref = 1;
+    x->height = ((l->height > r->height) ? l->height : r->height) + 1;
+    x->bytes = l->bytes + r->bytes;
+    x->lines = l->lines + r->lines;
+    x->runes = l->runes + r->runes;
+    return x;
+}
+
+static rope_node_t *ropebalance_(rope_node_t *l, rope_node_t *r, bool *oom) // 高度差不超过2
+{
+    rope_node_t *a, *b, *c, *d;
+    if (ropeheight_(l) > ropeheight_(r) + 1) {
+        a = roperef_(l->left);
+        b = roperef_(l->right);
+        ropeunref_(l);
+        if (ropeheight_(a) >= ropeheight_(b)) {
+            return ropenode_(a, ropenode_(b, r, oom), oom);
+        }
+        c = roperef_(b->left);
+        d = roperef_(b->right);
+        ropeunref_(b);
+        return ropenode_(ropenode_(a, c, oom), ropenode_(d, r, oom), oom);
+    }
+    if (ropeheight_(r) > ropeheight_(l) + 1) {
+        a = roperef_(r->left);
+        b = roperef_(r->right);
+        ropeunref_(r);
+        if (ropeheight_(b) >= ropeheight_(a)) {
+            return ropenode_(ropenode_(l, a, oom), b, oom);
+        }
+        c = roperef_(a->left);
+        d = roperef_(a->right);
+        ropeunref_(a);
+        return ropenode_(ropenode_(l, c, oom), ropenode_(d, b, oom), oom);
+    }
+    return ropenode_(l, r, oom);
+}
+
+static rope_node_t *ropejoin_(rope_node_t *a, rope_node_t *b, bool *oom)
+{
+    rope_node_t *l, *r, *x;
+    if (!a || !b) {
+        return a ? a : b;
+    }
+    if (!a->height && !b->height && a->bytes + b->bytes <= ROPE_LEAF_MAX) { // 合并相邻的小叶子
+        x = ropeleaf_(ROPE_DATA(a), a->bytes, ROPE_DATA(b), b->bytes, null, 0, oom);
+        ropeunref_(a);
+        ropeunref_(b);
+        return x;
+    }
+    if (a->height > b->height + 1) { // 沿着较高的树的边缘向下，直到高度相近
+        l = roperef_(a->left);
+        r = roperef_(a->right);
+        ropeunref_(a);
+        return ropebalance_(l, ropejoin_(r, b, oom), oom);
+    }
+    if (b->height > a->height + 1) {
+        l = roperef_(b->left);
+        r = roperef_(b->right);
+        ropeunref_(b);
+        return ropebalance_(ropejoin_(a, l, oom), r, oom);
+    }
+    return ropenode_(a, b, oom);
+}
+
+static void ropesplit_(rope_node_t *n, uint96 pos, rope_node_t **l, rope_node_t **r, bool *oom)
+{
+    rope_node_t *a, *b, *x, *y;
+    if (!n || !pos) {
+        *l = null;
+        *r = n;
+        return;
+    }
+    if (pos >= n->bytes) {
+        *l = n;
+        *r = null;
+        return;
+    }
+    if (!n->height) {
+        *l = ropeleaf_(ROPE_DATA(n), pos, null, 0, null, 0, oom);
+        *r = ropeleaf_(ROPE_DATA(n) + pos, n->bytes - pos, null, 0, null, 0, oom);
+        ropeunref_(n);
+        return;
+    }
+    a = roperef_(n->left);
+    b = roperef_(n->right);
+    ropeunref_(n);
+    if (pos <= a->bytes) {
+        ropesplit_(a, pos, &x, &y, oom);
+        *l = x;
+        *r = ropejoin_(y, b, oom);
+    } else {
+        pos -= a->bytes;
+        ropesplit_(b, pos, &x, &y, oom);
+        *l = ropejoin_(a, x, oom);
+        *r = y;
+    }
+}
+
+static rope_node_t *ropebuild_(const byte *a, uint96 n, bool *oom) // 左右子树的叶子个数最多差1
+{
+    uint96 leaves = (n + ROPE_LEAF_FILL - 1) / ROPE_LEAF_FILL, m;
+    rope_node_t *l;
+    if (leaves <= 1) {
+        return ropeleaf_(a, n, null, 0, null, 0, oom);
+    }
+    m = (leaves / 2) * ROPE_LEAF_FILL;
+    l = ropebuild_(a, m, oom);
+    return ropenode_(l, ropebuild_(a + m, n - m, oom), oom);
+}
+
+static bool ropefits_(const rope_node_t *n, uint96 pos, uint96 del, uint96 len) // 修改范围是否在一个叶子中
+{
+    while (n && n->height) {
+        if (pos + del <= n->left->bytes) {
+            n = n->left;
+        } else if (pos >= n->left->bytes) {
+            pos -= n->left->bytes;
+            n = n->right;
+        } else {
+            return false;
+        }
+    }
+    return n && n->bytes - del + len <= ROPE_LEAF_MAX && n->bytes - del + len > 0;
+}
+
+static rope_node_t *ropeput_(rope_node_t *n, uint96 pos, uint96 del, const byte *data, uint96 len, bool *oom)
+{
+    rope_node_t *x, *a, *b;
+    if (!n->height) { // 叶子的高度不变，路径上的节点不需要重新平衡
+        x = ropeleaf_(ROPE_DATA(n), pos, data, len, ROPE_DATA(n) + pos + del, n->bytes - pos - del, oom);
+        ropeunref_(n);
+        return x;
+    }
+    a = roperef_(n->left);
+    b = roperef_(n->right);
+    ropeunref_(n);
+    if (pos + del <= a->bytes) {
+        return ropenode_(ropeput_(a, pos, del, data, len, oom), b, oom);
+    }
+    pos -= a->bytes;
+    return ropenode_(a, ropeput_(b, pos, del, data, len, oom), oom);
+}
+
+static bool ropeset_(rope_t *r, rope_node_t *x, bool oom)
+{
+    if (oom) {
+        ropeunref_(x);
+        return false;
+    }
+    ropeunref_(r->root);
+    r->root = x;
+    return true;
+}
+
+void rope_init(rope_t *r)
+{
+    r->root = null;
+}
+
+bool rope_from(rope_t *r, const byte *data, uint96 n)
+{
+    bool oom = false;
+    rope_init(r);
+    return ropeset_(r, ropebuild_(data, n, &oom), oom);
+}
+
+void rope_free(rope_t *r)
+{
+    ropeunref_(r->root);
+    r->root = null;
+}
+
+void rope_snapshot(const rope_t *r, rope_t *out)
+{
+    out->root = roperef_(r->root);
+}
+
+bool rope_insert(rope_t *r, uint96 pos, const byte *data, uint96 n)
+{
+    rope_node_t *a, *b, *x;
+    bool oom = false;
+    if (!n) {
+        return true;
+    }
+    if (pos > rope_len(r)) {
+        pos = rope_len(r);
+    }
+    if (ropefits_(r->root, pos, 0, n)) { // 常见的小段编辑只复制一条路径，不改变树的形状
+        x = ropeput_(roperef_(r->root), pos, 0, data, n, &oom);
+    } else {
+        ropesplit_(roperef_(r->root), pos, &a, &b, &oom);
+        x = ropejoin_(ropejoin_(a, ropebuild_(data, n, &oom), &oom), b, &oom);
+    }
+    return ropeset_(r, x, oom);
+}
+
+bool rope_erase(rope_t *r, uint96 pos, uint96 n)
+{
+    rope_node_t *a, *b, *mid, *rest;
+    bool oom = false;
+    if (pos >= rope_len(r) || !n) {
+        return true;
+    }
+    if (n > rope_len(r) - pos) {
+        n = rope_len(r) - pos;
+    }
+    if (ropefits_(r->root, pos, n, 0)) {
+        return ropeset_(r, ropeput_(roperef_(r->root), pos, n, null, 0, &oom), oom);
+    }
+    ropesplit_(roperef_(r->root), pos, &a, &rest, &oom);
+    ropesplit_(rest, n, &mid, &b, &oom);
+    ropeunref_(mid);
+    return ropeset_(r, ropejoin_(a, b, &oom), oom);
+}
+
+bool rope_append(rope_t *r, const rope_t *a)
+{
+    bool oom = false;
+    return ropeset_(r, ropejoin_(roperef_(r->root), roperef_(a->root), &oom), oom);
+}
+
+bool rope_substr(const rope_t *r, uint96 pos, uint96 n, rope_t *out)
+{
+    rope_node_t *a, *b, *mid, *rest;
+    bool oom = false;
+    rope_init(out);
+    ropesplit_(roperef_(r->root), pos, &a, &rest, &oom);
+    ropeunref_(a);
+    ropesplit_(rest, n, &mid, &b, &oom);
+    ropeunref_(b);
+    return ropeset_(out, mid, oom);
+}
+
+uint96 rope_line_start(const rope_t *r, uint96 line)
+{
+    const rope_node_t *n = r->root;
+    uint96 base = 0, i;
+    const byte *d;
+    if (!line) {
+        return 0;
+    }
+    if (!n || line > n->lines) {
+        return rope_len(r);
+    }
+    while (n->height) { // 查找第 line 个换行符
+        if (line <= n->left->lines) {
+            n = n->left;
+        } else {
+            line -= n->left->lines;
+            base += n->left->bytes;
+            n = n->right;
+        }
+    }
+    for (d = ROPE_DATA(n), i = 0; ; i += 1) {
+        if (d[i] == '\n' && !--line) {
+            return base + i + 1;
+        }
+    }
+}
+
+uint96 rope_rune_start(const rope_t *r, uint96 i)
+{
+    const rope_node_t *n = r->root;
+    uint96 base = 0, k = i + 1, j;
+    const byte *d;
+    if (!n || k > n->runes) {
+        return rope_len(r);
+    }
+    while (n->height) { // 查找第 k 个不是 10xxxxxx 的字节
+        if (k <= n->left->runes) {
+            n = n->left;
+        } else {
+            k -= n->left->runes;
+            base += n->left->bytes;
+            n = n->right;
+        }
+    }
+    for (d = ROPE_DATA(n), j = 0; ; j += 1) {
+        if ((d[j] & 0xC0) != 0x80 && !--k) {
+            return base + j;
+        }
+    }
+}
+
+static void ropeprefix_(const rope_node_t *n, uint96 pos, uint96 *lines, uint96 *runes) // [0, pos) 的统计
+{
+    const byte *d;
+    uint96 i;
+    *lines = *runes = 0;
+    if (!n || pos >= n->bytes) {
+        *lines = n ? n->lines : 0;
+        *runes = n ? n->runes : 0;
+        return;
+    }
+    while (n->height) {
+        if (pos < n->left->bytes) {
+            n = n->left;
+        } else {
+            pos -= n->left->bytes;
+            *lines += n->left->lines;
+            *runes += n->left->runes;
+            n = n->right;
+        }
+    }
+    for (d = ROPE_DATA(n), i = 0; i < pos; i += 1) {
+        *lines += (d[i] == '\n');
+        *runes += ((d[i] & 0xC0) != 0x80);
+    }
+}
+
+void rope_line_col(const rope_t *r, uint96 pos, uint96 *line, uint96 *col)
+{
+    uint96 runes, start, n;
+    ropeprefix_(r->root, pos, line, &runes);
+    ropeprefix_(r->root, rope_line_start(r, *line), &n, &start);
+    *col = runes - start;
+}
+
+uint96 rope_copy(const rope_t *r, uint96 pos, byte *out, uint96 n)
+{
+    rope_iter_t it;
+    const byte *p;
+    uint96 len, m = 0;
+    rope_iter_init(&it, r, pos);
+    while (m < n && (p = rope_iter_next(&it, &len))) {
+        len = (len < n - m) ? len : (n - m);
+        memcpy(out + m, p, len);
+        m += len;
+    }
+    return m;
+}
+
+static void ropeleftmost_(rope_iter_t *it, const rope_node_t *n)
+{
+    while (n->height) {
+        it->stack[it->top++] = n->right;
+        n = n->left;
+    }
+    it->cur = ROPE_DATA(n);
+    it->end = it->cur + n->bytes;
+}
+
+void rope_iter_init(rope_iter_t *it, const rope_t *r, uint96 pos)
+{
+    const rope_node_t *n = r->root;
+    it->top = 0;
+    it->cur = it->end = null;
+    it->eof = false;
+    if (!n || pos >= n->bytes) {
+        return;
+    }
+    while (n->height) {
+        if (pos < n->left->bytes) {
+            it->stack[it->top++] = n->right;
+            n = n->left;
+        } else {
+            pos -= n->left->bytes;
+            n = n->right;
+        }
+    }
+    it->cur = ROPE_DATA(n) + pos;
+    it->end = ROPE_DATA(n) + n->bytes;
+}
+
+const byte *rope_iter_next(rope_iter_t *it, uint96 *n)
+{
+    const byte *p;
+    if (it->cur == it->end) {
+        if (!it->top) {
+            *n = 0;
+            return null;
+        }
+        ropeleftmost_(it, it->stack[--it->top]);
+    }
+    p = it->cur;
+    *n = (uint96)(it->end - p);
+    it->cur = it->end;
+    return p;
+}
+
+rune rope_iter_get_ex(rope_iter_t *it, void (*f)(void *p, const byte *e), void *p)
+{
+    const byte *e = it->end;
+    if (it->cur == it->end) {
+        if (!it->top) {
+            it->eof = true;
+            return CHAR_EOF;
+        }
+        ropeleftmost_(it, it->stack[--it->top]);
+        if (f) {
+            f(p, e);
+        }
+    }
+    it->eof = false;
+    return *it->cur++;
+}
@@ -0,0 +1,101 @@
+#ifndef CHAPL_BUILTIN_ROPE_H
+#define CHAPL_BUILTIN_ROPE_H
+#include "builtin/decl.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 绳索（rope）文本缓存，用于常驻内存的源文件的增量编辑。文本保存在不超过 ROPE_LEAF_MAX
+// 字节的叶子节点中，内部节点组成高度平衡的二叉树（AVL），每个节点记录子树的字节数、换行
+// 符个数和 UTF-8 字符个数，按字节、行或字符定位都是 O(log n)。插入、删除和取子串都由分裂
+// 和连接组成，连接两棵树的代价与它们的高度差成正比。
+//
+// 节点创建之后不再修改，修改只复制从根到修改位置的路径，其余节点通过引用计数共享，因此
+// rope_snapshot 是 O(1) 的，快照不受之后修改的影响。引用计数不是原子的，同一棵树的快照
+// 在多个线程之间共享时，创建和释放快照需要调用者加锁，只读访问不需要。
+//
+// 词法分析不需要把文本展平成一块内存：rope_iter_get/rope_iter_unget 与 file_get/file_unget
+// 一样逐字节读取，多字节的 UTF-8 字符可以跨越叶子节点，由调用者解码；rope_iter_get_ex 在
+// 离开一个叶子节点之前调用 f(p, end)，与 file_get_ex 相同，用于拷贝跨越叶子节点的词法。
+// rope_iter_next 一次返回一段连续的字节。迭代器不持有引用，读取期间树（或它的快照）必须
+// 保持有效。
+
+#define ROPE_LEAF_MAX 1024
+#define ROPE_LEAF_FILL 768 // 成块插入时每个叶子的字节数，留出原地编辑的空间
+#define ROPE_MAX_HEIGHT 64
+
+typedef struct rope_node {
+    struct rope_node *left; // 叶子节点为空，数据紧跟在节点之后
+    struct rope_node *right;
+    uint32 ref;
+    uint32 height;          // 叶子节点为0
+    uint96 bytes;
+    uint96 lines;           // 换行符个数
+    uint96 runes;           // UTF-8 字符个数，即不是 10xxxxxx 的字节个数
+} rope_node_t;
+
+typedef struct {
+    rope_node_t *root;
+} rope_t;
+
+typedef struct {
+    const rope_node_t *stack[ROPE_MAX_HEIGHT]; // 还没有访问的右子树
+    uint32 top;
+    const byte *cur;
+    const byte *end;
+    bool eof;       // 最后一次读取返回了 CHAR_EOF
+} rope_iter_t;
+
+void rope_init(rope_t *r);
+bool rope_from(rope_t *r, const byte *data, uint96 n);
+void rope_free(rope_t *r);
+void rope_snapshot(const rope_t *r, rope_t *out); // 用 rope_free 释放快照
+bool rope_insert(rope_t *r, uint96 pos, const byte *data, uint96 n);
+bool rope_erase(rope_t *r, uint96 pos, uint96 n);
+bool rope_append(rope_t *r, const rope_t *a); // a 的节点被共享，a 保持不变
+bool rope_substr(const rope_t *r, uint96 pos, uint96 n, rope_t *out);
+uint96 rope_line_start(const rope_t *r, uint96 line); // 第 line 行（从0开始）的字节位置，超出返回字节数
+uint96 rope_rune_start(const rope_t *r, uint96 i); // 第 i 个字符的字节位置，超出返回字节数
+void rope_line_col(const rope_t *r, uint96 pos, uint96 *line, uint96 *col); // col 按字符计数，都从0开始
+uint96 rope_copy(const rope_t *r, uint96 pos, byte *out, uint96 n); // 返回实际拷贝的字节数
+
+void rope_iter_init(rope_iter_t *it, const rope_t *r, uint96 pos);
+const byte *rope_iter_next(rope_iter_t *it, uint96 *n); // 没有更多数据返回空
+rune rope_iter_get_ex(rope_iter_t *it, void (*f)(void *p, const byte *e), void *p);
+
+inline uint96 rope_len(const rope_t *r)
+{
+    return r->root ? r->root->bytes : 0;
+}
+
+inline uint96 rope_lines(const rope_t *r) // 换行符个数
+{
+    return r->root ? r->root->lines : 0;
+}
+
+inline uint96 rope_runes(const rope_t *r)
+{
+    return r->root ? r->root->runes : 0;
+}
+
+inline rune rope_iter_get(rope_iter_t *it) // 读取一个字节，结束返回 CHAR_EOF
+{
+    if (it->cur < it->end) {
+        return *it->cur++;
+    }
+    return rope_iter_get_ex(it, null, null);
+}
+
+inline void rope_iter_unget(rope_iter_t *it) // 只能回退当前叶子节点中已经读取的字节
+{
+    if (it->eof) {
+        it->eof = false;
+    } else {
+        it->cur -= 1;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_BUILTIN_ROPE_H */
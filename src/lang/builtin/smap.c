@@ -0,0 +1,112 @@
+#include "builtin/smap.h"
+
+extern inline uint64 smap_hash_u64(uint64 x);
+extern inline uint32 smap_ctz(uint32 m);
+extern inline uint32 smap_match(const byte *ctrl, byte h2);
+extern inline uint32 smap_match_free(const byte *ctrl);
+extern inline uint32 smap_match_empty(const byte *ctrl);
+
+uint64 smap_hash_bytes(const byte *a, uintd_t n) // 每次处理8个字节
+{
+    uint64 h = 0x9e3779b97f4a7c15ULL ^ (n * 0xc2b2ae3d27d4eb4fULL), w;
+    for (; n >= 8; n -= 8, a += 8) {
+        memcpy(&w, a, 8);
+        h = (h ^ smap_hash_u64(w)) * 0x9e3779b97f4a7c15ULL;
+    }
+    if (n) {
+        w = 0;
+        memcpy(&w, a, n);
+        h = (h ^ smap_hash_u64(w)) * 0x9e3779b97f4a7c15ULL;
+    }
+    return smap_hash_u64(h);
+}
+
+bool smap_init(smap_t *m, uint96 len, uint96 slot_bytes)
+{
+    uint96 cap = SMAP_MIN_CAP;
+    memset(m, 0, sizeof(smap_t));
+    while (cap - cap / 8 < len) {
+        cap *= 2;
+    }
+    if (!(m->ctrl = (byte *)malloc(cap + SMAP_GROUP + cap * slot_bytes))) { // 控制标记和槽位一次分配，槽位按16字节对齐
+        return false;
+    }
+    memset(m->ctrl, SMAP_EMPTY, cap + SMAP_GROUP);
+    m->slot = m->ctrl + cap + SMAP_GROUP;
+    m->cap = cap;
+    m->left = cap - cap / 8;
+    return true;
+}
+
+void smap_free(smap_t *m)
+{
+    free(m->ctrl);
+    memset(m, 0, sizeof(smap_t));
+}
+
+void smap_clear(smap_t *m)
+{
+    if (m->cap) {
+        memset(m->ctrl, SMAP_EMPTY, m->cap + SMAP_GROUP);
+        m->len = 0;
+        m->left = m->cap - m->cap / 8;
+    }
+}
+
+void smap_set_ctrl(smap_t *m, uint96 i, byte c)
+{
+    m->ctrl[i] = c;
+    if (i < SMAP_GROUP) { // 末尾重复开头的一组标记
+        m->ctrl[m->cap + i] = c;
+    }
+}
+
+uint96 smap_find_free(const smap_t *m, uint64 hash)
+{
+    uint96 mask = m->cap - 1, pos = (uint96)(hash >> 7), step = 0;
+    uint32 b;
+    for (; ;) {
+        pos &= mask;
+        if ((b = smap_match_free(m->ctrl + pos))) {
+            return (pos + smap_ctz(b)) & mask;
+        }
+        step += SMAP_GROUP;
+        pos += step;
+    }
+}
+
+static uint32 smapclz16_(uint32 b) // b 不为0，16位掩码最高位开始连续的0的个数
+{
+#if defined(__MSC__)
+    unsigned long i;
+    _BitScanReverse(&i, b);
+    return 15 - (uint32)i;
+#else
+    return (uint32)__builtin_clz(b) - 16;
+#endif
+}
+
+void smap_erase_at(smap_t *m, uint96 i)
+{
+    uint32 before = smap_match_empty(m->ctrl + ((i - SMAP_GROUP) & (m->cap - 1)));
+    uint32 after = smap_match_empty(m->ctrl + i);
+    m->len -= 1;
+    // 包含 i 的连续非空标记不足一组时，任何探测序列都不会在经过 i 的一组中找不到空槽位而继
+    // 续向后探测，可以直接标记为空，否则标记为已删除
+    if (before && after && smapclz16_(before) + smap_ctz(after) < SMAP_GROUP) {
+        smap_set_ctrl(m, i, SMAP_EMPTY);
+        m->left += 1;
+    } else {
+        smap_set_ctrl(m, i, SMAP_DELETED);
+    }
+}
+
+int96 smap_next(const smap_t *m, uint96 i)
+{
+    for (; i < m->cap; i += 1) {
+        if (!(m->ctrl[i] & 0x80)) {
+            return (int96)i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,208 @@
+#ifndef CHAPL_BUILTIN_SMAP_H
+#define CHAPL_BUILTIN_SMAP_H
+#include "builtin/decl.h"
+#include <stddef.h>
+#if defined(__MSC__)
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SMAP_SSE2 1
+#endif
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 开放寻址的哈希表：每个槽位有一个字节的控制标记，最高位为1表示空槽位或已删除的槽位，最
+// 高位为0时低7位是键的哈希值的低7位（h2）。查找时从哈希值其余的位（h1）确定的位置开始，
+// 每次用 SSE2 同时比较16个控制标记，只有标记等于 h2 的槽位才需要比较键，遇到空槽位说明
+// 键不存在。组之间按三角数序列探测，容量是2的幂时可以访问到所有组。控制标记数组末尾重复
+// 开头的 SMAP_GROUP 个标记，从任意位置开始读取一组时不需要回绕。
+//
+// 键值对直接保存在槽位中，插入不分配内存，负载超过 7/8 时容量加倍。删除的槽位所在的连续
+// 非空标记不足一组时可以直接标记为空，否则标记为已删除，避免截断经过它的探测序列，已删除
+// 的槽位在插入时复用，过多时在扩容时清理。
+//
+// SMAP_DEFINE(name, key_t, val_t, hash, equal) 为每种键值类型生成专门的函数，哈希和键的比
+// 较在生成的代码中内联展开，不通过函数指针调用。hash(key) 返回 uint64，equal(a, b) 比较两
+// 个键是否相等。生成的函数：
+//
+//  name_find(m, key)               返回值的地址，不存在返回 null
+//  name_insert(m, key, &exist)     返回值的地址，键不存在时插入一个未初始化的值
+//  name_erase(m, key)              删除成功返回 true
+//  name_slot(m, i)                 第 i 个槽位，与 smap_next 一起用于遍历
+//
+// 插入或扩容之后，之前返回的地址全部失效。哈希表不是线程安全的。
+
+#define SMAP_GROUP 16
+#define SMAP_EMPTY 0x80
+#define SMAP_DELETED 0xfe
+#define SMAP_MIN_CAP SMAP_GROUP
+
+typedef struct {
+    byte *ctrl;     // cap + SMAP_GROUP 个控制标记
+    byte *slot;     // cap 个槽位
+    uint96 cap;     // 容量是2的幂，为0时还没有分配
+    uint96 len;
+    uint96 left;    // 不需要扩容时还能占用的空槽位个数
+} smap_t;
+
+inline uint64 smap_hash_u64(uint64 x) // 整数键的哈希，所有位都参与 h1 和 h2
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64 smap_hash_bytes(const byte *a, uintd_t n);
+
+inline uint32 smap_ctz(uint32 m) // m 不为0
+{
+#if defined(__MSC__)
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return (uint32)i;
+#else
+    return (uint32)__builtin_ctz(m);
+#endif
+}
+
+inline uint32 smap_match(const byte *ctrl, byte h2) // 一组中标记等于 h2 的槽位
+{
+#if defined(SMAP_SSE2)
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)h2)));
+#else
+    uint32 i, m = 0;
+    for (i = 0; i < SMAP_GROUP; i += 1) {
+        m |= (uint32)(ctrl[i] == h2) << i;
+    }
+    return m;
+#endif
+}
+
+inline uint32 smap_match_free(const byte *ctrl) // 一组中的空槽位和已删除的槽位
+{
+#if defined(SMAP_SSE2)
+    return (uint32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    uint32 i, m = 0;
+    for (i = 0; i < SMAP_GROUP; i += 1) {
+        m |= (uint32)(ctrl[i] >> 7) << i;
+    }
+    return m;
+#endif
+}
+
+inline uint32 smap_match_empty(const byte *ctrl)
+{
+    return smap_match(ctrl, SMAP_EMPTY);
+}
+
+bool smap_init(smap_t *m, uint96 len, uint96 slot_bytes); // 预留 len 个键值对的空间
+void smap_free(smap_t *m);
+void smap_clear(smap_t *m);
+void smap_set_ctrl(smap_t *m, uint96 i, byte c);
+uint96 smap_find_free(const smap_t *m, uint64 hash); // 插入位置，调用前必须有空槽位
+void smap_erase_at(smap_t *m, uint96 i);
+int96 smap_next(const smap_t *m, uint96 i); // 从 i 开始的第一个有效槽位，没有返回 -1
+
+#define SMAP_EQUAL(a, b) ((a) == (b))
+#define SMAP_HASH(k) smap_hash_u64((uint64)(k))
+#define SMAP_STR_EQUAL(x, y) ((x).len == (y).len && !memcmp((x).a, (y).a, (x).len))
+#define SMAP_STR_HASH(k) smap_hash_bytes((k).a, (k).len)
+
+#define SMAP_DEFINE(name, key_t, val_t, hash, equal) \
+typedef struct { key_t key; val_t val; } name##_slot_t; \
+static name##_slot_t *name##_slot(const smap_t *m, uint96 i) \
+{ \
+    return (name##_slot_t *)m->slot + i; \
+} \
+static val_t *name##_find(const smap_t *m, key_t key) \
+{ \
+    uint64 h = hash(key); \
+    uint96 mask = m->cap - 1, pos = (uint96)(h >> 7), step = 0; \
+    uint32 b; \
+    name##_slot_t *s; \
+    if (!m->cap) { \
+        return null; \
+    } \
+    for (; ;) { \
+        pos &= mask; \
+        for (b = smap_match(m->ctrl + pos, (byte)(h & 0x7f)); b; b &= b - 1) { \
+            s = (name##_slot_t *)m->slot + ((pos + smap_ctz(b)) & mask); \
+            if (equal(s->key, key)) { \
+                return &s->val; \
+            } \
+        } \
+        if (smap_match_empty(m->ctrl + pos)) { \
+            return null; \
+        } \
+        step += SMAP_GROUP; \
+        pos += step; \
+    } \
+} \
+static bool name##_rehash_(smap_t *m) /* 已删除的槽位较多时只清理不扩容 */ \
+{ \
+    smap_t n; \
+    name##_slot_t *s; \
+    uint96 i, j; \
+    if (!smap_init(&n, m->len * 2, sizeof(name##_slot_t))) { \
+        return false; \
+    } \
+    for (i = 0; i < m->cap; i += 1) { \
+        if (m->ctrl[i] & 0x80) { \
+            continue; \
+        } \
+        s = (name##_slot_t *)m->slot + i; \
+        j = smap_find_free(&n, hash(s->key)); \
+        smap_set_ctrl(&n, j, m->ctrl[i]); \
+        ((name##_slot_t *)n.slot)[j] = *s; \
+    } \
+    n.len = m->len; \
+    n.left -= m->len; \
+    smap_free(m); \
+    *m = n; \
+    return true; \
+} \
+static val_t *name##_insert(smap_t *m, key_t key, bool *exist) \
+{ \
+    val_t *v = name##_find(m, key); \
+    uint64 h; \
+    uint96 i; \
+    name##_slot_t *s; \
+    if (exist) { \
+        *exist = (v != null); \
+    } \
+    if (v) { \
+        return v; \
+    } \
+    h = hash(key); \
+    if (!m->left && !name##_rehash_(m)) { \
+        return null; \
+    } \
+    i = smap_find_free(m, h); \
+    m->left -= (m->ctrl[i] == SMAP_EMPTY); /* 复用已删除的槽位不减少空槽位 */ \
+    m->len += 1; \
+    smap_set_ctrl(m, i, (byte)(h & 0x7f)); \
+    s = (name##_slot_t *)m->slot + i; \
+    s->key = key; \
+    return &s->val; \
+} \
+static bool name##_erase(smap_t *m, key_t key) \
+{ \
+    val_t *v = name##_find(m, key); \
+    if (!v) { \
+        return false; \
+    } \
+    smap_erase_at(m, (uint96)((name##_slot_t *)((byte *)v - offsetof(name##_slot_t, val)) - (name##_slot_t *)m->slot)); \
+    return true; \
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_BUILTIN_SMAP_H */
@@ -2,11 +2,20 @@
 #include "internal/decl.h"
 #include "chcc/chcc.h"
 #include "chcc/gabi.h"
+#include "chcc/gelf.h"
+#include "direct/trace.h"
 
 #define IDENT_HASH_INIT 1
 #define IDENT_HASH_SIZE (8*1024) // 必须是2的幂
 #define IDENT_ARRAY_EXPAND 512
-#define CFSTR_ALLOC_EXPAND 128
+#define INLINE_MAX_CODE_SIZE 64 // 自动内联的叶子函数的最大代码字节数
+#define INLINE_MAX_DEPTH 4 // 内联展开的最大嵌套深度
+#define FUNC_CODE_SIZE(n) ((n) * 16 + 256) // 并行生成时函数代码缓存的初始大小，按函数体源代码长度估计
+#define FUNC_CODE_MAX 0x4000000 // 空间不足时加倍重新生成，单个函数代码的最大大小
+#define OBJ_TEXT_SIZE 0x400000 // 生成目标文件时代码分区的最大大小
+#define OBJ_RODATA_SIZE 0x100000 // 只读数据和只读字符串各占一半
+#define OBJ_DATA_SIZE 0x40000
+#define OBJ_CCCFG "elf64_x86_64" // 目标文件只有这一种格式，作为缓存键的目标配置
 
 uint32 ident_hash(uint32 h, rune c)
 {
@@ -45,10 +54,14 @@ bool ident_eq(const void *object, const void *para)
 ident_t *findhashident(hashident_t *a, string_t s, uint32 hash)
 {
     identeq_t param = {&s};
-    return (ident_t *)bhash_find(&a->hash_ident, hash, ident_eq, &param);
+    ident_t *d;
+    if (a->lock) { mutex_lock(a->lock); }
+    d = (ident_t *)bhash_find(&a->hash_ident, hash, ident_eq, &param);
+    if (a->lock) { mutex_unlock(a->lock); }
+    return d;
 }
 
-ident_t *pushhashident_x(hashident_t *a, string_t s, string_t s2, uint32 hash, bool calc)
+static ident_t *pushhashident_x_(hashident_t *a, string_t s, string_t s2, uint32 hash, bool calc)
 {
     array_ex_t *arry_ident = a->arry_ident.a;
     bhash_t *hash_ident = a->hash_ident.a;
@@ -87,11 +100,59 @@ ident_t *pushhashident_x(hashident_t *a, string_t s, string_t s2, uint32 hash, b
     return d;
 }
 
+ident_t *pushhashident_x(hashident_t *a, string_t s, string_t s2, uint32 hash, bool calc)
+{
+    ident_t *d;
+    if (!a->lock) {
+        return pushhashident_x_(a, s, s2, hash, calc);
+    }
+    mutex_lock(a->lock);
+    d = pushhashident_x_(a, s, s2, hash, calc);
+    mutex_unlock(a->lock);
+    return d;
+}
+
 ident_t *pushhashident(hashident_t *a, string_t name, uint32 hash, bool calc)
 {
     return pushhashident_x(a, name, strnull(), hash, calc);
 }
 
+// 并行生成函数代码时，局部符号不能绑定到共享的 ident->defsym，而是绑定到线程自己的
+// 工作上下文中按标识符序号索引的数组。并行生成期间共享的 ident->defsym 只保存全局符
+// 号的全名绑定，不会被修改。
+static THREAD_LOCAL chcc_t *worker_cc;
+
+symb_t *identdef(ident_t *ident)
+{
+    chcc_t *w = worker_cc;
+    uint96 i = ident->id - CIFA_IDENT_START;
+    symb_t *s;
+    if (!w) {
+        return ident->defsym;
+    }
+    s = (i < w->ldef.len / sizeof(symb_t *)) ? ((symb_t **)w->ldef.a)[i] : null;
+    return s ? s : ident->defsym;
+}
+
+bool identsetdef(ident_t *ident, symb_t *symb)
+{
+    static symb_t *zero[64];
+    chcc_t *w = worker_cc;
+    uint96 need;
+    if (!w) {
+        ident->defsym = symb;
+        return true;
+    }
+    need = (ident->id - CIFA_IDENT_START + 1) * sizeof(symb_t *);
+    while (w->ldef.len < need) {
+        if (!buffer_push(&w->ldef, (byte *)zero, sizeof(zero), 0)) {
+            return false;
+        }
+    }
+    ((symb_t **)w->ldef.a)[ident->id - CIFA_IDENT_START] = symb;
+    return true;
+}
+
 static bool type_ident(const byte *p, const byte *e)
 {
     int96 len = e - p;
@@ -516,7 +577,7 @@ void cpstr(void *p, const byte *e)
     file_t *f = top->f;
     buffer_t *b = &top->s;
     byte *s = top->start;
-    buffer_push(b, s, e - s, CFSTR_ALLOC_EXPAND);
+    buffer_push(b, s, e - s, 0);
     top->start = f->b.cur;
 }
 
@@ -844,7 +905,7 @@ label_finish:
     un_rch(top); // 以上算法总会预读一个字符
     un_cpstr(b, 1);
     if (s->len) {
-        buffer_push(s, top->start, b->cur - top->start, CFSTR_ALLOC_EXPAND);
+        buffer_push(s, top->start, b->cur - top->start, 0);
         d = strflen(s->a, s->len);
     } else {
         d = strfend(top->start, b->cur);
@@ -878,7 +939,7 @@ static uint96 comment(bufile_t *top, cfid_t c)
             if (c == CHAR_RETURN || c == CHAR_NEWLINE) {
                 un_rch(top);
                 un_cpstr(top, 1);
-                buffer_push(s, top->start, b->cur - top->start, CFSTR_ALLOC_EXPAND);
+                buffer_push(s, top->start, b->cur - top->start, 0);
                 break;
             }
         }
@@ -892,8 +953,8 @@ static uint96 comment(bufile_t *top, cfid_t c)
                 break;
             }
             if (c == CHAR_RETURN || c == CHAR_NEWLINE) {
-                buffer_push(s, top->start, b->cur - 1 - top->start, CFSTR_ALLOC_EXPAND);
-                buffer_put(s, '\n', CFSTR_ALLOC_EXPAND);
+                buffer_push(s, top->start, b->cur - 1 - top->start, 0);
+                buffer_put(s, '\n', 0);
                 newline(top, c);
                 nch = 0;
                 top->start = b->cur - 1;
@@ -904,7 +965,7 @@ static uint96 comment(bufile_t *top, cfid_t c)
                 }
                 rch_ex(top, cpstr);
                 if (top->c == '/') {
-                    buffer_push(s, top->start, b->cur - 2 - top->start, CFSTR_ALLOC_EXPAND); // */ 不属于注释内容
+                    buffer_push(s, top->start, b->cur - 2 - top->start, 0); // */ 不属于注释内容
                     nch += 1; // */
                     break; // 块注释读取完毕
                 }
@@ -1039,9 +1100,9 @@ static uint96 strlit(bufile_t *top, rune quote)
         c = top->c;
         if (c == CHAR_RETURN || c == CHAR_NEWLINE) {
             if (rawstr) {
-                buffer_push(s, top->start, b->cur - 1 - top->start, CFSTR_ALLOC_EXPAND);
+                buffer_push(s, top->start, b->cur - 1 - top->start, 0);
                 newline(top, c);
-                buffer_put(s, '\n', CFSTR_ALLOC_EXPAND);
+                buffer_put(s, '\n', 0);
                 top->start = b->cur;
                 nch = 0;
             } else {
@@ -1055,13 +1116,13 @@ static uint96 strlit(bufile_t *top, rune quote)
             error = ERROR_MISS_CLOSE_QUOTE;
             goto label_copied; // 遇到结束引号前到达文件尾，字符串读取完毕
         } else if (c == CHAR_BSLASH && !rawstr) {
-            buffer_push(s, top->start, b->cur - 1 - top->start, CFSTR_ALLOC_EXPAND);
+            buffer_push(s, top->start, b->cur - 1 - top->start, 0);
             nch += 1 + esc(top, CHAR_DQUOTE, &error);
             if (top->cf.unicode) { // 代码点转换成utf8字符串字节流
                 len = unc2utf(top->c, utf8);
-                buffer_push(s, utf8, len, CFSTR_ALLOC_EXPAND);
+                buffer_push(s, utf8, len, 0);
             } else {
-                buffer_put(s, (byte)top->c, CFSTR_ALLOC_EXPAND);
+                buffer_put(s, (byte)top->c, 0);
             }
             top->start = b->cur;
         } else {
@@ -1073,7 +1134,7 @@ static uint96 strlit(bufile_t *top, rune quote)
         }
     }
     if (s->len) {
-        buffer_push(s, top->start, pend - top->start, CFSTR_ALLOC_EXPAND);
+        buffer_push(s, top->start, pend - top->start, 0);
 label_copied:
         top->cf.val.str = string_ref_buffer(&top->s);
     } else {
@@ -1175,21 +1236,21 @@ bool ident(bufile_t *top)
         }
     } else {
         if (cf->istype && !cf->reftype) {
-            if (ident->defsym) {
+            if (identdef(ident)) {
                 cf->reftype = 1; // 该类型名称已经定义
             } else {
                 cf->deftype = 1;
             }
         }
         if (cf->isconst) {
-            if (ident->defsym) {
+            if (identdef(ident)) {
                 cf->refconst = 1; // 该常量名称已经定义
             } else {
                 cf->defconst = 1;
             }
         }
         if (cf->isvar && !cf->refvar) {
-            if (ident->defsym) {
+            if (identdef(ident)) {
                 cf->refvar = 1; // 该变量名称已经定义
             } else {
                 cf->defvar = 1;
@@ -1323,6 +1384,10 @@ void next(chcc_t *cc)
         }
     }
     cc->cf = *cf;
+    if (cc->lines && cc->top == cc->ltop && cf->line != cc->lline) {
+        cc->lline = cf->line;
+        dwline_add(cc->lines, (uint32)(cc->text - cc->lstart), (uint32)cf->line, (uint32)cf->cols);
+    }
 }
 
 void skip(chcc_t *cc, cfid_t id)
@@ -1371,9 +1436,10 @@ void pushfile_(chcc_t *cc, file_t *f, bool dont_change_file_line)
     if (!f) {
         return;
     }
-    cur = (bufile_t *)stack_push(&cc->fstk, sizeof(bufile_t));
+    cur = (bufile_t *)stack_push_p(&cc->fstk, sizeof(bufile_t), &cc->npool);
     cur->a = cc->prearr;
     cur->f = f;
+    cur->isfile = false;
     cc->top = cur;
     if (prev && dont_change_file_line) {
         cur->line = prev->line;
@@ -1389,7 +1455,15 @@ void pushstrtofile(chcc_t *cc, string_t s, bool dont_change_file_line)
 
 void pushfile(chcc_t *cc, const char *filename) // filename "-" 可以从标准输入读取
 {
+    bufile_t *prev = cc->top;
+    if (!cc->top && !cc->srcname.len) { // 调试信息中的源文件名称
+        string_init(&cc->srcname, (const byte *)filename, strlen(filename), true);
+    }
     pushfile_(cc, file_open(filename, 'r', 0), false);
+    if (cc->top != prev) {
+        cc->top->isfile = true;
+        trace_begin("lex_file"); // 单遍编译，区间包括这个文件的词法分析和在其中完成的代码生成
+    }
 }
 
 void filestackfree(void *object)
@@ -1401,17 +1475,24 @@ void filestackfree(void *object)
 
 void popfile(chcc_t *cc)
 {
-    stack_pop(&cc->fstk, filestackfree);
+    if (cc->top && cc->top->isfile) {
+        trace_end("lex_file");
+    }
+    stack_pop_p(&cc->fstk, filestackfree, &cc->npool);
     cc->top = (bufile_t *)stack_top(&cc->fstk);
 }
 
 void replacefile_(chcc_t *cc, file_t *f)
 {
     bufile_t *cur;
-    stack_pop(&cc->fstk, filestackfree);
+    if (cc->top && cc->top->isfile) {
+        trace_end("lex_file");
+    }
+    stack_pop_p(&cc->fstk, filestackfree, &cc->npool);
     if (f) {
-        cur = (bufile_t *)stack_push(&cc->fstk, sizeof(bufile_t));
+        cur = (bufile_t *)stack_push_p(&cc->fstk, sizeof(bufile_t), &cc->npool);
         cur->f = f;
+        cur->isfile = false;
         start(cc);
     }
 }
@@ -1426,12 +1507,62 @@ void replacefile(chcc_t *cc, const char *filename)
     replacefile_(cc, file_open(filename, 'r', 0));
 }
 
+// 计算目标文件缓存的键：只做词法分析，跳过注释和空白，标识符和字面量使用其内容而不是标
+// 识符序号，换行只记录与上一个词法是否在同一行（换行可以当作分号），因此只修改注释和缩进
+// 的文件仍然命中缓存。影响目标文件内容的编译选项也要加入键中。
+bool chcckey(chcc_t *cc, const char *filename, const char *cccfg, objkey_t *key)
+{
+    bufile_t *top = cc->top;
+    cifa_t *cf = &cc->cf;
+    uint96 line = 0;
+    uint32 v[4];
+    pushfile(cc, filename);
+    if (cc->top == top) {
+        return false;
+    }
+    objkey_init(key, CHCC_VERSION, cccfg);
+    v[0] = cc->ozlib;
+    v[1] = cc->gdebug;
+    objkey_feed(key, (byte *)v, 2 * sizeof(uint32));
+    for (next(cc); cf->cfid != CHAR_EOF; next(cc)) {
+        if (cf->iscmm) {
+            continue;
+        }
+        v[0] = cf->cfid;
+        v[1] = (cf->line != line); // 换行标记
+        v[2] = cf->isattr;
+        v[3] = cf->numbase;
+        line = cf->line;
+        if (cf->ident) {
+            v[0] = 0; // 标识符序号与标识符出现的顺序有关
+            objkey_feed(key, (byte *)v, sizeof(v));
+            objkey_feed(key, cf->ident->s.a, cf->ident->s.len);
+        } else if (cf->isstr) {
+            objkey_feed(key, (byte *)v, sizeof(v));
+            objkey_feed(key, cf->val.str.a, cf->val.str.len);
+        } else if (cf->islit) {
+            objkey_feed(key, (byte *)v, sizeof(v));
+            objkey_feed(key, (byte *)&cf->val.i64, sizeof(uint64)); // 浮点数也按64位整数吸收
+            objkey_feed(key, cf->s.a, cf->s.len); // 数值字面量后缀
+        } else {
+            objkey_feed(key, (byte *)v, sizeof(v));
+        }
+    }
+    popfile(cc);
+    return true;
+}
+
 ident_t *findident(chcc_t *cc, cfid_t cfid)
 {
+    hashident_t *a = cc->prearr.hash; // 并行生成的工作上下文指向主上下文的标识符
+    ident_t *d;
     if (cfid < CIFA_IDENT_START || cfid >= CIFA_ANON_IDENT) {
         return null;
     }
-    return (ident_t *)array_ex_at_n(cc->ident.arry_ident.a, cfid-CIFA_IDENT_START, sizeof(ident_t *));
+    if (a->lock) { mutex_lock(a->lock); }
+    d = (ident_t *)array_ex_at_n(a->arry_ident.a, cfid-CIFA_IDENT_START, sizeof(ident_t *));
+    if (a->lock) { mutex_unlock(a->lock); }
+    return d;
 }
 
 ident_t *getrealident(ident_t *ident)
@@ -1479,12 +1610,14 @@ bool pushscopesym(chcc_t *cc, symb_t *def_symb)
         def_symb->real = gname;
         def_symb->cfid = gname->id;
     } else if (named) {
-        if (named->defsym) {
+        if (identdef(named)) {
 label_dup_defined:
             errs(cc, ERROR_SYMB_DUP_DEFINED, named->s, 0);
             return false;
         }
-        named->defsym = def_symb;
+        if (!identsetdef(named, def_symb)) {
+            return false;
+        }
         def_symb->real = named;
         def_symb->cfid = named->id;
     } else {
@@ -1499,8 +1632,8 @@ symb_t *getscopesym(ident_t *ident)
     if (!ident) {
         return null;
     }
-    if (ident->defsym) {
-        return ident->defsym;
+    if (identdef(ident)) {
+        return identdef(ident);
     }
     if (ident->glosym) {
         return ident->glosym;
@@ -1519,7 +1652,7 @@ void freescopesym(symb_t *symb, bool global)
     if (global) {
         named->defsym = named->glosym = null;
     } else if (named) {
-        named->defsym = null;
+        identsetdef(named, null);
     }
 }
 
@@ -1536,7 +1669,7 @@ void scopefree(void *object)
 void enterscope(chcc_t *cc)
 {
     scope_t *prev = curscope(cc);
-    scope_t *s = (scope_t *)stack_push(&cc->scope, sizeof(scope_t));
+    scope_t *s = (scope_t *)stack_push_p(&cc->scope, sizeof(scope_t), &cc->npool);
     s->local = prev->local + 1;
     cc->sstk = &s->symb;
     cc->local = s->local;
@@ -1545,7 +1678,7 @@ void enterscope(chcc_t *cc)
 void leavescope(chcc_t *cc)
 {
     scope_t *s;
-    stack_pop(&cc->scope, scopefree);
+    stack_pop_p(&cc->scope, scopefree, &cc->npool);
     s = curscope(cc);
     cc->sstk = &s->symb;
     cc->local = s->local;
@@ -1668,7 +1801,27 @@ void basicdecl(chcc_t *cc)
 
 void vstackinit(chcc_t *cc)
 {
-    cc->vtop = (synval_t *)stack_push(&cc->vstack, sizeof(synval_t));
+    region_init(&cc->vrgn, 0);
+    cc->vtop = cc->vbase = (synval_t *)stack_push(&cc->vstack, sizeof(synval_t));
+}
+
+static region_t *vregion(chcc_t *cc) // 表达式值节点按后进先出使用，从区域分配避免频繁的 malloc/free
+{
+    return cc->vheap ? null : &cc->vrgn;
+}
+
+static synval_t *vnew(chcc_t *cc, int96 bytes)
+{
+    return (synval_t *)stack_new_node_r(bytes, vregion(cc));
+}
+
+void vstackfree(chcc_t *cc)
+{
+    while (stack_top(&cc->vstack) && (synval_t *)stack_top(&cc->vstack) != cc->vbase) {
+        stack_pop_r(&cc->vstack, null, vregion(cc));
+    }
+    stack_free(&cc->vstack, null);
+    region_free(&cc->vrgn);
 }
 
 synval_t *vtopvalid(chcc_t *cc, synval_t *prev)
@@ -1707,12 +1860,12 @@ void vpush(chcc_t *cc, synval_t *node)
 
 void vpop(chcc_t *cc)
 {
-    stack_pop(&cc->vstack, null);
+    stack_pop_r(&cc->vstack, null, vregion(cc));
 }
 
 synval_t *vi(chcc_t *cc, uint32 i, symb_t *tsym)
 {
-    synval_t *synv = (synval_t *)stack_new_node(sizeof(synval_t));
+    synval_t *synv = vnew(cc, sizeof(synval_t));
     synv->val.c = i;
     synv->refs = tsym;
     synv->symb.isconst = 1;
@@ -1724,7 +1877,7 @@ synval_t *vi(chcc_t *cc, uint32 i, symb_t *tsym)
 
 synval_t *vi64(chcc_t *cc, uint64 i)
 {
-    synval_t *synv = (synval_t *)stack_new_node(sizeof(synval_t));
+    synval_t *synv = vnew(cc, sizeof(synval_t));
     synv->val.i64 = i;
     synv->refs = findscopesym(cc, CIFA_ID_INT64);
     synv->symb.isconst = 1;
@@ -1736,7 +1889,7 @@ synval_t *vi64(chcc_t *cc, uint64 i)
 
 synval_t *vf(chcc_t *cc, float f, symb_t *tsym)
 {
-    synval_t *synv = (synval_t *)stack_new_node(sizeof(synval_t));
+    synval_t *synv = vnew(cc, sizeof(synval_t));
     synv->val.f = f;
     synv->refs = tsym;
     synv->symb.isconst = 1;
@@ -1748,7 +1901,7 @@ synval_t *vf(chcc_t *cc, float f, symb_t *tsym)
 
 synval_t *vstr(chcc_t *cc, string_t s)
 {
-    synval_t *synv = (synval_t *)stack_new_node(sizeof(synval_t) + s.len);
+    synval_t *synv = vnew(cc, sizeof(synval_t) + s.len);
     if (s.len) {
         memcpy(synv + 1, s.a, s.len);
         synv->val.str = strflen((byte *)(synv + 1), s.len);
@@ -1817,7 +1970,7 @@ void vcst(chcc_t *cc, csym_t *csym, ident_t *ident) // 常量标识符
         errs(top, ERROR_INVALID_CONST_SYMB, ident->s, 0);
         return;
     }
-    synv = (synval_t *)stack_new_node(sizeof(synval_t));
+    synv = vnew(cc, sizeof(synval_t));
     synv->symb = csym->symb;
     synv->val = csym->val;
     synv->refs = csym->refs;
@@ -1846,11 +1999,59 @@ void vvar(chcc_t *cc, ident_t *ident)
         errs(cc->top, ERROR_INVALID_VAR_SYMB, ident->s, 0);
         return;
     }
-    synv = (synval_t *)stack_new_node(sizeof(synval_t));
+    if (!identdef(ident) && !symb->isfvar) {
+        cc->nglobal += 1;
+    }
+    synv = vnew(cc, sizeof(synval_t));
     synv->symb = *symb;
     synv->refv = (vsym_t *)symb;
     synv->refs = ((vsym_t *)symb)->refs;
     vpush(cc, synv);
+    if (!symb->isfvar) { // 变量的值加载到%eax，全局变量的使用位置在变量地址确定之后写入
+        gldr(cc, synv);
+    }
+}
+
+void vload(chcc_t *cc) // 保证栈顶的值在%eax中，整数常量在使用时才加载
+{
+    synval_t *vtop = cc->vtop;
+    if (vtop->symb.isconst && vtop->symb.btype_i) {
+        gi(cc, vtop->val.c);
+    }
+}
+
+bool vop(chcc_t *cc, cfid_t op) // 二元操作，左操作数已经压栈，右操作数在值栈栈顶
+{
+    synval_t *synv;
+    symb_t symb;
+    symb_t *refs;
+    vload(cc);
+    if (!gbinop(cc, op)) {
+        ferr(cc->top, ERROR_INVALID_BINARY_OPER, op);
+        return false;
+    }
+    vpop(cc); // 右操作数
+    symb = cc->vtop->symb;
+    refs = cc->vtop->refs;
+    vpop(cc); // 左操作数
+    synv = vnew(cc, sizeof(synval_t)); // 结果保存在%eax中，不再是常量或左值
+    synv->symb = symb;
+    synv->symb.isconst = 0;
+    synv->symb.isvar = 0;
+    synv->symb.islval = 0;
+    synv->refs = refs;
+    vpush(cc, synv);
+    return true;
+}
+
+uint32 localloc(fsym_t *f, uint32 size, uint32 align) // 在函数帧中分配局部变量，记录函数帧的最大大小
+{
+    uint32 addr = round_up(f->loc, align);
+    f->loc = addr + size;
+    if (f->loc > f->maxloc) {
+        f->maxloc = f->loc;
+    }
+    return addr;
 }
 
 void vret(chcc_t *cc, fsym_t *f)
@@ -1863,9 +2064,199 @@ void vret(chcc_t *cc, fsym_t *f)
         if (!expr(cc, f, false)) {
             return;
         }
+        vload(cc);
         rval = true;
     }
-    // f->radr = (int96 *)gjmp(cc, (byte *)f->radr); // 跳转到函数返回之前
+    f->radr = (int96 *)gjmp(cc, (byte *)f->radr); // 跳转到函数返回之前，内联展开时跳转到展开代码的结尾
+}
+
+void vrval(chcc_t *cc, fsym_t *callee) // 函数返回值，保存在%eax中
+{
+    synval_t *synv = vnew(cc, sizeof(synval_t));
+    vsym_t *r = (vsym_t *)slist_front(&callee->retp);
+    if (r) {
+        synv->symb = r->symb;
+        synv->refs = r->refs;
+    }
+    vpush(cc, synv);
+}
+
+// 实参全部计算完成之后才保存到被调函数的参数位置，因为实参中的函数调用会使用同一个被调
+// 函数帧。每个实参先保存到主调函数的临时局部变量，临时变量按形参的布局连续分配，形参
+// p 对应的临时变量位于 tmp + p->addr - 8。
+bool vargs(chcc_t *cc, fsym_t *f, fsym_t *callee, uint32 *tmp) // 计算实参，保存到主调函数的临时变量
+{
+    cifa_t *cf = &cc->cf;
+    struct slist_it *it = slist_begin(&callee->para);
+    synval_t *vtop = cc->vtop;
+    vsym_t *p;
+    *tmp = localloc(f, callee->plen - 8, SIZE_OF_POINTER);
+    skip(cc, '(');
+    while (cf->cfid != ')') {
+        if (it == slist_end(&callee->para)) {
+            goto label_not_match;
+        }
+        p = (vsym_t *)slist_it_get(it);
+        expr_assign(cc, f, 0x10);
+        if (!vtopvalid(cc, vtop)) {
+            return false;
+        }
+        vload(cc);
+        gstoloc(cc, *tmp + p->addr - 8); // %eax => 临时变量
+        vpop(cc);
+        it = slist_next(it);
+        if (cf->cfid != ',') {
+            break;
+        }
+        next(cc);
+    }
+    if (it != slist_end(&callee->para)) {
+label_not_match:
+        errs(cc->top, ERROR_FUNC_ARGS_NOT_MATCH, callee->v.symb.name->s, 0);
+        return false;
+    }
+    skip(cc, ')');
+    return true;
+}
+
+bool vbindpara(chcc_t *cc, fsym_t *callee, uint32 base) // 将形参绑定为局部变量，形参 p 位于 base + p->addr
+{
+    struct slist_it *it;
+    vsym_t *p, *v;
+    for (it = slist_begin(&callee->para); it != slist_end(&callee->para); it = slist_next(it)) {
+        p = (vsym_t *)slist_it_get(it);
+        v = vsymalloc();
+        if (!v) {
+            return false;
+        }
+        *v = *p;
+        v->usel = null;
+        v->symb.isvar = 1;
+        v->symb.islval = 1;
+        v->symb.isgvar = 0;
+        v->addr = base + p->addr;
+        if (!pushscopesym(cc, &v->symb)) {
+            vsymfree(v);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 内联函数体在被调函数的作用域中解析，展开之前隐藏主调函数的局部符号，展开之后恢复。
+// 这样函数体中的自由标识符只能解析到全局符号，形参名称也不会和主调函数的局部变量冲突。
+bool vhidelocals(chcc_t *cc, buffer_t *hide)
+{
+    scope_t *s;
+    symb_t *symb;
+    for (s = curscope(cc); s && s->local; s = (scope_t *)stack_node_next((byte *)s)) {
+        for (symb = stack_top(&s->symb); symb; symb = (symb_t *)stack_node_next((byte *)symb)) {
+            if (!symb->name || identdef(symb->name) != symb) {
+                continue;
+            }
+            if (!buffer_push(hide, (byte *)&symb, sizeof(symb), 0)) {
+                return false;
+            }
+            identsetdef(symb->name, null);
+        }
+    }
+    return true;
+}
+
+void vshowlocals(buffer_t *hide)
+{
+    symb_t **a = (symb_t **)hide->a;
+    uint32 i, n = hide->len / sizeof(symb_t *);
+    for (i = 0; i < n; i += 1) {
+        identsetdef(a[i]->name, a[i]);
+    }
+    buffer_free(hide);
+}
+
+bool ginline(chcc_t *cc, fsym_t *f, fsym_t *callee) // 在调用处展开内联函数，不生成函数调用和函数帧
+{
+    uint32 loc = f->loc;
+    int96 *radr = f->radr;
+    buffer_t hide = {0};
+    uint32 tmp;
+    bool succ;
+    if (!vargs(cc, f, callee, &tmp)) {
+        f->loc = loc;
+        return false;
+    }
+    // 实参已经保存在临时变量中，形参直接绑定到这些临时变量
+    succ = vhidelocals(cc, &hide);
+    enterscope(cc);
+    if (!succ || !vbindpara(cc, callee, tmp - 8)) {
+        leavescope(cc);
+        vshowlocals(&hide);
+        f->loc = loc;
+        return false;
+    }
+    cc->inline_depth += 1;
+    f->radr = null; // 函数体中的return跳转到展开代码的结尾
+    pushstrtofile(cc, callee->inl, true);
+    next(cc);
+    succ = block(cc, f, 0);
+    popfile(cc);
+    cc->cf = cc->top->cf;
+    grel(cc->text, f->radr);
+    f->radr = radr;
+    cc->inline_depth -= 1;
+    leavescope(cc);
+    vshowlocals(&hide);
+    f->loc = loc;
+    if (!succ) {
+        return false;
+    }
+    cc->ninline += 1;
+    vrval(cc, callee);
+    return true;
+}
+
+bool vcall(chcc_t *cc, fsym_t *f) // 函数调用，被调函数符号在值栈栈顶
+{
+    synval_t *vtop = cc->vtop;
+    fsym_t *callee = (fsym_t *)vtop->refv;
+    struct slist_it *it;
+    uint32 loc = f->loc;
+    uint32 tmp;
+    vsym_t *p;
+    byte *a;
+    if (!callee || !vtop->symb.isfvar) {
+        err(cc->top, ERROR_NOT_CALLABLE_SYMB, 0);
+        return false;
+    }
+    vpop(cc);
+    // 并行生成时被调函数可能还在其他线程生成，只展开声明了@inline属性的函数
+    if ((cc->rels ? callee->inlattr : callee->isinline) && callee != f && cc->inline_depth < INLINE_MAX_DEPTH) {
+        return ginline(cc, f, callee);
+    }
+    if (!vargs(cc, f, callee, &tmp)) {
+        f->loc = loc;
+        return false;
+    }
+    // 所有实参计算完成之后，在调用之前将临时变量复制到参数位置
+    if (!callee->v.symb.body) { // 外部函数使用C调用约定，通过导入地址槽间接调用
+        a = gcenter(cc);
+        for (it = slist_begin(&callee->para); it != slist_end(&callee->para); it = slist_next(it)) {
+            p = (vsym_t *)slist_it_get(it);
+            gldrloc(cc, tmp + p->addr - 8);
+            gcarg(cc, p->addr - 8); // %eax => C调用约定的栈上参数位置
+        }
+        gccall(cc, callee->slot, a, callee->plen - 8);
+    } else {
+        for (it = slist_begin(&callee->para); it != slist_end(&callee->para); it = slist_next(it)) {
+            p = (vsym_t *)slist_it_get(it);
+            gldrloc(cc, tmp + p->addr - 8);
+            garg(cc, p->addr); // %eax => 被调函数参数位置
+        }
+        gcall(cc, callee);
+    }
+    f->loc = loc;
+    cc->ncall += 1;
+    vrval(cc, callee);
+    return true;
 }
 
 void gcvt(chcc_t *cc, vsym_t *v, vsym_t *t)
@@ -2050,7 +2441,9 @@ label_invalid:
         } else if (id == '[') {
 
         } else if (id == '(') {
-
+            if (!vcall(cc, f)) {
+                return false;
+            }
         } else {
             break;
         }
@@ -2116,12 +2509,14 @@ void expr_infix(chcc_t *cc, fsym_t *f, uintd_t begin_with_paren, uint32 prior)
         if (cf->cfid == CIFA_OP_LOR || cf->cfid == CIFA_OP_LAND) {
             expr_logic(cc, f, op);
         } else {
+            vload(cc);
+            gpush(cc); // 保存左操作数
             next(cc);
             unary(cc, f, 0x10 | begin_with_paren);
             if (cf->oper > prior) {
                 expr_infix(cc, f, 0x10 | begin_with_paren, prior + 1);
             }
-            gop(op);
+            vop(cc, op->cfid);
         }
     }
 }
@@ -2164,10 +2559,12 @@ void expr_assign(chcc_t *cc, fsym_t *f, uintd_t begin_with_paren)
             expr_assign(cc, f, false); // 单纯赋值
         } else { // 处理常量表达式，变量也可能赋值常量
             vdup(cc);
+            gpush(cc); // 左值变量的值已经加载到%eax
             expr_assign(cc, f, false);
-            gop(cc, oper); // 先二元操作再赋值
+            vop(cc, oper->cfid); // 先二元操作再赋值
         }
-        gmov(cc); // 赋值，栈顶赋值给次顶
+        vload(cc);
+        gsto(cc, ((synval_t *)vtop)->refv); // 赋值，栈顶的值在%eax中，保存到次顶的左值变量
     }
 }
 
@@ -2190,6 +2587,118 @@ bool expr(chcc_t *cc, fsym_t *f, uintd_t begin_with_paren)
     return true;
 }
 
+int casecmp(const void *a, const void *b)
+{
+    int32 x = ((const case_t *)a)->val;
+    int32 y = ((const case_t *)b)->val;
+    return (x < y) ? -1 : (x > y);
+}
+
+bool casepush(chcc_t *cc, fsym_t *f, buffer_t *cases) // 分支常量值
+{
+    synval_t *vtop = cc->vtop;
+    case_t c;
+    expr_assign(cc, f, 0x10);
+    if (!(vtop = vtop_valid_const(cc, vtop))) {
+        return false;
+    }
+    if (!vtop->symb.btype_i) {
+        err(cc->top, ERROR_CONST_NEED_INT_TYPE, 0);
+        vpop(cc);
+        return false;
+    }
+    c.val = (int32)vtop->val.c;
+    c.addr = cc->text;
+    vpop(cc);
+    return buffer_push(cases, (byte *)&c, sizeof(case_t), 0);
+}
+
+bool switch_stmt(chcc_t *cc, fsym_t *f, int96 *b)
+{
+    // switchstmt = "switch" expr "{" { ("case" expr { "," expr } | "default") ":" { stmt } [ "fallthrough" ] } "}" .
+    // 选择的值计算到%eax之后直接跳转到最后生成的分支选择代码，分支代码结束后跳出switch
+    cifa_t *cf = &cc->cf;
+    buffer_t cases = {0}; // 包含 case_t
+    byte *dflt = null;
+    int96 *a, *end = null;
+    case_t *c;
+    uint32 i, n;
+    bool fall = false;
+    bool succ = false;
+    next(cc);
+    if (!expr(cc, f, false)) {
+        return false;
+    }
+    vpop(cc);
+    if (cf->cfid != '{') {
+        err(cc->top, ERROR_NO_OPEN_CURLY, 0);
+        return false;
+    }
+    next(cc);
+    a = (int96 *)gjmp(cc, 0);
+    while (cf->cfid == CIFA_ID_CASE || cf->cfid == CIFA_ID_DEFAULT) {
+        if (cf->cfid == CIFA_ID_DEFAULT) {
+            if (dflt) {
+                err(cc->top, ERROR_DEFAULT_REDEFINED, 0);
+                goto label_free;
+            }
+            dflt = cc->text;
+            next(cc);
+        } else {
+            do {
+                next(cc);
+                if (!casepush(cc, f, &cases)) {
+                    goto label_free;
+                }
+            } while (cf->cfid == ',');
+        }
+        skip(cc, ':');
+        fall = false;
+        while (cf->cfid != CIFA_ID_CASE && cf->cfid != CIFA_ID_DEFAULT && cf->cfid != '}') {
+            if (fall) {
+                err(cc->top, ERROR_FALLTHROUGH_POS, 0);
+                goto label_free;
+            }
+            if (cf->cfid == CIFA_ID_FALLTHROUGH) { // 继续执行下一个分支的代码
+                fall = true;
+                next(cc);
+                continue;
+            }
+            if (!block(cc, f, b)) {
+                goto label_free;
+            }
+        }
+        if (!fall) {
+            end = (int96 *)gjmp(cc, (byte *)end);
+        }
+    }
+    if (fall) {
+        err(cc->top, ERROR_FALLTHROUGH_POS, 0);
+        goto label_free;
+    }
+    skip(cc, '}');
+    if (!dflt) { // 没有 default 分支时，未匹配的值直接跳出
+        dflt = cc->text;
+        end = (int96 *)gjmp(cc, (byte *)end);
+    }
+    c = (case_t *)cases.a;
+    n = (uint32)(cases.len / sizeof(case_t));
+    qsort(c, n, sizeof(case_t), casecmp);
+    for (i = 1; i < n; i += 1) {
+        if (c[i].val == c[i-1].val) {
+            err(cc->top, ERROR_CASE_DUP_VALUE, c[i].val);
+            goto label_free;
+        }
+    }
+    grel(cc->text, a);
+    gswitch(cc, c, n, dflt);
+    grel(cc->text, end);
+    succ = true;
+label_free:
+    buffer_free(&cases);
+    return succ;
+}
+
 bool block(chcc_t *cc, fsym_t *f, int96 *b) // 语句块
 {
     cifa_t *cf = &cc->cf;
@@ -2236,6 +2745,11 @@ label_if_expr:
         }
     } else if (cfid == CIFA_ID_FOR) {
 
+    } else if (cfid == CIFA_ID_SWITCH) {
+        if (!switch_stmt(cc, f, b)) {
+            goto label_false;
+        }
+        f->loc = loc;
     } else if (cfid == '{') {
         enterscope(cc);
         next(cc);
@@ -2290,6 +2804,8 @@ void fsyminit(fsym_t *f, int96 addr)
 
 void fsymfree(fsym_t *f)
 {
+    string_free(&f->inl);
+    buffer_free(&f->lines);
     slist_free(&f->para, null);
     slist_free(&f->retp, null);
     stack_free_node((byte *)f);
@@ -2371,6 +2887,7 @@ fsym_t *func_syn(chcc_t *cc, ident_t *dest)
     fsym_t *f = fsymalloc();
     uint32 len = 0;
     vsym_t *v;
+    trace_begin("func_syn");
     next(cc);
     if (cf->istype) {
         f->recv = cf->ident;
@@ -2393,11 +2910,15 @@ fsym_t *func_syn(chcc_t *cc, ident_t *dest)
     skip(cc, ')');
     while (cf->isattr) {
         // f->v.symb.flags |= cf->attr;
+        if (cf->ident->id == CIFA_ID_ATTR_INLINE) {
+            f->inlattr = 1;
+        }
         next(cc);
     }
     f->v.symb.body = (cf->cfid == '{');
     if (cc->top->haserr) {
         fsymfree(f);
+        trace_end("func_syn");
         return null;
     }
     for (it = slist_begin(&f->para); it != slist_end(&f->para); it = slist_next(it)) {
@@ -2418,14 +2939,88 @@ fsym_t *func_syn(chcc_t *cc, ident_t *dest)
     if (cc->local) {
         f->dest = dest;
     }
+    trace_end("func_syn");
     return f;
 }
 
+bool func_body_gen(chcc_t *cc, fsym_t *f) // 从保存的函数体源代码生成函数代码
+{
+    uint32 ncall = cc->ncall;
+    uint32 nglobal = cc->nglobal;
+    buffer_t *lines = cc->lines; // 局部函数在外层函数中间生成
+    byte *lstart = cc->lstart;
+    bufile_t *ltop = cc->ltop;
+    uint96 lline = cc->lline;
+    region_mark_t vmark = region_mark(&cc->vrgn); // 局部函数的回退嵌套在外层函数之内
+    synval_t *vtop = cc->vtop;
+    byte *vnode = stack_top(&cc->vstack);
+    byte *start;
+    bool succ;
+    trace_begin("func_body_gen");
+    cc->text = round_up_addr(cc->text, sizeof(uint96)-1);
+    start = cc->text;
+    if (!cc->rels) { // 并行生成时函数地址在拼接代码时才确定
+        fsyminit(f, (int96)cc->text);
+    }
+    // 进入函数作用域并生成代码，形参是相对%ebp的局部变量
+    genter(cc, f);
+    enterscope(cc);
+    if (!vbindpara(cc, f, 0)) {
+        leavescope(cc);
+        cc->text = start;
+        trace_end("func_body_gen");
+        return false;
+    }
+    pushstrtofile(cc, f->inl, true);
+    cc->top->line = f->line;
+    cc->top->cols = f->cols;
+    if (cc->gdebug) { // 函数开始处是函数体的第一行
+        buffer_clear(&f->lines);
+        cc->lines = &f->lines;
+        cc->lstart = start;
+        cc->ltop = cc->top;
+        cc->lline = f->line;
+        dwline_add(cc->lines, 0, f->line, f->cols);
+    }
+    next(cc);
+    succ = block(cc, f, 0);
+    cc->lines = lines;
+    cc->lstart = lstart;
+    cc->ltop = ltop;
+    cc->lline = lline;
+    if (stack_top(&cc->vstack) != vnode) { // 出错时值栈可能没有恢复，回退区域之前弹出剩余的节点
+        while (stack_top(&cc->vstack) && stack_top(&cc->vstack) != vnode) {
+            vpop(cc);
+        }
+        cc->vtop = vtop;
+    }
+    region_rollback(&cc->vrgn, vmark);
+    popfile(cc);
+    cc->cf = cc->top->cf;
+    leavescope(cc);
+    if (!succ) {
+        cc->text = start;
+        trace_end("func_body_gen");
+        return false;
+    }
+    gret(cc, f);
+    f->clen = cc->text - start;
+    // 没有函数调用、没有引用全局变量的小函数自动内联，@inline 属性的函数总是内联
+    f->isleaf = (cc->ncall == ncall);
+    f->isinline = f->inlattr || (f->isleaf && cc->nglobal == nglobal && f->clen <= INLINE_MAX_CODE_SIZE);
+    if (!f->isinline) {
+        string_free(&f->inl);
+    }
+    trace_end("func_body_gen");
+    return true;
+}
+
 bool func_gen(chcc_t *cc, fsym_t *f)
 {
     ident_t *name = f->v.symb.name;
     ident_t *fglo = null;
-    uint32 loc;
+    string_t body;
+    trace_begin("func_gen");
     // 必须先创建函数符号，因为可以递归调用
 #if 0
     if (cc->local) {
@@ -2436,29 +3031,258 @@ bool func_gen(chcc_t *cc, fsym_t *f)
         err(cc, ERROR_GLOBAL_FUNC_NONAME, 0);
         goto label_false;
     }
+    if (cc->genobj) { // 函数代码是32位x86代码，不能放进x86-64目标文件
+        log_error_s(ERROR_OBJ_CODE_NOT_X64, name->s);
+        goto label_false;
+    }
     if (!pushscopesym(cc, &f->v.symb)) {
         goto label_false;
     }
-    cc->text = round_up_addr(cc->text, sizeof(uint96)-1);
-    fsyminit(f, (int96)cc->text);
-    // 进入函数作用域并生成代码
-    loc = genter(cc, f);
-    if (!block(cc, loc, 0)) {
+    // 先保存函数体源代码，再从保存的源代码生成函数，可内联函数在调用处重新解析展开
+    f->line = (uint32)cc->top->line;
+    f->cols = (uint32)cc->top->cols;
+    if (!get_func_body(cc, &body)) {
+        err(cc->top, ERROR_FUNC_BODY_NOT_CLOSED, 0);
+        goto label_false;
+    }
+    string_init(&f->inl, body.a, body.len, true);
+    next(cc); // 结束括号已经被 get_func_body 读取，读取函数体之后的词法
+    if (cc->jobs > 1 && !cc->local && !cc->main) { // 全局函数延迟到 func_gen_all 并行生成
+        fsyminit(f, 0);
+        f->v.symb.isvar = 1;
+        f->v.symb.isfvar = 1;
+        if (!buffer_push(&cc->funcs, (byte *)&f, sizeof(fsym_t *), 0)) {
+            goto label_false;
+        }
+        trace_end("func_gen");
+        return true;
+    }
+    if (!func_body_gen(cc, f) || cc->text_full || (!cc->local && !gobjdef(cc, f))) {
         goto label_false;
     }
-    gret(cc, f);
-    f->clen = cc->text - f->v.addr;
     popscopesym(cc, &f->v.symb, false);
+    trace_end("func_gen");
     return true;
 label_false:
-    cc->text = f->v.addr;
     popscopesym(cc, &f->v.symb, true);
+    trace_end("func_gen");
     return false;
 }
 
-bool func_type_decl(chcc_t *cc, fsym_t *f)
+// 并行生成函数代码：函数的语法分析完成之后，代码生成只依赖已经确定的全局符号。每个
+// 线程使用自己的工作上下文，每个函数生成到自己的代码缓存，调用其他函数的地址以及函
+// 数内的绝对地址记录为函数自己的重定位。所有函数生成之后，串行拼接代码并重定位。
+
+void gfrel(chcc_t *cc, byte *a, uint32 type, void *sym) // 记录函数代码的重定位
+{
+    frel_t r;
+    r.offset = (uint32)(a - cc->text_section); // 工作上下文的代码段是当前函数的代码缓存
+    r.type = type;
+    r.sym = sym;
+    buffer_push(cc->rels, (byte *)&r, sizeof(frel_t), 0);
+}
+
+void chccfork(chcc_t *cc, chcc_t *w) // 创建并行生成的工作上下文，共享预定义表、标识符和全局符号
+{
+    memset(w, 0, sizeof(chcc_t));
+    w->main = cc;
+    w->prearr = cc->prearr;
+    w->user_id_start = cc->user_id_start;
+    w->pknm = cc->pknm;
+    w->anon_id = cc->anon_id;
+    w->expose_pretype = cc->expose_pretype;
+    w->expose_prenull = cc->expose_prenull;
+    w->expose_prebool = cc->expose_prebool;
+    w->gdebug = cc->gdebug;
+    w->vheap = cc->vheap;
+    pool_init(&w->npool, 0);
+    scopeinit(w);
+    vstackinit(w);
+}
+
+void chccforkfree(chcc_t *w)
+{
+    stack_free_p(&w->fstk, filestackfree, &w->npool);
+    stack_free_p(&w->scope, scopefree, &w->npool);
+    pool_free(&w->npool);
+    vstackfree(w);
+    buffer_free(&w->ldef);
+}
+
+// 函数代码中的跳转链和使用地址都是缓存中的绝对地址，缓存不能移动。生成时检查剩余空间，
+// 空间不足时丢弃生成的代码和重定位，把缓存加倍之后从保存的函数体源代码重新生成。
+void func_gen_task(void *para, uint32 worker, uint32 task)
+{
+    chcc_t *w = (chcc_t *)para + worker;
+    fsym_t *f = ((fsym_t **)w->main->funcs.a)[task];
+    uint32 ncall = w->ncall, nglobal = w->nglobal, ninline = w->ninline;
+    uintd_t size = FUNC_CODE_SIZE(f->inl.len);
+    worker_cc = w;
+    f->genok = false;
+    while (buffer_init(&f->code, size)) {
+        w->text_section = f->code.a;
+        w->text = f->code.a;
+        w->text_end = f->code.a + size;
+        w->text_full = false;
+        w->rels = &f->rels;
+        f->genok = func_body_gen(w, f);
+        if (!w->text_full) {
+            f->code.len = w->text - f->code.a;
+            break;
+        }
+        f->genok = false;
+        buffer_free(&f->code);
+        buffer_clear(&f->rels);
+        w->ncall = ncall;
+        w->nglobal = nglobal;
+        w->ninline = ninline;
+        if (size >= FUNC_CODE_MAX) {
+            log_error_s(ERROR_FUNC_CODE_TOO_LARGE, f->v.symb.name->s);
+            break;
+        }
+        size *= 2;
+    }
+    w->rels = null;
+    w->text_end = null;
+    w->text_full = false;
+    worker_cc = null;
+}
+
+bool func_link(chcc_t *cc) // 串行拼接函数代码，重定位函数之间的调用、函数内的绝对地址和全局变量引用
+{
+    fsym_t **fs = (fsym_t **)cc->funcs.a;
+    uint32 i, j, n = (uint32)(cc->funcs.len / sizeof(fsym_t *));
+    bool succ = true;
+    fsym_t *f;
+    frel_t *r;
+    vsym_t *v;
+    byte *p;
+    trace_begin("func_link");
+    for (i = 0; i < n; i += 1) { // 确定函数地址并拷贝代码
+        f = fs[i];
+        if (!f->genok) {
+            succ = false;
+            continue;
+        }
+        cc->text = round_up_addr(cc->text, sizeof(uint96)-1);
+        if (cc->text_end && cc->text + f->code.len > cc->text_end) {
+            log_error(ERROR_JIT_TEXT_TOO_LARGE);
+            f->genok = false;
+            succ = false;
+            continue;
+        }
+        f->v.addr = (int96)cc->text;
+        memcpy(cc->text, f->code.a, f->code.len);
+        cc->text += f->code.len;
+        if (!gobjdef(cc, f)) {
+            succ = false;
+        }
+    }
+    for (i = 0; i < n; i += 1) {
+        f = fs[i];
+        r = (frel_t *)f->rels.a;
+        for (j = 0; f->genok && j < f->rels.len / sizeof(frel_t); j += 1) {
+            p = (byte *)f->v.addr + r[j].offset;
+            if (r[j].type == FREL_CALL) {
+                host_32_to_lp((uint32)(((fsym_t *)r[j].sym)->v.addr - (int96)(p + 4)), p);
+                if (cc->genobj) {
+                    gorel(cc, p, ELF_R_X86_64_PLT32, &((fsym_t *)r[j].sym)->v, 0, -4);
+                }
+            } else if (r[j].type == FREL_TEXT) {
+                host_32_to_lp(lp_32_to_host(p) - (uint32)(uintd_t)f->code.a + (uint32)f->v.addr, p);
+                if (cc->genobj) {
+                    gorel(cc, p, ELF_R_X86_64_32, null, OSEC_TEXT, (int32)(lp_32_to_host(p) - (uint32)(uintd_t)cc->text_section));
+                }
+            } else if (r[j].type == FREL_TEXT64) { // 只在生成目标文件时使用
+                host_64_to_lp(lp_64_to_host(p) - (uintd_t)f->code.a + (uintd_t)f->v.addr, p);
+                gorel(cc, p, ELF_R_X86_64_64, null, OSEC_TEXT, (int32)(lp_64_to_host(p) - (uintd_t)cc->text_section));
+            } else if (r[j].type == FREL_SLOT) { // 导入地址槽的地址已经是最终地址
+                if (cc->genobj) {
+                    gorel(cc, p, ELF_R_X86_64_PC32, null, OSEC_DATA, (int32)((byte *)r[j].sym - cc->data_section) - 4);
+                }
+            } else { // FREL_USEL 串连到变量的使用地址列表
+                v = (vsym_t *)r[j].sym;
+                if (cc->genobj) {
+                    gorel(cc, p, ELF_R_X86_64_PC32, v, 0, -4);
+                }
+                host_32_to_lp((uint32)(uintd_t)v->usel, p);
+                v->usel = (int96 *)p;
+            }
+        }
+        buffer_free(&f->code);
+        buffer_free(&f->rels);
+    }
+    buffer_clear(&cc->funcs);
+    trace_end("func_link");
+    return succ;
+}
+
+bool func_gen_all(chcc_t *cc) // 并行生成所有延迟生成的全局函数
 {
+    uint32 n = (uint32)(cc->funcs.len / sizeof(fsym_t *));
+    uint32 i, nw = (cc->jobs < n) ? cc->jobs : n;
+    mutex_t lock;
+    chcc_t *w;
+    bool succ;
+    if (!n) {
+        return true;
+    }
+    w = (chcc_t *)malloc(nw * sizeof(chcc_t));
+    if (!w || !mutex_init(&lock)) {
+        free(w);
+        return false;
+    }
+    for (i = 0; i < nw; i += 1) {
+        chccfork(cc, w + i);
+    }
+    cc->ident.lock = &lock;
+    succ = thread_for(nw, n, func_gen_task, w);
+    cc->ident.lock = null;
+    for (i = 0; i < nw; i += 1) {
+        cc->ncall += w[i].ncall;
+        cc->ninline += w[i].ninline;
+        chccforkfree(w + i);
+    }
+    mutex_free(&lock);
+    free(w);
+    if (!succ) { // thread_for 失败时没有执行任何任务，func_link 只释放代码缓存和重定位
+        for (i = 0; i < n; i += 1) {
+            ((fsym_t **)cc->funcs.a)[i]->genok = false;
+        }
+    }
+    return func_link(cc) && succ;
+}
 
+bool vimport(chcc_t *cc, fsym_t *f) // 为外部函数分配导入地址槽
+{
+    cc->data = round_up_addr(cc->data, sizeof(upsz)-1);
+    if (cc->data_end && cc->data + sizeof(upsz) > cc->data_end) {
+        log_error(ERROR_JIT_DATA_TOO_LARGE);
+        return false;
+    }
+    f->slot = cc->data;
+    memset(cc->data, 0, sizeof(upsz));
+    cc->data += sizeof(upsz);
+    return buffer_push(&cc->imps, (byte *)&f, sizeof(fsym_t *), 0);
+}
+
+bool func_type_decl(chcc_t *cc, fsym_t *f) // 没有函数体的函数声明，是一个外部函数
+{
+    if (!f->v.symb.name) {
+        err(cc, ERROR_GLOBAL_FUNC_NONAME, 0);
+        return false;
+    }
+    if (!pushscopesym(cc, &f->v.symb)) {
+        return false;
+    }
+    fsyminit(f, 0);
+    f->v.symb.isvar = 1;
+    f->v.symb.isfvar = 1;
+    if (!vimport(cc, f)) {
+        popscopesym(cc, &f->v.symb, true);
+        return false;
+    }
+    return true;
 }
 
 csym_t *csymalloc(void)
@@ -2479,7 +3303,7 @@ void cstvaladd(csym_t *csym, ident_t *name, vsym_t *v)
     vsym->symb.name = name;
 }
 
-bool get_cst_expr(chcc_t *cc, string_t *out)
+bool get_pair_text(chcc_t *cc, string_t *out, rune open, rune close) // 获取成对括号包含的源代码
 {
     bufile_t *top = cc->top;
     buffer_t *s = &top->s;
@@ -2487,13 +3311,13 @@ bool get_cst_expr(chcc_t *cc, string_t *out)
     uint32 paren = 1;
     rune c;
     buffer_clear(s);
-    top->start = b->cur - 1; // 包含开始'('
+    top->start = b->cur - 1; // 包含开始括号
     for (; ;) {
         rch_ex(cc, cpstr);
         c = top->c;
-        if (c == '(') {
+        if (c == open) {
             paren += 1;
-        } else if (c == ')') {
+        } else if (c == close) {
             paren -= 1;
             if (paren == 0) {
                 break;
@@ -2505,15 +3329,25 @@ bool get_cst_expr(chcc_t *cc, string_t *out)
         }
     }
     if (s->len) {
-        buffer_push(s, top->start, b->cur - top->start, CFSTR_ALLOC_EXPAND);
+        buffer_push(s, top->start, b->cur - top->start, 0);
         *out = strflen(s->a, s->len);
     } else {
         *out = strfend(top->start, b->cur);
     }
-    top->cols += out->len - 1; // 开始'('已经计算
+    top->cols += out->len - 1; // 开始括号已经计算
     return true;
 }
 
+bool get_cst_expr(chcc_t *cc, string_t *out)
+{
+    return get_pair_text(cc, out, '(', ')');
+}
+
+bool get_func_body(chcc_t *cc, string_t *out)
+{
+    return get_pair_text(cc, out, '{', '}');
+}
+
 csym_t *cst_syn(chcc_t *cc, fsym_t *f)
 {
     cifa_t *cf = &cc->cf;
@@ -2690,16 +3524,74 @@ symb_t *decl(chcc_t *cc, fsym_t *f, ident_t *dest) // 类型声明，函数声
             popscopesym(cc, vsym, true);
             return false;
         }
-        vsym->addr = round_up(f->loc, vtop->symb.align);
-        f->loc += vtop->symb.size;
-        gmov(cc); // 赋值，栈顶赋值给次顶
+        vsym->addr = localloc(f, vtop->symb.size, vtop->symb.align);
+        vload(cc);
+        gsto(cc, vsym); // 赋值，栈顶的值在%eax中，保存到新定义的变量
         return &vsym->symb;
     }
 }
 
+bool var_decl(chcc_t *cc) // 全局变量声明 var name type，变量分配在未初始化数据段
+{
+    cifa_t *cf = &cc->cf;
+    vsym_t *v;
+    next(cc);
+    if (!cf->defvar) {
+        err(cc->top, ERROR_GLOBAL_VAR_NONAME, 0);
+        return false;
+    }
+    if (!(v = vsymalloc())) {
+        return false;
+    }
+    v->symb.name = cf->ident;
+    v->symb.isvar = 1;
+    v->symb.isgvar = 1;
+    v->symb.islval = 1;
+    next(cc);
+    if (!reftype(cc, v) || !pushscopesym(cc, &v->symb)) {
+        vsymfree(v);
+        return false;
+    }
+    // 地址先保存在未初始化数据段中的偏移，数据段的大小确定之后才写入所有使用位置
+    cc->bss = round_up(cc->bss, v->symb.align);
+    v->addr = cc->bss;
+    cc->bss += v->symb.size;
+    return buffer_push(&cc->vars, (byte *)&v, sizeof(vsym_t *), 0);
+}
+
+// 编译当前文件中的所有全局声明。cc->jobs 大于1时全局函数只保存函数体源代码，所有声明
+// 处理完之后由 func_gen_all 并行生成，函数可以调用在它之后定义的函数。
+bool chccgen(chcc_t *cc)
+{
+    cifa_t *cf = &cc->cf;
+    bool succ = true;
+    trace_begin("chccgen");
+    next(cc);
+    while (succ && cf->cfid != CHAR_EOF) {
+        if (cf->iscmm || cf->cfid == ';') {
+            next(cc);
+        } else if (cf->cfid == CIFA_ID_FUNC) {
+            succ = (decl(cc, null, null) != null);
+        } else if (cf->cfid == CIFA_ID_CONST) {
+            decl(cc, null, null);
+        } else if (cf->cfid == CIFA_ID_VAR) {
+            succ = var_decl(cc);
+        } else {
+            err(cc->top, ERROR_INVALID_GLOBAL_DECL, cf->cfid);
+            succ = false;
+        }
+        if (cc->top->haserr) {
+            succ = false;
+        }
+    }
+    succ = succ && func_gen_all(cc);
+    trace_end("chccgen");
+    return succ;
+}
+
 void scopeinit(chcc_t *cc)
 {
-    cc->gsym = (scope_t *)stack_push(&cc->scope, sizeof(scope_t));
+    cc->gsym = (scope_t *)stack_push_p(&cc->scope, sizeof(scope_t), &cc->npool);
     cc->sstk = &cc->gsym->symb;
     cc->local = 0;
 }
@@ -2710,6 +3602,7 @@ void chccinit(chcc_t *cc)
     ident_t *sym = 0;
     prearr_t *prearr = &cc->prearr;
     hashident_t *a = &cc->ident;
+    const char *jobs = getenv("CHAPL_JOBS");
     byte predecl_ident[] = {
 #define PREDECL(id, ...) __VA_ARGS__, 0x00,
 #include "chcc/decl.h"
@@ -2737,9 +3630,15 @@ void chccinit(chcc_t *cc)
     cc->user_id_start = sym->id + 1;
     cc->anon_id = CIFA_ANON_IDENT;
 
+    pool_init(&cc->npool, 0);
     scopeinit(cc);
     vstackinit(cc);
 
+    cc->jobs = jobs ? (uint32)atoi(jobs) : 1; // 为0时使用处理器个数
+    if (jobs && !cc->jobs) {
+        cc->jobs = thread_cpu_count();
+    }
+
     // 添加预声明名称，例如：type~int 以及别名 int 需要自动添加到哈希表和标识符数组，
     // 并且 int 需要指向 type~int；null~null bool~true 以及别名 null/true/false 需
     // 要自动添加到哈希表和标识符数组，并且后者指向前者
@@ -2750,12 +3649,81 @@ void chccfree(chcc_t *cc)
 {
     prearr_t *a = &cc->prearr;
     hashident_t *h = a->hash;
+    uintd_t i;
     bhash_free(&h->hash_ident, ident_free);
     array_ex_free(&h->arry_ident);
-    stack_free(&cc->fstk, filestackfree);
-    stack_free(&cc->scope, scopefree);
-    stack_free(&cc->vstack, null);
+    stack_free_p(&cc->fstk, filestackfree, &cc->npool);
+    stack_free_p(&cc->scope, scopefree, &cc->npool);
+    pool_free(&cc->npool);
+    vstackfree(cc);
+    buffer_free(&cc->funcs);
+    buffer_free(&cc->vars);
+    buffer_free(&cc->imps);
+    buffer_free(&cc->orels);
+    buffer_free(&cc->odefs);
+    for (i = 0; i < cc->osecs.len / sizeof(osec_t); i += 1) {
+        buffer_free(&((osec_t *)cc->osecs.a)[i].data);
+        buffer_free(&((osec_t *)cc->osecs.a)[i].rels);
+    }
+    buffer_free(&cc->osecs);
+    buffer_free(&cc->omem);
+    string_free(&cc->srcname);
     free(a->ops);
     free(a->esc);
     free(a->b128);
 }
+
+bool chccobjinit(chcc_t *cc) // 进入目标文件模式，代码和数据生成到堆上的缓存
+{
+    byte *a;
+    if (!buffer_init(&cc->omem, OBJ_TEXT_SIZE + OBJ_RODATA_SIZE + OBJ_DATA_SIZE)) {
+        return false;
+    }
+    a = cc->omem.a;
+    cc->text_section = cc->text = a;
+    cc->text_end = a + OBJ_TEXT_SIZE;
+    cc->text_full = false;
+    cc->rodata_section = cc->rodata = cc->text_end;
+    cc->rodstr_section = cc->rodstr = cc->rodata + OBJ_RODATA_SIZE / 2;
+    cc->rodata_end = cc->rodstr_section;
+    cc->data_section = cc->data = cc->rodata_section + OBJ_RODATA_SIZE;
+    cc->data_end = cc->data + OBJ_DATA_SIZE;
+    cc->bss = 0;
+    cc->genobj = true;
+    return true;
+}
+
+// 编译源文件生成可重定位目标文件。代码生成器只生成32位x86代码，目标文件是 ELF64 x86-64
+// 格式，因此目前只能编译没有函数定义的源文件（全局变量和外部函数声明），定义函数时报错。
+// 设置了 cc->ocache 时先用源文件的词法流计算键，命中缓存时直接使用缓存的目标文件。
+bool chccobj(chcc_t *cc, const char *srcname, const char *objname)
+{
+    bufile_t *top = cc->top;
+    bool succ = false;
+    objkey_t key;
+    trace_begin("chccobj");
+    if (cc->ocache) {
+        if (!chcckey(cc, srcname, OBJ_CCCFG, &key)) {
+            goto label_end;
+        }
+        if (objcache_get(cc->ocache, &key, objname)) {
+            succ = true;
+            goto label_end;
+        }
+    }
+    if (!chccobjinit(cc)) {
+        goto label_end;
+    }
+    pushfile(cc, srcname);
+    if (cc->top == top) {
+        goto label_end;
+    }
+    succ = chccgen(cc) && gobjsave(cc, objname);
+    popfile(cc);
+    if (succ && cc->ocache) {
+        objcache_put(cc->ocache, &key, objname); // 存入失败不影响生成的目标文件
+    }
+label_end:
+    trace_end("chccobj");
+    return succ;
+}
@@ -2,6 +2,14 @@
 #define CHAPL_LANG_CHCC_H
 #include "builtin/decl.h"
 #include "builtin/file.h"
+#include "builtin/region.h"
+#include "builtin/pool.h"
+#include "direct/thread.h"
+#include "chcc/gcache.h"
+#include "chcc/gdwarf.h"
+#include "chcc/gbuildid.h"
+
+#define CHCC_VERSION "chcc 0.1 " __DATE__ " " __TIME__ // 目标文件缓存键的一部分，重新构建编译器会使缓存失效
 
 #define __CHCC_DEBUG__ 1
 
@@ -235,6 +243,7 @@ typedef struct symb_t {
     uint32 isconst: 1;  // 该符号是一个常量
     uint32 isvar: 1;    // 该符号是一个变量
     uint32 isfvar: 1;   // 是一个可调用变量
+    uint32 isgvar: 1;   // 是一个全局变量，使用绝对地址引用
     uint32 islval: 1;   // 是左值可赋值变量
     uint32 ptrvar: 1;   // 是一个可解引用变量
     uint32 ptrder: 1;
@@ -249,8 +258,60 @@ typedef struct {
     uint32 plen;
     uint32 rlen;
     uint32 clen;
+    string_t inl;       // 可内联函数的函数体源代码，包含开始'{'和结束'}'
+    uint32 inlattr: 1;  // 函数声明了@inline属性
+    // 以下字段由并行生成的工作线程写入，其他线程同时会读取被调函数的 inlattr，不能和它共用一个字
+    byte isleaf;        // 函数体中没有函数调用
+    byte isinline;      // 函数调用在调用处展开
+    byte genok;         // 并行生成的函数代码生成成功
+    buffer_t code;      // 并行生成时函数自己的代码，拼接之后释放
+    buffer_t rels;      // 包含 frel_t，并行生成时函数代码中需要在拼接之后重定位的位置
+    byte *slot;         // 外部函数的导入地址槽，保存在数据段中
+    uint32 line;        // 函数体开始的行号和列号，重新解析函数体时从这里开始计算
+    uint32 cols;
+    buffer_t lines;     // 包含 dwline_t，生成调试信息时函数代码的行号表
 } fsym_t; // 函数原型
 
+#define FREL_CALL 1 // 调用其他函数的相对地址，sym 指向被调函数 fsym_t
+#define FREL_TEXT 2 // 函数代码内的绝对地址，需要从函数代码缓存移动到最终地址
+#define FREL_USEL 3 // 引用全局变量的地址，sym 指向变量 vsym_t，拼接时串连到变量的 usel
+#define FREL_SLOT 4 // 通过导入地址槽调用外部函数，sym 指向导入地址槽，生成目标文件时需要重定位
+#define FREL_TEXT64 5 // 生成目标文件时跳转表中64位的代码绝对地址，同 FREL_TEXT
+
+typedef struct {
+    uint32 offset;  // 需要重定位的位置在函数代码中的偏移
+    uint32 type;
+    void *sym;
+} frel_t; // 函数代码的重定位
+
+// 目标文件的分区头部索引，同时也是对应分区符号的符号索引
+#define OSEC_TEXT 1
+#define OSEC_RODATA 2
+#define OSEC_RODSTR 3
+#define OSEC_DATA 4
+#define OSEC_BSS 5
+
+#define OSEC_EXTRA_MAX 8 // 附加分区的最大个数
+
+typedef struct {
+    const char *name;
+    uint32 type;    // ELF_SEC_XXX
+    uint32 align;
+    uint32 flags;   // ELF_SF_XXX
+    bool zlib;      // 压缩级别非零时压缩分区内容
+    buffer_t data;
+    buffer_t rels;  // 包含 osrel_t，非空时生成对应的 .rela 分区
+} osec_t; // 目标文件的附加非加载分区，例如调试信息和元数据
+
+#define OSEC_EXTRA(i) (0x100 + (i)) // 第 i 个附加分区作为重定位目标
+
+typedef struct {
+    uint64 offset;  // 需要重定位的位置在附加分区中的偏移
+    uint32 type;    // ELF_R_X86_64_XXX
+    uint32 sec;     // 相对分区符号重定位，OSEC_XXX 或 OSEC_EXTRA(i)
+    int64 addend;
+} osrel_t; // 附加分区的重定位
+
 typedef struct {
     symb_t symb;
 } ssym_t; // 结构体类型符号
@@ -264,8 +325,17 @@ typedef struct {
     symb_t *refs;   // 涉及的类型符号，即变量的类型
     int96 addr;     // 变量地址（包括函数地址、标签地址）
     int96 *usel;    // 使用变量的地址列表，所有使用的地方都需要写入变量的地址
+    uint32 objsym;  // 生成目标文件时符号在符号表中的索引
 } vsym_t; // 变量符号
 
+typedef struct {
+    byte *addr;     // 需要重定位的位置，位于代码段或只读数据段
+    uint32 type;    // ELF_R_X86_64_XXX
+    uint32 sec;     // sym 为空时，相对分区符号 OSEC_XXX 重定位
+    int32 addend;
+    vsym_t *sym;    // 函数 f->v 或全局变量
+} orel_t; // 目标文件的重定位
+
 typedef struct {
     symb_t symb;    // symb.name 常量枚举类型的名称，或常量的名称
     symb_t *refs;   // 涉及的类型符号，即常量的类型
@@ -278,6 +348,8 @@ typedef struct {
     fsym_t fsym;
     ident_t *dest; // 赋值目标变量名称
     uint32 loc;
+    uint32 maxloc; // 函数帧的最大大小，包括所有局部变量和临时变量
+    byte *fsize; // 函数帧大小在代码中的位置，函数生成结束之后写入
     int96 *radr;
     struct fsym_t *root; // root 函数必须是全局函数
     slist_t closure; // 包含 buffix_t，
@@ -292,6 +364,11 @@ typedef struct {
     symb_t *post;  // 字面量后缀操作，字面量总是并保存在值栈中
 } synval_t; // 值栈中的语法值
 
+typedef struct {
+    int32 val;      // 分支的整数常量值
+    byte *addr;     // 分支代码的地址
+} case_t; // switch 语句分支
+
 // 1. 操作符和标点
 //      cfid < CIFA_OPER_PUNCT（0xc0）
 //      oper > 0 操作符，表示优先级
@@ -424,6 +501,7 @@ typedef struct {
 typedef struct {
     bhash2_t hash_ident;
     array2_ex_t arry_ident;
+    mutex_t *lock; // 并行生成时多个线程同时添加标识符
 } hashident_t;
 
 typedef struct {
@@ -449,9 +527,10 @@ typedef struct {
     buffer_t s;
     byte *start;
     prearr_t a;
+    bool isfile;  // 由 pushfile 打开的源文件，压入到弹出之间记录一个跟踪区间
 } bufile_t;
 
-typedef struct {
+typedef struct chcc_t {
     stack_t fstk;
     bufile_t *top; // stack top file
     cifa_t cf;
@@ -471,27 +550,65 @@ typedef struct {
     uint32 anon_id;
     stack_t vstack; // 包含 synval_t
     synval_t *vtop;
+    synval_t *vbase; // 值栈底部的哨兵节点，从堆分配
+    region_t vrgn;  // 表达式值节点的分配区域，每个函数体生成之后回退
+    bool vheap;     // 表达式值节点直接从堆分配，只用于对比区域分配的性能
     scope_t *gsym; // 全局符号
     stack_t *sstk; // 当前作用域符号栈
     uint32 local;
     stack_t scope;
+    pool_t npool; // 文件栈和作用域栈频繁压入弹出，节点从池中分配
     uint32 const_index;
     bool expose_pretype;
     bool expose_prenull;
     bool expose_prebool;
+    uint32 ncall;   // 已生成的函数调用个数，用于判断叶子函数
+    uint32 nglobal; // 已引用的全局变量个数，引用全局变量的函数不自动内联
+    uint32 ninline; // 已展开的内联调用个数
+    uint32 inline_depth; // 当前内联展开的嵌套深度
+    uint32 jobs;    // 并行生成函数代码的线程个数，小于等于1时串行生成，chccinit 从环境变量 CHAPL_JOBS 读取
+    buffer_t funcs; // 包含 fsym_t *，并行生成时延迟生成代码的函数
+    buffer_t *rels; // 并行生成时当前函数的重定位列表，为空表示串行生成
+    buffer_t ldef;  // 包含 symb_t *，并行生成时本线程的局部符号绑定，按标识符序号索引
+    struct chcc_t *main; // 并行生成的工作上下文对应的主上下文
+    byte *text_end; // 并行生成时函数代码缓存的结尾，为空表示不检查剩余空间
+    bool text_full; // 函数代码缓存空间不足，之后生成的代码都被丢弃
+    byte *rodata_end; // 只读数据的结尾，为空表示不检查剩余空间
+    byte *data_end; // 数据段的结尾，为空表示不检查剩余空间
+    buffer_t vars;  // 包含 vsym_t *，全局变量，分配在未初始化数据段
+    buffer_t imps;  // 包含 fsym_t *，声明的外部函数，加载时需要填写导入地址槽
+    bool genobj;    // 生成目标文件，代码中的地址需要记录重定位
+    buffer_t orels; // 包含 orel_t，目标文件代码分区的重定位
+    buffer_t odefs; // 包含 fsym_t *，目标文件中定义的全局函数
+    buffer_t osecs; // 包含 osec_t，目标文件的附加分区
+    uint32 ozlib;   // 附加分区的压缩级别，0表示不压缩
+    bool gdebug;    // 生成目标文件时生成 DWARF 行号表和函数范围
+    objcache_t *ocache; // 目标文件缓存，为空表示不使用
+    string_t srcname; // 最外层的源文件名称
+    buffer_t omem;  // 生成目标文件时代码、只读数据和数据的缓存
+    buffer_t *lines; // 正在生成的函数的行号表，为空表示不记录
+    byte *lstart;   // 正在生成的函数的代码开始位置
+    bufile_t *ltop; // 函数体源代码，内联展开和常量表达式的代码属于它们所在的行
+    uint96 lline;   // 最后记录的行号
 } chcc_t;
 
 void chccinit(chcc_t *cc);
 void chccfree(chcc_t *cc);
 void pushfile(chcc_t *cc, const char *filename);
-void pushstrtofile(chcc_t *cc, string_t s);
+void pushstrtofile(chcc_t *cc, string_t s, bool dont_change_file_line);
 void popfile(chcc_t *cc);
+bool chcckey(chcc_t *cc, const char *filename, const char *cccfg, objkey_t *key);
+bool chccobjinit(chcc_t *cc);
+bool chccobj(chcc_t *cc, const char *srcname, const char *objname);
 void replacestrtofile(chcc_t *cc, string_t s);
 void replacefile(chcc_t *cc, const char *filename);
 void next(chcc_t *cc);
+bool func_gen_all(chcc_t *cc);
+bool chccgen(chcc_t *cc);
 symb_t *getscopesym(ident_t *ident);
 symb_t *findscopesym(chcc_t *cc, cfid_t cfid);
 ident_t *getrealident(ident_t *ident);
+ident_t *pushhashident(hashident_t *a, string_t name, uint32 hash, bool calc);
 
 enum {
     ERROR_CMMT_NOT_CLOSED = 0xE00,
@@ -574,6 +691,31 @@ enum {
     ERROR_INVALID_LIT_SUFFIX,
     ERROR_INVALID_VSTACK_TOP,
     ERROR_SHALL_BE_LVALUE,
+    ERROR_FUNC_BODY_NOT_CLOSED,
+    ERROR_NOT_CALLABLE_SYMB,
+    ERROR_FUNC_ARGS_NOT_MATCH,
+    ERROR_CASE_DUP_VALUE,
+    ERROR_DEFAULT_REDEFINED,
+    ERROR_FALLTHROUGH_POS,
+    ERROR_JIT_MAP_FAILED,
+    ERROR_JIT_SYMB_NOT_FOUND,
+    ERROR_JIT_ENTRY_NOT_FOUND,
+    ERROR_JIT_ARCH_NOT_SUPPORT,
+    ERROR_LINK_READ_FAILED,
+    ERROR_LINK_INVALID_OBJECT,
+    ERROR_LINK_SYMB_DUP_DEFINED,
+    ERROR_LINK_SYMB_UNDEFINED,
+    ERROR_LINK_RELOC_NOT_SUPPORT,
+    ERROR_LINK_RELOC_OVERFLOW,
+    ERROR_LINK_ENTRY_NOT_FOUND,
+    ERROR_LINK_WRITE_FAILED,
+    ERROR_GLOBAL_VAR_NONAME,
+    ERROR_INVALID_GLOBAL_DECL,
+    ERROR_FUNC_CODE_TOO_LARGE,
+    ERROR_JIT_DATA_TOO_LARGE,
+    ERROR_JIT_TEXT_TOO_LARGE,
+    ERROR_JIT_RODATA_TOO_LARGE,
+    ERROR_OBJ_CODE_NOT_X64,
 };
 
 #endif /* CHAPL_LANG_CHCC_H */
@@ -129,6 +129,9 @@ PREDECL(CIFA_ID_ALIAS_NULL,       'n', 'u', 'l', 'l')
 PREDECL(CIFA_ID_ALIAS_TRUE,       't', 'r', 'u', 'e')
 PREDECL(CIFA_ID_ALIAS_FALSE,      'f', 'a', 'l', 's', 'e')
 
+// 预声明属性名称
+PREDECL(CIFA_ID_ATTR_INLINE,      'i', 'n', 'l', 'i', 'n', 'e')
+
 #ifdef PREDECL
 #undef PREDECL
 #endif
@@ -0,0 +1,446 @@
+#include "chcc/deflate.h"
+
+#define ZWIN_SIZE 32768
+#define ZWIN_MASK (ZWIN_SIZE - 1)
+#define ZHASH_BITS 15
+#define ZHASH_SIZE (1 << ZHASH_BITS)
+#define ZMIN_MATCH 3
+#define ZMAX_MATCH 258
+#define ZTOO_FAR 4096           // 距离太远的3字节匹配编码后比3个字面量还长
+#define ZBLOCK_SYMS 16384       // 每个块最多的符号个数
+#define ZSTORED_MAX 65535       // 不压缩存储块的最大长度
+#define ZLIT_NUM 288            // 字面量/长度字母表，286 和 287 不会出现在数据中
+#define ZDIST_NUM 30
+#define ZCLEN_NUM 19
+#define ZMATCH 0x80000000       // 符号是匹配：ZMATCH | 长度 << 15 | 距离-1
+#define ZBUF_SIZE 4096
+
+static const u16 zlen_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const byte zlen_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const u16 zdist_base[ZDIST_NUM] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const byte zdist_extra[ZDIST_NUM] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const byte zclen_order[ZCLEN_NUM] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+typedef struct {
+    buffer_t *out;
+    uint64 bits;            // 还没有输出的位，低位先输出
+    uint32 nbit;
+    uint32 n;
+    byte buf[ZBUF_SIZE];    // 输出缓存，满了以后追加到 out
+    bool fail;
+    uint32 chain;           // 哈希链的最大查找深度
+    uint32 head[ZHASH_SIZE]; // 哈希值对应的最近位置+1
+    uint32 prev[ZWIN_SIZE];  // 同一哈希值的前一个位置+1，按位置模窗口大小索引
+    uint32 syms[ZBLOCK_SYMS];
+    uint32 nsym;
+    uint32 lfreq[ZLIT_NUM];
+    uint32 dfreq[ZDIST_NUM];
+    byte lcode[256];        // 长度-3 对应的长度符号-257
+    byte dcode[512];        // 距离-1 小于256时直接索引，否则用 256 + ((距离-1) >> 7) 索引
+} zstate_t;
+
+static void zflush_(zstate_t *z)
+{
+    if (z->n && !buffer_push(z->out, z->buf, z->n, 0)) {
+        z->fail = true;
+    }
+    z->n = 0;
+}
+
+static void zbits_(zstate_t *z, uint32 v, uint32 n)
+{
+    z->bits |= (uint64)v << z->nbit;
+    z->nbit += n;
+    while (z->nbit >= 8) {
+        if (z->n == ZBUF_SIZE) {
+            zflush_(z);
+        }
+        z->buf[z->n++] = (byte)z->bits;
+        z->bits >>= 8;
+        z->nbit -= 8;
+    }
+}
+
+static void zalign_(zstate_t *z)
+{
+    if (z->nbit) {
+        zbits_(z, 0, 8 - z->nbit);
+    }
+}
+
+static void zbytes_(zstate_t *z, const byte *a, uint32 n) // 调用前位已经按字节对齐
+{
+    zflush_(z);
+    if (n && !buffer_push(z->out, a, n, 0)) {
+        z->fail = true;
+    }
+}
+
+static uint32 zlog2_(uint32 v)
+{
+    uint32 n = 0;
+    while (v >>= 1) {
+        n += 1;
+    }
+    return n;
+}
+
+static void ztables_(zstate_t *z)
+{
+    uint32 v, nb;
+    for (v = 0; v < 256; v += 1) {
+        nb = zlog2_(v);
+        z->lcode[v] = (byte)((v < 8) ? v : (v == 255) ? 28 : 4 * (nb - 1) + ((v >> (nb - 2)) & 3));
+    }
+    for (v = 0; v < 512; v += 1) {
+        uint32 d = (v < 256) ? v : (v - 256) << 7;
+        nb = zlog2_(d);
+        z->dcode[v] = (byte)((d < 4) ? d : 2 * nb + ((d >> (nb - 1)) & 1));
+    }
+}
+
+static uint32 zdistcode_(zstate_t *z, uint32 d) // d 是距离-1
+{
+    return z->dcode[(d < 256) ? d : 256 + (d >> 7)];
+}
+
+// 根据频率计算哈夫曼编码长度，最长编码超过 limit 时把频率减半再重新计算。按权重排序的叶
+// 子节点和依次生成的内部节点各自有序，每次从两个队列头部取最小的两个节点合并。
+static void zhufflen_(const uint32 *freq, uint32 n, uint32 limit, byte *lens)
+{
+    uint32 sym[ZLIT_NUM], w[2 * ZLIT_NUM], parent[2 * ZLIT_NUM], depth[2 * ZLIT_NUM];
+    uint32 m, i, j, k, a, b, t, shift, maxd;
+    for (shift = 0; ; shift += 1) {
+        for (i = m = 0; i < n; i += 1) {
+            lens[i] = 0;
+            if (freq[i]) {
+                sym[m++] = i;
+            }
+        }
+        if (m <= 1) { // 只有一个符号时补一个长度也为1的符号，凑成完整的编码
+            lens[m ? sym[0] : 0] = 1;
+            lens[(m && sym[0]) ? 0 : 1] = 1;
+            return;
+        }
+        for (i = 0; i < m; i += 1) {
+            w[i] = (freq[sym[i]] >> shift) | 1;
+        }
+        for (i = 1; i < m; i += 1) { // 插入排序，符号个数最多288
+            for (j = i, t = sym[i], k = w[i]; j > 0 && w[j-1] > k; j -= 1) {
+                w[j] = w[j-1];
+                sym[j] = sym[j-1];
+            }
+            w[j] = k;
+            sym[j] = t;
+        }
+        for (i = 0, j = m, k = m; k < 2 * m - 1; k += 1) {
+            a = (i < m && (j >= k || w[i] <= w[j])) ? i++ : j++;
+            b = (i < m && (j >= k || w[i] <= w[j])) ? i++ : j++;
+            w[k] = w[a] + w[b];
+            parent[a] = parent[b] = k;
+        }
+        depth[2 * m - 2] = 0;
+        for (k = 2 * m - 2; k-- > 0; ) {
+            depth[k] = depth[parent[k]] + 1;
+        }
+        for (i = maxd = 0; i < m; i += 1) {
+            lens[sym[i]] = (byte)depth[i];
+            if (depth[i] > maxd) {
+                maxd = depth[i];
+            }
+        }
+        if (maxd <= limit) {
+            return;
+        }
+    }
+}
+
+static void zhuffcode_(const byte *lens, uint32 n, u16 *codes) // 规范哈夫曼编码，按输出顺序反转位
+{
+    uint32 count[16] = {0}, next[16], i, c, r, b;
+    for (i = 0; i < n; i += 1) {
+        count[lens[i]] += 1;
+    }
+    count[0] = 0;
+    for (b = 1, c = 0; b < 16; b += 1) {
+        c = (c + count[b-1]) << 1;
+        next[b] = c;
+    }
+    for (i = 0; i < n; i += 1) {
+        if (!lens[i]) {
+            continue;
+        }
+        for (c = next[lens[i]]++, r = 0, b = 0; b < lens[i]; b += 1) {
+            r = (r << 1) | ((c >> b) & 1);
+        }
+        codes[i] = (u16)r;
+    }
+}
+
+static uint64 zcost_(zstate_t *z, const byte *llens, const byte *dlens)
+{
+    uint64 bits = 0;
+    uint32 i;
+    for (i = 0; i < ZLIT_NUM; i += 1) {
+        bits += (uint64)z->lfreq[i] * (llens[i] + ((i > 256 && i < 286) ? zlen_extra[i-257] : 0));
+    }
+    for (i = 0; i < ZDIST_NUM; i += 1) {
+        bits += (uint64)z->dfreq[i] * (dlens[i] + zdist_extra[i]);
+    }
+    return bits;
+}
+
+static void zdata_(zstate_t *z, const byte *llens, const u16 *lcodes, const byte *dlens, const u16 *dcodes)
+{
+    uint32 i, s, len, d, c;
+    for (i = 0; i < z->nsym; i += 1) {
+        s = z->syms[i];
+        if (!(s & ZMATCH)) {
+            zbits_(z, lcodes[s], llens[s]);
+            continue;
+        }
+        len = (s >> 15) & 0x1ff;
+        d = s & ZWIN_MASK;
+        c = z->lcode[len - ZMIN_MATCH];
+        zbits_(z, lcodes[257 + c], llens[257 + c]);
+        zbits_(z, len - zlen_base[c], zlen_extra[c]);
+        c = zdistcode_(z, d);
+        zbits_(z, dcodes[c], dlens[c]);
+        zbits_(z, d + 1 - zdist_base[c], zdist_extra[c]);
+    }
+    zbits_(z, lcodes[256], llens[256]);
+}
+
+static void zstored_(zstate_t *z, const byte *a, uintd_t n, bool last)
+{
+    uint32 k;
+    do {
+        k = (n > ZSTORED_MAX) ? ZSTORED_MAX : (uint32)n;
+        zbits_(z, (last && k == n) ? 1 : 0, 3); // BFINAL BTYPE=00
+        zalign_(z);
+        zbits_(z, k, 16);
+        zbits_(z, ~k & 0xffff, 16);
+        zbytes_(z, a, k);
+        a += k;
+        n -= k;
+    } while (n);
+}
+
+static void zblock_(zstate_t *z, const byte *a, uintd_t n, bool last) // 选择最小的编码方式输出一个块
+{
+    byte llens[ZLIT_NUM], dlens[ZDIST_NUM], flens[ZLIT_NUM], fdlens[ZDIST_NUM];
+    byte all[ZLIT_NUM + ZDIST_NUM], clens[ZCLEN_NUM];
+    u16 lcodes[ZLIT_NUM], dcodes[ZDIST_NUM], ccodes[ZCLEN_NUM];
+    u16 rle[ZLIT_NUM + ZDIST_NUM]; // 低5位是码长符号，高位是重复次数的附加值
+    uint32 cfreq[ZCLEN_NUM] = {0}, nrle = 0, hlit, hdist, hclen, total, i, k, run, r;
+    uint64 dyn, fix, stored;
+    static const byte cextra[3] = {2, 3, 7};
+    z->lfreq[256] = 1;
+    zhufflen_(z->lfreq, ZLIT_NUM, 15, llens);
+    zhufflen_(z->dfreq, ZDIST_NUM, 15, dlens);
+    for (hlit = 286; hlit > 257 && !llens[hlit-1]; hlit -= 1) {}
+    for (hdist = 30; hdist > 1 && !dlens[hdist-1]; hdist -= 1) {}
+    memcpy(all, llens, hlit);
+    memcpy(all + hlit, dlens, hdist);
+    total = hlit + hdist;
+    for (i = 0; i < total; i += run) { // 码长序列的游程编码：16 重复前一个3-6次，17 零3-10次，18 零11-138次
+        for (run = 1; i + run < total && all[i+run] == all[i]; run += 1) {}
+        if (all[i] == 0 && run >= 3) {
+            for (k = run; k >= 11; k -= r) {
+                r = (k > 138) ? 138 : k;
+                rle[nrle++] = (u16)(18 | ((r - 11) << 5));
+            }
+            if (k >= 3) {
+                rle[nrle++] = (u16)(17 | ((k - 3) << 5));
+            } else {
+                for (; k; k -= 1) { rle[nrle++] = 0; }
+            }
+        } else if (all[i] && run >= 4) {
+            rle[nrle++] = all[i];
+            for (k = run - 1; k >= 3; k -= r) {
+                r = (k > 6) ? 6 : k;
+                rle[nrle++] = (u16)(16 | ((r - 3) << 5));
+            }
+            for (; k; k -= 1) { rle[nrle++] = all[i]; }
+        } else {
+            for (k = run; k; k -= 1) { rle[nrle++] = all[i]; }
+        }
+    }
+    for (i = 0; i < nrle; i += 1) {
+        cfreq[rle[i] & 31] += 1;
+    }
+    zhufflen_(cfreq, ZCLEN_NUM, 7, clens);
+    for (hclen = ZCLEN_NUM; hclen > 4 && !clens[zclen_order[hclen-1]]; hclen -= 1) {}
+    dyn = 3 + 14 + 3 * hclen + zcost_(z, llens, dlens);
+    for (i = 0; i < nrle; i += 1) {
+        k = rle[i] & 31;
+        dyn += clens[k] + ((k >= 16) ? cextra[k-16] : 0);
+    }
+    for (i = 0; i < ZLIT_NUM; i += 1) {
+        flens[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+    }
+    memset(fdlens, 5, ZDIST_NUM);
+    fix = 3 + zcost_(z, flens, fdlens);
+    stored = (n / ZSTORED_MAX + 1) * (3 + 7 + 32) + (uint64)n * 8;
+    if (stored <= dyn && stored <= fix) {
+        zstored_(z, a, n, last);
+    } else if (fix <= dyn) {
+        zbits_(z, last ? 3 : 2, 3); // BFINAL BTYPE=01
+        zhuffcode_(flens, ZLIT_NUM, lcodes);
+        zhuffcode_(fdlens, ZDIST_NUM, dcodes);
+        zdata_(z, flens, lcodes, fdlens, dcodes);
+    } else {
+        zbits_(z, last ? 5 : 4, 3); // BFINAL BTYPE=10
+        zbits_(z, hlit - 257, 5);
+        zbits_(z, hdist - 1, 5);
+        zbits_(z, hclen - 4, 4);
+        for (i = 0; i < hclen; i += 1) {
+            zbits_(z, clens[zclen_order[i]], 3);
+        }
+        zhuffcode_(clens, ZCLEN_NUM, ccodes);
+        for (i = 0; i < nrle; i += 1) {
+            k = rle[i] & 31;
+            zbits_(z, ccodes[k], clens[k]);
+            if (k >= 16) {
+                zbits_(z, rle[i] >> 5, cextra[k-16]);
+            }
+        }
+        zhuffcode_(llens, ZLIT_NUM, lcodes);
+        zhuffcode_(dlens, ZDIST_NUM, dcodes);
+        zdata_(z, llens, lcodes, dlens, dcodes);
+    }
+    z->nsym = 0;
+    memset(z->lfreq, 0, sizeof(z->lfreq));
+    memset(z->dfreq, 0, sizeof(z->dfreq));
+}
+
+static uint32 zhash_(const byte *p)
+{
+    return (((uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16)) * 2654435761u) >> (32 - ZHASH_BITS);
+}
+
+static void zinsert_(zstate_t *z, const byte *a, uint32 pos)
+{
+    uint32 h = zhash_(a + pos);
+    z->prev[pos & ZWIN_MASK] = z->head[h];
+    z->head[h] = pos + 1;
+}
+
+static void zlz77_(zstate_t *z, const byte *a, uint32 n)
+{
+    uint32 pos = 0, start = 0, cand, c, depth, best, dist, len, maxlen, i;
+    while (pos < n) {
+        best = dist = 0;
+        if (n - pos >= ZMIN_MATCH) {
+            maxlen = (n - pos < ZMAX_MATCH) ? n - pos : ZMAX_MATCH;
+            for (cand = z->head[zhash_(a + pos)], depth = z->chain; cand && depth; cand = z->prev[c & ZWIN_MASK], depth -= 1) {
+                c = cand - 1;
+                if (pos - c > ZWIN_SIZE) {
+                    break;
+                }
+                if (a[c + best] != a[pos + best]) {
+                    continue;
+                }
+                for (len = 0; len < maxlen && a[c + len] == a[pos + len]; len += 1) {}
+                if (len > best) {
+                    best = len;
+                    dist = pos - c;
+                    if (len == maxlen) {
+                        break;
+                    }
+                }
+            }
+        }
+        if (best > ZMIN_MATCH || (best == ZMIN_MATCH && dist <= ZTOO_FAR)) {
+            z->syms[z->nsym++] = ZMATCH | (best << 15) | (dist - 1);
+            z->lfreq[257 + z->lcode[best - ZMIN_MATCH]] += 1;
+            z->dfreq[zdistcode_(z, dist - 1)] += 1;
+            for (i = 0; i < best; i += 1, pos += 1) {
+                if (n - pos >= ZMIN_MATCH) {
+                    zinsert_(z, a, pos);
+                }
+            }
+        } else {
+            z->syms[z->nsym++] = a[pos];
+            z->lfreq[a[pos]] += 1;
+            if (n - pos >= ZMIN_MATCH) {
+                zinsert_(z, a, pos);
+            }
+            pos += 1;
+        }
+        if (z->nsym == ZBLOCK_SYMS) {
+            zblock_(z, a + start, pos - start, false);
+            start = pos;
+        }
+    }
+    zblock_(z, a + start, n - start, true); // 可能是只有结束符号的空块
+}
+
+uint32 zlib_adler32(uint32 adler, const byte *a, uintd_t n)
+{
+    uint32 s1 = adler & 0xffff, s2 = adler >> 16, k;
+    while (n) {
+        k = (n < 5552) ? (uint32)n : 5552; // s2 在取模之前不会溢出的最大字节数
+        n -= k;
+        while (k--) {
+            s1 += *a++;
+            s2 += s1;
+        }
+        s1 %= 65521;
+        s2 %= 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
+bool zlib_deflate(const byte *a, uintd_t n, uint32 level, buffer_t *out)
+{
+    static const u16 chains[10] = {0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+    zstate_t *z;
+    uint32 flg, adler;
+    bool succ;
+    if (n >= 0xffffffff) { // 位置用 uint32 保存
+        return false;
+    }
+    if (!(z = (zstate_t *)malloc(sizeof(zstate_t)))) {
+        return false;
+    }
+    memset(z, 0, sizeof(zstate_t));
+    z->out = out;
+    z->chain = chains[(level > 9) ? 9 : level];
+    ztables_(z);
+    flg = ((level < 2) ? 0 : (level < 6) ? 1 : (level == 6) ? 2 : 3) << 6; // FLEVEL
+    flg += 31 - ((0x78 * 256 + flg) % 31); // (CMF*256 + FLG) 是31的倍数
+    zbits_(z, 0x78, 8); // CM=8 deflate，CINFO=7 窗口大小32KB
+    zbits_(z, flg, 8);
+    if (level == 0) {
+        zstored_(z, a, n, true);
+    } else {
+        zlz77_(z, a, (uint32)n);
+    }
+    zalign_(z);
+    adler = zlib_adler32(1, a, n);
+    zbits_(z, adler >> 24, 8);
+    zbits_(z, (adler >> 16) & 0xff, 8);
+    zbits_(z, (adler >> 8) & 0xff, 8);
+    zbits_(z, adler & 0xff, 8);
+    zflush_(z);
+    succ = !z->fail;
+    free(z);
+    return succ;
+}
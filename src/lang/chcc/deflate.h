@@ -0,0 +1,17 @@
+#ifndef CHAPL_CHCC_DEFLATE_H
+#define CHAPL_CHCC_DEFLATE_H
+#include "builtin/decl.h"
+
+// DEFLATE 压缩（RFC 1951）和 ZLIB 格式封装（RFC 1950），只有压缩没有解压，用于生成压缩
+// 的 ELF 分区。使用32KB窗口的 LZ77 匹配，匹配位置通过3字节哈希链查找，每个块根据实际的
+// 符号频率选择动态哈夫曼编码、固定哈夫曼编码或不压缩存储中最小的一种。
+//
+// 压缩级别 0 只存储不压缩，1 到 9 对应哈希链的最大查找深度，级别越高压缩率越高速度越慢，
+// 6 是通常的默认级别。压缩状态只在一次调用中使用，不同的线程可以同时压缩不同的数据。
+
+#define DEFLATE_LEVEL_DEFAULT 6
+
+uint32 zlib_adler32(uint32 adler, const byte *a, uintd_t n); // adler 初始值为1
+bool zlib_deflate(const byte *a, uintd_t n, uint32 level, buffer_t *out); // 压缩结果追加到 out
+
+#endif /* CHAPL_CHCC_DEFLATE_H */
@@ -26,7 +26,28 @@ byte *gjz(chcc_t *cc, byte *addr);
 byte *gjnz(chcc_t *cc, byte *addr);
 
 void grel(byte *cur, int96 *usel);
+void guse(chcc_t *cc, byte *a, vsym_t *v);
+void gvaraddr(vsym_t *v, byte *addr);
+void gmov(chcc_t *cc, uint32 val, vsym_t *v);
+void gldr(chcc_t *cc, synval_t *a);
+void gsto(chcc_t *cc, vsym_t *a);
+void gldrloc(chcc_t *cc, uint32 disp);
+void gstoloc(chcc_t *cc, uint32 disp);
+void gpush(chcc_t *cc);
+bool gbinop(chcc_t *cc, cfid_t op);
 uint32 genter(chcc_t *cc, fsym_t *f);
 void gret(chcc_t *cc, fsym_t *f);
+void garg(chcc_t *cc, uint32 disp);
+void gcall(chcc_t *cc, fsym_t *f);
+void gswitch(chcc_t *cc, case_t *c, uint32 n, byte *dflt);
+void gfrel(chcc_t *cc, byte *a, uint32 type, void *sym);
+byte *gcenter(chcc_t *cc);
+void gcarg(chcc_t *cc, uint32 disp);
+void gccall(chcc_t *cc, byte *slot, byte *a, uint32 size);
+void gorel(chcc_t *cc, byte *a, uint32 type, vsym_t *v, uint32 sec, int32 addend);
+bool gobjdef(chcc_t *cc, fsym_t *f);
+bool gobjsection(chcc_t *cc, const char *name, uint32 type, uint32 align, bool zlib, const byte *a, uintd_t n);
+bool gobjfile(chcc_t *cc, buffer_t *out);
+bool gobjsave(chcc_t *cc, const char *filename);
 
 #endif /* CHAPL_CHCC_GABI_H */
@@ -0,0 +1,215 @@
+#include "chcc/gbuildid.h"
+#include "chcc/gelf.h"
+#include "direct/thread.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BID_SSE2 1
+#endif
+
+#define BID_LANES 8
+#define BID_STRIPE 64
+#define BID_BLOCK_STRIPES 8 // 每个块打乱一次累加值
+#define BID_P32 0x9e3779b1U
+#define BID_P1 0x9e3779b97f4a7c15ULL
+#define BID_P2 0xc2b2ae3d27d4eb4fULL
+
+// 密钥的第 s 个64位字开始的8个字用于一个块中的第 s 个条带，最后一个字用于打乱
+static const uint64 bidkey[BID_LANES + BID_BLOCK_STRIPES] = {
+    0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+    0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL, 0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL,
+    0xcb00c391bb52283cULL, 0xa32e531b8b65d088ULL, 0x4ef90da297486471ULL, 0xd8acdea946ef1938ULL,
+    0x3f349ce33f76faa8ULL, 0x1d4f0bc7c7bbdcf9ULL, 0x3159b4cd4be0518aULL, 0x647378d9c97e9fc8ULL
+};
+
+typedef struct {
+    uint64 acc[BID_LANES];
+    byte buf[BID_STRIPE];   // 不足一个条带的输入
+    uint32 nbuf;
+    uint32 stripe;          // 当前块中已经处理的条带个数
+    uint64 total;
+} bidstate_t;
+
+static uint64 bidmix_(uint64 x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void bidinit_(bidstate_t *s, uint64 seed)
+{
+    uint32 i;
+    memset(s, 0, sizeof(bidstate_t));
+    for (i = 0; i < BID_LANES; i += 1) {
+        s->acc[i] = bidkey[i] ^ (seed * BID_P1);
+    }
+}
+
+#if defined(BID_SSE2)
+static void bidstripe_(uint64 *acc, const byte *p, const uint64 *key)
+{
+    __m128i *a = (__m128i *)acc, d, k; // acc 只按8字节对齐
+    uint32 i;
+    for (i = 0; i < BID_LANES / 2; i += 1) {
+        d = _mm_loadu_si128((const __m128i *)p + i);
+        k = _mm_xor_si128(d, _mm_loadu_si128((const __m128i *)key + i));
+        k = _mm_mul_epu32(k, _mm_srli_epi64(k, 32)); // 每个通道输入高低32位的乘积
+        d = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)); // 输入字累加到相邻通道
+        _mm_storeu_si128(a + i, _mm_add_epi64(_mm_loadu_si128(a + i), _mm_add_epi64(k, d)));
+    }
+}
+#else
+static void bidstripe_(uint64 *acc, const byte *p, const uint64 *key)
+{
+    uint64 d, k;
+    uint32 i;
+    for (i = 0; i < BID_LANES; i += 1) {
+        d = lp_64_to_host((byte *)p + i * 8);
+        k = d ^ key[i];
+        acc[i ^ 1] += d;
+        acc[i] += (k & 0xffffffff) * (k >> 32);
+    }
+}
+#endif
+
+static void bidscramble_(uint64 *acc)
+{
+    uint32 i;
+    for (i = 0; i < BID_LANES; i += 1) {
+        acc[i] = (acc[i] ^ (acc[i] >> 47) ^ bidkey[BID_LANES + BID_BLOCK_STRIPES - 1]) * BID_P32;
+    }
+}
+
+static void bidconsume_(bidstate_t *s, const byte *p, uintd_t nstripe)
+{
+    for (; nstripe; nstripe -= 1, p += BID_STRIPE) {
+        bidstripe_(s->acc, p, bidkey + s->stripe);
+        if (++s->stripe == BID_BLOCK_STRIPES) {
+            bidscramble_(s->acc);
+            s->stripe = 0;
+        }
+    }
+}
+
+static void bidfeed_(bidstate_t *s, const byte *p, uintd_t n)
+{
+    uintd_t m;
+    s->total += n;
+    if (s->nbuf) {
+        m = BID_STRIPE - s->nbuf;
+        if (n < m) {
+            memcpy(s->buf + s->nbuf, p, n);
+            s->nbuf += (uint32)n;
+            return;
+        }
+        memcpy(s->buf + s->nbuf, p, m);
+        bidconsume_(s, s->buf, 1);
+        s->nbuf = 0;
+        p += m;
+        n -= m;
+    }
+    bidconsume_(s, p, n / BID_STRIPE);
+    p += n & ~(uintd_t)(BID_STRIPE - 1);
+    n &= BID_STRIPE - 1;
+    memcpy(s->buf, p, n);
+    s->nbuf = (uint32)n;
+}
+
+static void biddigest_(bidstate_t *s, byte out[BUILDID_SIZE])
+{
+    uint64 h0 = s->total * BID_P1, h1 = ~s->total * BID_P2;
+    uint32 i;
+    if (s->nbuf) { // 最后不足一个条带的输入用零填充
+        memset(s->buf + s->nbuf, 0, BID_STRIPE - s->nbuf);
+        bidconsume_(s, s->buf, 1);
+    }
+    for (i = 0; i < BID_LANES; i += 1) {
+        h0 = bidmix_(h0 ^ s->acc[i]) + BID_P2;
+        h1 = bidmix_(h1 + (s->acc[i] ^ bidkey[i + 1])) ^ h0;
+    }
+    host_64_to_lp(bidmix_(h0 + h1), out);
+    host_64_to_lp(bidmix_(h1 ^ (h0 >> 29)), out + 8);
+}
+
+typedef struct {
+    const bidpart_t *part;
+    uint32 npart;
+    const uint64 *start;    // 每一段在拼接内容中的起始位置
+    uint64 total;
+    byte *leaf;
+} bidtree_t;
+
+static void bidleaf_task(void *para, uint32 worker, uint32 task) // 每个任务计算一个块的摘要
+{
+    bidtree_t *t = (bidtree_t *)para;
+    uint64 pos = (uint64)task * BUILDID_CHUNK, end = pos + BUILDID_CHUNK, off, n;
+    uint32 lo = 0, hi = t->npart, mid;
+    bidstate_t s;
+    (void)worker;
+    if (end > t->total) {
+        end = t->total;
+    }
+    while (lo + 1 < hi) { // 查找包含块开始位置的段
+        mid = (lo + hi) / 2;
+        if (t->start[mid] <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    bidinit_(&s, task);
+    for (; pos < end && lo < t->npart; lo += 1) {
+        off = pos - t->start[lo];
+        n = t->part[lo].n - off;
+        if (n > end - pos) {
+            n = end - pos;
+        }
+        bidfeed_(&s, t->part[lo].a + off, (uintd_t)n);
+        pos += n;
+    }
+    biddigest_(&s, t->leaf + (uintd_t)task * BUILDID_SIZE);
+}
+
+bool buildid_hash(const bidpart_t *part, uint32 npart, uint32 jobs, byte out[BUILDID_SIZE])
+{
+    bidtree_t t;
+    bidstate_t s;
+    uint64 *start;
+    uint32 i, nleaf;
+    if (!(start = (uint64 *)malloc((npart + 1) * sizeof(uint64)))) {
+        return false;
+    }
+    for (t.total = 0, i = 0; i < npart; i += 1) {
+        start[i] = t.total;
+        t.total += part[i].n;
+    }
+    nleaf = (uint32)((t.total + BUILDID_CHUNK - 1) / BUILDID_CHUNK);
+    if (!(t.leaf = (byte *)malloc((nleaf ? nleaf : 1) * BUILDID_SIZE))) {
+        free(start);
+        return false;
+    }
+    t.part = part;
+    t.npart = npart;
+    t.start = start;
+    thread_for(jobs ? jobs : 1, nleaf, bidleaf_task, &t);
+    bidinit_(&s, ~(uint64)0);
+    bidfeed_(&s, t.leaf, (uintd_t)nleaf * BUILDID_SIZE);
+    s.total = t.total; // 根节点的长度是全部输入的长度
+    biddigest_(&s, out);
+    free(t.leaf);
+    free(start);
+    return true;
+}
+
+void buildid_note(byte note[BUILDID_NOTE_SIZE])
+{
+    byte *p = note;
+    p = host_32_to_lp(4, p);                // namesz 包括 NUL 字符
+    p = host_32_to_lp(BUILDID_SIZE, p);     // descsz
+    p = host_32_to_lp(ELF_NT_GNU_BUILD_ID, p);
+    memcpy(p, "GNU", 4);
+    memset(p + 4, 0, BUILDID_SIZE);
+}
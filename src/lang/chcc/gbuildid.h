@@ -0,0 +1,28 @@
+#ifndef CHAPL_CHCC_GBUILDID_H
+#define CHAPL_CHCC_GBUILDID_H
+#include "builtin/decl.h"
+
+// 构建标识：对输出文件的最终内容计算128位哈希，保存在 .note.gnu.build-id 的 GNU 说明条目
+// ELF_NT_GNU_BUILD_ID 中，符号服务器和调试器用它匹配可执行文件和调试信息。计算哈希时说明
+// 条目的内容为全零，算出后再填入。
+//
+// 哈希是两层的树：输入按 BUILDID_CHUNK 字节切成块，每个块是一个叶子，在工作线程中独立计算，
+// 根节点是所有叶子摘要按顺序拼接之后的哈希。切块只与总长度有关，结果不依赖线程个数。叶子
+// 的哈希每次处理64字节，8个64位通道分别累加输入字和输入与密钥异或之后高低32位的乘积，每
+// 512字节把累加值打乱一次，SSE2 每条指令处理两个通道，每个字节大约只需要一条指令。这个
+// 哈希不是密码学哈希，只用于区分不同的构建结果。
+
+#define BUILDID_SIZE 16
+#define BUILDID_CHUNK (1024 * 1024)
+#define BUILDID_NOTE_SIZE 32    // namesz descsz type "GNU\0" desc
+#define BUILDID_NOTE_DESC 16    // 说明条目中构建标识的偏移
+
+typedef struct {
+    const byte *a;
+    uintd_t n;
+} bidpart_t; // 输入是若干段内容按顺序拼接起来
+
+bool buildid_hash(const bidpart_t *part, uint32 npart, uint32 jobs, byte out[BUILDID_SIZE]); // 内存分配失败返回 false
+void buildid_note(byte note[BUILDID_NOTE_SIZE]); // 生成内容为全零的说明条目
+
+#endif /* CHAPL_CHCC_GBUILDID_H */
@@ -0,0 +1,381 @@
+#include "chcc/gcache.h"
+#if defined(__MSC__)
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#define OBJKEY_P1 0x9e3779b97f4a7c15ULL
+#define OBJKEY_P2 0xc2b2ae3d27d4eb4fULL
+#define OBJCACHE_STATS "stats"
+
+typedef struct {
+    char name[OBJCACHE_KEY_LEN+3];
+    uint64 mtime;   // 最近使用时间
+    uint64 size;
+} objfile_t;
+
+static uint64 objrotl_(uint64 x, uint32 r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64 objmix_(uint64 x) // 64位终结混合，每一位输入影响所有输出位
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void objword_(objkey_t *k, uint64 w) // 两个独立的通道各自吸收一个64位字
+{
+    k->h[0] = objrotl_(k->h[0] ^ (w * OBJKEY_P1), 31) * OBJKEY_P2;
+    k->h[1] = objrotl_(k->h[1] ^ (w * OBJKEY_P2), 27) * OBJKEY_P1 + k->h[0];
+}
+
+void objkey_feed(objkey_t *k, const byte *a, uintd_t n)
+{
+    uint64 w = 0;
+    uintd_t i;
+    for (i = 0; i + 8 <= n; i += 8) {
+        objword_(k, lp_64_to_host((byte *)a + i));
+    }
+    for (; i < n; i += 1) { // 剩余不足8字节
+        w = (w << 8) | a[i];
+    }
+    objword_(k, w);
+    objword_(k, (uint64)n); // 吸收长度使输入的边界不会有歧义
+}
+
+void objkey_init(objkey_t *k, const char *version, const char *cccfg)
+{
+    k->h[0] = OBJKEY_P1;
+    k->h[1] = OBJKEY_P2;
+    objkey_feed(k, (const byte *)version, strlen(version));
+    objkey_feed(k, (const byte *)cccfg, strlen(cccfg));
+}
+
+void objkey_hex(const objkey_t *k, char out[OBJCACHE_KEY_LEN+1])
+{
+    static const char hex[] = "0123456789abcdef";
+    uint64 h[2];
+    uint32 i;
+    h[0] = objmix_(k->h[0] ^ objrotl_(k->h[1], 17));
+    h[1] = objmix_(k->h[1] + h[0]);
+    for (i = 0; i < OBJCACHE_KEY_LEN; i += 1) {
+        out[i] = hex[(h[i/16] >> ((15 - i%16) * 4)) & 0x0f];
+    }
+    out[OBJCACHE_KEY_LEN] = 0;
+}
+
+static bool objpath_(objcache_t *c, const char *name, char *out)
+{
+    int n = snprintf(out, OBJCACHE_PATH_MAX, "%s/%s", c->dir, name);
+    return n > 0 && n < OBJCACHE_PATH_MAX;
+}
+
+static bool objentry_(const objkey_t *k, objcache_t *c, char *out)
+{
+    char hex[OBJCACHE_KEY_LEN+1], name[OBJCACHE_KEY_LEN+3];
+    objkey_hex(k, hex);
+    snprintf(name, sizeof(name), "%s.o", hex);
+    return objpath_(c, name, out);
+}
+
+static bool objisentry_(const char *name) // 缓存文件名是32个十六进制字符加 .o
+{
+    uint32 i;
+    for (i = 0; i < OBJCACHE_KEY_LEN; i += 1) {
+        if (!((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f'))) {
+            return false;
+        }
+    }
+    return strcmp(name + OBJCACHE_KEY_LEN, ".o") == 0;
+}
+
+static bool objcopy_(const char *from, const char *to, uint64 *size)
+{
+    FILE *in = fopen(from, "rb"), *out = null;
+    byte buf[64*1024];
+    size_t n;
+    bool succ = false;
+    *size = 0;
+    if (!in || !(out = fopen(to, "wb"))) {
+        goto label_close;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, n, out) != n) {
+            goto label_close;
+        }
+        *size += n;
+    }
+    succ = !ferror(in);
+label_close:
+    if (in) {
+        fclose(in);
+    }
+    if (out) {
+        succ = (fclose(out) == 0) && succ;
+    }
+    return succ;
+}
+
+static bool objreadstats_(objcache_t *c, objstat_t *s)
+{
+    char path[OBJCACHE_PATH_MAX], name[16];
+    long long v;
+    FILE *fp;
+    memset(s, 0, sizeof(objstat_t));
+    if (!objpath_(c, OBJCACHE_STATS, path) || !(fp = fopen(path, "rb"))) {
+        return false;
+    }
+    while (fscanf(fp, "%15s %lld", name, &v) == 2) {
+        if (strcmp(name, "hits") == 0) {
+            s->hits = (uint64)v;
+        } else if (strcmp(name, "misses") == 0) {
+            s->misses = (uint64)v;
+        } else if (strcmp(name, "stores") == 0) {
+            s->stores = (uint64)v;
+        } else if (strcmp(name, "evicts") == 0) {
+            s->evicts = (uint64)v;
+        } else if (strcmp(name, "size") == 0) {
+            s->size = (int64)v;
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+#if defined(__MSC__)
+static bool objmkdir_(const char *dir)
+{
+    return _mkdir(dir) == 0 || GetFileAttributesA(dir) != INVALID_FILE_ATTRIBUTES;
+}
+
+static bool objlink_(const char *from, const char *to)
+{
+    return CreateHardLinkA(to, from, null) != 0;
+}
+
+static bool objrename_(const char *from, const char *to)
+{
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+static void objtouch_(const char *path)
+{
+    _utime(path, null);
+}
+
+static uint32 objpid_(void)
+{
+    return (uint32)GetCurrentProcessId();
+}
+
+static bool objscan_(objcache_t *c, buffer_t *out) // 收集所有缓存文件的名称、修改时间和大小
+{
+    char path[OBJCACHE_PATH_MAX];
+    WIN32_FIND_DATAA d;
+    HANDLE h;
+    objfile_t f;
+    if (!objpath_(c, "*.o", path) || (h = FindFirstFileA(path, &d)) == INVALID_HANDLE_VALUE) {
+        return true;
+    }
+    do {
+        if (!objisentry_(d.cFileName)) {
+            continue;
+        }
+        memcpy(f.name, d.cFileName, sizeof(f.name));
+        f.mtime = ((uint64)d.ftLastWriteTime.dwHighDateTime << 32) | d.ftLastWriteTime.dwLowDateTime;
+        f.size = ((uint64)d.nFileSizeHigh << 32) | d.nFileSizeLow;
+        if (!buffer_push(out, (byte *)&f, sizeof(objfile_t), 0)) {
+            FindClose(h);
+            return false;
+        }
+    } while (FindNextFileA(h, &d));
+    FindClose(h);
+    return true;
+}
+#else
+static bool objmkdir_(const char *dir)
+{
+    struct stat st;
+    return mkdir(dir, 0755) == 0 || (stat(dir, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+static bool objlink_(const char *from, const char *to)
+{
+    return link(from, to) == 0;
+}
+
+static bool objrename_(const char *from, const char *to)
+{
+    return rename(from, to) == 0;
+}
+
+static void objtouch_(const char *path)
+{
+    utime(path, null);
+}
+
+static uint32 objpid_(void)
+{
+    return (uint32)getpid();
+}
+
+static bool objscan_(objcache_t *c, buffer_t *out)
+{
+    char path[OBJCACHE_PATH_MAX];
+    struct dirent *e;
+    struct stat st;
+    objfile_t f;
+    DIR *d = opendir(c->dir);
+    if (!d) {
+        return false;
+    }
+    while ((e = readdir(d))) {
+        if (!objisentry_(e->d_name) || !objpath_(c, e->d_name, path) || stat(path, &st) != 0) {
+            continue;
+        }
+        memcpy(f.name, e->d_name, sizeof(f.name));
+        f.mtime = (uint64)st.st_mtim.tv_sec * 1000000000 + (uint64)st.st_mtim.tv_nsec;
+        f.size = (uint64)st.st_size;
+        if (!buffer_push(out, (byte *)&f, sizeof(objfile_t), 0)) {
+            closedir(d);
+            return false;
+        }
+    }
+    closedir(d);
+    return true;
+}
+#endif
+
+bool objcache_open(objcache_t *c, const char *dir, uint64 limit)
+{
+    uintd_t n = strlen(dir);
+    memset(c, 0, sizeof(objcache_t));
+    if (!n || n >= OBJCACHE_PATH_MAX - OBJCACHE_KEY_LEN - 16 || !objmkdir_(dir)) {
+        return false;
+    }
+    memcpy(c->dir, dir, n + 1);
+    c->limit = limit;
+    objreadstats_(c, &c->base);
+    return true;
+}
+
+bool objcache_get(objcache_t *c, const objkey_t *k, const char *filename)
+{
+    char path[OBJCACHE_PATH_MAX];
+    uint64 size;
+    FILE *fp;
+    if (!objentry_(k, c, path) || !(fp = fopen(path, "rb"))) {
+        c->stat.misses += 1;
+        return false;
+    }
+    fclose(fp);
+    remove(filename); // 不改写输出位置的旧文件，它可能是另一个缓存文件的硬链接
+    if (!objlink_(path, filename) && !objcopy_(path, filename, &size)) {
+        c->stat.misses += 1;
+        return false;
+    }
+    objtouch_(path); // 更新最近使用时间
+    c->stat.hits += 1;
+    return true;
+}
+
+static int objfilecmp_(const void *a, const void *b)
+{
+    uint64 x = ((const objfile_t *)a)->mtime, y = ((const objfile_t *)b)->mtime;
+    return (x < y) ? -1 : (x > y);
+}
+
+bool objcache_evict(objcache_t *c, uint64 limit)
+{
+    char path[OBJCACHE_PATH_MAX];
+    buffer_t files = {0};
+    objfile_t *f;
+    uint64 total = 0;
+    uintd_t i, n;
+    if (!objscan_(c, &files)) {
+        buffer_free(&files);
+        return false;
+    }
+    f = (objfile_t *)files.a;
+    n = files.len / sizeof(objfile_t);
+    for (i = 0; i < n; i += 1) {
+        total += f[i].size;
+    }
+    if (total > limit) {
+        qsort(f, n, sizeof(objfile_t), objfilecmp_); // 最久没有使用的在前
+        for (i = 0; i < n && total > limit; i += 1) {
+            if (objpath_(c, f[i].name, path) && remove(path) == 0) {
+                total -= f[i].size;
+                c->stat.evicts += 1;
+            }
+        }
+    }
+    c->stat.size = (int64)total - c->base.size; // 校正总大小
+    buffer_free(&files);
+    return true;
+}
+
+bool objcache_put(objcache_t *c, const objkey_t *k, const char *filename)
+{
+    char path[OBJCACHE_PATH_MAX], temp[OBJCACHE_PATH_MAX];
+    uint64 size;
+    if (!objentry_(k, c, path) || snprintf(temp, sizeof(temp), "%s.%u.tmp", path, objpid_()) >= (int)sizeof(temp)) {
+        return false;
+    }
+    if (!objcopy_(filename, temp, &size) || !objrename_(temp, path)) {
+        remove(temp);
+        return false;
+    }
+    c->stat.stores += 1;
+    c->stat.size += (int64)size;
+    if (c->limit && (uint64)(c->base.size + c->stat.size) > c->limit) {
+        objcache_evict(c, c->limit / 4 * 3);
+    }
+    return true;
+}
+
+void objcache_stats(objcache_t *c, objstat_t *out)
+{
+    out->hits = c->base.hits + c->stat.hits;
+    out->misses = c->base.misses + c->stat.misses;
+    out->stores = c->base.stores + c->stat.stores;
+    out->evicts = c->base.evicts + c->stat.evicts;
+    out->size = c->base.size + c->stat.size;
+}
+
+bool objcache_close(objcache_t *c)
+{
+    char path[OBJCACHE_PATH_MAX], temp[OBJCACHE_PATH_MAX];
+    objstat_t s;
+    FILE *fp;
+    bool succ = false;
+    if (!c->dir[0]) {
+        return false;
+    }
+    objreadstats_(c, &c->base); // 其他进程可能已经更新了统计文件
+    objcache_stats(c, &s);
+    if (objpath_(c, OBJCACHE_STATS, path) && snprintf(temp, sizeof(temp), "%s.%u.tmp", path, objpid_()) < (int)sizeof(temp) &&
+        (fp = fopen(temp, "wb"))) {
+        fprintf(fp, "hits %llu\nmisses %llu\nstores %llu\nevicts %llu\nsize %lld\n", (unsigned long long)s.hits,
+            (unsigned long long)s.misses, (unsigned long long)s.stores, (unsigned long long)s.evicts, (long long)(s.size < 0 ? 0 : s.size));
+        succ = (fclose(fp) == 0) && objrename_(temp, path);
+        if (!succ) {
+            remove(temp);
+        }
+    }
+    memset(c, 0, sizeof(objcache_t));
+    return succ;
+}
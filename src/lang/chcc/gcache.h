@@ -0,0 +1,49 @@
+#ifndef CHAPL_CHCC_GCACHE_H
+#define CHAPL_CHCC_GCACHE_H
+#include "builtin/decl.h"
+
+// 目标文件缓存：生成目标文件之前先计算键，键是词法流、编译器版本、目标配置和影响输出的编
+// 译选项的128位哈希，缓存目录中以键的十六进制字符串命名保存对应的目标文件。命中时目标文件
+// 通过硬链接放到输出位置，不能创建硬链接时（例如跨文件系统）拷贝文件。未命中时正常生成目
+// 标文件然后拷贝到缓存目录，先写到临时文件再重命名，多个编译进程可以同时使用同一个缓存目
+// 录。生成目标文件会先删除输出位置的旧文件，不会改写缓存中硬链接的文件。
+//
+// 缓存按最近使用淘汰：命中时更新缓存文件的修改时间，缓存的总大小超过上限时按修改时间从旧
+// 到新删除文件，直到总大小降到上限的 3/4，避免每次存入都扫描目录。缓存目录中的 stats 文
+// 件保存累计的命中、未命中、存入、淘汰次数和总大小，关闭缓存时把本次的增量加到文件中，多
+// 个进程同时关闭时统计值是近似的，总大小在每次淘汰扫描时重新校正。
+
+#define OBJCACHE_PATH_MAX 512
+#define OBJCACHE_KEY_LEN 32 // 键的十六进制字符串长度
+
+typedef struct {
+    uint64 h[2];
+} objkey_t;
+
+typedef struct {
+    uint64 hits;
+    uint64 misses;
+    uint64 stores;
+    uint64 evicts;
+    int64 size;     // 缓存目标文件的总字节数，作为增量时可以为负
+} objstat_t;
+
+typedef struct {
+    char dir[OBJCACHE_PATH_MAX];
+    uint64 limit;   // 缓存总大小的上限，0表示不限制
+    objstat_t base; // 打开时 stats 文件中的累计值
+    objstat_t stat; // 本次打开以来的增量
+} objcache_t;
+
+void objkey_init(objkey_t *k, const char *version, const char *cccfg);
+void objkey_feed(objkey_t *k, const byte *a, uintd_t n); // 每次输入的边界也影响哈希值
+void objkey_hex(const objkey_t *k, char out[OBJCACHE_KEY_LEN+1]);
+
+bool objcache_open(objcache_t *c, const char *dir, uint64 limit); // 目录不存在时创建
+bool objcache_get(objcache_t *c, const objkey_t *k, const char *filename); // 命中时把缓存的目标文件放到 filename
+bool objcache_put(objcache_t *c, const objkey_t *k, const char *filename); // 存入刚生成的目标文件，必要时淘汰旧文件
+bool objcache_evict(objcache_t *c, uint64 limit); // 淘汰到总大小不超过 limit
+void objcache_stats(objcache_t *c, objstat_t *out); // 累计值加上本次的增量
+bool objcache_close(objcache_t *c); // 保存统计信息
+
+#endif /* CHAPL_CHCC_GCACHE_H */
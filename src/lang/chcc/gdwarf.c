@@ -0,0 +1,220 @@
+#include "chcc/gdwarf.h"
+
+#define DW_TAG_compile_unit 0x11
+#define DW_TAG_subprogram 0x2e
+#define DW_AT_name 0x03
+#define DW_AT_stmt_list 0x10
+#define DW_AT_low_pc 0x11
+#define DW_AT_high_pc 0x12
+#define DW_AT_language 0x13
+#define DW_AT_producer 0x25
+#define DW_AT_decl_file 0x3a
+#define DW_AT_decl_line 0x3b
+#define DW_AT_external 0x3f
+#define DW_FORM_addr 0x01
+#define DW_FORM_data2 0x05
+#define DW_FORM_data8 0x07
+#define DW_FORM_string 0x08
+#define DW_FORM_data1 0x0b
+#define DW_FORM_udata 0x0f
+#define DW_FORM_sec_offset 0x17
+#define DW_FORM_flag_present 0x19
+
+#define DW_LNS_copy 1
+#define DW_LNS_advance_pc 2
+#define DW_LNS_advance_line 3
+#define DW_LNS_set_column 5
+#define DW_LNE_end_sequence 1
+#define DW_LNE_set_address 2
+
+#define DW_LINE_BASE (-5)   // 特殊操作码可以表示的行号增量 [-5, 8]
+#define DW_LINE_RANGE 14
+#define DW_OPCODE_BASE 13
+
+#define DWABBR_CU 1
+#define DWABBR_FUNC 2
+
+bool dwline_add(buffer_t *rows, uint32 offset, uint32 line, uint32 cols)
+{
+    dwline_t *a = (dwline_t *)rows->a, e;
+    uintd_t n = rows->len / sizeof(dwline_t);
+    while (n && a[n-1].offset >= offset) { // 同一位置只保留最后一行，代码回退时丢弃之后的行
+        n -= 1;
+    }
+    rows->len = n * sizeof(dwline_t);
+    e.offset = offset;
+    e.line = line;
+    e.cols = cols;
+    return buffer_push(rows, (byte *)&e, sizeof(dwline_t), 0);
+}
+
+static bool dwbyte(buffer_t *b, uint32 c)
+{
+    return buffer_put(b, (byte)c, 0);
+}
+
+static bool dwuleb(buffer_t *b, uint64 v)
+{
+    byte e[10];
+    uint32 n = 0;
+    do {
+        e[n] = (byte)(v & 0x7f);
+        v >>= 7;
+        e[n++] |= v ? 0x80 : 0;
+    } while (v);
+    return buffer_push(b, e, n, 0);
+}
+
+static bool dwsleb(buffer_t *b, int64 v)
+{
+    byte e[10];
+    uint32 n = 0;
+    bool more = true;
+    while (more) {
+        e[n] = (byte)(v & 0x7f);
+        v >>= 7; // 算术右移
+        more = !((v == 0 && !(e[n] & 0x40)) || (v == -1 && (e[n] & 0x40)));
+        e[n++] |= more ? 0x80 : 0;
+    }
+    return buffer_push(b, e, n, 0);
+}
+
+static bool dwint(buffer_t *b, uint64 v, uint32 size)
+{
+    byte e[8];
+    host_64_to_lp(v, e);
+    return buffer_push(b, e, size, 0);
+}
+
+static bool dwstr(buffer_t *b, const byte *a, uint32 n)
+{
+    return (!n || buffer_push(b, a, n, 0)) && dwbyte(b, 0);
+}
+
+static bool dwrel(dwsec_t *s, uint32 size, uint32 target, int64 addend) // 在当前位置记录重定位并填充零
+{
+    dwrel_t r;
+    r.offset = (uint32)s->data.len;
+    r.size = size;
+    r.target = target;
+    r.addend = addend;
+    return buffer_push(&s->rels, (byte *)&r, sizeof(dwrel_t), 0) && dwint(&s->data, 0, size);
+}
+
+static bool dwabbrev(buffer_t *b)
+{
+    static const byte a[] = {
+        DWABBR_CU, DW_TAG_compile_unit, 1,
+        DW_AT_producer, DW_FORM_string,
+        DW_AT_language, DW_FORM_data2,
+        DW_AT_name, DW_FORM_string,
+        DW_AT_low_pc, DW_FORM_addr,
+        DW_AT_high_pc, DW_FORM_data8,
+        DW_AT_stmt_list, DW_FORM_sec_offset,
+        0, 0,
+        DWABBR_FUNC, DW_TAG_subprogram, 0,
+        DW_AT_name, DW_FORM_string,
+        DW_AT_external, DW_FORM_flag_present,
+        DW_AT_decl_file, DW_FORM_data1,
+        DW_AT_decl_line, DW_FORM_udata,
+        DW_AT_low_pc, DW_FORM_addr,
+        DW_AT_high_pc, DW_FORM_data8,
+        0, 0,
+        0
+    };
+    return buffer_push(b, a, sizeof(a), 0);
+}
+
+static bool dwinfo(dwsec_t *s, const byte *srcname, uint32 namelen, const dwfunc_t *f, uint32 n, uint64 textsize)
+{
+    buffer_t *b = &s->data;
+    uint32 i;
+    bool succ = dwint(b, 0, 4) && dwint(b, 4, 2) && dwrel(s, 4, DWSEC_ABBREV, 0) && dwbyte(b, 8) &&
+        dwuleb(b, DWABBR_CU) && dwstr(b, (const byte *)"chcc", 4) && dwint(b, DW_LANG_CHAPL, 2) &&
+        dwstr(b, srcname, namelen) && dwrel(s, 8, DWSEC_TEXT, 0) && dwint(b, textsize, 8) && dwrel(s, 4, DWSEC_LINE, 0);
+    for (i = 0; succ && i < n; i += 1) {
+        succ = dwuleb(b, DWABBR_FUNC) && dwstr(b, f[i].name, f[i].namelen) && dwbyte(b, 1) && dwuleb(b, f[i].line) &&
+            dwrel(s, 8, DWSEC_TEXT, (int64)f[i].offset) && dwint(b, f[i].size, 8);
+    }
+    succ = succ && dwbyte(b, 0); // 编译单元的子条目结束
+    if (succ) {
+        host_32_to_lp((uint32)(b->len - 4), b->a); // unit_length 不包括自己
+    }
+    return succ;
+}
+
+static bool dwseq(dwsec_t *s, const dwfunc_t *f) // 一个函数的行号程序指令序列
+{
+    buffer_t *b = &s->data;
+    uint64 addr = 0, dline, op;
+    int64 line = 1;
+    uint32 i, cols = 0;
+    bool succ = dwbyte(b, 0) && dwuleb(b, 9) && dwbyte(b, DW_LNE_set_address) && dwrel(s, 8, DWSEC_TEXT, (int64)f->offset);
+    for (i = 0; succ && i < f->nrow && f->rows[i].offset < f->size; i += 1) {
+        if (f->rows[i].cols != cols) {
+            cols = f->rows[i].cols;
+            succ = dwbyte(b, DW_LNS_set_column) && dwuleb(b, cols);
+        }
+        dline = (uint64)((int64)f->rows[i].line - line - DW_LINE_BASE);
+        op = dline + DW_LINE_RANGE * (f->rows[i].offset - addr) + DW_OPCODE_BASE;
+        if (dline < DW_LINE_RANGE && op <= 255) { // 特殊操作码同时增加地址和行号并添加一行
+            succ = succ && dwbyte(b, (uint32)op);
+        } else {
+            if (f->rows[i].line != line) {
+                succ = succ && dwbyte(b, DW_LNS_advance_line) && dwsleb(b, (int64)f->rows[i].line - line);
+            }
+            if (f->rows[i].offset != addr) {
+                succ = succ && dwbyte(b, DW_LNS_advance_pc) && dwuleb(b, f->rows[i].offset - addr);
+            }
+            succ = succ && dwbyte(b, DW_LNS_copy);
+        }
+        line = f->rows[i].line;
+        addr = f->rows[i].offset;
+    }
+    if (succ && f->size > addr) {
+        succ = dwbyte(b, DW_LNS_advance_pc) && dwuleb(b, f->size - addr);
+    }
+    return succ && dwbyte(b, 0) && dwuleb(b, 1) && dwbyte(b, DW_LNE_end_sequence);
+}
+
+static bool dwline(dwsec_t *s, const byte *srcname, uint32 namelen, const dwfunc_t *f, uint32 n)
+{
+    static const byte oplen[DW_OPCODE_BASE - 1] = {0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1};
+    buffer_t *b = &s->data;
+    uint32 i;
+    bool succ = dwint(b, 0, 4) && dwint(b, 4, 2) && dwint(b, 0, 4) &&
+        dwbyte(b, 1) && dwbyte(b, 1) && dwbyte(b, 1) && dwbyte(b, (byte)DW_LINE_BASE) && dwbyte(b, DW_LINE_RANGE) &&
+        dwbyte(b, DW_OPCODE_BASE) && buffer_push(b, oplen, sizeof(oplen), 0) &&
+        dwbyte(b, 0) && // 没有包含目录
+        dwstr(b, srcname, namelen) && dwuleb(b, 0) && dwuleb(b, 0) && dwuleb(b, 0) && dwbyte(b, 0);
+    if (succ) {
+        host_32_to_lp((uint32)(b->len - 10), b->a + 6); // header_length 从该字段之后到第一条指令
+    }
+    for (i = 0; succ && i < n; i += 1) {
+        succ = dwseq(s, f + i);
+    }
+    if (succ) {
+        host_32_to_lp((uint32)(b->len - 4), b->a);
+    }
+    return succ;
+}
+
+bool dwarf_build(const byte *srcname, uint32 namelen, const dwfunc_t *f, uint32 n, uint64 textsize, dwsec_t out[DWSEC_NUM])
+{
+    memset(out, 0, DWSEC_NUM * sizeof(dwsec_t));
+    if (dwabbrev(&out[DWSEC_ABBREV].data) && dwinfo(out + DWSEC_INFO, srcname, namelen, f, n, textsize) &&
+        dwline(out + DWSEC_LINE, srcname, namelen, f, n)) {
+        return true;
+    }
+    dwarf_free(out);
+    return false;
+}
+
+void dwarf_free(dwsec_t out[DWSEC_NUM])
+{
+    uint32 i;
+    for (i = 0; i < DWSEC_NUM; i += 1) {
+        buffer_free(&out[i].data);
+        buffer_free(&out[i].rels);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef CHAPL_CHCC_GDWARF_H
+#define CHAPL_CHCC_GDWARF_H
+#include "builtin/decl.h"
+
+// DWARF 4 调试信息：只生成性能分析和调试器定位源代码需要的最小集合。
+// .debug_line   行号程序，每个函数一个指令序列，从函数地址开始按代码偏移记录行号和列号
+// .debug_info   一个编译单元，包含源文件名称、代码范围和行号程序偏移，每个函数一个子程序
+//               条目，包含函数名称、声明行号和代码范围，字符串都内联在条目中
+// .debug_abbrev 上面两种条目的缩写表
+// 调试信息中的代码地址和对其他调试分区的偏移在目标文件中都需要重定位，生成的重定位记录目
+// 标分区 DWSEC_XXX、位置和宽度，由目标文件生成转换成 ELF 重定位。
+
+#define DWSEC_TEXT 0    // 代码分区，只作为重定位目标
+#define DWSEC_ABBREV 1
+#define DWSEC_INFO 2
+#define DWSEC_LINE 3
+#define DWSEC_NUM 4
+
+#define DW_LANG_CHAPL 0x8000 // DW_LANG_lo_user
+
+typedef struct {
+    uint32 offset;  // 代码相对函数开始的偏移
+    uint32 line;
+    uint32 cols;
+} dwline_t;
+
+typedef struct {
+    const byte *name;
+    uint32 namelen;
+    uint32 line;        // 函数体开始的行号
+    uint64 offset;      // 函数在代码分区中的偏移
+    uint64 size;
+    const dwline_t *rows; // 按代码偏移递增
+    uint32 nrow;
+} dwfunc_t;
+
+typedef struct {
+    uint32 offset;  // 需要重定位的位置
+    uint32 size;    // 4 或 8
+    uint32 target;  // DWSEC_XXX
+    int64 addend;
+} dwrel_t;
+
+typedef struct {
+    buffer_t data;
+    buffer_t rels;  // 包含 dwrel_t
+} dwsec_t;
+
+bool dwline_add(buffer_t *rows, uint32 offset, uint32 line, uint32 cols); // 记录一行，代码回退时丢弃回退位置之后的行
+bool dwarf_build(const byte *srcname, uint32 namelen, const dwfunc_t *f, uint32 n, uint64 textsize, dwsec_t out[DWSEC_NUM]);
+void dwarf_free(dwsec_t out[DWSEC_NUM]);
+
+#endif /* CHAPL_CHCC_GDWARF_H */
@@ -2,6 +2,8 @@
 #define __CURR_FILE__ STRID_CHCC_GELF
 #include "internal/decl.h"
 #include "chcc/gelf.h"
+#include "chcc/deflate.h"
+#include "direct/trace.h"
 
 // LINUX 进程典型内存布局：
 //  0x0000_0000 [   ...            ] 虚拟内存开始，大概 128MB 空间也可用于栈
@@ -234,3 +236,312 @@ uint32 elf_hash(const byte* sym_name)
 }
 
 // 生成 ELF 格式的可执行文件
+
+uint32 elf_gnu_hash(const byte *sym_name)
+{
+    uint32 h = 5381;
+    while (*sym_name) {
+        h = (h << 5) + h + *sym_name++;
+    }
+    return h;
+}
+
+static uint32 elfnbucket_(uint32 nsym) // 与 GNU ld 类似，平均每个桶两到四个符号
+{
+    static const uint32 primes[] = {
+        1, 3, 17, 37, 67, 97, 131, 197, 263, 521, 1031, 2053, 4099, 8209,
+        16411, 32771, 65537, 131101, 262147, 524309, 1048583, 2097169
+    };
+    uint32 i, n = 1;
+    for (i = 0; i < sizeof(primes)/sizeof(primes[0]); i += 1) {
+        if (primes[i] * 2 > nsym) {
+            break;
+        }
+        n = primes[i];
+    }
+    return n;
+}
+
+uint32 *elf_hash_build(const byte *const *names, uint32 nsym, uintd_t *size)
+{
+    uint32 nbucket = elfnbucket_(nsym);
+    uint32 *ht, *bucket, *chain;
+    uint32 i, b;
+    *size = (2 + nbucket + nsym) * sizeof(uint32);
+    if (!(ht = (uint32 *)calloc(1, *size))) {
+        return null;
+    }
+    ht[0] = nbucket;
+    ht[1] = nsym;
+    bucket = ht + 2;
+    chain = elf_hash_chain(ht, nbucket);
+    for (i = nsym; i > 1; i -= 1) { // 倒序插入到链表头，同一个桶中的符号按索引从小到大查找
+        b = elf_hash(names[i-1]) % nbucket;
+        chain[i-1] = bucket[b];
+        bucket[b] = i-1;
+    }
+    return ht;
+}
+
+uint32 *elf_gnu_hash_build(const byte *const *names, uint32 nsym, uint32 symoffset, bool elf64, uint32 *order, uintd_t *size)
+{
+    uint32 n = (nsym > symoffset) ? (nsym - symoffset) : 0;
+    uint32 nbucket = elfnbucket_(n);
+    uint32 C = elf64 ? 64 : 32;
+    uint32 bloom_size = 1, i, j, b, h;
+    uint32 *gh, *hash, *count, *bucket, *chain;
+    byte *bloom;
+    uint64 w;
+    while (bloom_size * C < n * 8) { // 每个符号大约8位，两位置1时误判率约5%
+        bloom_size <<= 1;
+    }
+    *size = sizeof(ElfGnuHash) + bloom_size * (C / 8) + (nbucket + n) * sizeof(uint32);
+    gh = (uint32 *)calloc(1, *size);
+    hash = (uint32 *)malloc((n + nbucket + 1) * sizeof(uint32));
+    if (!gh || !hash) {
+        free(gh);
+        free(hash);
+        return null;
+    }
+    gh[0] = nbucket;
+    gh[1] = symoffset;
+    gh[2] = bloom_size;
+    gh[3] = ELF_GNU_HASH_BLOOM_SHIFT;
+    bloom = (byte *)(gh + 4);
+    bucket = (uint32 *)(bloom + bloom_size * (C / 8));
+    chain = bucket + nbucket;
+    // 按桶计数排序，同一个桶中保持原始顺序
+    count = hash + n;
+    memset(count, 0, (nbucket + 1) * sizeof(uint32));
+    for (i = 0; i < n; i += 1) {
+        hash[i] = elf_gnu_hash(names[symoffset + i]);
+        count[hash[i] % nbucket + 1] += 1;
+    }
+    for (b = 0; b < nbucket; b += 1) {
+        count[b + 1] += count[b];
+    }
+    for (i = 0; i < n; i += 1) {
+        order[symoffset + count[hash[i] % nbucket]++] = symoffset + i;
+    }
+    for (i = 0; i < n; i += 1) {
+        j = order[symoffset + i] - symoffset;
+        h = hash[j];
+        b = h % nbucket;
+        if (!bucket[b]) {
+            bucket[b] = symoffset + i;
+        }
+        chain[i] = h & ~1u;
+        if (i + 1 == n || hash[order[symoffset + i + 1] - symoffset] % nbucket != b) {
+            chain[i] |= 1; // 桶中最后一个符号
+        }
+        if (elf64) {
+            w = lp_64_to_host(bloom + (h / C % bloom_size) * 8);
+            w |= ((uint64)1 << (h % C)) | ((uint64)1 << ((h >> ELF_GNU_HASH_BLOOM_SHIFT) % C));
+            host_64_to_lp(w, bloom + (h / C % bloom_size) * 8);
+        } else {
+            w = lp_32_to_host(bloom + (h / C % bloom_size) * 4);
+            w |= ((uint32)1 << (h % C)) | ((uint32)1 << ((h >> ELF_GNU_HASH_BLOOM_SHIFT) % C));
+            host_32_to_lp((uint32)w, bloom + (h / C % bloom_size) * 4);
+        }
+    }
+    free(hash);
+    return gh;
+}
+
+uint32 elf_hash_lookup(const uint32 *ht, const byte *const *names, const byte *sym_name)
+{
+    uint32 nbucket = ht[0];
+    const uint32 *chain = ht + 2 + nbucket;
+    uint32 y = ht[2 + elf_hash(sym_name) % nbucket];
+    for (; y != ELF_SYMNDX_UNDEF; y = chain[y]) {
+        if (strcmp((const char *)names[y], (const char *)sym_name) == 0) {
+            return y;
+        }
+    }
+    return ELF_SYMNDX_UNDEF;
+}
+
+uint32 elf_gnu_hash_lookup(const uint32 *gh, bool elf64, const byte *const *names, const byte *sym_name)
+{
+    uint32 nbucket = gh[0], symoffset = gh[1], bloom_size = gh[2], shift = gh[3];
+    uint32 C = elf64 ? 64 : 32;
+    uint32 h = elf_gnu_hash(sym_name), y, c;
+    const byte *bloom = (const byte *)(gh + 4);
+    const uint32 *bucket = (const uint32 *)(bloom + bloom_size * (C / 8));
+    const uint32 *chain = bucket + nbucket;
+    uint64 w, m;
+    if (elf64) {
+        w = lp_64_to_host((byte *)bloom + (h / C & (bloom_size - 1)) * 8);
+    } else {
+        w = lp_32_to_host((byte *)bloom + (h / C & (bloom_size - 1)) * 4);
+    }
+    m = ((uint64)1 << (h % C)) | ((uint64)1 << ((h >> shift) % C));
+    if ((w & m) != m) {
+        return ELF_SYMNDX_UNDEF;
+    }
+    if ((y = bucket[h % nbucket]) == ELF_SYMNDX_UNDEF) {
+        return ELF_SYMNDX_UNDEF;
+    }
+    for (; ; y += 1) {
+        c = chain[y - symoffset];
+        if ((c | 1) == (h | 1) && strcmp((const char *)names[y], (const char *)sym_name) == 0) {
+            return y;
+        }
+        if (c & 1) {
+            break;
+        }
+    }
+    return ELF_SYMNDX_UNDEF;
+}
+
+static uint32 elfstrhash_(const byte *a, uint32 len)
+{
+    uint32 h = 5381, i;
+    for (i = 0; i < len; i += 1) {
+        h = (h << 5) + h + a[i];
+    }
+    return h;
+}
+
+bool elf_strtab_init(elf_strtab_t *t)
+{
+    elfstr_t e = {(const byte *)"", 0, 5381, 0};
+    memset(t, 0, sizeof(elf_strtab_t));
+    t->rawsize = 1;
+    return buffer_push(&t->strs, (byte *)&e, sizeof(elfstr_t), 0);
+}
+
+static bool elfstrgrow_(elf_strtab_t *t, uint32 n) // 负载因子保持在一半以下
+{
+    elfstr_t *e = (elfstr_t *)t->strs.a;
+    uint32 cap = t->icap ? t->icap * 2 : 256;
+    uint32 *index, i, k;
+    if (n * 2 < t->icap) {
+        return true;
+    }
+    if (!(index = (uint32 *)calloc(cap, sizeof(uint32)))) {
+        return false;
+    }
+    for (k = 1; k < n; k += 1) {
+        for (i = e[k].hash & (cap - 1); index[i]; i = (i + 1) & (cap - 1)) {}
+        index[i] = k + 1;
+    }
+    free(t->index);
+    t->index = index;
+    t->icap = cap;
+    return true;
+}
+
+uint32 elf_strtab_intern(elf_strtab_t *t, const byte *a, uint32 len)
+{
+    uint32 n = (uint32)(t->strs.len / sizeof(elfstr_t));
+    uint32 h = elfstrhash_(a, len), i, k;
+    elfstr_t *e, s;
+    if (!len) {
+        t->rawsize += 1;
+        return 0;
+    }
+    if (!elfstrgrow_(t, n + 1)) {
+        return 0xffffffff;
+    }
+    e = (elfstr_t *)t->strs.a;
+    for (i = h & (t->icap - 1); (k = t->index[i]); i = (i + 1) & (t->icap - 1)) {
+        if (e[k-1].hash == h && e[k-1].len == len && memcmp(e[k-1].a, a, len) == 0) {
+            t->rawsize += len + 1;
+            return k - 1;
+        }
+    }
+    s.a = a;
+    s.len = len;
+    s.hash = h;
+    s.offset = 0;
+    if (!buffer_push(&t->strs, (byte *)&s, sizeof(elfstr_t), 0)) {
+        return 0xffffffff;
+    }
+    t->index[i] = n + 1;
+    t->rawsize += len + 1;
+    return n;
+}
+
+static int elfstrcmp_(const void *x, const void *y) // 从尾部向前比较，即反转后的字典序
+{
+    const elfstr_t *a = *(const elfstr_t *const *)x;
+    const elfstr_t *b = *(const elfstr_t *const *)y;
+    uint32 i = a->len, j = b->len;
+    while (i && j) {
+        i -= 1;
+        j -= 1;
+        if (a->a[i] != b->a[j]) {
+            return (a->a[i] < b->a[j]) ? -1 : 1;
+        }
+    }
+    return (i == j) ? 0 : (i ? 1 : -1);
+}
+
+bool elf_strtab_build(elf_strtab_t *t, buffer_t *out)
+{
+    elfstr_t *e = (elfstr_t *)t->strs.a;
+    uint32 n = (uint32)(t->strs.len / sizeof(elfstr_t)), i;
+    elfstr_t **sorted, *s, *next;
+    bool succ = false;
+    trace_begin("elf_strtab_build");
+    buffer_clear(out);
+    if (!buffer_put(out, 0, 0)) {
+        goto label_end;
+    }
+    if (n <= 1) {
+        t->size = 1;
+        succ = true;
+        goto label_end;
+    }
+    if (!(sorted = (elfstr_t **)malloc((n - 1) * sizeof(elfstr_t *)))) {
+        goto label_end;
+    }
+    for (i = 1; i < n; i += 1) {
+        sorted[i-1] = e + i;
+    }
+    qsort(sorted, n - 1, sizeof(elfstr_t *), elfstrcmp_);
+    // 排序之后以 s 为后缀的名称都紧跟在 s 后面，从后往前处理，s 是下一个名称的后缀时引用下
+    // 一个名称的尾部，下一个名称本身可能也引用了更后面名称的尾部
+    for (i = n - 1; i > 0; i -= 1) {
+        s = sorted[i-1];
+        next = (i < n - 1) ? sorted[i] : null;
+        if (next && next->len >= s->len && memcmp(next->a + next->len - s->len, s->a, s->len) == 0) {
+            s->offset = next->offset + next->len - s->len;
+            continue;
+        }
+        s->offset = (uint32)out->len;
+        if (!buffer_push(out, s->a, s->len, 0) || !buffer_put(out, 0, 0)) {
+            free(sorted);
+            goto label_end;
+        }
+    }
+    free(sorted);
+    t->size = (uint32)out->len;
+    succ = true;
+label_end:
+    trace_end("elf_strtab_build");
+    return succ;
+}
+
+void elf_strtab_free(elf_strtab_t *t)
+{
+    buffer_free(&t->strs);
+    free(t->index);
+    memset(t, 0, sizeof(elf_strtab_t));
+}
+
+bool elf_compress_section(const byte *a, uint64 size, uint64 addralign, uint32 level, buffer_t *out)
+{
+    byte hdr[sizeof(Elf64Chdr)], *p = hdr;
+    bool succ;
+    trace_begin("elf_compress_section");
+    p = host_32_to_lp(ELF_COMPRESS_ZLIB, p);
+    p = host_32_to_lp(0, p);
+    p = host_64_to_lp(size, p);
+    host_64_to_lp(addralign, p);
+    buffer_clear(out);
+    succ = buffer_push(out, hdr, sizeof(hdr), 0) && zlib_deflate(a, (uintd_t)size, level, out);
+    trace_end("elf_compress_section");
+    return succ;
+}
@@ -472,6 +472,7 @@ typedef struct {
 #define ELF_SEC_GROUP 17       // 该分区定义一个分区组合，分区组合是一组关联的分区可以让链接器特别对待，只能存在于可重定位目标文件中，该分区头部必须位于所有包含的分区头部的前面
 #define ELF_SEC_SYMTAB_SHNDX 18 // 该分区与一个符号表分区关联，符号表中如果包含值为 ELF_SHNDX_XINDEX 的分区头部索引，该分区包含对应符号引用地实际索引或0
 #define ELF_SEC_LOOS 0x60000000 // 操作系统特殊语义预留
+#define ELF_SEC_GNU_HASH 0x6ffffff6 // GNU 哈希表分区，包含布隆过滤器和按桶排序的符号哈希链
 #define ELF_SEC_HIOS 0x6fffffff // 操作系统特殊语义预留
 #define ELF_SEC_LOPROC 0x70000000 // 处理器特殊语义预留
 #define ELF_SEC_HIPROC 0x7fffffff // 处理器特殊语义预留
@@ -492,6 +493,7 @@ typedef struct {
 #define ELF_SF_COMPRESSED 0x800   // 该分区包含压缩的数据，不能和 ELF_SF_ALLOC 一起使用，也不能应用到 ELF_SEC_NOBITS 分区
 #define ELF_SF_MASKOS 0x0ff00000  // 操作系统特殊语义预留
 #define ELF_SF_MASKPROC 0xf0000000 // 处理器特殊语义预留
+#define ELF_SF_EXCLUDE 0x80000000 // 链接生成可执行文件或共享目标文件时丢弃该分区，GNU 扩展
 
 // 依赖于分区类型的值 link 和 info：
 // 分区类型                  link                               info
@@ -567,14 +569,14 @@ typedef struct {
 typedef struct {
     uint32 name;
     uint32 type;
-    uint32 flags;
+    uint64 flags;
     uint64 addr;
     uint64 offset;
-    uint32 size;
+    uint64 size;
     uint32 link;
     uint32 info;
-    uint32 addralign;
-    uint32 entsize;
+    uint64 addralign;
+    uint64 entsize;
 } Elf64Shdr;
 
 // 压缩算法类型
@@ -609,6 +611,10 @@ typedef struct {
     uint64 addralign;
 } Elf64Chdr;
 
+// 生成压缩分区的内容：Elf64Chdr 头部（compress 之后有4字节保留）紧跟 zlib 格式的压缩数据，
+// out 的内容被替换，level 见 zlib_deflate
+bool elf_compress_section(const byte *a, uint64 size, uint64 addralign, uint32 level, buffer_t *out);
+
 // 存在一些特殊的分区，有固定的分区类型和属性；以点号开始的分区名称是系统
 // 预留的名称，一个目标文件可以有多个相同名称的分区；处理器架构相关的分区
 // 以 machine 字段定义的处理器名称开头例如 .AARCH64.procsec。
@@ -672,6 +678,31 @@ typedef struct {
 inline byte *elf_strtab(byte *p) { *p++ = 0x00; return p; }
 inline byte *elf_strtab_add(byte *p, string_t s) { memcpy(p, s.a, s.len); p += s.len; *p++ = 0x00; return p; }
 
+// 字符串表构建：名称先登记到 elf_strtab_t 中，相同的名称只保存一次，登记返回的序号在生成
+// 字符串表之后换算成偏移。生成时按反转后的字符串排序，如果一个名称是排在它后面的名称的后
+// 缀，就直接引用那个名称的尾部，例如 coro_call 引用 prh_impl_asm_coro_call 的尾部，.text
+// 引用 .rela.text 的尾部。登记的名称不能包含 NUL，内容在生成字符串表之前必须有效。
+typedef struct {
+    const byte *a;
+    uint32 len;
+    uint32 hash;
+    uint32 offset;
+} elfstr_t;
+
+typedef struct {
+    buffer_t strs;      // 包含 elfstr_t，序号0是空字符串
+    uint32 *index;      // 开放寻址哈希索引，保存序号+1
+    uint32 icap;
+    uint32 size;        // 合并之后的字符串表大小
+    uint32 rawsize;     // 每个名称直接追加时的字符串表大小
+} elf_strtab_t;
+
+bool elf_strtab_init(elf_strtab_t *t);
+uint32 elf_strtab_intern(elf_strtab_t *t, const byte *a, uint32 len); // 失败返回 0xffffffff
+bool elf_strtab_build(elf_strtab_t *t, buffer_t *out); // 清空 out 然后写入字符串表内容
+inline uint32 elf_strtab_offset(elf_strtab_t *t, uint32 id) { return ((elfstr_t *)t->strs.a)[id].offset; }
+void elf_strtab_free(elf_strtab_t *t);
+
 // 符号表分区的第一个符号总是未定义符号：
 // ElfSym.name      0 没有名称
 // ElfSym.value     0 零值
@@ -873,6 +904,33 @@ inline byte *elf_sym_add_64(byte *p, Elf64Sym sym) { memcpy(p, &sym, sizeof(sym)
 #define ELF_R_386_IRELATIVE     42  // word32   indirect (B + A)
 #define ELF_R_386_GOT32X        43  // word32   G + A - GOT / G + A
 
+// x86-64 重定位类型，只使用 ElfRela 类型的重定位条目，其中 S 符号值、A 附加值、P 重定位
+// 位置的地址、L 符号的过程链接表条目地址、G 符号在全局偏移表中的偏移、Z 符号大小
+#define ELF_R_X86_64_NONE       0   // 无
+#define ELF_R_X86_64_64         1   // word64   S + A
+#define ELF_R_X86_64_PC32       2   // word32   S + A - P
+#define ELF_R_X86_64_GOT32      3   // word32   G + A
+#define ELF_R_X86_64_PLT32      4   // word32   L + A - P
+#define ELF_R_X86_64_COPY       5   // 无
+#define ELF_R_X86_64_GLOB_DAT   6   // word64   S
+#define ELF_R_X86_64_JUMP_SLOT  7   // word64   S
+#define ELF_R_X86_64_RELATIVE   8   // word64   B + A
+#define ELF_R_X86_64_GOTPCREL   9   // word32   G + GOT + A - P
+#define ELF_R_X86_64_32         10  // word32   S + A 零扩展
+#define ELF_R_X86_64_32S        11  // word32   S + A 符号扩展
+#define ELF_R_X86_64_16         12  // word16   S + A
+#define ELF_R_X86_64_PC16       13  // word16   S + A - P
+#define ELF_R_X86_64_8          14  // word8    S + A
+#define ELF_R_X86_64_PC8        15  // word8    S + A - P
+#define ELF_R_X86_64_PC64       24  // word64   S + A - P
+#define ELF_R_X86_64_GOTOFF64   25  // word64   S + A - GOT
+#define ELF_R_X86_64_GOTPC32    26  // word32   GOT + A - P
+#define ELF_R_X86_64_SIZE32     32  // word32   Z + A
+#define ELF_R_X86_64_SIZE64     33  // word64   Z + A
+#define ELF_R_X86_64_IRELATIVE  37  // word64   indirect (B + A)
+#define ELF_R_X86_64_GOTPCRELX  41  // word32   G + GOT + A - P
+#define ELF_R_X86_64_REX_GOTPCRELX 42 // word32 G + GOT + A - P
+
 // 重定位结构体，重定位用于处理符号引用和符号定义；例如当程序调用一个函数时，
 // 对应的调用指令必须将代码控制权转移到合适的目标地址；重定位文件必须有重定
 // 位条目来描述怎样修改它的分区内容，从而允许可执行或共享目标文件为程序的进
@@ -943,6 +1001,10 @@ typedef struct {
 #define ELF_X64_REL(offset, symndx, reltype) (Elf64Rel) {                       \
     host_64_to_le(offset),                                                      \
     host_64_to_le(ELF_REL_INFO_64(symndx, reltype)) }
+#define ELF_X64_RELA(offset, symndx, reltype, addend) (Elf64Rela) {             \
+    host_64_to_le(offset),                                                      \
+    host_64_to_le(ELF_REL_INFO_64(symndx, reltype)),                            \
+    host_64_to_le(addend) }
 inline byte *elf_rel_add_32(byte *p, Elf32Rel rel) { memcpy(p, &rel, sizeof(rel)); return p + sizeof(rel); }
 inline byte *elf_rel_add_64(byte *p, Elf64Rel rel) { memcpy(p, &rel, sizeof(rel)); return p + sizeof(rel); }
 
@@ -1201,6 +1263,7 @@ typedef struct {
 #define ELF_DT_PREINIT_ARRAYSZ 33 // val  O       忽略     预初始化函数指针数组的大小
 #define ELF_DT_SYMTAB_SHNDX 34 // ptr     O       O       符号表 ELF_DT_SYMTAB 引用的 ELF_SEC_SYMTAB_SHNDX 分区的地址
 #define ELF_DT_LOOS 0x6000000D // 未指定  未指定  未指定   未指定
+#define ELF_DT_GNU_HASH 0x6ffffef5 // ptr  O       O       GNU 哈希表分区的地址，可以与 ELF_DT_HASH 同时存在
 #define ELF_DT_HIOS 0x6ffff000 // 未指定  未指定  未指定   未指定
 #define ELF_DT_LOPROC 0x70000000 // 未指定 未指定 未指定   未指定
 #define ELF_DT_HIPROC 0x7fffffff // 未指定 未指定 未指定   未指定
@@ -1252,6 +1315,11 @@ typedef struct {
     byte name[1];
 } Elf64Note;
 
+// GNU 说明条目，名称是 "GNU"
+#define ELF_NT_GNU_ABI_TAG 1        // 内容是操作系统和最低内核版本
+#define ELF_NT_GNU_BUILD_ID 3       // 内容是唯一标识构建结果的字节串，通常由文件内容哈希得到
+#define ELF_NT_GNU_PROPERTY_TYPE_0 5
+
 // TLS 分段的程序头部信息，TLS 模板由所有标记是 ELF_SF_TLS 的分区组成，存有初始化数据
 // 的 TLS 模板的位置是 TLS 初始映像，TLS 模板的剩余部分由一个 ELF_SEC_NOBITS 的 TLS
 // 分区组成：
@@ -1285,4 +1353,41 @@ typedef struct {
 uint32 elf_hash(const byte* sym_name); // 传入一个符号的名称，返回用于计算桶索引的值
 inline uint32 *elf_hash_chain(uint32 *ht, uint32 nbucket) { return ht + 2 + nbucket; }
 
+// GNU 哈希表（.gnu.hash）是 ElfWord 整数数组，布隆过滤器的字大小与文件类型一致（32位文件
+// 是 uint32，64位文件是 uint64）。动态符号表中从 symoffset 开始的符号必须按桶排序，同一个
+// 桶的符号连续存放，bucket 保存每个桶第一个符号的符号索引，chain[y-symoffset] 保存符号 y
+// 的哈希值，最低位为1表示是桶中最后一个符号。查找时先检查布隆过滤器中的两位，不存在的符
+// 号大多数时候只需要读一个字就能确定，存在的符号只需要比较哈希值相同的符号名称：
+//      h = elf_gnu_hash(sym_name);
+//      w = bloom[(h / C) % bloom_size];    C 是字的位数
+//      如果 w 中 h % C 和 (h >> bloom_shift) % C 两位不都为1，符号不存在
+//      y = bucket[h % nbucket];            为0表示符号不存在
+//      比较 chain[y-symoffset]|1 == h|1 的符号名称，直到 chain 的最低位为1
+typedef struct {
+    uint32 nbucket;     // 桶的个数
+    uint32 symoffset;   // 第一个参与查找的符号索引，之前的符号（例如未定义符号）不在哈希表中
+    uint32 bloom_size;  // 布隆过滤器的字个数，必须是2的幂
+    uint32 bloom_shift; // 计算布隆过滤器第二位时哈希值的移位
+    // ElfAddr bloom[bloom_size];
+    // uint32 bucket[nbucket];
+    // uint32 chain[nsym-symoffset];
+} ElfGnuHash;
+
+#define ELF_GNU_HASH_BLOOM_SHIFT 6
+
+uint32 elf_gnu_hash(const byte *sym_name);
+
+// names[i] 是符号索引为 i 的符号名称，nsym 是符号个数（包括索引0的未定义符号），返回
+// 哈希表的内容，size 返回哈希表的字节大小，哈希表需要调用者释放。.hash 是可选的，动态
+// 链接器只要有 .gnu.hash 就会使用它。
+uint32 *elf_hash_build(const byte *const *names, uint32 nsym, uintd_t *size);
+
+// 生成 .gnu.hash 之前，符号需要按桶重新排序，order[i] 返回排序之后索引为 i 的符号的原
+// 始索引（i 从 symoffset 开始），生成动态符号表时按 order 的顺序输出符号。
+uint32 *elf_gnu_hash_build(const byte *const *names, uint32 nsym, uint32 symoffset, bool elf64, uint32 *order, uintd_t *size);
+
+// 加载时的符号查找，names 按符号表中的顺序索引，找不到返回 ELF_SYMNDX_UNDEF
+uint32 elf_hash_lookup(const uint32 *ht, const byte *const *names, const byte *sym_name);
+uint32 elf_gnu_hash_lookup(const uint32 *gh, bool elf64, const byte *const *names, const byte *sym_name);
+
 #endif /* CHAPL_CHCC_GELF_H */
@@ -0,0 +1,605 @@
+#define __CURR_FILE__ STRID_CHCC_GLINK
+#include "internal/decl.h"
+#include "chcc/chcc.h"
+#include "chcc/glink.h"
+#include "direct/trace.h"
+#if !defined(__MSC__)
+#include <sys/stat.h>
+#endif
+
+#define LINK_PHNUM 3
+#define LINK_NOTE_OFFSET (sizeof(Elf64Ehdr) + LINK_PHNUM * sizeof(Elf64Phdr))
+#define LINK_HDR_SIZE (LINK_NOTE_OFFSET + BUILDID_NOTE_SIZE)
+#define LINK_PAGE_SIZE ELF_X86_PAGE_SIZE
+#define LINK_STUB_SIZE 28
+#define LINK_COMMON_OBJ 0xffffffff
+
+static string_t lname_(const char *name)
+{
+    return string_create((const byte *)name, strlen(name), false);
+}
+
+bool glink_init(glink_t *l, uint32 jobs)
+{
+    memset(l, 0, sizeof(glink_t));
+    l->jobs = jobs ? jobs : 1;
+    return true;
+}
+
+static uint32 lsymfind_(glink_t *l, const char *name, uint32 hash) // 返回全局符号序号，不存在返回 0xffffffff
+{
+    lsym_t *syms = (lsym_t *)l->syms.a;
+    uint32 i, k;
+    if (!l->icap) {
+        return 0xffffffff;
+    }
+    for (i = hash & (l->icap - 1); (k = l->index[i]); i = (i + 1) & (l->icap - 1)) {
+        if (syms[k-1].hash == hash && strcmp(syms[k-1].name, name) == 0) {
+            return k - 1;
+        }
+    }
+    return 0xffffffff;
+}
+
+static bool lsymgrow_(glink_t *l) // 哈希索引的负载因子保持在一半以下
+{
+    lsym_t *syms = (lsym_t *)l->syms.a;
+    uint32 n = (uint32)(l->syms.len / sizeof(lsym_t));
+    uint32 cap = l->icap ? l->icap * 2 : 1024;
+    uint32 *index, i, k;
+    if (n * 2 < l->icap) {
+        return true;
+    }
+    if (!(index = (uint32 *)calloc(cap, sizeof(uint32)))) {
+        return false;
+    }
+    for (k = 0; k < n; k += 1) {
+        for (i = syms[k].hash & (cap - 1); index[i]; i = (i + 1) & (cap - 1)) {}
+        index[i] = k + 1;
+    }
+    free(l->index);
+    l->index = index;
+    l->icap = cap;
+    return true;
+}
+
+static uint32 lsympush_(glink_t *l, const char *name)
+{
+    uint32 hash = elf_gnu_hash((const byte *)name);
+    uint32 k = lsymfind_(l, name, hash), i;
+    lsym_t s;
+    if (k != 0xffffffff) {
+        return k;
+    }
+    if (!lsymgrow_(l)) {
+        return 0xffffffff;
+    }
+    memset(&s, 0, sizeof(lsym_t));
+    s.name = name;
+    s.hash = hash;
+    k = (uint32)(l->syms.len / sizeof(lsym_t));
+    if (!buffer_push(&l->syms, (byte *)&s, sizeof(lsym_t), 0)) {
+        return 0xffffffff;
+    }
+    for (i = hash & (l->icap - 1); l->index[i]; i = (i + 1) & (l->icap - 1)) {}
+    l->index[i] = k + 1;
+    return k;
+}
+
+static const char *lsymname_(lobj_t *o, uint32 i)
+{
+    uint32 name = lp_32_to_host(o->sym + i * sizeof(Elf64Sym));
+    if (name >= o->strsz || !memchr(o->str + name, 0, o->strsz - name)) {
+        return null;
+    }
+    return o->str + name;
+}
+
+static bool lobjparse_(lobj_t *o) // 解析文件头部、分区头部和符号表
+{
+    byte *a = o->a, *sh;
+    uint64 shoff;
+    uint32 i, symtab = 0;
+    lsec_t *s;
+    if (o->len < sizeof(Elf64Ehdr) || lp_32_to_host(a) != 0x464c457f || a[ELF_IDENT_CLASS] != ELF_CLASS_64 ||
+        a[ELF_IDENT_DATA] != ELF_DATA_2LSB || lp_16_to_host(a + 16) != ELF_TYPE_REL ||
+        lp_16_to_host(a + 18) != ELF_MACHINE_X86_64 || lp_16_to_host(a + 58) != sizeof(Elf64Shdr)) {
+        return false;
+    }
+    shoff = lp_64_to_host(a + 40);
+    o->shnum = lp_16_to_host(a + 60);
+    if (shoff > o->len || (o->len - shoff) / sizeof(Elf64Shdr) < o->shnum) {
+        return false;
+    }
+    if (!(o->sec = (lsec_t *)calloc(o->shnum + 1, sizeof(lsec_t)))) {
+        return false;
+    }
+    for (i = 0; i < o->shnum; i += 1) {
+        sh = a + shoff + i * sizeof(Elf64Shdr);
+        s = o->sec + i;
+        s->type = lp_32_to_host(sh + 4);
+        s->flags = lp_64_to_host(sh + 8);
+        s->offset = lp_64_to_host(sh + 24);
+        s->size = lp_64_to_host(sh + 32);
+        s->link = lp_32_to_host(sh + 40);
+        s->info = lp_32_to_host(sh + 44);
+        s->align = lp_64_to_host(sh + 48);
+        s->out = LSEC_NONE;
+        if (!s->align) {
+            s->align = 1;
+        }
+        if ((s->align & (s->align - 1)) || s->align > LINK_PAGE_SIZE) {
+            return false;
+        }
+        if (s->type != ELF_SEC_NOBITS && (s->offset > o->len || s->size > o->len - s->offset)) {
+            return false;
+        }
+        if (i && (s->flags & ELF_SF_ALLOC)) { // 按分区属性合并到输出分区
+            if (s->type == ELF_SEC_NOBITS) {
+                s->out = LSEC_BSS;
+            } else if (s->flags & ELF_SF_EXECINSTR) {
+                s->out = LSEC_TEXT;
+            } else if (s->flags & ELF_SF_WRITE) {
+                s->out = LSEC_DATA;
+            } else {
+                s->out = LSEC_RODATA;
+            }
+        }
+        if (s->type == ELF_SEC_SYMTAB) {
+            symtab = i;
+        }
+    }
+    if (!symtab) { // 没有符号表的目标文件不需要解析符号
+        return true;
+    }
+    s = o->sec + symtab;
+    if (s->link >= o->shnum || o->sec[s->link].type != ELF_SEC_STRTAB) {
+        return false;
+    }
+    o->sym = a + s->offset;
+    o->nsym = (uint32)(s->size / sizeof(Elf64Sym));
+    o->str = (const char *)a + o->sec[s->link].offset;
+    o->strsz = (uintd_t)o->sec[s->link].size;
+    return (o->gsym = (uint32 *)calloc(o->nsym + 1, sizeof(uint32))) != null;
+}
+
+static bool lobjsyms_(glink_t *l, lobj_t *o, uint32 obj) // 将非本地符号加入全局符号表
+{
+    lsym_t *g;
+    const char *name;
+    byte *s;
+    uint32 i, k, shndx;
+    bool weak;
+    for (i = 1; i < o->nsym; i += 1) {
+        s = o->sym + i * sizeof(Elf64Sym);
+        if (ELF_SYM_BIND(s[4]) == ELF_SYM_BIND_LOCAL) {
+            continue;
+        }
+        if (!(name = lsymname_(o, i)) || (k = lsympush_(l, name)) == 0xffffffff) {
+            log_error_s(ERROR_LINK_INVALID_OBJECT, o->name);
+            return false;
+        }
+        o->gsym[i] = k;
+        g = (lsym_t *)l->syms.a + k;
+        shndx = lp_16_to_host(s + 6);
+        weak = (ELF_SYM_BIND(s[4]) == ELF_SYM_BIND_WEAK);
+        if (shndx == ELF_SHNDX_UNDEF) {
+            continue;
+        }
+        if (shndx == ELF_SHNDX_COMMON) { // 通用符号取最大的大小和对齐
+            if (!g->defined || g->common) {
+                g->common = 1;
+                g->defined = 1;
+                g->obj = LINK_COMMON_OBJ;
+                if (lp_64_to_host(s + 16) > g->size) { g->size = lp_64_to_host(s + 16); }
+                if (lp_64_to_host(s + 8) > g->value) { g->value = lp_64_to_host(s + 8); }
+            }
+            continue;
+        }
+        if (shndx != ELF_SHNDX_ABS && shndx >= o->shnum) {
+            log_error_s(ERROR_LINK_INVALID_OBJECT, o->name);
+            return false;
+        }
+        if (g->defined && !g->common) {
+            if (weak) {
+                continue;
+            }
+            if (!g->weak) {
+                log_error_s(ERROR_LINK_SYMB_DUP_DEFINED, lname_(name));
+                return false;
+            }
+        }
+        g->defined = 1;
+        g->common = 0;
+        g->weak = weak;
+        g->obj = obj;
+        g->shndx = shndx;
+        g->value = lp_64_to_host(s + 8);
+        g->size = lp_64_to_host(s + 16);
+    }
+    return true;
+}
+
+static bool lsymaddr_(glink_t *l, lobj_t *o, uint32 i, uint64 *S) // 计算符号在可执行文件中的地址
+{
+    byte *s = o->sym + i * sizeof(Elf64Sym);
+    uint32 shndx = lp_16_to_host(s + 6);
+    uint64 value = lp_64_to_host(s + 8);
+    lsym_t *g;
+    if (ELF_SYM_BIND(s[4]) != ELF_SYM_BIND_LOCAL) {
+        g = (lsym_t *)l->syms.a + o->gsym[i];
+        if (!g->defined) {
+            if (ELF_SYM_BIND(s[4]) == ELF_SYM_BIND_WEAK) { // 未定义的弱符号地址为0
+                *S = 0;
+                return true;
+            }
+            log_error_s(ERROR_LINK_SYMB_UNDEFINED, lname_(g->name));
+            return false;
+        }
+        if (g->common) {
+            *S = l->addr[LSEC_BSS] + g->value;
+            return true;
+        }
+        o = (lobj_t *)l->objs.a + g->obj;
+        shndx = g->shndx;
+        value = g->value;
+    }
+    if (shndx == ELF_SHNDX_ABS) {
+        *S = value;
+    } else if (shndx && shndx < o->shnum && o->sec[shndx].out != LSEC_NONE) {
+        *S = l->addr[o->sec[shndx].out] + o->sec[shndx].pos + value;
+    } else {
+        log_error_s(ERROR_LINK_INVALID_OBJECT, o->name);
+        return false;
+    }
+    return true;
+}
+
+bool glink_add_obj(glink_t *l, byte *a, uintd_t len, string_t name)
+{
+    lobj_t o;
+    memset(&o, 0, sizeof(lobj_t));
+    o.a = a;
+    o.len = len;
+    string_init(&o.name, name.a, name.len, true);
+    if (!lobjparse_(&o)) {
+        log_error_s(ERROR_LINK_INVALID_OBJECT, name);
+        goto label_false;
+    }
+    if (!buffer_push(&l->objs, (byte *)&o, sizeof(lobj_t), 0)) {
+        goto label_false;
+    }
+    return true;
+label_false:
+    string_free(&o.name);
+    free(o.sec);
+    free(o.gsym);
+    return false;
+}
+
+bool glink_add_file(glink_t *l, const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    long size;
+    byte *a = null;
+    if (!fp) {
+        goto label_false;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        goto label_false;
+    }
+    if (!(a = (byte *)malloc(size ? size : 1)) || fread(a, 1, size, fp) != (size_t)size) {
+        goto label_false;
+    }
+    fclose(fp);
+    if (!glink_add_obj(l, a, (uintd_t)size, lname_(filename))) {
+        free(a);
+        return false;
+    }
+    ((lobj_t *)(l->objs.a + l->objs.len) - 1)->owned = true;
+    return true;
+label_false:
+    log_error_s(ERROR_LINK_READ_FAILED, lname_(filename));
+    if (fp) {
+        fclose(fp);
+    }
+    free(a);
+    return false;
+}
+
+static void llayout_(glink_t *l) // 计算每个输入分区在输出分区中的位置，以及输出分区的地址
+{
+    lobj_t *objs = (lobj_t *)l->objs.a;
+    lsym_t *syms = (lsym_t *)l->syms.a;
+    uint32 nobj = (uint32)(l->objs.len / sizeof(lobj_t));
+    uint32 nsym = (uint32)(l->syms.len / sizeof(lsym_t));
+    uint32 i, j, k;
+    uint64 end;
+    lsec_t *s;
+    for (k = 0; k < LSEC_NUM; k += 1) {
+        l->size[k] = 0;
+        l->align[k] = 16;
+    }
+    l->size[LSEC_TEXT] = l->stub;
+    for (i = 0; i < nobj; i += 1) {
+        for (j = 1; j < objs[i].shnum; j += 1) {
+            s = objs[i].sec + j;
+            if (s->out == LSEC_NONE) {
+                continue;
+            }
+            s->pos = u64_times_of_N(l->size[s->out], s->align);
+            l->size[s->out] = s->pos + s->size;
+            if (s->align > l->align[s->out]) {
+                l->align[s->out] = s->align;
+            }
+        }
+    }
+    for (k = 0; k < nsym; k += 1) { // 通用符号分配在 .bss 末尾，value 从对齐改为分区偏移
+        if (syms[k].common) {
+            end = syms[k].value ? syms[k].value : 1;
+            syms[k].value = u64_times_of_N(l->size[LSEC_BSS], end);
+            l->size[LSEC_BSS] = syms[k].value + syms[k].size;
+        }
+    }
+    l->offset[LSEC_TEXT] = u64_times_of_N(LINK_HDR_SIZE, l->align[LSEC_TEXT]);
+    l->offset[LSEC_RODATA] = u64_times_of_N(l->offset[LSEC_TEXT] + l->size[LSEC_TEXT], l->align[LSEC_RODATA]);
+    end = l->offset[LSEC_RODATA] + l->size[LSEC_RODATA];
+    l->offset[LSEC_DATA] = u64_times_of_N(end, l->align[LSEC_DATA]);
+    l->offset[LSEC_BSS] = l->offset[LSEC_DATA] + l->size[LSEC_DATA];
+    l->addr[LSEC_TEXT] = ELF_X64_BASE_ADDR + l->offset[LSEC_TEXT];
+    l->addr[LSEC_RODATA] = ELF_X64_BASE_ADDR + l->offset[LSEC_RODATA];
+    // 可读写分段从下一个内存页开始，虚拟地址与文件偏移模页大小同余
+    l->addr[LSEC_DATA] = u64_times_of_N(ELF_X64_BASE_ADDR + end, LINK_PAGE_SIZE) + (l->offset[LSEC_DATA] & (LINK_PAGE_SIZE - 1));
+    l->addr[LSEC_BSS] = u64_times_of_N(l->addr[LSEC_DATA] + l->size[LSEC_DATA], l->align[LSEC_BSS]);
+    l->filesz = l->offset[LSEC_BSS];
+}
+
+typedef struct {
+    uint32 obj;
+    uint32 sec;
+} lreloc_t;
+
+static void lreloc_task(void *para, uint32 worker, uint32 task) // 每个任务处理一个重定位分区，不同任务修改的内容不重叠
+{
+    glink_t *l = (glink_t *)((void **)para)[0];
+    lreloc_t *t = (lreloc_t *)((void **)para)[1] + task;
+    lobj_t *o = (lobj_t *)l->objs.a + t->obj;
+    lsec_t *rs = o->sec + t->sec;
+    lsec_t *ts = o->sec + rs->info;
+    byte *r = o->a + rs->offset, *loc;
+    uint64 n = rs->size / sizeof(Elf64Rela), i, off, info, S, P;
+    int64 A, v;
+    uint32 sym, type;
+    trace_begin("lreloc_task");
+    for (i = 0; i < n; i += 1, r += sizeof(Elf64Rela)) {
+        off = lp_64_to_host(r);
+        info = lp_64_to_host(r + 8);
+        A = (int64)lp_64_to_host(r + 16);
+        sym = (uint32)ELF_REL_SYM_64(info);
+        type = (uint32)ELF_REL_TYPE_64(info);
+        if (type == ELF_R_X86_64_NONE) {
+            continue;
+        }
+        if (sym >= o->nsym || off > ts->size || ts->size - off < ((type == ELF_R_X86_64_64 || type == ELF_R_X86_64_PC64) ? 8 : 4)) {
+            log_error_s(ERROR_LINK_INVALID_OBJECT, o->name);
+            goto label_failed;
+        }
+        if (!lsymaddr_(l, o, sym, &S)) {
+            goto label_failed;
+        }
+        P = l->addr[ts->out] + ts->pos + off;
+        loc = l->image + l->offset[ts->out] + ts->pos + off;
+        switch (type) {
+        case ELF_R_X86_64_64:
+            host_64_to_lp(S + A, loc);
+            break;
+        case ELF_R_X86_64_PC64:
+            host_64_to_lp(S + A - P, loc);
+            break;
+        case ELF_R_X86_64_PC32:
+        case ELF_R_X86_64_PLT32: // 静态链接时过程链接表条目就是函数自己
+            v = (int64)(S + A - P);
+            if (v < -(int64)0x80000000 || v > 0x7fffffff) {
+                goto label_overflow;
+            }
+            host_32_to_lp((uint32)v, loc);
+            break;
+        case ELF_R_X86_64_32:
+            if (S + A > 0xffffffff) {
+                goto label_overflow;
+            }
+            host_32_to_lp((uint32)(S + A), loc);
+            break;
+        case ELF_R_X86_64_32S:
+            v = (int64)(S + A);
+            if (v < -(int64)0x80000000 || v > 0x7fffffff) {
+                goto label_overflow;
+            }
+            host_32_to_lp((uint32)v, loc);
+            break;
+        default:
+            log_error_3(ERROR_LINK_RELOC_NOT_SUPPORT, type, t->obj, t->sec);
+            goto label_failed;
+        }
+    }
+    trace_end("lreloc_task");
+    return;
+label_overflow:
+    log_error_s(ERROR_LINK_RELOC_OVERFLOW, o->name);
+label_failed:
+    atom_store_rel(&l->failed, 1);
+    trace_end("lreloc_task");
+}
+
+static void lstub_(glink_t *l, uint64 main_addr) // _start: 以 main(argc, argv) 的返回值退出进程
+{
+    byte *p = l->image + l->offset[LSEC_TEXT];
+    static const byte code[LINK_STUB_SIZE] = {
+        0x31, 0xed,                     // xor %ebp,%ebp        栈回溯的最外层
+        0x8b, 0x3c, 0x24,               // mov (%rsp),%edi      argc
+        0x48, 0x8d, 0x74, 0x24, 0x08,   // lea 8(%rsp),%rsi     argv
+        0x48, 0x83, 0xe4, 0xf0,         // and $-16,%rsp        调用前栈对齐到16字节
+        0xe8, 0x00, 0x00, 0x00, 0x00,   // call main
+        0x89, 0xc7,                     // mov %eax,%edi
+        0xb8, 0x3c, 0x00, 0x00, 0x00,   // mov $60,%eax         exit
+        0x0f, 0x05                      // syscall
+    };
+    memcpy(p, code, LINK_STUB_SIZE);
+    host_32_to_lp((uint32)(main_addr - (l->addr[LSEC_TEXT] + 19)), p + 15);
+}
+
+static byte *lphdr_(byte *p, uint32 type, uint32 flags, uint64 offset, uint64 vaddr, uint64 filesz, uint64 memsz, uint64 align)
+{
+    p = host_32_to_lp(type, p);
+    p = host_32_to_lp(flags, p);
+    p = host_64_to_lp(offset, p);
+    p = host_64_to_lp(vaddr, p);
+    p = host_64_to_lp(vaddr, p);
+    p = host_64_to_lp(filesz, p);
+    p = host_64_to_lp(memsz, p);
+    return host_64_to_lp(align, p);
+}
+
+static void lexehdr_(glink_t *l, uint64 entry)
+{
+    byte *p = l->image;
+    p = host_32_to_lp(0x464c457f, p);   // 0x7f 'E' 'L' 'F'
+    p = host_32_to_lp(0x00010102, p);   // ELF_CLASS_64 ELF_DATA_2LSB ELF_VERSION_CURR ELF_OSABI_NONE
+    p = host_64_to_lp(0, p);            // ELF_ABIVERSION_NONE ELF_HDR_PAD
+    p = host_32_to_lp(0x003e0002, p);   // ELF_TYPE_EXEC ELF_MACHINE_X86_64
+    p = host_32_to_lp(ELF_VERSION_CURR, p);
+    p = host_64_to_lp(entry, p);        // entry
+    p = host_64_to_lp(sizeof(Elf64Ehdr), p); // phoff
+    p = host_64_to_lp(0, p);            // shoff 可执行文件不需要分区头部
+    p = host_32_to_lp(0, p);            // flags
+    p = host_16_to_lp(sizeof(Elf64Ehdr), p);
+    p = host_16_to_lp(sizeof(Elf64Phdr), p);
+    p = host_16_to_lp(LINK_PHNUM, p);
+    p = host_16_to_lp(sizeof(Elf64Shdr), p);
+    p = host_16_to_lp(0, p);            // shnum
+    p = host_16_to_lp(0, p);            // strsh
+    p = lphdr_(p, ELF_PT_LOAD, ELF_PF_R|ELF_PF_X, 0, ELF_X64_BASE_ADDR, l->offset[LSEC_RODATA] + l->size[LSEC_RODATA],
+        l->offset[LSEC_RODATA] + l->size[LSEC_RODATA], LINK_PAGE_SIZE);
+    p = lphdr_(p, ELF_PT_LOAD, ELF_PF_R|ELF_PF_W, l->offset[LSEC_DATA], l->addr[LSEC_DATA], l->size[LSEC_DATA],
+        l->addr[LSEC_BSS] + l->size[LSEC_BSS] - l->addr[LSEC_DATA], LINK_PAGE_SIZE);
+    lphdr_(p, ELF_PT_NOTE, ELF_PF_R, LINK_NOTE_OFFSET, ELF_X64_BASE_ADDR + LINK_NOTE_OFFSET, BUILDID_NOTE_SIZE, BUILDID_NOTE_SIZE, 4);
+    buildid_note(l->image + LINK_NOTE_OFFSET);
+}
+
+static bool lbuildid_(glink_t *l) // 对整个文件内容计算构建标识，输出越大并行的块越多
+{
+    bidpart_t part;
+    part.a = l->image;
+    part.n = (uintd_t)l->filesz;
+    return buildid_hash(&part, 1, l->jobs, l->image + LINK_NOTE_OFFSET + BUILDID_NOTE_DESC);
+}
+
+bool glink_output(glink_t *l, const char *filename)
+{
+    lobj_t *objs = (lobj_t *)l->objs.a;
+    uint32 nobj = (uint32)(l->objs.len / sizeof(lobj_t));
+    uint32 i, j, start, entry_sym;
+    buffer_t tasks = {0};
+    lsym_t *g;
+    lreloc_t t;
+    lsec_t *s;
+    void *para[2];
+    uint64 entry;
+    FILE *fp;
+    bool succ = false;
+    trace_begin("glink_output");
+    for (i = 0; i < nobj; i += 1) {
+        if (!lobjsyms_(l, objs + i, i)) {
+            goto label_free;
+        }
+    }
+    start = lsymfind_(l, "_start", elf_gnu_hash((const byte *)"_start"));
+    entry_sym = start;
+    if (start == 0xffffffff || !((lsym_t *)l->syms.a)[start].defined) { // 没有定义 _start 时生成入口代码
+        entry_sym = lsymfind_(l, "main", elf_gnu_hash((const byte *)"main"));
+        if (entry_sym == 0xffffffff || !((lsym_t *)l->syms.a)[entry_sym].defined) {
+            log_error_s(ERROR_LINK_ENTRY_NOT_FOUND, lname_("_start"));
+            goto label_free;
+        }
+        l->stub = LINK_STUB_SIZE;
+    }
+    llayout_(l);
+    if (!(l->image = (byte *)calloc(1, (uintd_t)l->filesz))) {
+        goto label_free;
+    }
+    for (i = 0; i < nobj; i += 1) { // 拷贝分区内容，收集需要应用的重定位分区
+        for (j = 1; j < objs[i].shnum; j += 1) {
+            s = objs[i].sec + j;
+            if (s->out != LSEC_NONE && s->out != LSEC_BSS) {
+                memcpy(l->image + l->offset[s->out] + s->pos, objs[i].a + s->offset, (uintd_t)s->size);
+            }
+            if (s->type == ELF_SEC_REL) {
+                log_error_s(ERROR_LINK_RELOC_NOT_SUPPORT, objs[i].name);
+                goto label_free;
+            }
+            if (s->type == ELF_SEC_RELA && s->info < objs[i].shnum && objs[i].sec[s->info].out != LSEC_NONE) {
+                t.obj = i;
+                t.sec = j;
+                if (!buffer_push(&tasks, (byte *)&t, sizeof(lreloc_t), 0)) {
+                    goto label_free;
+                }
+            }
+        }
+    }
+    // 符号地址在布局之后都已确定，各重定位分区并行处理
+    para[0] = l;
+    para[1] = tasks.a;
+    thread_for(l->jobs, (uint32)(tasks.len / sizeof(lreloc_t)), lreloc_task, para);
+    if (atom_load_acq(&l->failed)) {
+        goto label_free;
+    }
+    g = (lsym_t *)l->syms.a + entry_sym;
+    if (g->common || g->shndx == ELF_SHNDX_ABS || objs[g->obj].sec[g->shndx].out != LSEC_TEXT) {
+        log_error_s(ERROR_LINK_ENTRY_NOT_FOUND, lname_(g->name));
+        goto label_free;
+    }
+    entry = l->addr[LSEC_TEXT] + objs[g->obj].sec[g->shndx].pos + g->value;
+    if (l->stub) {
+        lstub_(l, entry);
+        entry = l->addr[LSEC_TEXT];
+    }
+    lexehdr_(l, entry);
+    if (!lbuildid_(l)) {
+        goto label_free;
+    }
+    if (!(fp = fopen(filename, "wb"))) {
+        log_error_s(ERROR_LINK_WRITE_FAILED, lname_(filename));
+        goto label_free;
+    }
+    succ = (fwrite(l->image, 1, (size_t)l->filesz, fp) == l->filesz);
+    succ = (fclose(fp) == 0) && succ;
+#if !defined(__MSC__)
+    succ = succ && chmod(filename, 0755) == 0;
+#endif
+    if (!succ) {
+        log_error_s(ERROR_LINK_WRITE_FAILED, lname_(filename));
+    }
+label_free:
+    buffer_free(&tasks);
+    trace_end("glink_output");
+    return succ;
+}
+
+void glink_free(glink_t *l)
+{
+    lobj_t *objs = (lobj_t *)l->objs.a;
+    uint32 i, n = (uint32)(l->objs.len / sizeof(lobj_t));
+    for (i = 0; i < n; i += 1) {
+        if (objs[i].owned) {
+            free(objs[i].a);
+        }
+        string_free(&objs[i].name);
+        free(objs[i].sec);
+        free(objs[i].gsym);
+    }
+    buffer_free(&l->objs);
+    buffer_free(&l->syms);
+    free(l->index);
+    free(l->image);
+    memset(l, 0, sizeof(glink_t));
+}
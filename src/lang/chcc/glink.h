@@ -0,0 +1,86 @@
+#ifndef CHAPL_CHCC_GLINK_H
+#define CHAPL_CHCC_GLINK_H
+#include "chcc/gelf.h"
+#include "direct/thread.h"
+#include "chcc/gbuildid.h"
+
+// 静态链接器：读取 ELF64 可重定位目标文件，合并同类分区，通过全局符号哈希索引解析符号，
+// 按重定位分区并行应用重定位，输出静态链接的 x86-64 可执行文件。可执行文件的布局：
+//  0x0040_0000 [   Elf64Ehdr       ] 只读可执行分段
+//              [   Elf64Phdr * 3   ] 两个可加载分段和说明分段
+//              [   .note.gnu.build-id ] 构建标识，文件其余内容都确定之后计算
+//              [   .text           ] 所有输入的代码分区
+//              [   .rodata         ] 所有输入的只读数据分区
+//  下一个内存页 [   .data           ] 可读写分段，与文件偏移模页大小同余
+//              [   .bss            ] 不占用文件空间，包括通用符号
+// 程序入口是全局符号 _start，如果输入文件没有定义 _start，链接器在代码分区开始处生成一个
+// 调用 main 并以其返回值调用 exit 系统调用的入口。
+
+#define LSEC_TEXT 0
+#define LSEC_RODATA 1
+#define LSEC_DATA 2
+#define LSEC_BSS 3
+#define LSEC_NUM 4
+#define LSEC_NONE 0xff
+
+typedef struct {
+    uint32 type;
+    uint32 link;
+    uint32 info;
+    uint32 out;     // 输出分区 LSEC_XXX，LSEC_NONE 表示不加载
+    uint64 flags;
+    uint64 offset;
+    uint64 size;
+    uint64 align;
+    uint64 pos;     // 在输出分区中的偏移
+} lsec_t;
+
+typedef struct {
+    string_t name;
+    byte *a;        // 文件内容
+    uintd_t len;
+    bool owned;     // 文件内容由链接器分配
+    lsec_t *sec;
+    uint32 shnum;
+    byte *sym;      // 符号表，Elf64Sym 数组
+    uint32 nsym;
+    const char *str; // 符号名称字符串表
+    uintd_t strsz;
+    uint32 *gsym;   // 非本地符号在全局符号表中的序号
+} lobj_t;
+
+typedef struct {
+    const char *name;
+    uint32 hash;
+    uint32 obj;     // 定义符号的目标文件序号
+    uint32 shndx;
+    uint64 value;
+    uint64 size;
+    uint32 defined: 1;
+    uint32 weak: 1;
+    uint32 common: 1; // 通用符号，在 .bss 中分配，value 是地址对齐
+} lsym_t;
+
+typedef struct {
+    buffer_t objs;  // 包含 lobj_t
+    buffer_t syms;  // 包含 lsym_t
+    uint32 *index;  // 全局符号哈希索引，开放寻址，保存符号序号+1
+    uint32 icap;
+    uint32 jobs;    // 并行重定位的线程个数
+    uint64 size[LSEC_NUM];
+    uint64 align[LSEC_NUM];
+    uint64 addr[LSEC_NUM];   // 输出分区的虚拟地址
+    uint64 offset[LSEC_NUM]; // 输出分区的文件偏移
+    uint64 stub;    // 生成的入口代码大小，为0表示使用输入文件定义的 _start
+    byte *image;    // 可执行文件内容
+    uint64 filesz;
+    uintd_t failed;
+} glink_t;
+
+bool glink_init(glink_t *l, uint32 jobs);
+bool glink_add_obj(glink_t *l, byte *a, uintd_t len, string_t name); // a 由调用者管理，链接完成前必须有效
+bool glink_add_file(glink_t *l, const char *filename);
+bool glink_output(glink_t *l, const char *filename);
+void glink_free(glink_t *l);
+
+#endif /* CHAPL_CHCC_GLINK_H */
@@ -0,0 +1,306 @@
+#include "chcc/gread.h"
+#if defined(__MSC__)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static bool elfrange_(elfmap_t *m, uint64 off, uint64 size) // [off, off+size) 在文件范围内
+{
+    return off <= m->len && size <= m->len - off;
+}
+
+static bool elfparse_(elfmap_t *m) // 检查文件头部、程序头部表和分区头部表
+{
+    const byte *a = m->a;
+    const Elf64Ehdr *e = (const Elf64Ehdr *)a;
+    const Elf64Shdr *strsh;
+    uint64 shoff, phoff;
+    uint32 strndx;
+    if (m->len < sizeof(Elf64Ehdr) || ((upr)a & 7) || le_32_to_host(*(const uint32 *)a) != 0x464c457f ||
+        e->ident[ELF_IDENT_CLASS] != ELF_CLASS_64 || e->ident[ELF_IDENT_DATA] != ELF_DATA_2LSB) {
+        return false;
+    }
+    m->ehdr = e;
+    phoff = le_64_to_host(e->phoff);
+    if (phoff && le_16_to_host(e->phnum)) {
+        m->phnum = le_16_to_host(e->phnum);
+        if ((phoff & 7) || le_16_to_host(e->phsize) != sizeof(Elf64Phdr) || !elfrange_(m, phoff, (uint64)m->phnum * sizeof(Elf64Phdr))) {
+            return false;
+        }
+        m->phdr = (const Elf64Phdr *)(a + phoff);
+    }
+    shoff = le_64_to_host(e->shoff);
+    if (!shoff) { // 没有分区头部表
+        return true;
+    }
+    if ((shoff & 7) || le_16_to_host(e->shsize) != sizeof(Elf64Shdr) || !elfrange_(m, shoff, sizeof(Elf64Shdr))) {
+        return false;
+    }
+    m->shdr = (const Elf64Shdr *)(a + shoff);
+    m->shnum = le_16_to_host(e->shnum);
+    strndx = le_16_to_host(e->strsh);
+    if (m->shnum == 0) { // 分区个数>=0xff00时实际个数保存在第一个分区头部
+        m->shnum = (uint32)le_64_to_host(m->shdr[0].size);
+    }
+    if (strndx == ELF_SHNDX_XINDEX) {
+        strndx = le_32_to_host(m->shdr[0].link);
+    }
+    if (!elfrange_(m, shoff, (uint64)m->shnum * sizeof(Elf64Shdr))) {
+        return false;
+    }
+    if ((strsh = elfmap_section(m, strndx)) && strndx) {
+        m->shstr = (const char *)elfmap_secdata(m, strsh);
+        m->shstrsz = m->shstr ? le_64_to_host(strsh->size) : 0;
+    }
+    return true;
+}
+
+bool elfmap_init(elfmap_t *m, const byte *a, uintd_t len)
+{
+    memset(m, 0, sizeof(elfmap_t));
+    m->a = a;
+    m->len = len;
+    return elfparse_(m);
+}
+
+#if defined(__MSC__)
+bool elfmap_open(elfmap_t *m, const char *filename)
+{
+    HANDLE f = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+    HANDLE h = null;
+    LARGE_INTEGER size;
+    void *a = null;
+    memset(m, 0, sizeof(elfmap_t));
+    if (f == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    if (GetFileSizeEx(f, &size) && size.QuadPart && (h = CreateFileMappingA(f, null, PAGE_READONLY, 0, 0, null))) {
+        a = MapViewOfFile(h, FILE_MAP_READ, 0, 0, 0);
+    }
+    CloseHandle(f); // 映射保持对文件的引用
+    if (!a) {
+        if (h) {
+            CloseHandle(h);
+        }
+        return false;
+    }
+    m->a = (const byte *)a;
+    m->len = (uintd_t)size.QuadPart;
+    m->mapped = true;
+    m->handle = (uintd_t)h;
+    if (!elfparse_(m)) {
+        elfmap_close(m);
+        return false;
+    }
+    return true;
+}
+
+void elfmap_close(elfmap_t *m)
+{
+    if (m->mapped) {
+        UnmapViewOfFile(m->a);
+        CloseHandle((HANDLE)m->handle);
+    }
+    memset(m, 0, sizeof(elfmap_t));
+}
+#else
+bool elfmap_open(elfmap_t *m, const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    void *a = MAP_FAILED;
+    memset(m, 0, sizeof(elfmap_t));
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        a = mmap(null, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd); // 映射保持对文件的引用
+    if (a == MAP_FAILED) {
+        return false;
+    }
+    m->a = (const byte *)a;
+    m->len = (uintd_t)st.st_size;
+    m->mapped = true;
+    if (!elfparse_(m)) {
+        elfmap_close(m);
+        return false;
+    }
+    return true;
+}
+
+void elfmap_close(elfmap_t *m)
+{
+    if (m->mapped) {
+        munmap((void *)m->a, m->len);
+    }
+    memset(m, 0, sizeof(elfmap_t));
+}
+#endif
+
+const Elf64Phdr *elfmap_segment(elfmap_t *m, uint32 i)
+{
+    return (i < m->phnum) ? m->phdr + i : null;
+}
+
+const Elf64Shdr *elfmap_section(elfmap_t *m, uint32 i)
+{
+    return (i < m->shnum) ? m->shdr + i : null;
+}
+
+const char *elfmap_secname(elfmap_t *m, const Elf64Shdr *sh)
+{
+    uint32 name = le_32_to_host(sh->name);
+    if (name >= m->shstrsz || !memchr(m->shstr + name, 0, (uintd_t)(m->shstrsz - name))) {
+        return "";
+    }
+    return m->shstr + name;
+}
+
+const Elf64Shdr *elfmap_find(elfmap_t *m, const char *name)
+{
+    uint32 i;
+    for (i = 1; i < m->shnum; i += 1) {
+        if (strcmp(elfmap_secname(m, m->shdr + i), name) == 0) {
+            return m->shdr + i;
+        }
+    }
+    return null;
+}
+
+const byte *elfmap_secdata(elfmap_t *m, const Elf64Shdr *sh)
+{
+    uint64 off = le_64_to_host(sh->offset), size = le_64_to_host(sh->size);
+    if (le_32_to_host(sh->type) == ELF_SEC_NOBITS || !elfrange_(m, off, size)) {
+        return null;
+    }
+    return m->a + off;
+}
+
+const char *elfmap_string(elfmap_t *m, uint32 strsh, uint64 off)
+{
+    const Elf64Shdr *sh = elfmap_section(m, strsh);
+    const char *s = sh ? (const char *)elfmap_secdata(m, sh) : null;
+    uint64 size = sh ? le_64_to_host(sh->size) : 0;
+    if (!s || off >= size || !memchr(s + off, 0, (uintd_t)(size - off))) {
+        return null;
+    }
+    return s + off;
+}
+
+static const byte *elfarray_(elfmap_t *m, const Elf64Shdr *sh, uintd_t entsize, uint32 *n) // 覆盖结构体数组的分区
+{
+    const byte *a = elfmap_secdata(m, sh);
+    uint64 size = le_64_to_host(sh->size);
+    if (!a || ((upr)a & 7) || le_64_to_host(sh->entsize) != entsize || size / entsize > 0xffffffff) {
+        return null;
+    }
+    *n = (uint32)(size / entsize);
+    return a;
+}
+
+bool elfsym_init(elfsymit_t *it, elfmap_t *m, const Elf64Shdr *symtab)
+{
+    const Elf64Shdr *str = elfmap_section(m, le_32_to_host(symtab->link));
+    memset(it, 0, sizeof(elfsymit_t));
+    if (!(it->sym = (const Elf64Sym *)elfarray_(m, symtab, sizeof(Elf64Sym), &it->n))) {
+        return false;
+    }
+    if (str && le_32_to_host(str->type) == ELF_SEC_STRTAB && (it->str = (const char *)elfmap_secdata(m, str))) {
+        it->strsz = le_64_to_host(str->size);
+    }
+    return true;
+}
+
+const Elf64Sym *elfsym_next(elfsymit_t *it)
+{
+    return (it->i < it->n) ? it->sym + it->i++ : null;
+}
+
+const char *elfsym_name(elfsymit_t *it, const Elf64Sym *sym)
+{
+    uint32 name = le_32_to_host(sym->name);
+    if (name >= it->strsz || !memchr(it->str + name, 0, (uintd_t)(it->strsz - name))) {
+        return "";
+    }
+    return it->str + name;
+}
+
+bool elfrela_init(elfrelait_t *it, elfmap_t *m, const Elf64Shdr *rela)
+{
+    memset(it, 0, sizeof(elfrelait_t));
+    return (it->rela = (const Elf64Rela *)elfarray_(m, rela, sizeof(Elf64Rela), &it->n)) != null;
+}
+
+const Elf64Rela *elfrela_next(elfrelait_t *it)
+{
+    return (it->i < it->n) ? it->rela + it->i++ : null;
+}
+
+static bool elfnotes_(elfnoteit_t *it, const byte *p, uint64 size, uint64 align)
+{
+    memset(it, 0, sizeof(elfnoteit_t));
+    if (!p || ((upr)p & 3)) {
+        return false;
+    }
+    it->p = p;
+    it->end = p + size;
+    it->align = (align == 8) ? 8 : 4;
+    return true;
+}
+
+bool elfnote_init(elfnoteit_t *it, elfmap_t *m, const Elf64Shdr *note)
+{
+    return elfnotes_(it, elfmap_secdata(m, note), le_64_to_host(note->size), le_64_to_host(note->addralign));
+}
+
+bool elfnote_init_seg(elfnoteit_t *it, elfmap_t *m, const Elf64Phdr *note)
+{
+    uint64 off = le_64_to_host(note->offset), size = le_64_to_host(note->filesz);
+    if (le_32_to_host(note->type) != ELF_PT_NOTE || !elfrange_(m, off, size)) {
+        memset(it, 0, sizeof(elfnoteit_t));
+        return false;
+    }
+    return elfnotes_(it, m->a + off, size, le_64_to_host(note->align));
+}
+
+bool elfnote_next(elfnoteit_t *it, elfnote_t *n)
+{
+    const Elf32Note *e = (const Elf32Note *)it->p;
+    uint64 left = (uint64)(it->end - it->p), desc, next;
+    if (left < 12) {
+        return false;
+    }
+    n->namesz = le_32_to_host(e->namesz);
+    n->descsz = le_32_to_host(e->descsz);
+    n->type = le_32_to_host(e->type);
+    desc = u64_times_of_N(12 + (uint64)n->namesz, it->align); // 内容和下一个条目的位置都相对于条目开始对齐
+    next = u64_times_of_N(desc + n->descsz, it->align);
+    if (desc > left || n->descsz > left - desc || (n->namesz && ((const char *)it->p)[12 + n->namesz - 1] != 0)) {
+        it->p = it->end; // 条目超出分区范围或名称不以 NUL 结尾
+        return false;
+    }
+    n->name = n->namesz ? (const char *)it->p + 12 : "";
+    n->desc = it->p + desc;
+    it->p = (next < left) ? it->p + next : it->end;
+    return true;
+}
+
+bool elfdyn_init(elfdynit_t *it, elfmap_t *m, const Elf64Shdr *dynamic)
+{
+    memset(it, 0, sizeof(elfdynit_t));
+    return (it->dyn = (const Elf64Dyn *)elfarray_(m, dynamic, sizeof(Elf64Dyn), &it->n)) != null;
+}
+
+const Elf64Dyn *elfdyn_next(elfdynit_t *it)
+{
+    if (it->i >= it->n || le_64_to_host((uint64)it->dyn[it->i].tag) == ELF_DT_NULL) {
+        return null;
+    }
+    return it->dyn + it->i++;
+}
@@ -0,0 +1,82 @@
+#ifndef CHAPL_CHCC_GREAD_H
+#define CHAPL_CHCC_GREAD_H
+#include "chcc/gelf.h"
+
+// ELF64 文件读取：文件以只读方式映射到内存，gelf.h 中的结构体直接覆盖在映射的内容上，不
+// 拷贝也不转换，结构体成员需要通过 le_XX_to_host 读取。打开文件只检查文件头部和分区头部
+// 表，分区内容在访问时才检查范围，只有访问到的内存页才会从文件中读入，因此打开和遍历几百
+// MB 的文件只需要几毫秒。覆盖结构体数组的分区必须按成员对齐并且 entsize 与结构体大小一致，
+// 否则迭代器初始化失败。说明分区的条目使用32位的 namesz/descsz/type（与 Elf32Note 相同，
+// ELF64 文件也是如此），内容和下一个条目相对条目开始对齐到分区的 addralign（4或8）。
+
+typedef struct {
+    const byte *a;          // 文件内容
+    uintd_t len;
+    const Elf64Ehdr *ehdr;
+    const Elf64Phdr *phdr;  // 程序头部表，可重定位目标文件没有
+    uint32 phnum;
+    const Elf64Shdr *shdr;  // 分区头部表
+    uint32 shnum;
+    const char *shstr;      // 分区名称字符串表
+    uint64 shstrsz;
+    bool mapped;            // a 是映射的文件，关闭时解除映射
+    uintd_t handle;         // windows 的文件映射句柄
+} elfmap_t;
+
+typedef struct {
+    const Elf64Sym *sym;
+    uint32 i;
+    uint32 n;
+    const char *str;        // 符号名称字符串表
+    uint64 strsz;
+} elfsymit_t;
+
+typedef struct {
+    const Elf64Rela *rela;
+    uint32 i;
+    uint32 n;
+} elfrelait_t;
+
+typedef struct {
+    const byte *p;
+    const byte *end;
+    uint32 align;
+} elfnoteit_t;
+
+typedef struct {
+    uint32 type;
+    uint32 namesz;          // 包括 NUL 字符
+    uint32 descsz;
+    const char *name;
+    const byte *desc;
+} elfnote_t;
+
+typedef struct {
+    const Elf64Dyn *dyn;
+    uint32 i;
+    uint32 n;
+} elfdynit_t;
+
+bool elfmap_open(elfmap_t *m, const char *filename);
+bool elfmap_init(elfmap_t *m, const byte *a, uintd_t len); // 使用已经在内存中的文件内容，a 由调用者管理
+void elfmap_close(elfmap_t *m);
+
+const Elf64Phdr *elfmap_segment(elfmap_t *m, uint32 i); // i 超出范围返回 null
+const Elf64Shdr *elfmap_section(elfmap_t *m, uint32 i); // i 超出范围返回 null
+const Elf64Shdr *elfmap_find(elfmap_t *m, const char *name);
+const char *elfmap_secname(elfmap_t *m, const Elf64Shdr *sh); // 名称无效时返回空字符串
+const byte *elfmap_secdata(elfmap_t *m, const Elf64Shdr *sh); // 内容超出文件范围或 NOBITS 返回 null
+const char *elfmap_string(elfmap_t *m, uint32 strsh, uint64 off); // 指定字符串表分区中的字符串，无效时返回 null
+
+bool elfsym_init(elfsymit_t *it, elfmap_t *m, const Elf64Shdr *symtab); // SYMTAB 或 DYNSYM 分区
+const Elf64Sym *elfsym_next(elfsymit_t *it); // 遍历结束返回 null，包括索引0的空符号
+const char *elfsym_name(elfsymit_t *it, const Elf64Sym *sym);
+bool elfrela_init(elfrelait_t *it, elfmap_t *m, const Elf64Shdr *rela);
+const Elf64Rela *elfrela_next(elfrelait_t *it);
+bool elfnote_init(elfnoteit_t *it, elfmap_t *m, const Elf64Shdr *note);
+bool elfnote_init_seg(elfnoteit_t *it, elfmap_t *m, const Elf64Phdr *note); // 没有分区头部的可执行文件通过 ELF_PT_NOTE 分段访问
+bool elfnote_next(elfnoteit_t *it, elfnote_t *n); // 条目超出分区范围时也返回 false
+bool elfdyn_init(elfdynit_t *it, elfmap_t *m, const Elf64Shdr *dynamic);
+const Elf64Dyn *elfdyn_next(elfdynit_t *it); // 遇到 ELF_DT_NULL 结束
+
+#endif /* CHAPL_CHCC_GREAD_H */
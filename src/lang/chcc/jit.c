@@ -0,0 +1,184 @@
+#define __CURR_FILE__ STRID_CHCC_JIT
+#include "internal/decl.h"
+#include "chcc/jit.h"
+#include "chcc/gabi.h"
+#if defined(__MSC__)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#endif
+
+#define JIT_PAGE_SIZE 4096
+#define JIT_TRAMP_SIZE 32
+#define JIT_NAME_MAX 256
+
+// 入口跳板，C调用约定 int32 tramp(byte *stack, byte *entry)，进入协程栈函数之前保护被
+// 调函数必须保护的寄存器，并将返回地址写入协程栈底，入口函数返回时 jmp (%edx) 回到跳板
+typedef int32 (*jit_tramp_t)(byte *stack, byte *entry);
+
+static byte *jitmap_(uintd_t size)
+{
+#if defined(__MSC__)
+    return (byte *)VirtualAlloc(null, size, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+#else
+    void *p = mmap(null, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED) ? null : (byte *)p;
+#endif
+}
+
+static bool jitprotect_(byte *p, uintd_t size, bool exec)
+{
+    if (!size) {
+        return true;
+    }
+#if defined(__MSC__)
+    DWORD old;
+    return VirtualProtect(p, size, exec ? PAGE_EXECUTE_READ : PAGE_READONLY, &old) != 0;
+#else
+    return mprotect(p, size, exec ? (PROT_READ|PROT_EXEC) : PROT_READ) == 0;
+#endif
+}
+
+static void *jitsym_(const char *name) // 在当前进程已加载的模块中查找外部符号
+{
+#if defined(__MSC__)
+    static const char *mods[] = {"ucrtbase.dll", "msvcrt.dll", "kernel32.dll", null};
+    const char **m;
+    HMODULE h;
+    void *p = (void *)GetProcAddress(GetModuleHandleA(null), name);
+    for (m = mods; !p && *m; m += 1) {
+        if ((h = GetModuleHandleA(*m)) || (h = LoadLibraryA(*m))) {
+            p = (void *)GetProcAddress(h, name);
+        }
+    }
+    return p;
+#else
+    void *h = dlopen(null, RTLD_NOW);
+    void *p = h ? dlsym(h, name) : null;
+    if (h) {
+        dlclose(h);
+    }
+    return p;
+#endif
+}
+
+static void jittramp_(byte *p)
+{
+    byte *ret = p + 20;
+    *p++ = 0x55;                            // push %ebp
+    *p++ = 0x53;                            // push %ebx
+    *p++ = 0x56;                            // push %esi
+    *p++ = 0x57;                            // push %edi
+    p = host_32_to_lp(0x1424548b, p);       // mov 0x14(%esp),%edx [8b 54 24 14] 协程栈
+    p = host_32_to_lp(0x1824448b, p);       // mov 0x18(%esp),%eax [8b 44 24 18] 入口函数
+    *p++ = 0xc7; *p++ = 0x02;               // movl $imm32,(%edx) [c7 02 imm32] 入口函数返回地址
+    p = host_32_to_lp((u32)(uintd_t)ret, p);
+    *p++ = 0xff; *p++ = 0xe0;               // jmp *%eax [ff e0]
+    *p++ = 0x5f;                            // pop %edi
+    *p++ = 0x5e;                            // pop %esi
+    *p++ = 0x5b;                            // pop %ebx
+    *p++ = 0x5d;                            // pop %ebp
+    *p = 0xc3;                              // ret，返回值在%eax
+}
+
+bool jit_init(jit_t *j, chcc_t *cc, string_t entry, uintd_t text_size, uintd_t rodata_size, uintd_t data_size, uintd_t stack_size)
+{
+    memset(j, 0, sizeof(jit_t));
+    if (!(j->entry = pushhashident(&cc->ident, entry, 0, true))) {
+        return false;
+    }
+    j->text_size = upr_times_of_N(JIT_TRAMP_SIZE + text_size, JIT_PAGE_SIZE);
+    j->rodata_size = upr_times_of_N(rodata_size, JIT_PAGE_SIZE);
+    j->data_size = upr_times_of_N(data_size, JIT_PAGE_SIZE);
+    j->size = j->text_size + j->rodata_size + j->data_size;
+    if (!(j->mem = jitmap_(j->size))) {
+        log_error(ERROR_JIT_MAP_FAILED);
+        return false;
+    }
+    j->stack_size = stack_size;
+    if (!(j->stack = (byte *)malloc(stack_size))) {
+        jit_free(j);
+        return false;
+    }
+    jittramp_(j->mem);
+    cc->text_section = cc->text = j->mem + JIT_TRAMP_SIZE;
+    cc->text_end = j->mem + j->text_size;
+    cc->text_full = false;
+    cc->rodata_section = cc->rodata = j->mem + j->text_size;
+    cc->rodstr_section = cc->rodstr = cc->rodata + rodata_size / 2; // 只读数据和只读字符串各占一半
+    cc->rodata_end = cc->rodstr_section;
+    cc->data_section = cc->data = j->mem + j->text_size + j->rodata_size;
+    cc->data_end = j->mem + j->size;
+    cc->bss = 0;
+    return true;
+}
+
+bool jit_link(jit_t *j, chcc_t *cc) // 填写外部函数的导入地址槽，并修改内存页属性
+{
+    fsym_t **imps = (fsym_t **)cc->imps.a;
+    vsym_t **vars = (vsym_t **)cc->vars.a;
+    uintd_t i, n = cc->imps.len / sizeof(fsym_t *);
+    byte *bss = round_up_addr(cc->data, sizeof(uint96)-1); // 未初始化数据在数据之后
+    char name[JIT_NAME_MAX];
+    string_t *s;
+    void *addr;
+    bool succ = true;
+    for (i = 0; i < n; i += 1) {
+        s = &imps[i]->v.symb.name->s;
+        if (s->len >= JIT_NAME_MAX) {
+            log_error_s(ERROR_JIT_SYMB_NOT_FOUND, *s);
+            succ = false;
+            continue;
+        }
+        memcpy(name, s->a, s->len);
+        name[s->len] = 0;
+        if (!(addr = jitsym_(name))) {
+            log_error_s(ERROR_JIT_SYMB_NOT_FOUND, *s);
+            succ = false;
+            continue;
+        }
+        host_pr_to_lp((upr)addr, imps[i]->slot);
+    }
+    if (bss + cc->bss > j->mem + j->size) {
+        log_error(ERROR_JIT_DATA_TOO_LARGE);
+        return false;
+    }
+    for (i = 0; i < cc->vars.len / sizeof(vsym_t *); i += 1) { // 全局变量的地址写入所有使用位置
+        gvaraddr(vars[i], bss + vars[i]->addr);
+    }
+    if (!succ) {
+        return false;
+    }
+    return jitprotect_(j->mem, j->text_size, true) && jitprotect_(j->mem + j->text_size, j->rodata_size, false);
+}
+
+bool jit_run(jit_t *j, int32 *ret) // 调用入口函数，入口函数不能有参数
+{
+    fsym_t *f = (fsym_t *)getscopesym(j->entry);
+    if (!f || !f->v.symb.isfvar || !f->v.symb.body || !f->v.addr) {
+        log_error_s(ERROR_JIT_ENTRY_NOT_FOUND, j->entry->s);
+        return false;
+    }
+#if defined(__ARCH_X86__)
+    *ret = ((jit_tramp_t)j->mem)(j->stack, (byte *)f->v.addr);
+    return true;
+#else
+    log_error(ERROR_JIT_ARCH_NOT_SUPPORT);
+    return false;
+#endif
+}
+
+void jit_free(jit_t *j)
+{
+    if (j->mem) {
+#if defined(__MSC__)
+        VirtualFree(j->mem, 0, MEM_RELEASE);
+#else
+        munmap(j->mem, j->size);
+#endif
+    }
+    free(j->stack);
+    memset(j, 0, sizeof(jit_t));
+}
@@ -0,0 +1,31 @@
+#ifndef CHAPL_CHCC_JIT_H
+#define CHAPL_CHCC_JIT_H
+#include "chcc/chcc.h"
+
+// 进程内运行模式：代码和数据直接生成到映射的内存中，函数之间的调用和对数据的引用在生成
+// 时已经是进程内的实际地址，外部函数通过 dlsym 查找地址写入导入地址槽，然后将代码页改为
+// 可执行，通过入口跳板直接调用入口函数。生成的是32位x86代码，只能在32位x86进程中运行。
+// 代码、只读数据和数据的生成都不会超过各自区域的大小，空间不足时生成失败并报错。
+//
+// 内存布局（每个区域按内存分页对齐）：
+//      [ 入口跳板 | 代码 ]     生成时可读写，链接后只读可执行
+//      [ 只读数据 | 只读字符串 ] 生成时可读写，链接后只读
+//      [ 数据 | 未初始化数据 ]   可读写
+
+typedef struct {
+    byte *mem;
+    uintd_t size;
+    uintd_t text_size;      // 包含入口跳板
+    uintd_t rodata_size;    // 包含只读字符串
+    uintd_t data_size;      // 包含未初始化数据
+    byte *stack;            // 入口函数使用的协程栈，栈地址从低到高
+    uintd_t stack_size;
+    ident_t *entry;         // 入口函数名称，在生成代码之前加入标识符表
+} jit_t;
+
+bool jit_init(jit_t *j, chcc_t *cc, string_t entry, uintd_t text_size, uintd_t rodata_size, uintd_t data_size, uintd_t stack_size);
+bool jit_link(jit_t *j, chcc_t *cc);
+bool jit_run(jit_t *j, int32 *ret);
+void jit_free(jit_t *j);
+
+#endif /* CHAPL_CHCC_JIT_H */
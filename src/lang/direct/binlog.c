@@ -0,0 +1,215 @@
+#include "direct/binlog.h"
+
+#define BINLOG_MASK (BINLOG_RING_WORDS - 1)
+
+static const char *binlog_files_g[] = {
+#define FILE_MAPPING(ID, STR) STR,
+#include "internal/init.h"
+};
+
+static const char *binlog_errors_g[] = {
+    "SUCCESS",
+    "ERROR",
+#define ERROR_MAPPING(ID, STR) STR,
+#include "builtin/error.h"
+};
+
+static uintd_t binlog_rings_g; // binlog_ring_t 链表
+static uintd_t binlog_tid_g;
+static uintd_t binlog_stop_g;
+static FILE *binlog_file_g;
+static bool binlog_error_g; // 写入失败之后不再刷新，只由刷新线程修改
+static thread_t binlog_thread_g;
+static THREAD_LOCAL binlog_ring_t *binlog_ring_g;
+
+static binlog_ring_t *binlogring_(void)
+{
+    binlog_ring_t *r = (binlog_ring_t *)calloc(1, sizeof(binlog_ring_t));
+    uintd_t old;
+    if (!r) {
+        return null;
+    }
+    r->tid = (uint32)atom_add(&binlog_tid_g, 1);
+    do {
+        old = atom_load_acq(&binlog_rings_g);
+        r->next = (binlog_ring_t *)old;
+    } while (!atom_cas(&binlog_rings_g, old, (uintd_t)r));
+    binlog_ring_g = r;
+    return r;
+}
+
+void binlog_record(errot err, uint32 file_err, uint32 argn_line, const uint32 *args)
+{
+    binlog_ring_t *r = binlog_ring_g;
+    uint64 ts = thread_clock_ns();
+    uint32 argn = LOG_ARGN(argn_line), i;
+    uintd_t head;
+    if (!r && !(r = binlogring_())) {
+        return;
+    }
+    head = r->head;
+    if (head + BINLOG_HEAD_WORDS + argn - atom_load_acq(&r->tail) > BINLOG_RING_WORDS) {
+        atom_add(&r->dropped, 1); // 缓存满，丢弃
+        return;
+    }
+    r->word[head & BINLOG_MASK] = (uint32)ts;
+    r->word[(head + 1) & BINLOG_MASK] = (uint32)(ts >> 32);
+    r->word[(head + 2) & BINLOG_MASK] = (uint32)err;
+    r->word[(head + 3) & BINLOG_MASK] = file_err;
+    r->word[(head + 4) & BINLOG_MASK] = argn_line;
+    for (i = 0; i < argn; i += 1) {
+        r->word[(head + BINLOG_HEAD_WORDS + i) & BINLOG_MASK] = args[i];
+    }
+    atom_store_rel(&r->head, head + BINLOG_HEAD_WORDS + argn); // 发布整条日志
+}
+
+static bool binlogwrite_(const uint32 *w, uintd_t n)
+{
+    if (fwrite(w, sizeof(uint32), n, binlog_file_g) != n) {
+        binlog_error_g = true;
+        return false;
+    }
+    return true;
+}
+
+static uintd_t binlogflush_(void) // 把所有线程的缓存写入文件，返回写入的字数
+{
+    binlog_ring_t *r = (binlog_ring_t *)atom_load_acq(&binlog_rings_g);
+    uintd_t head, tail, dropped, i, n, total = 0;
+    uint32 hdr[3];
+    for (; r && !binlog_error_g; r = r->next) { // 写入失败之后缓存不再清空，之后的日志都被丢弃
+        tail = r->tail;
+        head = atom_load_acq(&r->head);
+        dropped = atom_load_acq(&r->dropped);
+        if (head == tail && dropped == r->reported) {
+            continue;
+        }
+        hdr[0] = r->tid;
+        hdr[1] = (uint32)(dropped - r->reported);
+        hdr[2] = (uint32)(head - tail);
+        if (!binlogwrite_(hdr, 3)) {
+            break;
+        }
+        i = tail & BINLOG_MASK;
+        n = head - tail;
+        if (i + n > BINLOG_RING_WORDS) { // 回绕
+            if (!binlogwrite_(r->word + i, BINLOG_RING_WORDS - i)) {
+                break;
+            }
+            n -= BINLOG_RING_WORDS - i;
+            i = 0;
+        }
+        if (!binlogwrite_(r->word + i, n)) {
+            break;
+        }
+        r->reported = dropped;
+        atom_store_rel(&r->tail, head);
+        total += head - tail + 3;
+    }
+    return total;
+}
+
+static void binlogflusher_(void *para)
+{
+    (void)para;
+    for (; ;) {
+        if (binlogflush_()) {
+            continue;
+        }
+        if (atom_load_acq(&binlog_stop_g)) {
+            binlogflush_(); // 停止之前发布的日志
+            break;
+        }
+        thread_sleep(1);
+    }
+    if (fflush(binlog_file_g)) {
+        binlog_error_g = true;
+    }
+}
+
+bool binlog_start(const char *filename)
+{
+    uint32 hdr[2] = {BINLOG_MAGIC, BINLOG_VERSION};
+    if (binlog_file_g || !(binlog_file_g = fopen(filename, "wb"))) {
+        return false;
+    }
+    binlog_error_g = false;
+    atom_store_rel(&binlog_stop_g, 0);
+    if (!binlogwrite_(hdr, 2) || !thread_create(&binlog_thread_g, binlogflusher_, null)) {
+        fclose(binlog_file_g);
+        binlog_file_g = null;
+        return false;
+    }
+    logsink_g = binlog_record;
+    return true;
+}
+
+bool binlog_stop(void)
+{
+    bool succ;
+    if (!binlog_file_g) {
+        return true;
+    }
+    logsink_g = null;
+    atom_store_rel(&binlog_stop_g, 1);
+    thread_join(&binlog_thread_g);
+    succ = !binlog_error_g;
+    succ = (fclose(binlog_file_g) == 0) && succ;
+    binlog_file_g = null;
+    return succ;
+}
+
+static void binlogerror_(FILE *out, uint32 err) // builtin_error(id) 的逆映射
+{
+    uint32 id = err >> 1;
+    if (err <= ERROR) {
+        fputs(binlog_errors_g[err], out);
+    } else if ((err & 1) && id > ERROR && id < BUILTIN_NUM_ERRORS) {
+        fputs(binlog_errors_g[id], out);
+    } else {
+        fprintf(out, "%02X", err);
+    }
+}
+
+bool binlog_decode(FILE *in, FILE *out)
+{
+    uint32 hdr[3], w[BINLOG_HEAD_WORDS + 32], n, argn, i;
+    uint64 ts, base = 0;
+    bool first = true;
+    strid_t file;
+    if (fread(hdr, sizeof(uint32), 2, in) != 2 || hdr[0] != BINLOG_MAGIC || hdr[1] != BINLOG_VERSION) {
+        return false;
+    }
+    while (fread(hdr, sizeof(uint32), 3, in) == 3) {
+        if (hdr[1]) {
+            fprintf(out, "T%u dropped %u\n", hdr[0], hdr[1]);
+        }
+        for (n = hdr[2]; n; n -= BINLOG_HEAD_WORDS + argn) {
+            if (n < BINLOG_HEAD_WORDS || fread(w, sizeof(uint32), BINLOG_HEAD_WORDS, in) != BINLOG_HEAD_WORDS) {
+                return false;
+            }
+            argn = LOG_ARGN(w[4]);
+            if (n < BINLOG_HEAD_WORDS + argn || fread(w + BINLOG_HEAD_WORDS, sizeof(uint32), argn, in) != argn) {
+                return false;
+            }
+            ts = (uint64)w[0] | ((uint64)w[1] << 32);
+            if (first) { // 时间相对于文件中的第一条日志，其他线程的日志可能更早
+                base = ts;
+                first = false;
+            }
+            file = LOG_FILE(w[3]);
+            fprintf(out, "%12.3f T%u [%c] ", (double)(int64)(ts - base) / 1000, hdr[0], LOG_CHAR(w[4]));
+            if (file < sizeof(binlog_files_g) / sizeof(binlog_files_g[0])) {
+                fprintf(out, "%s#%04d ", binlog_files_g[file], LOG_LINE(w[4]));
+            } else {
+                fprintf(out, "%02x#%04d ", file, LOG_LINE(w[4]));
+            }
+            binlogerror_(out, w[2]);
+            for (i = 0; i < argn; i += 1) {
+                fprintf(out, (i == 0) ? ": %02x" : " %02x", w[BINLOG_HEAD_WORDS + i]);
+            }
+            fputc('\n', out);
+        }
+    }
+    return true;
+}
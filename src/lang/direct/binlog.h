@@ -0,0 +1,48 @@
+#ifndef CHAPL_DIRECT_BINLOG_H
+#define CHAPL_DIRECT_BINLOG_H
+#include "direct/thread.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 二进制延迟日志：binlog_start 之后 logtrace_/logtracex_ 不再格式化输出，只把时间戳、
+// 错误码、文件和行号（file_err、argn_line 两个字原样保存）以及 u32 参数写入当前线程的环
+// 形缓存，由后台的刷新线程成块写入文件，格式化推迟到离线的 binlog_decode。
+//
+// 每个线程在第一次记录时分配自己的环形缓存，并用 CAS 加入全局链表。记录日志的线程只写
+// head，刷新线程只写 tail，二者之间不需要锁；缓存满时丢弃这条日志并计数，不阻塞记录日
+// 志的线程。环形缓存在 binlog_stop 之后仍然保留，线程可以在下一次 binlog_start 之后继续
+// 使用。binlog_start/binlog_stop 应在其他线程开始或停止记录日志时调用。logtraces_ 带有
+// 字符串参数，仍然立即格式化输出。写入文件失败之后刷新线程不再写入，缓存满之后的日志都
+// 被丢弃，binlog_stop 返回 false。
+//
+// 文件格式（主机字节序）：文件头是 BINLOG_MAGIC、BINLOG_VERSION 两个字，之后是若干块，
+// 每块开头三个字是线程序号、上一块之后丢弃的日志个数、块中的字数，之后是若干条日志，
+// 每条日志是时间戳（两个字，先低后高）、err、file_err、argn_line，以及 argn 个参数。
+
+#define BINLOG_MAGIC 0x474C4843 // "CHLG"
+#define BINLOG_VERSION 1
+#define BINLOG_RING_WORDS (1 << 14) // 每个线程 64KB
+#define BINLOG_HEAD_WORDS 5
+
+typedef struct binlog_ring {
+    uintd_t head;                   // 只由记录日志的线程修改
+    byte pad1[CACHE_LINE_SIZE - sizeof(uintd_t)];
+    uintd_t tail;                   // 只由刷新线程修改
+    byte pad2[CACHE_LINE_SIZE - sizeof(uintd_t)];
+    uintd_t dropped;
+    uintd_t reported;               // 已经写入文件的丢弃个数，只由刷新线程访问
+    struct binlog_ring *next;
+    uint32 tid;
+    uint32 word[BINLOG_RING_WORDS];
+} binlog_ring_t;
+
+bool binlog_start(const char *filename); // 已经启动或文件打不开时返回 false
+bool binlog_stop(void); // 写完所有缓存中的日志之后返回，写入文件失败时返回 false
+void binlog_record(errot err, uint32 file_err, uint32 argn_line, const uint32 *args);
+bool binlog_decode(FILE *in, FILE *out); // 格式错误返回 false
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_DIRECT_BINLOG_H */
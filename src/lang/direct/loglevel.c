@@ -0,0 +1,70 @@
+#include "direct/loglevel.h"
+
+typedef struct {
+    char *filename;
+    uint32 msec;
+    uintd_t stop;
+    thread_t thread;
+    char last[LOG_LEVEL_FILE_MAX + 1];
+} loglevel_watch_t;
+
+static loglevel_watch_t *loglevel_watch_g;
+
+static void loglevelpoll_(loglevel_watch_t *w)
+{
+    char spec[LOG_LEVEL_FILE_MAX + 1];
+    FILE *f = fopen(w->filename, "rb");
+    uintd_t n = 0;
+    if (f) {
+        n = fread(spec, 1, LOG_LEVEL_FILE_MAX, f);
+        fclose(f);
+    }
+    spec[n] = 0;
+    if (strcmp(spec, w->last)) { // 只在内容改变时重新设置
+        memcpy(w->last, spec, n + 1);
+        log_level_set(spec);
+    }
+}
+
+static void loglevelwatcher_(void *para)
+{
+    loglevel_watch_t *w = (loglevel_watch_t *)para;
+    uint32 t;
+    while (!atom_load_acq(&w->stop)) {
+        loglevelpoll_(w);
+        for (t = 0; t < w->msec && !atom_load_acq(&w->stop); t += 10) { // 停止时最多等待10毫秒
+            thread_sleep((w->msec - t < 10) ? (w->msec - t) : 10);
+        }
+    }
+}
+
+bool log_level_watch(const char *filename, uint32 msec)
+{
+    loglevel_watch_t *w;
+    uintd_t n = strlen(filename);
+    if (loglevel_watch_g || !(w = (loglevel_watch_t *)calloc(1, sizeof(loglevel_watch_t) + n + 1))) {
+        return false;
+    }
+    w->filename = (char *)(w + 1);
+    memcpy(w->filename, filename, n + 1);
+    w->msec = msec ? msec : 1;
+    loglevelpoll_(w); // 返回之前先应用一次
+    if (!thread_create(&w->thread, loglevelwatcher_, w)) {
+        free(w);
+        return false;
+    }
+    loglevel_watch_g = w;
+    return true;
+}
+
+void log_level_unwatch(void)
+{
+    loglevel_watch_t *w = loglevel_watch_g;
+    if (!w) {
+        return;
+    }
+    atom_store_rel(&w->stop, 1);
+    thread_join(&w->thread);
+    loglevel_watch_g = null;
+    free(w);
+}
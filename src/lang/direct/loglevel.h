@@ -0,0 +1,21 @@
+#ifndef CHAPL_DIRECT_LOGLEVEL_H
+#define CHAPL_DIRECT_LOGLEVEL_H
+#include "direct/thread.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 运行时调整日志级别的控制文件：后台线程每隔 msec 毫秒读取一次文件，内容改变时交给
+// log_level_set（格式见 builtin/decl.c），文件被删除或清空时恢复编译时的级别；开始监视时
+// 文件不存在则保留当前的级别，例如环境变量设置的级别。这样可以在不重启、不重新编译的情况
+// 下只为一个模块打开诊断日志。
+
+#define LOG_LEVEL_FILE_MAX 4096
+
+bool log_level_watch(const char *filename, uint32 msec); // 已经在监视时返回 false
+void log_level_unwatch(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_DIRECT_LOGLEVEL_H */
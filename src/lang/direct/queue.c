@@ -0,0 +1,155 @@
+#include "direct/queue.h"
+
+#define MPMC_SEQ(q, pos) ((uintd_t *)((q)->cell + ((pos) & (q)->mask) * (q)->cell_bytes))
+
+bool mpmc_init(mpmc_t *q, uint32 cap, uint32 elt_bytes)
+{
+    uintd_t n = 2, i;
+    memset(q, 0, sizeof(mpmc_t));
+    while (n < cap) {
+        n *= 2;
+    }
+    q->elt_bytes = elt_bytes;
+    q->cell_bytes = (uint32)upr_times_of_N(sizeof(uintd_t) + elt_bytes, sizeof(uintd_t));
+    if (!(q->cell = (byte *)malloc(n * q->cell_bytes))) {
+        return false;
+    }
+    q->mask = n - 1;
+    for (i = 0; i < n; i += 1) {
+        *MPMC_SEQ(q, i) = i;
+    }
+    return true;
+}
+
+bool mpmc_push(mpmc_t *q, const void *elt)
+{
+    uintd_t pos = atom_load(&q->tail), *seq;
+    intd_t dif;
+    for (; ;) {
+        seq = MPMC_SEQ(q, pos);
+        dif = (intd_t)(atom_load_acq(seq) - pos);
+        if (dif == 0) {
+            if (atom_cas(&q->tail, pos, pos + 1)) {
+                break;
+            }
+            pos = atom_load(&q->tail);
+        } else if (dif < 0) { // 单元还没有被上一圈的消费者取走
+            return false;
+        } else {
+            pos = atom_load(&q->tail); // 其他生产者已经占有这个单元
+        }
+    }
+    memcpy(seq + 1, elt, q->elt_bytes);
+    atom_store_rel(seq, pos + 1);
+    return true;
+}
+
+bool mpmc_pop(mpmc_t *q, void *elt)
+{
+    uintd_t pos = atom_load(&q->head), *seq;
+    intd_t dif;
+    for (; ;) {
+        seq = MPMC_SEQ(q, pos);
+        dif = (intd_t)(atom_load_acq(seq) - (pos + 1));
+        if (dif == 0) {
+            if (atom_cas(&q->head, pos, pos + 1)) {
+                break;
+            }
+            pos = atom_load(&q->head);
+        } else if (dif < 0) { // 生产者还没有发布这个单元
+            return false;
+        } else {
+            pos = atom_load(&q->head);
+        }
+    }
+    memcpy(elt, seq + 1, q->elt_bytes);
+    atom_store_rel(seq, pos + q->mask + 1);
+    return true;
+}
+
+void mpmc_free(mpmc_t *q)
+{
+    free(q->cell);
+    q->cell = null;
+}
+
+static lqnode_t *lqnew_(lqueue_t *q) // 持有尾部锁时调用
+{
+    lqnode_t *n = q->spare;
+    if (!n) {
+        n = q->spare = (lqnode_t *)atom_swap(&q->recycle, null); // 一次取走整个回收链表，没有 ABA 问题
+    }
+    if (n) {
+        q->spare = n->next;
+        return n;
+    }
+    return (lqnode_t *)pool_alloc(&q->pool, sizeof(lqnode_t) + q->elt_bytes);
+}
+
+static void lqrecycle_(lqueue_t *q, lqnode_t *n)
+{
+    lqnode_t *top;
+    do {
+        top = (lqnode_t *)atom_load(&q->recycle);
+        n->next = top;
+    } while (!atom_cas(&q->recycle, top, n));
+}
+
+bool lqueue_init(lqueue_t *q, uint32 elt_bytes)
+{
+    memset(q, 0, sizeof(lqueue_t));
+    q->elt_bytes = elt_bytes;
+    pool_init(&q->pool, 0);
+    if (!mutex_init(&q->hlock)) {
+        return false;
+    }
+    if (!mutex_init(&q->tlock) || !(q->head = (lqnode_t *)pool_alloc(&q->pool, sizeof(lqnode_t) + elt_bytes))) {
+        mutex_free(&q->hlock);
+        mutex_free(&q->tlock);
+        pool_free(&q->pool);
+        return false;
+    }
+    q->head->next = null;
+    q->tail = q->head;
+    return true;
+}
+
+bool lqueue_push(lqueue_t *q, const void *elt)
+{
+    lqnode_t *n;
+    mutex_lock(&q->tlock);
+    if (!(n = lqnew_(q))) {
+        mutex_unlock(&q->tlock);
+        return false;
+    }
+    n->next = null;
+    memcpy(n + 1, elt, q->elt_bytes);
+    atom_store_rel(&q->tail->next, n); // 消费者在头部锁下读取 next
+    q->tail = n;
+    mutex_unlock(&q->tlock);
+    return true;
+}
+
+bool lqueue_pop(lqueue_t *q, void *elt)
+{
+    lqnode_t *h, *n;
+    mutex_lock(&q->hlock);
+    h = q->head;
+    if (!(n = (lqnode_t *)atom_load_acq(&h->next))) {
+        mutex_unlock(&q->hlock);
+        return false;
+    }
+    memcpy(elt, n + 1, q->elt_bytes);
+    q->head = n; // n 成为新的哑节点
+    mutex_unlock(&q->hlock);
+    lqrecycle_(q, h);
+    return true;
+}
+
+void lqueue_free(lqueue_t *q)
+{
+    mutex_free(&q->hlock);
+    mutex_free(&q->tlock);
+    pool_free(&q->pool); // 所有节点都来自节点池
+    q->head = q->tail = q->spare = q->recycle = null;
+}
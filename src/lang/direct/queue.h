@@ -0,0 +1,60 @@
+#ifndef CHAPL_DIRECT_QUEUE_H
+#define CHAPL_DIRECT_QUEUE_H
+#include "direct/thread.h"
+#include "builtin/pool.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 多生产者多消费者队列，用于线程之间传递固定大小的元素。
+//
+// mpmc_t 是有界的无锁环形队列：每个单元有一个序号，入队位置 tail 上的单元序号等于 tail 时
+// 单元为空，生产者用 CAS 占有 tail 之后写入元素，再把序号改为 tail+1 发布给消费者；出队位
+// 置 head 上的单元序号等于 head+1 时有数据，消费者用 CAS 占有 head 之后取出元素，再把序号改
+// 为 head+cap 留给下一圈的生产者。生产者之间只竞争 tail，消费者之间只竞争 head，二者不共
+// 享写入的缓存行，head 和 tail 分别按缓存行对齐。队列满时入队失败，队列空时出队失败，调
+// 用者决定重试、让出还是转去做其他工作。
+//
+// lqueue_t 是无界的链式队列（两把锁的 Michael-Scott 队列）：生产者持有尾部锁追加节点，消
+// 费者持有头部锁取走节点，头尾之间始终隔着一个哑节点，生产者和消费者互不阻塞。消费者释放
+// 的节点用原子操作压入回收链表，生产者一次取走整个回收链表复用，回收链表为空时从节点池
+// 中分配，入队和出队都不调用 malloc/free。
+
+typedef struct {
+    CACHE_LINE_ALIGN uintd_t head;  // 下一个出队位置，只由消费者修改
+    CACHE_LINE_ALIGN uintd_t tail;  // 下一个入队位置，只由生产者修改
+    CACHE_LINE_ALIGN byte *cell;    // 以下字段初始化之后只读
+    uintd_t mask;
+    uint32 elt_bytes;
+    uint32 cell_bytes;              // 单元开头是 uintd_t 序号，之后是元素
+} mpmc_t;
+
+bool mpmc_init(mpmc_t *q, uint32 cap, uint32 elt_bytes); // cap 向上取2的幂
+bool mpmc_push(mpmc_t *q, const void *elt); // 队列满返回 false
+bool mpmc_pop(mpmc_t *q, void *elt); // 队列空返回 false
+void mpmc_free(mpmc_t *q);
+
+typedef struct lqnode {
+    struct lqnode *next;
+} lqnode_t; // 之后是元素
+
+typedef struct {
+    CACHE_LINE_ALIGN mutex_t hlock;
+    lqnode_t *head;                 // 哑节点，它的下一个节点是队首
+    CACHE_LINE_ALIGN mutex_t tlock;
+    lqnode_t *tail;
+    lqnode_t *spare;                // 生产者复用的节点，受尾部锁保护
+    pool_t pool;                    // 受尾部锁保护
+    CACHE_LINE_ALIGN lqnode_t *recycle; // 消费者释放的节点
+    uint32 elt_bytes;
+} lqueue_t;
+
+bool lqueue_init(lqueue_t *q, uint32 elt_bytes);
+bool lqueue_push(lqueue_t *q, const void *elt); // 只在内存分配失败时返回 false
+bool lqueue_pop(lqueue_t *q, void *elt); // 队列空返回 false
+void lqueue_free(lqueue_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_DIRECT_QUEUE_H */
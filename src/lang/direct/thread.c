@@ -0,0 +1,238 @@
+#include "direct/thread.h"
+#if defined(__MSC__)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+    thread_proc_t proc;
+    void *para;
+} thread_start_t;
+
+#if defined(__MSC__)
+static DWORD WINAPI threadstart_(LPVOID p)
+{
+    thread_start_t s = *(thread_start_t *)p;
+    free(p);
+    s.proc(s.para);
+    return 0;
+}
+
+bool thread_create(thread_t *t, thread_proc_t proc, void *para)
+{
+    thread_start_t *s = (thread_start_t *)malloc(sizeof(thread_start_t));
+    HANDLE h;
+    if (!s) {
+        return false;
+    }
+    s->proc = proc;
+    s->para = para;
+    h = CreateThread(null, 0, threadstart_, s, 0, null);
+    if (!h) {
+        free(s);
+        return false;
+    }
+    t->handle = (uintd_t)h;
+    return true;
+}
+
+void thread_join(thread_t *t)
+{
+    WaitForSingleObject((HANDLE)t->handle, INFINITE);
+    CloseHandle((HANDLE)t->handle);
+    t->handle = 0;
+}
+
+void thread_sleep(uint32 msec)
+{
+    Sleep(msec);
+}
+
+uint32 thread_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+uint64 thread_clock_ns(void)
+{
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64)((double)t.QuadPart * 1000000000.0 / (double)freq.QuadPart);
+}
+
+bool mutex_init(mutex_t *m)
+{
+    SRWLOCK *p = (SRWLOCK *)malloc(sizeof(SRWLOCK));
+    if (p) {
+        InitializeSRWLock(p);
+    }
+    m->impl = p;
+    return (p != null);
+}
+
+void mutex_lock(mutex_t *m)
+{
+    AcquireSRWLockExclusive((SRWLOCK *)m->impl);
+}
+
+void mutex_unlock(mutex_t *m)
+{
+    ReleaseSRWLockExclusive((SRWLOCK *)m->impl);
+}
+
+void mutex_free(mutex_t *m)
+{
+    free(m->impl);
+    m->impl = null;
+}
+#else
+static void *threadstart_(void *p)
+{
+    thread_start_t s = *(thread_start_t *)p;
+    free(p);
+    s.proc(s.para);
+    return null;
+}
+
+bool thread_create(thread_t *t, thread_proc_t proc, void *para)
+{
+    thread_start_t *s = (thread_start_t *)malloc(sizeof(thread_start_t));
+    pthread_t h;
+    if (!s) {
+        return false;
+    }
+    s->proc = proc;
+    s->para = para;
+    if (pthread_create(&h, null, threadstart_, s) != 0) {
+        free(s);
+        return false;
+    }
+    t->handle = (uintd_t)h;
+    return true;
+}
+
+void thread_join(thread_t *t)
+{
+    pthread_join((pthread_t)t->handle, null);
+    t->handle = 0;
+}
+
+void thread_sleep(uint32 msec)
+{
+    struct timespec ts;
+    ts.tv_sec = msec / 1000;
+    ts.tv_nsec = (long)(msec % 1000) * 1000000;
+    nanosleep(&ts, null);
+}
+
+uint32 thread_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (uint32)n : 1;
+}
+
+uint64 thread_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+}
+
+bool mutex_init(mutex_t *m)
+{
+    pthread_mutex_t *p = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+    if (p && pthread_mutex_init(p, null) != 0) {
+        free(p);
+        p = null;
+    }
+    m->impl = p;
+    return (p != null);
+}
+
+void mutex_lock(mutex_t *m)
+{
+    pthread_mutex_lock((pthread_mutex_t *)m->impl);
+}
+
+void mutex_unlock(mutex_t *m)
+{
+    pthread_mutex_unlock((pthread_mutex_t *)m->impl);
+}
+
+void mutex_free(mutex_t *m)
+{
+    if (m->impl) {
+        pthread_mutex_destroy((pthread_mutex_t *)m->impl);
+        free(m->impl);
+        m->impl = null;
+    }
+}
+#endif
+
+typedef struct {
+    thread_task_t proc;
+    void *para;
+    uint32 ntask;
+    uint32 worker;
+    uintd_t *next;
+} thread_for_t;
+
+static void threadfor_(void *p)
+{
+    thread_for_t *w = (thread_for_t *)p;
+    uintd_t i;
+    for (; ;) {
+        i = atom_add(w->next, 1) - 1; // 原子领取下一个任务
+        if (i >= w->ntask) {
+            break;
+        }
+        w->proc(w->para, w->worker, (uint32)i);
+    }
+}
+
+bool thread_for(uint32 nthread, uint32 ntask, thread_task_t proc, void *para)
+{
+    thread_for_t *w;
+    thread_t *t;
+    uintd_t next = 0;
+    uint32 i, n = 0;
+    if (nthread > ntask) {
+        nthread = ntask;
+    }
+    if (nthread <= 1) {
+        for (i = 0; i < ntask; i += 1) {
+            proc(para, 0, i);
+        }
+        return true;
+    }
+    w = (thread_for_t *)malloc(nthread * (sizeof(thread_for_t) + sizeof(thread_t)));
+    if (!w) {
+        return false;
+    }
+    t = (thread_t *)(w + nthread);
+    for (i = 0; i < nthread; i += 1) {
+        w[i].proc = proc;
+        w[i].para = para;
+        w[i].ntask = ntask;
+        w[i].worker = i;
+        w[i].next = &next;
+    }
+    for (i = 1; i < nthread; i += 1) { // 当前线程作为第0个线程，创建线程失败时剩余任务由已有线程完成
+        if (!thread_create(t + i, threadfor_, w + i)) {
+            break;
+        }
+        n = i;
+    }
+    threadfor_(w);
+    for (i = 1; i <= n; i += 1) {
+        thread_join(t + i);
+    }
+    free(w);
+    return true;
+}
@@ -0,0 +1,80 @@
+#ifndef CHAPL_DIRECT_THREAD_H
+#define CHAPL_DIRECT_THREAD_H
+#include "builtin/decl.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 线程、互斥锁以及原子操作，posix 使用 pthread，windows 使用 wapi
+
+#if defined(__MSC__)
+#include <intrin.h>
+#define THREAD_LOCAL __declspec(thread)
+#define CACHE_LINE_ALIGN __declspec(align(64))
+#else
+#define THREAD_LOCAL __thread
+#define CACHE_LINE_ALIGN __attribute__((aligned(64)))
+#endif
+
+#define CACHE_LINE_SIZE 64
+
+// 原子操作只用于 uintd_t 大小的整数和指针
+#if defined(__MSC__)
+#if defined(__ARCH_64BIT__)
+#define atom_load_acq(p)        ((uintd_t)_InterlockedOr64((volatile __int64 *)(p), 0))
+#define atom_store_rel(p, v)    _InterlockedExchange64((volatile __int64 *)(p), (__int64)(v))
+#define atom_add(p, n)          ((uintd_t)_InterlockedExchangeAdd64((volatile __int64 *)(p), (__int64)(n)) + (n))
+#define atom_swap(p, v)         ((uintd_t)_InterlockedExchange64((volatile __int64 *)(p), (__int64)(v)))
+#define atom_cas(p, old, v)     (_InterlockedCompareExchange64((volatile __int64 *)(p), (__int64)(v), (__int64)(old)) == (__int64)(old))
+#else
+#define atom_load_acq(p)        ((uintd_t)_InterlockedOr((volatile long *)(p), 0))
+#define atom_store_rel(p, v)    _InterlockedExchange((volatile long *)(p), (long)(v))
+#define atom_add(p, n)          ((uintd_t)_InterlockedExchangeAdd((volatile long *)(p), (long)(n)) + (n))
+#define atom_swap(p, v)         ((uintd_t)_InterlockedExchange((volatile long *)(p), (long)(v)))
+#define atom_cas(p, old, v)     (_InterlockedCompareExchange((volatile long *)(p), (long)(v), (long)(old)) == (long)(old))
+#endif
+#define atom_load(p)            (*(volatile uintd_t *)(p))
+#define atom_pause()            _mm_pause()
+#else
+#define atom_load_acq(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atom_store_rel(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atom_add(p, n)          __atomic_add_fetch((p), (n), __ATOMIC_ACQ_REL)
+#define atom_swap(p, v)         __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#define atom_cas(p, old, v)     __sync_bool_compare_and_swap((p), (old), (v))
+#define atom_load(p)            __atomic_load_n((p), __ATOMIC_RELAXED)
+#if defined(__ARCH_X86__) || defined(__ARCH_X64__)
+#define atom_pause()            __builtin_ia32_pause()
+#else
+#define atom_pause()            ((void)0)
+#endif
+#endif
+
+typedef void (*thread_proc_t)(void *para);
+typedef void (*thread_task_t)(void *para, uint32 worker, uint32 task);
+
+typedef struct {
+    uintd_t handle;
+} thread_t;
+
+typedef struct {
+    void *impl;
+} mutex_t;
+
+bool thread_create(thread_t *t, thread_proc_t proc, void *para);
+void thread_join(thread_t *t);
+void thread_sleep(uint32 msec);
+uint32 thread_cpu_count(void);
+uint64 thread_clock_ns(void);
+bool mutex_init(mutex_t *m);
+void mutex_lock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+void mutex_free(mutex_t *m);
+
+// 启动 nthread 个线程执行 ntask 个任务，任务按序号原子领取，worker 是执行任务的线程
+// 序号，可以用于访问线程自己的数据。nthread 为 1 时直接在当前线程执行。
+bool thread_for(uint32 nthread, uint32 ntask, thread_task_t proc, void *para);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_DIRECT_THREAD_H */
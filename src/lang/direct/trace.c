@@ -0,0 +1,169 @@
+#include "direct/trace.h"
+
+static const char *trace_files_g[] = {
+#define FILE_MAPPING(ID, STR) STR,
+#include "internal/init.h"
+};
+
+byte trace_enabled_g;
+static uintd_t trace_threads_g; // trace_thread_t 链表
+static uintd_t trace_tid_g;
+static uintd_t trace_gen_g; // trace_free 之后线程重新分配自己的记录
+static uint64 trace_clock0_g, trace_clock1_g; // trace_start 和 trace_stop 时的时钟
+static uint64 trace_ns0_g, trace_ns1_g;
+static THREAD_LOCAL trace_thread_t *trace_thread_g;
+static THREAD_LOCAL uintd_t trace_thread_gen_g;
+
+uint64 trace_clock(void)
+{
+#if defined(__ARCH_X86__) || defined(__ARCH_X64__)
+#if defined(__MSC__)
+    return __rdtsc();
+#else
+    return __builtin_ia32_rdtsc();
+#endif
+#else
+    return thread_clock_ns();
+#endif
+}
+
+static trace_thread_t *tracethread_(void)
+{
+    trace_thread_t *t = (trace_thread_t *)calloc(1, sizeof(trace_thread_t));
+    uintd_t old;
+    if (!t) {
+        return null;
+    }
+    t->tid = (uint32)atom_add(&trace_tid_g, 1);
+    do {
+        old = atom_load_acq(&trace_threads_g);
+        t->next = (trace_thread_t *)old;
+    } while (!atom_cas(&trace_threads_g, old, (uintd_t)t));
+    trace_thread_g = t;
+    trace_thread_gen_g = trace_gen_g;
+    return t;
+}
+
+void trace_record_(uint32 site, const char *name, uint32 phase)
+{
+    trace_thread_t *t = trace_thread_g;
+    trace_chunk_t *c;
+    trace_event_t *e;
+    uint64 ts = trace_clock();
+    if ((!t || trace_thread_gen_g != trace_gen_g) && !(t = tracethread_())) {
+        return;
+    }
+    if (!(c = t->tail) || c->len == TRACE_CHUNK_EVENTS) {
+        if (!(c = (trace_chunk_t *)malloc(sizeof(trace_chunk_t)))) {
+            t->dropped += 1; // 丢弃之后区间可能不再配对，导出时会报告丢弃的个数
+            return;
+        }
+        c->next = null;
+        c->len = 0;
+        if (t->tail) {
+            t->tail->next = c;
+        } else {
+            t->head = c;
+        }
+        t->tail = c;
+    }
+    e = c->event + c->len;
+    e->ts = ts;
+    e->site = site;
+    e->phase = phase;
+    e->name = name;
+    c->len += 1;
+}
+
+void trace_start(void)
+{
+    trace_free();
+    trace_clock1_g = 0;
+    trace_ns0_g = thread_clock_ns();
+    trace_clock0_g = trace_clock();
+    TRACE_ENABLED_STORE(1);
+}
+
+void trace_stop(void)
+{
+    if (!TRACE_ENABLED_LOAD()) {
+        return;
+    }
+    TRACE_ENABLED_STORE(0);
+    trace_clock1_g = trace_clock();
+    trace_ns1_g = thread_clock_ns();
+}
+
+static void traceputs_(FILE *fp, const char *s) // JSON 字符串转义
+{
+    for (; *s; s += 1) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', fp);
+            fputc(*s, fp);
+        } else if ((byte)*s < 0x20) {
+            fprintf(fp, "\\u%04x", (byte)*s);
+        } else {
+            fputc(*s, fp);
+        }
+    }
+}
+
+bool trace_export(const char *filename)
+{
+    trace_thread_t *t = (trace_thread_t *)atom_load_acq(&trace_threads_g);
+    trace_chunk_t *c;
+    trace_event_t *e;
+    uint64 clock1 = trace_clock1_g, ns1 = trace_ns1_g;
+    double us_per_tick = 0.001;
+    const char *sep = "";
+    strid_t file;
+    uintd_t i;
+    FILE *fp;
+    bool succ;
+    if (!(fp = fopen(filename, "wb"))) {
+        return false;
+    }
+    if (!clock1) { // 还没有停止时按当前时钟换算
+        clock1 = trace_clock();
+        ns1 = thread_clock_ns();
+    }
+    if (clock1 > trace_clock0_g) {
+        us_per_tick = (double)(ns1 - trace_ns0_g) / (double)(clock1 - trace_clock0_g) / 1000;
+    }
+    fputs("{\"traceEvents\":[", fp);
+    for (; t; t = t->next) {
+        fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"T%u\",\"dropped\":%u}}",
+            sep, t->tid, t->tid, (uint32)t->dropped);
+        sep = ",";
+        for (c = t->head; c; c = c->next) {
+            for (i = 0; i < c->len; i += 1) {
+                e = c->event + i;
+                file = TRACE_FILE(e->site);
+                fputs(",\n{\"name\":\"", fp);
+                traceputs_(fp, e->name);
+                fprintf(fp, "\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"line\":%u}}",
+                    (file < sizeof(trace_files_g) / sizeof(trace_files_g[0])) ? trace_files_g[file] : "",
+                    (char)e->phase, (double)(int64)(e->ts - trace_clock0_g) * us_per_tick, t->tid, TRACE_LINE(e->site));
+            }
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", fp);
+    succ = !ferror(fp);
+    succ = (fclose(fp) == 0) && succ;
+    return succ;
+}
+
+void trace_free(void)
+{
+    trace_thread_t *t = (trace_thread_t *)atom_swap(&trace_threads_g, 0), *tnext;
+    trace_chunk_t *c, *cnext;
+    for (; t; t = tnext) {
+        tnext = t->next;
+        for (c = t->head; c; c = cnext) {
+            cnext = c->next;
+            free(c);
+        }
+        free(t);
+    }
+    trace_gen_g += 1;
+}
@@ -0,0 +1,71 @@
+#ifndef CHAPL_DIRECT_TRACE_H
+#define CHAPL_DIRECT_TRACE_H
+#include "direct/thread.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 时间区间跟踪：trace_begin/trace_end 成对包围一段代码，和 log_* 一样在编译时把文件编号
+// 和行号编码进一个字（TRACE_SITE），没有开启跟踪时只是一个不跳转的分支。开启之后事件写
+// 入当前线程自己的事件块，不需要锁，时间戳在 x86 上直接读取 rdtsc，其他平台使用
+// thread_clock_ns，导出时按 trace_start 和 trace_stop 之间的时钟换算成微秒。
+//
+// trace_export 输出 Chrome 跟踪事件格式的 JSON，可以直接用 chrome://tracing 或者
+// ui.perfetto.dev 打开，同一个线程的区间按嵌套关系显示，cat 是源文件名称。区间名称必须
+// 是字符串常量，事件只保存它的指针。trace_start/trace_stop/trace_export/trace_free 应在
+// 其他线程没有记录事件时调用，trace_start 会丢弃上一次记录的事件。测试程序在环境变量
+// CHAPL_TRACE 设置时把编译测试的跟踪事件导出到它指定的文件。
+
+#define TRACE_CHUNK_EVENTS 4096
+
+typedef struct {
+    uint64 ts;
+    uint32 site;        // 文件编号 << 16 | 行号
+    uint32 phase;       // 'B' 或 'E'
+    const char *name;
+} trace_event_t;
+
+typedef struct trace_chunk {
+    struct trace_chunk *next;
+    uintd_t len;        // 只由记录事件的线程修改
+    trace_event_t event[TRACE_CHUNK_EVENTS];
+} trace_chunk_t;
+
+typedef struct trace_thread {
+    struct trace_thread *next;
+    trace_chunk_t *head;
+    trace_chunk_t *tail;
+    uintd_t dropped;    // 分配事件块失败时丢弃的事件个数
+    uint32 tid;
+} trace_thread_t;
+
+extern byte trace_enabled_g;
+
+#define TRACE_SITE() ((__CURR_FILE__ << 16) | (__LINE__ & 0xFFFF))
+#define TRACE_FILE(site) ((strid_t)((site) >> 16))
+#define TRACE_LINE(site) ((site) & 0xFFFF)
+
+#if defined(__GNU__)
+#define TRACE_ENABLED_LOAD() __atomic_load_n(&trace_enabled_g, __ATOMIC_RELAXED)
+#define TRACE_ENABLED_STORE(v) __atomic_store_n(&trace_enabled_g, (v), __ATOMIC_RELAXED)
+#define TRACE_ENABLED() __builtin_expect(TRACE_ENABLED_LOAD(), 0)
+#else
+#define TRACE_ENABLED_LOAD() (*(volatile byte *)&trace_enabled_g)
+#define TRACE_ENABLED_STORE(v) (*(volatile byte *)&trace_enabled_g = (v))
+#define TRACE_ENABLED() TRACE_ENABLED_LOAD()
+#endif
+
+#define trace_begin(name) (TRACE_ENABLED() ? trace_record_(TRACE_SITE(), (name), 'B') : (void)0)
+#define trace_end(name) (TRACE_ENABLED() ? trace_record_(TRACE_SITE(), (name), 'E') : (void)0)
+
+void trace_record_(uint32 site, const char *name, uint32 phase);
+uint64 trace_clock(void);
+void trace_start(void);
+void trace_stop(void);
+bool trace_export(const char *filename); // 文件打不开或写入失败时返回 false
+void trace_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CHAPL_DIRECT_TRACE_H */
@@ -7,12 +7,18 @@
 #define STRID_CHCC_CIFA_LOG_LEVEL 'D'
 #define STRID_CHCC_YUFA_LOG_LEVEL 'D'
 #define STRID_CHCC_GELF_LOG_LEVEL 'D'
+#define STRID_CHCC_JIT_LOG_LEVEL 'D'
+#define STRID_CHCC_GLINK_LOG_LEVEL 'D'
+#define STRID_TEST_DECL_LOG_LEVEL 'F'
+#define STRID_TEST_CHCC_LOG_LEVEL 'F'
 
 FILE_MAPPING(STRID_LANG_DECL, "lang/decl")
 FILE_MAPPING(STRID_LANG_CORO, "lang/coro")
 FILE_MAPPING(STRID_CHCC_CIFA, "chcc/cifa")
 FILE_MAPPING(STRID_CHCC_YUFA, "chcc/yufa")
 FILE_MAPPING(STRID_CHCC_GELF, "chcc/gelf")
+FILE_MAPPING(STRID_CHCC_JIT, "chcc/jit")
+FILE_MAPPING(STRID_CHCC_GLINK, "chcc/glink")
 FILE_MAPPING(STRID_TEST_DECL, "test/decl")
 FILE_MAPPING(STRID_TEST_CHCC, "test/chcc")
 
@@ -1,6 +1,11 @@
 #define __CURR_FILE__ STRID_TEST_CHCC
 #include "internal/decl.h"
 #include "chcc/chcc.h"
+#include "chcc/gabi.h"
+#include "chcc/jit.h"
+#include "chcc/gread.h"
+#include "chcc/glink.h"
+#include "chcc/deflate.h"
 
 #define cifa_assert(ln, col, c) next(&cc); \
     lang_assert_2(cf->line == ln && cf->cols == col && cf->cfid == c, cf->cols, cf->cfid)
@@ -27,6 +32,915 @@
 #define cifa_is_basic_type(c) \
     lang_assert_3((c) >= CIFA_ID_INT && (c) <= CIFA_ID_STRING, CIFA_ID_INT, CIFA_ID_STRING, (c))
 
+static void test_chcc_jobs(void) // 并行生成的函数引用全局变量，拼接之后使用位置串连到变量的使用地址列表
+{
+    chcc_t cc;
+    jit_t j;
+    vsym_t *v;
+    byte *a;
+    chccinit(&cc);
+    cc.jobs = 2;
+    lang_assert(jit_init(&j, &cc, strfrom("main"), 4096, 4096, 4096, 4096));
+    pushstrtofile(&cc, strfrom(
+        "var g int\n"
+        "func f1() {\n"
+        "    g\n"
+        "}\n"
+        "func f2() {\n"
+        "    g\n"
+        "}\n"), false);
+    lang_assert(chccgen(&cc));
+    lang_assert(cc.funcs.len == 0 && cc.vars.len == sizeof(vsym_t *));
+    v = ((vsym_t **)cc.vars.a)[0];
+    a = (byte *)v->usel; // 最后拼接的使用位置，mov (disp32),%eax [8b 05 disp32]
+    lang_assert(a && a >= cc.text_section + 2 && a + 4 <= cc.text);
+    lang_assert(a[-2] == 0x8b && a[-1] == 0x05);
+    jit_free(&j);
+    chccfree(&cc);
+}
+
+#if defined(__ARCH_X86__)
+static int32 test_chcc_run(chcc_t *cc, const char *src) // 生成并运行入口函数 main，返回它的返回值
+{
+    jit_t j;
+    int32 ret = 0;
+    lang_assert(jit_init(&j, cc, strfrom("main"), 4096, 4096, 4096, 4096));
+    pushstrtofile(cc, strfrom(src), false);
+    lang_assert(chccgen(cc));
+    lang_assert(jit_link(&j, cc));
+    lang_assert(jit_run(&j, &ret));
+    jit_free(&j);
+    return ret;
+}
+
+static void test_chcc_jitrun(void) // 运行入口函数，返回值在%eax中
+{
+    chcc_t cc;
+    int32 ret;
+    chccinit(&cc);
+    cc.jobs = 1;
+    ret = test_chcc_run(&cc,
+        "func main(return int) {\n"
+        "    return 42\n"
+        "}\n");
+    lang_assert_1(ret == 42, ret);
+    chccfree(&cc);
+}
+
+static void test_chcc_inline(void) // 实参全部计算完成之后才绑定形参，函数体在被调函数的作用域中解析
+{
+    chcc_t cc;
+    int32 ret;
+    chccinit(&cc);
+    cc.jobs = 1;
+    ret = test_chcc_run(&cc,
+        "func sub(a int, b int return int) {\n"
+        "    return a - b\n"
+        "}\n"
+        "func main(return int) {\n"
+        "    a := 10\n"
+        "    b := 3\n"
+        "    return sub(b, a) + sub(a, b) * 2\n"
+        "}\n");
+    lang_assert_1(ret == 7, ret);
+    lang_assert(cc.ninline == 2 && cc.ncall == 0);
+    chccfree(&cc);
+}
+
+static void test_chcc_nestcall(void) // 实参中的函数调用不会覆盖已经计算的实参
+{
+    chcc_t cc;
+    int32 ret;
+    chccinit(&cc);
+    cc.jobs = 1;
+    ret = test_chcc_run(&cc, // 引用全局变量的函数不会内联
+        "var g int\n"
+        "func f(a int, b int return int) {\n"
+        "    g = a\n"
+        "    return a - b\n"
+        "}\n"
+        "func h(a int return int) {\n"
+        "    g = a\n"
+        "    return a + 1\n"
+        "}\n"
+        "func main(return int) {\n"
+        "    x := 10\n"
+        "    y := 2\n"
+        "    return f(x, h(y)) + f(h(x), y)\n"
+        "}\n");
+    lang_assert_1(ret == 16, ret);
+    lang_assert(cc.ninline == 0 && cc.ncall == 4);
+    chccfree(&cc);
+}
+#endif
+
+static void test_chcc_jitfull(void) // 串行生成的代码超过代码区域时生成失败，不会写到下一个区域
+{
+    buffer_t src = {0};
+    chcc_t cc;
+    jit_t j;
+    uint32 i;
+    chccinit(&cc);
+    cc.jobs = 1;
+    lang_assert(jit_init(&j, &cc, strfrom("main"), 4096, 4096, 4096, 4096));
+    lang_assert(cc.text_end == j.mem + j.text_size && cc.rodata_end == cc.rodstr_section);
+    lang_assert(cc.data_end == j.mem + j.size);
+    buffer_push(&src, (const byte *)"func main(return int) {\n    x := 1\n", 35, 0);
+    for (i = 0; i < 1000; i += 1) { // 每行生成十几个字节
+        buffer_push(&src, (const byte *)"    x = x + 1\n", 14, 0);
+    }
+    buffer_push(&src, (const byte *)"    return x\n}\n", 15, 0);
+    pushstrtofile(&cc, strflen(src.a, src.len), false);
+    lang_assert(!chccgen(&cc));
+    lang_assert(cc.text_full && cc.text <= cc.text_end);
+    jit_free(&j);
+    chccfree(&cc);
+    buffer_free(&src);
+}
+
+// 代码生成器生成的是32位代码，目标文件模式下定义函数是一个错误
+static void test_chcc_objrefuse(void)
+{
+    chcc_t cc;
+    chccinit(&cc);
+    cc.jobs = 1;
+    lang_assert(chccobjinit(&cc));
+    pushstrtofile(&cc, strfrom(
+        "func main(return int) {\n"
+        "    return 0\n"
+        "}\n"), false);
+    lang_assert(!chccgen(&cc) && cc.odefs.len == 0);
+    chccfree(&cc);
+}
+
+// 目标文件模式下手工写入一个 x86-64 函数，返回全局变量 v 的值加上 k
+static void test_chcc_objfunc(chcc_t *cc, fsym_t *f, const char *name, vsym_t *v, uint32 k)
+{
+    byte *a;
+    memset(f, 0, sizeof(fsym_t));
+    f->v.symb.name = pushhashident(&cc->ident, strfrom(name), 0, true);
+    f->v.addr = (int96)cc->text;
+    a = ga(cc, 0x058b, 0); // mov v(%rip),%eax [8b 05 disp32]
+    gorel(cc, a, ELF_R_X86_64_PC32, v, 0, -4);
+    ga(cc, 0x05, (byte *)(uintd_t)k); // add $imm32,%eax [05 imm32]
+    g(cc, 0xc3); // ret
+    f->clen = (uint32)(cc->text - (byte *)f->v.addr);
+    lang_assert(gobjdef(cc, f));
+}
+
+static void test_chcc_objlink(void) // 生成的目标文件通过 gread 读回，并链接成可执行文件
+{
+    const char *exe = "test_chcc_objlink";
+    const Elf64Shdr *sh;
+    const Elf64Sym *sym;
+    const char *name;
+    elfsymit_t it;
+    elfmap_t m;
+    buffer_t out = {0};
+    glink_t l;
+    chcc_t cc;
+    vsym_t *v;
+    fsym_t f;
+    byte *p;
+    uint64 text, entry;
+    uint32 found = 0;
+    chccinit(&cc);
+    cc.jobs = 1;
+    lang_assert(chccobjinit(&cc));
+    pushstrtofile(&cc, strfrom("var g int\n"), false);
+    lang_assert(chccgen(&cc) && cc.vars.len == sizeof(vsym_t *));
+    v = ((vsym_t **)cc.vars.a)[0];
+    test_chcc_objfunc(&cc, &f, "main", v, 7);
+    lang_assert(gobjfile(&cc, &out));
+    // main 是 .text 中的函数，g 是 .bss 中的对象，对 g 的引用是一个 PC32 重定位
+    lang_assert(elfmap_init(&m, out.a, out.len));
+    lang_assert((sh = elfmap_find(&m, ".symtab")) && elfsym_init(&it, &m, sh));
+    while ((sym = elfsym_next(&it))) {
+        name = elfsym_name(&it, sym);
+        if (name && strcmp(name, "main") == 0) {
+            lang_assert(le_16_to_host(sym->shndx) == 1 && ELF_SYM_TYPE(sym->info) == ELF_SYM_TYPE_FUNC);
+            lang_assert(le_64_to_host(sym->value) == 0 && le_64_to_host(sym->size) == 12);
+            found += 1;
+        } else if (name && strcmp(name, "g") == 0) {
+            lang_assert(ELF_SYM_TYPE(sym->info) == ELF_SYM_TYPE_OBJECT);
+            found += 1;
+        }
+    }
+    lang_assert(found == 2);
+    lang_assert((sh = elfmap_find(&m, ".rela.text")) && le_64_to_host(sh->size) == sizeof(Elf64Rela));
+    elfmap_close(&m);
+    // 没有定义 _start，链接器在代码开始处生成调用 main 的入口
+    lang_assert(glink_init(&l, 1));
+    lang_assert(glink_add_obj(&l, out.a, out.len, strfrom("test.o")));
+    lang_assert(glink_output(&l, exe));
+    text = l.addr[LSEC_TEXT];
+    entry = text + 32; // 入口代码之后按 .text 的16字节对齐
+    p = l.image + l.offset[LSEC_TEXT];
+    lang_assert(l.stub && lp_64_to_host(l.image + 24) == text);
+    lang_assert(p[14] == 0xe8 && lp_32_to_host(p + 15) == (uint32)(entry - (text + 19)));
+    p += entry - text;
+    lang_assert(p[0] == 0x8b && p[1] == 0x05 && lp_32_to_host(p + 2) == (uint32)(l.addr[LSEC_BSS] - (entry + 6)));
+    lang_assert(p[6] == 0x05 && lp_32_to_host(p + 7) == 7 && p[11] == 0xc3);
+    glink_free(&l);
+    remove(exe);
+    buffer_free(&out);
+    chccfree(&cc);
+}
+
+static void test_chcc_objsave(void) // gobjsave 分段聚集写入的文件与 gobjfile 拼接的内容一致
+{
+    const char *name = "test_chcc_objsave.o";
+    buffer_t out = {0};
+    elfmap_t m;
+    chcc_t cc;
+    FILE *f;
+    byte *a;
+    long n;
+    chccinit(&cc);
+    cc.jobs = 1;
+    lang_assert(chccobjinit(&cc));
+    pushstrtofile(&cc, strfrom("var g int\nvar h int\n"), false);
+    lang_assert(chccgen(&cc) && gobjfile(&cc, &out));
+    lang_assert(gobjsave(&cc, name));
+    lang_assert((f = fopen(name, "rb")) && fseek(f, 0, SEEK_END) == 0 && (n = ftell(f)) == (long)out.len);
+    lang_assert((a = (byte *)malloc(out.len)) && fseek(f, 0, SEEK_SET) == 0);
+    lang_assert(fread(a, 1, out.len, f) == out.len && memcmp(a, out.a, out.len) == 0);
+    fclose(f);
+    free(a);
+    lang_assert(elfmap_open(&m, name) && elfmap_find(&m, ".symtab"));
+    elfmap_close(&m);
+    remove(name);
+    // 写入失败时返回 false，不留下文件
+    lang_assert(!gobjsave(&cc, "test_chcc_nodir/test.o"));
+    lang_assert((f = fopen("test_chcc_nodir/test.o", "rb")) == null);
+    buffer_free(&out);
+    chccfree(&cc);
+}
+
+// 目标文件模式编译 src，再写入函数 fname 读取第一个全局变量，vname 不为空时改为引用未定义的外部变量
+static void test_chcc_objbuf(buffer_t *out, const char *src, const char *fname, const char *vname)
+{
+    vsym_t ext = {0}, *v;
+    fsym_t f;
+    chcc_t cc;
+    chccinit(&cc);
+    cc.jobs = 1;
+    lang_assert(chccobjinit(&cc));
+    pushstrtofile(&cc, strfrom(src), false);
+    lang_assert(chccgen(&cc) && cc.vars.len);
+    v = ((vsym_t **)cc.vars.a)[0];
+    if (vname) {
+        ext.symb.name = pushhashident(&cc.ident, strfrom(vname), 0, true);
+        v = &ext;
+    }
+    test_chcc_objfunc(&cc, &f, fname, v, 1);
+    lang_assert(gobjfile(&cc, out));
+    chccfree(&cc);
+}
+
+static void test_chcc_link(void) // 链接多个目标文件：_start 入口、跨文件的重定位、重复定义和未定义的符号
+{
+    const char *exe = "test_chcc_link";
+    buffer_t a = {0}, b = {0}, c = {0}, d = {0};
+    uint64 text, bss, addr;
+    glink_t l;
+    byte *p;
+    test_chcc_objbuf(&a, "var g int\n", "_start", null);
+    test_chcc_objbuf(&b, "var h int\n", "main", null);
+    test_chcc_objbuf(&c, "var k int\n", "main", null);
+    test_chcc_objbuf(&d, "var k int\n", "main", "missing");
+    // 定义了 _start 时不生成入口代码，_start 位于第一个目标文件代码的开始
+    lang_assert(glink_init(&l, 2));
+    lang_assert(glink_add_obj(&l, a.a, a.len, strfrom("a.o")));
+    lang_assert(glink_add_obj(&l, b.a, b.len, strfrom("b.o")));
+    lang_assert(glink_output(&l, exe));
+    text = l.addr[LSEC_TEXT];
+    bss = l.addr[LSEC_BSS];
+    lang_assert(l.stub == 0 && lp_64_to_host(l.image + 24) == text);
+    // 只读可执行分段的文件大小覆盖到 .rodata 结束
+    p = l.image + sizeof(Elf64Ehdr);
+    lang_assert(lp_32_to_host(p) == ELF_PT_LOAD && lp_64_to_host(p + 32) == l.offset[LSEC_RODATA] + l.size[LSEC_RODATA]);
+    // a.o 的 _start 引用 g，g 位于 .bss 开始；b.o 的 main 按16字节对齐放在其后，引用的 h 是 .bss 中的另一个变量
+    p = l.image + l.offset[LSEC_TEXT];
+    lang_assert(p[0] == 0x8b && lp_32_to_host(p + 2) == (uint32)(bss - (text + 6)));
+    p += 16;
+    addr = text + 16 + 6 + (uint64)(int64)(int32)lp_32_to_host(p + 2);
+    lang_assert(p[0] == 0x8b && addr > bss && addr < bss + l.size[LSEC_BSS]);
+    glink_free(&l);
+    remove(exe);
+    // 两个目标文件都定义了 main
+    lang_assert(glink_init(&l, 1));
+    lang_assert(glink_add_obj(&l, b.a, b.len, strfrom("b.o")));
+    lang_assert(glink_add_obj(&l, c.a, c.len, strfrom("c.o")));
+    lang_assert(!glink_output(&l, exe));
+    glink_free(&l);
+    // main 引用的 missing 没有定义
+    lang_assert(glink_init(&l, 1));
+    lang_assert(glink_add_obj(&l, d.a, d.len, strfrom("d.o")));
+    lang_assert(!glink_output(&l, exe));
+    glink_free(&l);
+    lang_assert(fopen(exe, "rb") == null);
+    buffer_free(&a);
+    buffer_free(&b);
+    buffer_free(&c);
+    buffer_free(&d);
+}
+
+// 测试用的 DEFLATE 解压，只用来验证压缩结果能够还原
+typedef struct {
+    const byte *p;
+    const byte *end;
+    uint32 bit;
+    uint32 nbit;
+    bool bad;
+} tzin_t;
+
+typedef struct {
+    uint32 count[16];   // 每个码长的编码个数
+    uint32 symbol[288]; // 按码长和符号排序的符号
+} tzhuff_t;
+
+static uint32 tzbits(tzin_t *s, uint32 n)
+{
+    uint32 v = s->bit;
+    while (s->nbit < n) {
+        if (s->p >= s->end) {
+            s->bad = true;
+            return 0;
+        }
+        v |= (uint32)(*s->p++) << s->nbit;
+        s->nbit += 8;
+    }
+    s->bit = v >> n;
+    s->nbit -= n;
+    return v & ((1u << n) - 1);
+}
+
+static void tzhuff(tzhuff_t *h, const byte *lens, uint32 n)
+{
+    uint32 offs[16], i;
+    memset(h->count, 0, sizeof(h->count));
+    for (i = 0; i < n; i += 1) {
+        h->count[lens[i]] += 1;
+    }
+    offs[1] = 0;
+    for (i = 1; i < 15; i += 1) {
+        offs[i + 1] = offs[i] + h->count[i];
+    }
+    for (i = 0; i < n; i += 1) {
+        if (lens[i]) {
+            h->symbol[offs[lens[i]]++] = i;
+        }
+    }
+}
+
+static uint32 tzdecode(tzin_t *s, const tzhuff_t *h) // 规范哈夫曼编码逐位解码
+{
+    int32 code = 0, first = 0, index = 0, count;
+    uint32 len;
+    for (len = 1; len < 16; len += 1) {
+        code |= (int32)tzbits(s, 1);
+        count = (int32)h->count[len];
+        if (code - count < first) {
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    s->bad = true;
+    return 0xffffffff;
+}
+
+static bool tzcodes(tzin_t *s, const tzhuff_t *lcode, const tzhuff_t *dcode, buffer_t *out)
+{
+    static const uint32 lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint32 lext[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint32 dbase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const uint32 dext[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    uint32 sym, len, dist;
+    byte c;
+    for (;;) {
+        sym = tzdecode(s, lcode);
+        if (s->bad || sym == 256) {
+            return !s->bad;
+        }
+        if (sym < 256) {
+            c = (byte)sym;
+            if (!buffer_push(out, &c, 1, 0)) { return false; }
+            continue;
+        }
+        if ((sym -= 257) >= 29) {
+            return false;
+        }
+        len = lbase[sym] + tzbits(s, lext[sym]);
+        sym = tzdecode(s, dcode);
+        if (s->bad || sym >= 30) {
+            return false;
+        }
+        dist = dbase[sym] + tzbits(s, dext[sym]);
+        if (s->bad || dist > out->len) {
+            return false;
+        }
+        for (; len; len -= 1) { // 匹配可以和正在输出的内容重叠
+            c = out->a[out->len - dist];
+            if (!buffer_push(out, &c, 1, 0)) { return false; }
+        }
+    }
+}
+
+static bool tzdynamic(tzin_t *s, tzhuff_t *lcode, tzhuff_t *dcode)
+{
+    static const byte order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    uint32 nlen = tzbits(s, 5) + 257, ndist = tzbits(s, 5) + 1, ncode = tzbits(s, 4) + 4, i = 0, sym, rep;
+    byte lens[320] = {0}, prev;
+    tzhuff_t ccode;
+    for (; i < ncode; i += 1) {
+        lens[order[i]] = (byte)tzbits(s, 3);
+    }
+    tzhuff(&ccode, lens, 19);
+    for (i = 0; i < nlen + ndist && !s->bad; ) {
+        sym = tzdecode(s, &ccode);
+        if (sym < 16) {
+            lens[i++] = (byte)sym;
+            continue;
+        }
+        prev = (sym == 16) ? (i ? lens[i - 1] : 0xff) : 0;
+        rep = (sym == 16) ? 3 + tzbits(s, 2) : (sym == 17) ? 3 + tzbits(s, 3) : 11 + tzbits(s, 7);
+        if (prev == 0xff || i + rep > nlen + ndist) {
+            return false;
+        }
+        for (; rep; rep -= 1) { lens[i++] = prev; }
+    }
+    tzhuff(lcode, lens, nlen);
+    tzhuff(dcode, lens + nlen, ndist);
+    return !s->bad;
+}
+
+static bool test_chcc_inflate(const byte *a, uintd_t n, buffer_t *out) // 解压 zlib 格式的数据，检查头部和校验和
+{
+    tzin_t s = {a + 2, a + n, 0, 0, false};
+    tzhuff_t lcode, dcode;
+    byte lens[320];
+    uint32 last, type, len, i;
+    buffer_clear(out);
+    if (n < 6 || (a[0] & 0x0f) != 8 || ((uint32)a[0] << 8 | a[1]) % 31 != 0) {
+        return false;
+    }
+    do {
+        last = tzbits(&s, 1);
+        type = tzbits(&s, 2);
+        if (type == 0) { // 不压缩存储
+            s.bit = s.nbit = 0;
+            if (s.end - s.p < 4 || (s.p[0] | s.p[1] << 8) != (~(s.p[2] | s.p[3] << 8) & 0xffff)) {
+                return false;
+            }
+            len = s.p[0] | s.p[1] << 8;
+            s.p += 4;
+            if ((uintd_t)(s.end - s.p) < len || (len && !buffer_push(out, s.p, len, 0))) {
+                return false;
+            }
+            s.p += len;
+        } else if (type == 1) { // 固定哈夫曼编码
+            for (i = 0; i < 288; i += 1) {
+                lens[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+            }
+            tzhuff(&lcode, lens, 288);
+            memset(lens, 5, 30);
+            tzhuff(&dcode, lens, 30);
+            if (!tzcodes(&s, &lcode, &dcode, out)) {
+                return false;
+            }
+        } else if (type != 2 || !tzdynamic(&s, &lcode, &dcode) || !tzcodes(&s, &lcode, &dcode, out)) {
+            return false;
+        }
+    } while (!last && !s.bad);
+    // 块之后按字节对齐，紧跟大端的 adler32 校验和
+    return !s.bad && s.end - s.p == 4 &&
+        ((uint32)s.p[0] << 24 | (uint32)s.p[1] << 16 | (uint32)s.p[2] << 8 | s.p[3]) == zlib_adler32(1, out->a, out->len);
+}
+
+static void test_chcc_deflate(void) // 各个压缩级别的结果都能还原，重复的内容变小，不能压缩的内容使用不压缩存储
+{
+    static const uint32 levels[] = {0, 1, DEFLATE_LEVEL_DEFAULT, 9};
+    uintd_t sizes[] = {0, 1, 300, 70000, 200000};
+    buffer_t z = {0}, out = {0};
+    uint32 i, j, k, x = 1;
+    byte *text = (byte *)malloc(200000), *noise = (byte *)malloc(200000);
+    lang_assert(text && noise);
+    lang_assert(zlib_adler32(1, (const byte *)"Wikipedia", 9) == 0x11e60398);
+    for (i = 0; i < 200000; i += 1) { // 带有少量变化的重复文本，和伪随机的字节
+        x = x * 1103515245 + 12345;
+        text[i] = (byte)("func main(return int) {\n    return 42\n}\n"[i % 40] + ((x >> 16) % 97 == 0));
+        noise[i] = (byte)(x >> 23);
+    }
+    for (i = 0; i < sizeof(levels) / sizeof(levels[0]); i += 1) {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j += 1) {
+            for (k = 0; k < 2; k += 1) {
+                buffer_clear(&z);
+                lang_assert(zlib_deflate(k ? noise : text, sizes[j], levels[i], &z));
+                lang_assert(test_chcc_inflate(z.a, z.len, &out) && out.len == sizes[j]);
+                lang_assert(sizes[j] == 0 || memcmp(out.a, k ? noise : text, sizes[j]) == 0);
+                if (k) { // 每个块最多16384个符号，不压缩存储时每块只多出5字节的块头部
+                    lang_assert(z.len <= sizes[j] + 5 * (sizes[j] / 16384 + 1) + 6);
+                } else if (levels[i] && sizes[j] >= 70000) {
+                    lang_assert(z.len < sizes[j] / 8);
+                }
+            }
+        }
+    }
+    // 压缩分区：Elf64Chdr 头部之后是 zlib 数据
+    lang_assert(elf_compress_section(text, 5000, 8, DEFLATE_LEVEL_DEFAULT, &z));
+    lang_assert(z.len > sizeof(Elf64Chdr) && lp_32_to_host(z.a) == ELF_COMPRESS_ZLIB && lp_32_to_host(z.a + 4) == 0);
+    lang_assert(lp_64_to_host(z.a + 8) == 5000 && lp_64_to_host(z.a + 16) == 8);
+    lang_assert(test_chcc_inflate(z.a + sizeof(Elf64Chdr), z.len - sizeof(Elf64Chdr), &out));
+    lang_assert(out.len == 5000 && memcmp(out.a, text, 5000) == 0);
+    free(text);
+    free(noise);
+    buffer_free(&z);
+    buffer_free(&out);
+}
+
+static void test_chcc_objzlib(void) // 目标文件中的附加分区按 ozlib 压缩，读回之后解压得到原来的内容
+{
+    const Elf64Shdr *sh;
+    buffer_t obj = {0}, out = {0};
+    elfmap_t m;
+    chcc_t cc;
+    byte data[4096];
+    uint32 i;
+    for (i = 0; i < sizeof(data); i += 1) {
+        data[i] = (byte)(i % 13);
+    }
+    chccinit(&cc);
+    cc.jobs = 2;
+    cc.ozlib = DEFLATE_LEVEL_DEFAULT;
+    lang_assert(chccobjinit(&cc));
+    lang_assert(gobjsection(&cc, ".test_zlib", ELF_SEC_PROGBITS, 4, true, data, sizeof(data)));
+    lang_assert(gobjsection(&cc, ".test_raw", ELF_SEC_PROGBITS, 4, false, data, sizeof(data)));
+    pushstrtofile(&cc, strfrom("var g int\n"), false);
+    lang_assert(chccgen(&cc) && gobjfile(&cc, &obj));
+    lang_assert(elfmap_init(&m, obj.a, obj.len));
+    lang_assert((sh = elfmap_find(&m, ".test_zlib")) && (le_64_to_host(sh->flags) & ELF_SF_COMPRESSED));
+    lang_assert(le_64_to_host(sh->addralign) == 8 && le_64_to_host(sh->size) < sizeof(data));
+    lang_assert(lp_64_to_host((byte *)obj.a + le_64_to_host(sh->offset) + 8) == sizeof(data));
+    lang_assert(test_chcc_inflate(obj.a + le_64_to_host(sh->offset) + sizeof(Elf64Chdr), le_64_to_host(sh->size) - sizeof(Elf64Chdr), &out));
+    lang_assert(out.len == sizeof(data) && memcmp(out.a, data, sizeof(data)) == 0);
+    lang_assert((sh = elfmap_find(&m, ".test_raw")) && !(le_64_to_host(sh->flags) & ELF_SF_COMPRESSED));
+    lang_assert(le_64_to_host(sh->size) == sizeof(data) && memcmp(obj.a + le_64_to_host(sh->offset), data, sizeof(data)) == 0);
+    elfmap_close(&m);
+    buffer_free(&obj);
+    buffer_free(&out);
+    chccfree(&cc);
+}
+
+static void test_chcc_objfile(const char *name, const char *src)
+{
+    FILE *f;
+    lang_assert((f = fopen(name, "wb")) && fputs(src, f) >= 0 && !fclose(f));
+}
+
+static bool test_chcc_samefile(const char *a, const char *b)
+{
+    FILE *f = fopen(a, "rb"), *g = fopen(b, "rb");
+    int c = 0, d = 0;
+    while (f && g && c == d && c != EOF) {
+        c = fgetc(f);
+        d = fgetc(g);
+    }
+    if (f) fclose(f);
+    if (g) fclose(g);
+    return f && g && c == d;
+}
+
+static bool test_chcc_objcached(objcache_t *c, const char *src, const char *obj)
+{
+    chcc_t cc;
+    bool succ;
+    chccinit(&cc);
+    cc.jobs = 1;
+    cc.ocache = c;
+    succ = chccobj(&cc, src, obj);
+    chccfree(&cc);
+    return succ;
+}
+
+// 编译同一个源文件两次，第二次命中缓存；只修改注释时词法流不变也命中，修改代码之后未命中
+static void test_chcc_objcache(void)
+{
+    const char *dir = "test_chcc_objcache", *src = "test_chcc_objcache.ch";
+    char stats[64];
+    objcache_t c;
+    objstat_t st;
+    lang_assert(objcache_open(&c, dir, 0));
+    test_chcc_objfile(src, "var g int\n");
+    lang_assert(test_chcc_objcached(&c, src, "test_chcc_a.o"));
+    objcache_stats(&c, &st);
+    lang_assert(st.hits == 0 && st.misses == 1 && st.stores == 1);
+    lang_assert(test_chcc_objcached(&c, src, "test_chcc_b.o"));
+    objcache_stats(&c, &st);
+    lang_assert(st.hits == 1 && st.misses == 1 && test_chcc_samefile("test_chcc_a.o", "test_chcc_b.o"));
+    test_chcc_objfile(src, "// 全局变量\nvar g int\n");
+    lang_assert(test_chcc_objcached(&c, src, "test_chcc_b.o"));
+    objcache_stats(&c, &st);
+    lang_assert(st.hits == 2 && st.misses == 1);
+    test_chcc_objfile(src, "var g int\nvar h int\n");
+    lang_assert(test_chcc_objcached(&c, src, "test_chcc_b.o"));
+    objcache_stats(&c, &st);
+    lang_assert(st.hits == 2 && st.misses == 2 && st.stores == 2 && !test_chcc_samefile("test_chcc_a.o", "test_chcc_b.o"));
+    lang_assert(objcache_evict(&c, 0) && objcache_close(&c));
+    snprintf(stats, sizeof(stats), "%s/stats", dir);
+    remove(stats);
+    remove(dir);
+    remove(src);
+    remove("test_chcc_a.o");
+    remove("test_chcc_b.o");
+}
+
+static uint64 test_chcc_uleb(const byte **p)
+{
+    uint64 v = 0;
+    uint32 shift = 0;
+    byte c;
+    do {
+        c = *(*p)++;
+        v |= (uint64)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return v;
+}
+
+static int64 test_chcc_sleb(const byte **p)
+{
+    int64 v = 0;
+    uint32 shift = 0;
+    byte c;
+    do {
+        c = *(*p)++;
+        v |= (int64)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    if (shift < 64 && (c & 0x40)) {
+        v |= -((int64)1 << shift);
+    }
+    return v;
+}
+
+// 执行 .debug_line 的行号程序，输出的每一行是 (地址, 行号, 列号)，序列结束的一行列号为 0xffffffff，
+// 地址由 DW_LNE_set_address 位置的重定位附加值给出
+static uint32 test_chcc_dwrun(const dwsec_t *s, uint64 (*rows)[3], uint32 max)
+{
+    const byte *a = s->data.a, *p, *end = a + s->data.len, *hdr;
+    const dwrel_t *r = (const dwrel_t *)s->rels.a;
+    uint32 nrel = (uint32)(s->rels.len / sizeof(dwrel_t)), i, n = 0, op;
+    uint64 addr = 0, line = 1, cols = 0, len;
+    lang_assert(lp_32_to_host((byte *)a) == s->data.len - 4 && lp_16_to_host((byte *)a + 4) == 4);
+    hdr = a + 10;
+    p = hdr + lp_32_to_host((byte *)a + 6);
+    lang_assert(hdr[0] == 1 && hdr[1] == 1 && hdr[2] == 1 && (int8)hdr[3] == -5 && hdr[4] == 14 && hdr[5] == 13);
+    while (p < end) {
+        op = *p++;
+        if (op >= 13) { // 特殊操作码
+            op -= 13;
+            addr += op / 14;
+            line += (uint64)((int64)(op % 14) - 5);
+            lang_assert(n < max);
+            rows[n][0] = addr; rows[n][1] = line; rows[n][2] = cols; n += 1;
+        } else if (op == 0) { // 扩展操作码
+            len = test_chcc_uleb(&p);
+            op = *p;
+            if (op == 2) {
+                for (i = 0; i < nrel && r[i].offset != (uint32)(p + 1 - a); i += 1) {}
+                lang_assert(len == 9 && i < nrel && r[i].size == 8 && r[i].target == DWSEC_TEXT && lp_64_to_host((byte *)p + 1) == 0);
+                addr = (uint64)r[i].addend;
+            } else {
+                lang_assert(op == 1 && len == 1 && n < max);
+                rows[n][0] = addr; rows[n][1] = line; rows[n][2] = 0xffffffff; n += 1;
+                addr = 0; line = 1; cols = 0;
+            }
+            p += len;
+        } else if (op == 1) { // DW_LNS_copy
+            lang_assert(n < max);
+            rows[n][0] = addr; rows[n][1] = line; rows[n][2] = cols; n += 1;
+        } else if (op == 2) {
+            addr += test_chcc_uleb(&p);
+        } else if (op == 3) {
+            line += (uint64)test_chcc_sleb(&p);
+        } else {
+            lang_assert(op == 5);
+            cols = test_chcc_uleb(&p);
+        }
+    }
+    return n;
+}
+
+static void test_chcc_dwarf(void) // 行号程序还原出记录的行，代码回退时丢弃之后的行，超出函数范围的行不输出
+{
+    static const uint64 expect[][3] = {
+        {0, 3, 5}, {4, 4, 5}, {8, 7, 2}, {10, 4, 9}, {12, 30, 5}, {40, 30, 0xffffffff},
+        {64, 10, 1}, {66, 9, 1}, {64 + 350, 11, 3}, {64 + 390, 11, 3}, {64 + 400, 11, 0xffffffff},
+    };
+    buffer_t a = {0}, b = {0};
+    dwsec_t out[DWSEC_NUM];
+    dwfunc_t f[2];
+    uint64 rows[16][3];
+    const dwline_t *r;
+    uint32 i, n;
+    lang_assert(dwline_add(&a, 0, 3, 5) && dwline_add(&a, 4, 4, 5) && dwline_add(&a, 8, 7, 1) && dwline_add(&a, 9, 8, 1));
+    lang_assert(dwline_add(&a, 8, 7, 2) && a.len == 3 * sizeof(dwline_t)); // 回到偏移8，丢弃偏移9的行，替换偏移8的行
+    r = (const dwline_t *)a.a;
+    lang_assert(r[2].offset == 8 && r[2].line == 7 && r[2].cols == 2);
+    lang_assert(dwline_add(&a, 10, 4, 9) && dwline_add(&a, 12, 30, 5));
+    lang_assert(dwline_add(&b, 0, 10, 1) && dwline_add(&b, 2, 9, 1) && dwline_add(&b, 350, 11, 3));
+    lang_assert(dwline_add(&b, 390, 11, 3) && dwline_add(&b, 400, 12, 1));
+    f[0].name = (const byte *)"f";
+    f[0].namelen = 1;
+    f[0].line = 3;
+    f[0].offset = 0;
+    f[0].size = 40;
+    f[0].rows = (const dwline_t *)a.a;
+    f[0].nrow = (uint32)(a.len / sizeof(dwline_t));
+    f[1].name = (const byte *)"main";
+    f[1].namelen = 4;
+    f[1].line = 10;
+    f[1].offset = 64;
+    f[1].size = 400;
+    f[1].rows = (const dwline_t *)b.a;
+    f[1].nrow = (uint32)(b.len / sizeof(dwline_t));
+    lang_assert(dwarf_build((const byte *)"test.ch", 7, f, 2, 464, out));
+    // 文件名表只有源文件，之后是行号程序
+    lang_assert(memcmp(out[DWSEC_LINE].data.a + 10 + 6 + 12, "\0test.ch\0\0\0\0\0", 14) == 0);
+    n = test_chcc_dwrun(out + DWSEC_LINE, rows, 16);
+    lang_assert(n == sizeof(expect) / sizeof(expect[0]));
+    for (i = 0; i < n; i += 1) {
+        lang_assert_2(rows[i][0] == expect[i][0] && rows[i][1] == expect[i][1] && rows[i][2] == expect[i][2], i, rows[i][0]);
+    }
+    // 编译单元引用缩写表和行号程序，每个函数的开始地址都需要重定位
+    lang_assert(out[DWSEC_INFO].rels.len == 5 * sizeof(dwrel_t));
+    lang_assert(((dwrel_t *)out[DWSEC_INFO].rels.a)[4].addend == 64 && out[DWSEC_LINE].rels.len == 2 * sizeof(dwrel_t));
+    dwarf_free(out);
+    buffer_free(&a);
+    buffer_free(&b);
+}
+
+static void test_chcc_buildid(void) // 构建标识只与内容有关，与分段方式和线程个数无关
+{
+    uintd_t n = 2 * BUILDID_CHUNK + 12345, cut[2] = {BUILDID_CHUNK - 7, BUILDID_CHUNK + 100};
+    byte *a = (byte *)malloc(n), h[BUILDID_SIZE], g[BUILDID_SIZE], note[BUILDID_NOTE_SIZE], zero[BUILDID_SIZE] = {0};
+    bidpart_t part[3];
+    uint32 i, x = 7;
+    lang_assert(a);
+    for (i = 0; i < n; i += 1) {
+        x = x * 1103515245 + 12345;
+        a[i] = (byte)(x >> 16);
+    }
+    part[0].a = a;
+    part[0].n = n;
+    lang_assert(buildid_hash(part, 1, 1, h) && memcmp(h, zero, BUILDID_SIZE) != 0);
+    lang_assert(buildid_hash(part, 1, 4, g) && memcmp(h, g, BUILDID_SIZE) == 0);
+    part[0].n = cut[0]; // 分段边界不在切块边界上
+    part[1].a = a + cut[0];
+    part[1].n = cut[1] - cut[0];
+    part[2].a = a + cut[1];
+    part[2].n = n - cut[1];
+    lang_assert(buildid_hash(part, 3, 3, g) && memcmp(h, g, BUILDID_SIZE) == 0);
+    a[n - 1] ^= 1; // 最后一块的一个位不同
+    lang_assert(buildid_hash(part, 3, 2, g) && memcmp(h, g, BUILDID_SIZE) != 0);
+    a[n - 1] ^= 1;
+    part[2].n -= 1; // 长度不同
+    lang_assert(buildid_hash(part, 3, 2, g) && memcmp(h, g, BUILDID_SIZE) != 0);
+    part[0].n = 0;
+    lang_assert(buildid_hash(part, 1, 2, h) && buildid_hash(part, 0, 1, g) && memcmp(h, g, BUILDID_SIZE) == 0);
+    // 说明条目的名称是 "GNU\0"，构建标识为全零
+    memset(note, 0xff, sizeof(note));
+    buildid_note(note);
+    lang_assert(lp_32_to_host(note) == 4 && lp_32_to_host(note + 4) == BUILDID_SIZE && lp_32_to_host(note + 8) == ELF_NT_GNU_BUILD_ID);
+    lang_assert(memcmp(note + 12, "GNU", 4) == 0 && memcmp(note + BUILDID_NOTE_DESC, zero, BUILDID_SIZE) == 0);
+    free(a);
+}
+
+static void test_chcc_objbuildid_gen(uint32 jobs, buffer_t *out)
+{
+    chcc_t cc;
+    chccinit(&cc);
+    cc.jobs = jobs;
+    cc.gdebug = true;
+    lang_assert(chccobjinit(&cc));
+    pushstrtofile(&cc, strfrom("var g int\nvar h int\n"), false);
+    lang_assert(chccgen(&cc) && gobjfile(&cc, out));
+    chccfree(&cc);
+}
+
+static void test_chcc_objbuildid(void) // 同样的源文件用不同的线程个数生成的目标文件完全相同
+{
+    buffer_t a = {0}, b = {0};
+    const Elf64Shdr *sh;
+    byte zero[BUILDID_SIZE] = {0};
+    elfmap_t m;
+    test_chcc_objbuildid_gen(1, &a);
+    test_chcc_objbuildid_gen(4, &b);
+    lang_assert(a.len == b.len && memcmp(a.a, b.a, a.len) == 0);
+    lang_assert(elfmap_init(&m, a.a, a.len) && (sh = elfmap_find(&m, ".note.gnu.build-id")));
+    lang_assert(le_64_to_host(sh->size) == BUILDID_NOTE_SIZE);
+    lang_assert(memcmp(a.a + le_64_to_host(sh->offset) + BUILDID_NOTE_DESC, zero, BUILDID_SIZE) != 0);
+    elfmap_close(&m);
+    buffer_free(&a);
+    buffer_free(&b);
+}
+
+static void test_chcc_switch(void) // 密集的分支生成跳转表，稀疏的分支生成比较树
+{
+    static byte text[256];
+    static uint32 rotab[16]; // 跳转表按4字节对齐
+    byte *rodata = (byte *)rotab;
+    case_t dense[4] = {{1, text + 100}, {2, text + 110}, {4, text + 120}, {5, text + 130}};
+    case_t sparse[4] = {{-100, text + 100}, {1, text + 110}, {1000, text + 120}, {100000, text + 130}};
+    byte *dflt = text + 200, *a = text;
+    chcc_t cc;
+    chccinit(&cc);
+    cc.text_section = cc.text = text;
+    cc.text_end = text + sizeof(text);
+    cc.rodata_section = cc.rodata = rodata;
+    // sub $1,%eax; cmp $5,%eax; jae dflt; jmp *table(,%eax,4)，值3的表项是默认分支
+    gswitch(&cc, dense, 4, dflt);
+    lang_assert(a[0] == 0x2d && lp_32_to_host(a + 1) == 1);
+    lang_assert(a[5] == 0x3d && lp_32_to_host(a + 6) == 5);
+    lang_assert(a[10] == 0x0f && a[11] == 0x83 && a + 16 + (int32)lp_32_to_host(a + 12) == dflt);
+    lang_assert(a[16] == 0xff && a[17] == 0x24 && a[18] == 0x85);
+    lang_assert(lp_32_to_host(a + 19) == (uint32)(uintd_t)rodata && cc.text == a + 23);
+    lang_assert(cc.rodata == rodata + 5 * 4);
+    lang_assert(lp_32_to_host(rodata + 0) == (uint32)(uintd_t)(text + 100));
+    lang_assert(lp_32_to_host(rodata + 4) == (uint32)(uintd_t)(text + 110));
+    lang_assert(lp_32_to_host(rodata + 8) == (uint32)(uintd_t)dflt);
+    lang_assert(lp_32_to_host(rodata + 12) == (uint32)(uintd_t)(text + 120));
+    lang_assert(lp_32_to_host(rodata + 16) == (uint32)(uintd_t)(text + 130));
+    // 比较中间值1000，大于时跳到右半部分比较100000，否则顺序比较-100和1
+    a = cc.text;
+    cc.rodata = rodata;
+    gswitch(&cc, sparse, 4, dflt);
+    lang_assert(a[0] == 0x3d && lp_32_to_host(a + 1) == 1000);
+    lang_assert(a[5] == 0x0f && a[6] == 0x84 && a + 11 + (int32)lp_32_to_host(a + 7) == text + 120);
+    lang_assert(a[11] == 0x0f && a[12] == 0x8f && lp_32_to_host(a + 13) == 27);
+    lang_assert(a[17] == 0x3d && (int32)lp_32_to_host(a + 18) == -100);
+    lang_assert(a[28] == 0x3d && lp_32_to_host(a + 29) == 1);
+    lang_assert(a[39] == 0xe9 && a + 44 + (int32)lp_32_to_host(a + 40) == dflt);
+    lang_assert(a[44] == 0x3d && lp_32_to_host(a + 45) == 100000);
+    lang_assert(a[55] == 0xe9 && cc.text == a + 60 && cc.rodata == rodata);
+    // 只有默认分支时直接跳转
+    a = cc.text;
+    gswitch(&cc, null, 0, dflt);
+    lang_assert(a[0] == 0xe9 && a + 5 + (int32)lp_32_to_host(a + 1) == dflt && cc.text == a + 5);
+    cc.text_section = cc.text = cc.text_end = null;
+    cc.rodata_section = cc.rodata = null;
+    chccfree(&cc);
+}
+
+static void test_chcc_switchdup(void) // 重复的分支值是一个错误
+{
+    chcc_t cc;
+    jit_t j;
+    chccinit(&cc);
+    cc.jobs = 1;
+    lang_assert(jit_init(&j, &cc, strfrom("main"), 4096, 4096, 4096, 4096));
+    pushstrtofile(&cc, strfrom(
+        "func main(return int) {\n"
+        "    switch 2 {\n"
+        "    case 1, 2:\n"
+        "        return 1\n"
+        "    case 2:\n"
+        "        return 2\n"
+        "    }\n"
+        "    return 0\n"
+        "}\n"), false);
+    lang_assert(!chccgen(&cc));
+    jit_free(&j);
+    chccfree(&cc);
+}
+
+static void test_chcc_jittramp(void) // 入口跳板的指令字节，返回地址是 pop %edi 的位置
+{
+    static const byte head[] = {
+        0x55, 0x53, 0x56, 0x57,     // push %ebp; push %ebx; push %esi; push %edi
+        0x8b, 0x54, 0x24, 0x14,     // mov 0x14(%esp),%edx
+        0x8b, 0x44, 0x24, 0x18,     // mov 0x18(%esp),%eax
+        0xc7, 0x02,                 // movl $imm32,(%edx)
+    };
+    static const byte tail[] = {
+        0xff, 0xe0,                 // jmp *%eax
+        0x5f, 0x5e, 0x5b, 0x5d,     // pop %edi; pop %esi; pop %ebx; pop %ebp
+        0xc3,                       // ret
+    };
+    chcc_t cc;
+    jit_t j;
+    chccinit(&cc);
+    lang_assert(jit_init(&j, &cc, strfrom("main"), 4096, 4096, 4096, 4096));
+    lang_assert(memcmp(j.mem, head, sizeof(head)) == 0);
+    lang_assert(lp_32_to_host(j.mem + sizeof(head)) == (uint32)(uintd_t)(j.mem + sizeof(head) + 4 + 2));
+    lang_assert(memcmp(j.mem + sizeof(head) + 4, tail, sizeof(tail)) == 0);
+    jit_free(&j);
+    chccfree(&cc);
+}
+
 void test_chcc(void)
 {
     chcc_t cc;
@@ -375,4 +1289,25 @@ void test_chcc(void)
     cifa_ident_assert(3, 9, cc.user_id_start+8); lang_assert_s(memcmp(cf->s.a, "Z", 1) == 0, cf->s);
 
     chcc_free(&cc);
+
+    test_chcc_jittramp();
+    test_chcc_switch();
+    test_chcc_switchdup();
+    test_chcc_jitfull();
+    test_chcc_objrefuse();
+    test_chcc_objlink();
+    test_chcc_objsave();
+    test_chcc_link();
+    test_chcc_deflate();
+    test_chcc_objzlib();
+    test_chcc_objcache();
+    test_chcc_dwarf();
+    test_chcc_buildid();
+    test_chcc_objbuildid();
+#if defined(__ARCH_X86__)
+    test_chcc_jitrun();
+    test_chcc_inline();
+    test_chcc_nestcall();
+#endif
+    test_chcc_jobs();
 }
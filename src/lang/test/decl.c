@@ -1,9 +1,385 @@
 #define __CURR_FILE__ STRID_TEST_DECL
 #include "internal/decl.h"
+#include "builtin/region.h"
+#include "builtin/pool.h"
+#include "builtin/smap.h"
+#include "builtin/deque.h"
+#include "builtin/rope.h"
+#include "direct/queue.h"
+#include "direct/binlog.h"
+#include "direct/loglevel.h"
+#include "direct/trace.h"
+
+static void test_region(void)
+{
+    region_t r;
+    region_mark_t m, m2;
+    buffer_t b = {0};
+    stack_t s = {0};
+    byte *p, *q, i;
+    region_init(&r, 256);
+    p = (byte *)region_alloc(&r, 10);
+    lang_assert(p && ((upr)p & (REGION_ALIGN - 1)) == 0);
+    q = (byte *)region_realloc(&r, p, 10, 100); // 最近一次分配的对象原地扩大
+    lang_assert(q == p);
+    m = region_mark(&r);
+    for (i = 0; i < 200; i += 1) { // 跨越多个块
+        lang_assert(buffer_put_r(&b, i, 0, &r));
+        lang_assert(stack_push_r(&s, 24, &r));
+    }
+    lang_assert(b.len == 200 && b.a[199] == 199);
+    m2 = region_mark(&r);
+    lang_assert(region_alloc(&r, 1000) != null); // 大对象单独占用一个块
+    region_rollback(&r, m2);
+    lang_assert(r.cur == m2.cur);
+    while (stack_pop_r(&s, null, &r)) {}
+    region_rollback(&r, m);
+    lang_assert(r.cur == m.cur && r.spare != null);
+    region_reset(&r);
+    lang_assert(r.block == null && region_alloc(&r, 8) != null && r.block != null);
+    region_free(&r);
+    lang_assert(r.block == null && r.spare == null);
+}
+
+static void test_pool(void)
+{
+    pool_t p;
+    slist_t l = {0};
+    stack_t s = {0};
+    byte *a, *b, *c;
+    uint32 i;
+    pool_init(&p, POOL_CACHE_LINE);
+    a = stack_push_p(&s, 24, &p);
+    lang_assert(a && ((upr)(a - sizeof(snode_t)) & (POOL_CACHE_LINE - 1)) == 0);
+    lang_assert(stack_pop_p(&s, null, &p));
+    b = stack_push_p(&s, 24, &p); // 释放的节点放回空闲链表，下次直接复用
+    lang_assert(b == a && b[0] == 0);
+    c = stack_push_p(&s, 2000, &p); // 大对象单独分配
+    lang_assert(c && (byte *)(s.top + 1) == c);
+    stack_free_p(&s, null, &p);
+    lang_assert(s.top == null);
+    for (i = 0; i < 5000; i += 1) { // 跨越多个块
+        *(uint32 *)slist_push_back_p(&l, sizeof(uint32), &p) = i;
+    }
+    lang_assert(*(uint32 *)slist_front(&l) == 0 && *(uint32 *)slist_back(&l) == 4999);
+    lang_assert(slist_pop_front_p(&l, null, &p) && *(uint32 *)slist_front(&l) == 1);
+    *(uint32 *)slist_push_front_p(&l, sizeof(uint32), &p) = 7;
+    lang_assert(*(uint32 *)slist_front(&l) == 7);
+    slist_free_p(&l, null, &p);
+    lang_assert(l.head.next == null && l.tail == null);
+    pool_free(&p);
+    lang_assert(p.block == null && p.align == POOL_CACHE_LINE);
+}
+
+static void test_buffer(void)
+{
+    buffer_t b = {0};
+    uint32 i;
+    lang_assert(buffer_put(&b, 1, 0) && b.cap == 64); // 小缓存至少分配64字节
+    for (i = 0; i < 300 * 1024; i += 1) {
+        buffer_put(&b, (byte)i, 0);
+    }
+    lang_assert(b.len == 300 * 1024 + 1 && b.cap % 4096 == 0 && b.a[300 * 1024] == (byte)(300 * 1024 - 1));
+    lang_assert(buffer_put(&b, 1, 10) && b.cap >= b.len);
+    buffer_free(&b);
+}
+
+SMAP_DEFINE(u32map, uint32, uint32, SMAP_HASH, SMAP_EQUAL)
+SMAP_DEFINE(strmap, string_t, int96, SMAP_STR_HASH, SMAP_STR_EQUAL)
+
+static void test_smap(void)
+{
+    smap_t m = {0}, t = {0};
+    uint32 i, n = 0, *v;
+    bool exist;
+    int96 j;
+    lang_assert(u32map_find(&m, 1) == null && !u32map_erase(&m, 1));
+    for (i = 0; i < 10000; i += 1) {
+        *u32map_insert(&m, i * 7, &exist) = i;
+        lang_assert(!exist);
+    }
+    lang_assert(m.len == 10000 && m.len + m.left <= m.cap - m.cap / 8);
+    for (i = 0; i < 10000; i += 2) { // 删除一半，再插入已删除的键
+        lang_assert(u32map_erase(&m, i * 7));
+    }
+    for (i = 0; i < 10000; i += 1) {
+        v = u32map_find(&m, i * 7);
+        lang_assert((i & 1) ? (v && *v == i) : !v);
+        lang_assert(!u32map_find(&m, i * 7 + 1));
+    }
+    for (i = 0; i < 10000; i += 4) {
+        *u32map_insert(&m, i * 7, &exist) = i;
+        lang_assert(!exist);
+    }
+    for (j = smap_next(&m, 0); j >= 0; j = smap_next(&m, j + 1)) {
+        lang_assert(u32map_slot(&m, j)->key == u32map_slot(&m, j)->val * 7);
+        n += 1;
+    }
+    lang_assert(n == m.len && n == 7500);
+    smap_free(&m);
+    *strmap_insert(&t, strflen((const byte *)"chapl", 5), &exist) = 1;
+    *strmap_insert(&t, strflen((const byte *)"chcc", 4), &exist) = 2;
+    lang_assert(*strmap_find(&t, strflen((const byte *)"chcc", 4)) == 2);
+    lang_assert(!strmap_find(&t, strflen((const byte *)"chap", 4)));
+    smap_free(&t);
+}
+
+static void test_deque(void)
+{
+    deque_t d;
+    uint32 i, v, a[3000];
+    uint96 j, n, sum = 0;
+    byte *p, *e;
+    deque_init(&d, sizeof(uint32));
+    lang_assert(!deque_pop_front(&d, &v) && !deque_front(&d));
+    for (i = 0; i < 3000; i += 1) {
+        a[i] = i;
+        lang_assert(deque_push_back(&d, &i) && deque_push_front(&d, (v = ~i, &v)));
+    }
+    e = deque_at(&d, 3000); // 元素0，两端压入不移动已有的元素
+    lang_assert(d.len == 6000 && *(uint32 *)e == 0 && *(uint32 *)deque_front(&d) == ~2999u);
+    for (i = 0; i < 3000; i += 1) {
+        lang_assert(*(uint32 *)deque_at(&d, 2999 - i) == ~i && *(uint32 *)deque_at(&d, 3000 + i) == i);
+    }
+    for (i = 0; i < 3000; i += 1) {
+        lang_assert(deque_pop_front(&d, &v) && v == ~(2999 - i));
+    }
+    lang_assert(deque_append(&d, a, 3000) && d.len == 6000 && deque_at(&d, 0) == e);
+    for (j = 0; (p = deque_run(&d, j, &n)); j += n) { // 逐段遍历连续的元素
+        for (i = 0; i < n; i += 1) {
+            sum += ((uint32 *)p)[i];
+        }
+    }
+    lang_assert(j == 6000 && sum == 2 * (2999 * 3000 / 2));
+    for (i = 0; i < 6000; i += 1) {
+        lang_assert(deque_pop_back(&d, &v) && v == 2999 - i % 3000);
+    }
+    lang_assert(!deque_pop_back(&d, &v) && d.nblock == 0);
+    deque_free(&d);
+}
+
+static void test_rope(void)
+{
+    static byte a[8192], b[8192];
+    const byte *u = (const byte *)"\xe4\xb8\xad"; // 中
+    rope_t r, s;
+    rope_iter_t it;
+    uint96 n = 0, i, pos, len, line, col;
+    uint32 x = 1;
+    rope_init(&r);
+    for (i = 0; i < 4000; i += 1) { // 随机插入和删除，与平坦的数组比较
+        x = x * 1103515245 + 12345;
+        pos = (x >> 8) % (n + 1);
+        if ((x & 3) || n < 64) {
+            len = 1 + (x >> 20) % ((x & 64) ? 1500 : 8);
+            len = (n + len > sizeof(a)) ? (sizeof(a) - n) : len;
+            memmove(a + pos + len, a + pos, n - pos);
+            memset(a + pos, (i % 7) ? 'a' + i % 26 : '\n', len);
+            lang_assert(rope_insert(&r, pos, a + pos, len));
+            n += len;
+        } else {
+            len = (x >> 20) % 600;
+            len = (pos + len > n) ? (n - pos) : len;
+            memmove(a + pos, a + pos + len, n - pos - len);
+            lang_assert(rope_erase(&r, pos, len));
+            n -= len;
+        }
+        lang_assert(rope_len(&r) == n);
+    }
+    lang_assert(rope_copy(&r, 0, b, n) == n && !memcmp(a, b, n));
+    lang_assert(r.root->height < 20);
+    rope_snapshot(&r, &s);
+    lang_assert(rope_erase(&r, 10, n - 20) && rope_insert(&r, 5, u, 3) && rope_len(&r) == 23);
+    lang_assert(rope_len(&s) == n && rope_copy(&s, 0, b, n) == n && !memcmp(a, b, n)); // 快照不变
+    for (i = 0, line = 0; i < n; i += 1) {
+        if (a[i] == '\n') {
+            line += 1;
+            lang_assert(rope_line_start(&s, line) == i + 1);
+        }
+    }
+    lang_assert(rope_lines(&s) == line && rope_line_start(&s, line + 1) == n);
+    rope_free(&r);
+    rope_free(&s);
+    memset(a, 'x', 2000);
+    memcpy(a + 1022, u, 3); // 跨越第一个叶子的结尾
+    a[1500] = '\n';
+    lang_assert(rope_from(&r, a, 2000) && rope_runes(&r) == 1998);
+    lang_assert(rope_rune_start(&r, 1022) == 1022 && rope_rune_start(&r, 1023) == 1025);
+    rope_line_col(&r, 1600, &line, &col);
+    lang_assert(line == 1 && col == 99);
+    rope_line_col(&r, 1400, &line, &col);
+    lang_assert(line == 0 && col == 1398);
+    rope_iter_init(&it, &r, 1020);
+    for (i = 0; rope_iter_get(&it) != CHAR_EOF; i += 1) {
+        if (i == 4) {
+            rope_iter_unget(&it); // 在第二个叶子中回退
+            lang_assert(rope_iter_get(&it) == 0xad);
+        }
+    }
+    rope_iter_unget(&it);
+    lang_assert(i == 980 && rope_iter_get(&it) == CHAR_EOF);
+    lang_assert(rope_substr(&r, 1000, 30, &s) && rope_copy(&s, 0, b, 100) == 30 && !memcmp(b, a + 1000, 30));
+    lang_assert(rope_append(&r, &s) && rope_len(&r) == 2030 && rope_len(&s) == 30);
+    rope_free(&r);
+    rope_free(&s);
+}
+
+static void test_queue(void)
+{
+    mpmc_t q;
+    lqueue_t l;
+    uint32 i, v;
+    lang_assert(mpmc_init(&q, 5, sizeof(uint32)) && q.mask == 7);
+    for (i = 0; i < 8; i += 1) {
+        lang_assert(mpmc_push(&q, &i));
+    }
+    lang_assert(!mpmc_push(&q, &i)); // 队列满
+    for (i = 0; i < 20; i += 1) { // 多次绕过环形缓存的末尾
+        lang_assert(mpmc_pop(&q, &v) && v == i && mpmc_push(&q, (v = i + 8, &v)));
+    }
+    for (i = 20; i < 28; i += 1) {
+        lang_assert(mpmc_pop(&q, &v) && v == i);
+    }
+    lang_assert(!mpmc_pop(&q, &v));
+    mpmc_free(&q);
+    lang_assert(lqueue_init(&l, sizeof(uint32)));
+    lang_assert(!lqueue_pop(&l, &v));
+    for (i = 0; i < 1000; i += 1) {
+        lang_assert(lqueue_push(&l, &i));
+        if (i & 1) {
+            lang_assert(lqueue_pop(&l, &v) && v == i / 2);
+        }
+    }
+    for (i = 500; i < 1000; i += 1) {
+        lang_assert(lqueue_pop(&l, &v) && v == i);
+    }
+    lang_assert(!lqueue_pop(&l, &v));
+    lqueue_free(&l);
+}
+
+static void test_binlog(void)
+{
+    const char *name = "test_binlog.bin";
+    char line[256];
+    FILE *f, *out;
+    uint32 n = 0;
+    lang_assert(binlog_start(name) && !binlog_start(name));
+    logtrace_(ERROR, X_FILE(ERROR), LOG_LEVEL_E | 12);
+    logtracex_(builtin_error(ERROR_OUT_OF_MEMORY), X_FILE(0), (2 << 27) | LOG_LEVEL_I | 34, 0xab, 0xcd);
+    lang_assert(binlog_stop());
+    lang_assert(logsink_g == null && (f = fopen(name, "rb")) && (out = tmpfile()));
+    lang_assert(binlog_decode(f, out));
+    rewind(out);
+    while (fgets(line, sizeof(line), out)) {
+        n += 1;
+        lang_assert(strstr(line, (n == 1) ? "[E] test/decl#0012 ERROR" : "[I] test/decl#0034 OUT OF MEMORY: ab cd"));
+    }
+    lang_assert(n == 2);
+    fclose(out);
+    fclose(f);
+    remove(name);
+#if defined(__OS_LINUX__)
+    lang_assert(binlog_start("/dev/full")); // 写入失败，停止时报告
+    logtrace_(ERROR, X_FILE(ERROR), LOG_LEVEL_E | 12);
+    lang_assert(!binlog_stop() && logsink_g == null);
+#endif
+}
+
+static uint32 test_log_count;
+
+static void test_log_sink(errot err, uint32 file_err, uint32 argn_line, const uint32 *args)
+{
+    test_log_count += 1;
+}
+
+static void test_loglevel(void)
+{
+    const char *name = "test_loglevel.txt";
+    uint32 n = 0, i;
+    FILE *f;
+    logsink_g = test_log_sink;
+    lang_assert(log_level_set(null) && log_levels_g[STRID_TEST_DECL] == 0 && log_levels_g[STRID_CHCC_CIFA] == 4);
+    log_info_1(ERROR, n++); // 没有开启，参数不会被求值
+    lang_assert(test_log_count == 0 && n == 0);
+    lang_assert(log_level_set("chcc/cifa=e test/decl=I"));
+    lang_assert(log_levels_g[STRID_CHCC_CIFA] == 2 && log_levels_g[STRID_CHCC_GLINK] == 4);
+    log_info_1(ERROR, n++);
+    log_error(ERROR);
+    lang_assert(test_log_count == 2 && n == 1);
+    lang_assert(!log_level_set("test/decl=E, chcc/none=D; chcc/jit=X *"));
+    log_info(ERROR);
+    log_main(ERROR);
+    lang_assert(test_log_count == 3 && log_levels_g[STRID_CHCC_CIFA] == 4);
+    lang_assert(log_level_set("*=F") && log_levels_g[STRID_CHCC_GLINK] == 0);
+    lang_assert((f = fopen(name, "wb")) && fputs("test/decl=D\n", f) >= 0 && !fclose(f));
+    lang_assert(log_level_watch(name, 5) && !log_level_watch(name, 5));
+    lang_assert(log_levels_g[STRID_TEST_DECL] == 4 && log_levels_g[STRID_CHCC_GLINK] == 4);
+    lang_assert((f = fopen(name, "wb")) && fputs("test/decl=M", f) >= 0 && !fclose(f));
+    for (i = 0; i < 200 && LOG_LEVEL_LOAD(STRID_TEST_DECL) != 1; i += 1) {
+        thread_sleep(5);
+    }
+    lang_assert(LOG_LEVEL_LOAD(STRID_TEST_DECL) == 1);
+    log_level_unwatch();
+    remove(name);
+    log_level_set(null);
+    logsink_g = null;
+}
+
+static void test_trace_task(void *para, uint32 worker, uint32 task)
+{
+    trace_begin("task");
+    trace_end("task");
+}
+
+static void test_trace(void)
+{
+    const char *name = "test_trace.json";
+    char line[512];
+    uint32 nbegin = 0, nend = 0, nthread = 0, nescape = 0;
+    FILE *f;
+    trace_begin("off"); // 没有开启，不记录
+    trace_start();
+    trace_begin("outer");
+    trace_begin("in\"ner");
+    trace_end("in\"ner");
+    lang_assert(thread_for(2, 4, test_trace_task, null));
+    trace_end("outer");
+    trace_stop();
+    trace_end("off");
+    lang_assert(trace_export(name) && (f = fopen(name, "rb")));
+    while (fgets(line, sizeof(line), f)) {
+        lang_assert(!strstr(line, "\"off\""));
+        if (strstr(line, "\"thread_name\"")) {
+            nthread += 1;
+            continue;
+        }
+        if (!strstr(line, "\"ph\":")) {
+            continue;
+        }
+        lang_assert(strstr(line, "\"cat\":\"test/decl\""));
+        nbegin += (strstr(line, "\"ph\":\"B\"") != null);
+        nend += (strstr(line, "\"ph\":\"E\"") != null);
+        nescape += (strstr(line, "\"name\":\"in\\\"ner\"") != null); // 名称中的引号被转义
+    }
+    lang_assert(nbegin == 6 && nend == 6 && nescape == 2 && nthread >= 1);
+    fclose(f);
+    remove(name);
+    trace_free();
+}
 
 void test_decl(void)
 {
     lang_assert(null == 0);
     lang_assert(ERROR == 1);
     lang_assert(BUILTIN_LAST_ERROR & 1);
+    test_region();
+    test_pool();
+    test_buffer();
+    test_smap();
+    test_deque();
+    test_rope();
+    test_queue();
+    test_binlog();
+    test_loglevel();
+    test_trace();
 }
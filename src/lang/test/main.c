@@ -1,11 +1,44 @@
 #include "internal/decl.h"
+#include "direct/trace.h"
+#include "chcc/chcc.h"
 void test_decl(void);
 void test_chcc(void);
 
+static int compile(const char *src, const char *obj) // -c obj src 编译源文件生成目标文件
+{
+    const char *dir = getenv("CHAPL_OBJCACHE"); // 设置时使用这个目录作为目标文件缓存
+    objcache_t cache;
+    chcc_t cc;
+    bool succ;
+    chccinit(&cc);
+    if (dir && objcache_open(&cache, dir, 0)) {
+        cc.ocache = &cache;
+    }
+    succ = chccobj(&cc, src, obj);
+    if (cc.ocache) {
+        objcache_close(&cache);
+    }
+    chccfree(&cc);
+    return succ ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
+    const char *trace = getenv("CHAPL_TRACE"); // 设置时把编译过程的跟踪事件导出到这个文件
+    log_level_init();
+    if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+        return compile(argv[3], argv[2]);
+    }
     test_decl();
+    if (trace) {
+        trace_start();
+    }
     test_chcc();
+    if (trace) {
+        trace_stop();
+        trace_export(trace);
+        trace_free();
+    }
     printf("TEST PASS\n");
     return 0;
 }